@@ -8,8 +8,57 @@ from winhelpers import run_windows_program
 SCRIPTS_DIR = Path(__file__).parent
 
 
-def build(build_type, verbose=False, jobs=1, target=None):
-    configure(build_type)
+def build(
+    build_type,
+    verbose=False,
+    jobs=1,
+    target=None,
+    compact_anm_vm=False,
+    pipelined_draw=False,
+    track_allocs=False,
+    batch_bullet_collision=False,
+    predecoded_ecl=False,
+    batch_sprites=False,
+    d3d_state_cache=False,
+    chain_profiler=False,
+    text_glyph_atlas=False,
+    pixel_kernels=False,
+    bgm_read_ahead=False,
+    zun_arenas=False,
+    player_bullet_grid=False,
+    anm_idle_skip=False,
+    predecoded_anm=False,
+    software_renderer=False,
+    perf_overlay=False,
+    sound_mixer=False,
+    midi_timeline=False,
+    asset_trace=False,
+    fixed_step=False,
+):
+    configure(
+        build_type,
+        compact_anm_vm,
+        pipelined_draw,
+        track_allocs,
+        batch_bullet_collision,
+        predecoded_ecl,
+        batch_sprites,
+        d3d_state_cache,
+        chain_profiler,
+        text_glyph_atlas,
+        pixel_kernels,
+        bgm_read_ahead,
+        zun_arenas,
+        player_bullet_grid,
+        anm_idle_skip,
+        predecoded_anm,
+        software_renderer,
+        perf_overlay,
+        sound_mixer,
+        midi_timeline,
+        asset_trace,
+        fixed_step,
+    )
 
     ninja_args = []
     if verbose:
@@ -65,6 +114,155 @@ def main():
             See https://github.com/happyhavoc/th06/issues/79 for more information."""),
     )
     parser.add_argument("--verbose", action="store_true")
+    parser.add_argument(
+        "--compact-anm-vm",
+        action="store_true",
+        help=textwrap.dedent("""
+            Build AnmVm without its full sprite matrix, shrinking every VM by 0x38 bytes.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--pipelined-draw",
+        action="store_true",
+        help=textwrap.dedent("""
+            Record each frame's draw calls and submit them from a render thread while the next frame's calc runs.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--track-allocs",
+        action="store_true",
+        help=textwrap.dedent("""
+            Tag every allocation, and append what's live per tag and what earlier scenes left behind to memtrack.log
+            at each scene change. Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--batch-bullet-collision",
+        action="store_true",
+        help=textwrap.dedent("""
+            Move all fired bullets first, then check their hitboxes against the player in one SSE batch.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--predecoded-ecl",
+        action="store_true",
+        help=textwrap.dedent("""
+            Decode ECL subs when a stage loads, and run their math, compare and jump instructions through a handler
+            table. Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--batch-sprites",
+        action="store_true",
+        help=textwrap.dedent("""
+            Build bullet sprites into one vertex array per frame and submit them in as few indexed draws as their
+            textures and render states allow. Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--d3d-state-cache",
+        action="store_true",
+        help=textwrap.dedent("""
+            Send render states, texture stage states, textures and vertex shaders through a shadow of the device
+            state that drops the calls setting a value the device already holds. Not available for builds that must
+            match the original binary."""),
+    )
+    parser.add_argument(
+        "--chain-profiler",
+        action="store_true",
+        help=textwrap.dedent("""
+            Time every calc and draw chain callback, for -chaintrace to export as a Chrome trace.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--text-glyph-atlas",
+        action="store_true",
+        help=textwrap.dedent("""
+            Build text from a cache of glyphs GDI rasterizes once, instead of drawing every string through GDI.
+            Edge pixels differ slightly from GDI's. Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--pixel-kernels",
+        action="store_true",
+        help=textwrap.dedent("""
+            Run the alpha texture merge and the text alpha invert through SSE2 kernels. The output is the same.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--bgm-read-ahead",
+        action="store_true",
+        help=textwrap.dedent("""
+            Stream the DirectSound BGM through the same read-ahead ring as -swmixer, filled by its own thread.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--zun-arenas",
+        action="store_true",
+        help=textwrap.dedent("""
+            Load stage scripts, data and anm files into arenas that are reset between stages and games, instead of
+            one heap allocation each. Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--player-bullet-grid",
+        action="store_true",
+        help=textwrap.dedent("""
+            Bucket the player's bullets into a grid so enemies only test the nearby ones.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--anm-idle-skip",
+        action="store_true",
+        help=textwrap.dedent("""
+            Let anm VMs waiting on their next instruction with nothing to interpolate skip the script and the
+            interpolation blocks. Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--predecoded-anm",
+        action="store_true",
+        help=textwrap.dedent("""
+            Check every anm script when it is loaded and resolve its jumps to absolute addresses ahead of time.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--software-renderer",
+        action="store_true",
+        help=textwrap.dedent("""
+            Add the -swrender switch, which draws on the CPU and dumps every frame to frames.y4m.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--perf-overlay",
+        action="store_true",
+        help=textwrap.dedent("""
+            Time calc, draw and present every frame, for the -perfoverlay graph and the -perfcsv log.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--sound-mixer",
+        action="store_true",
+        help=textwrap.dedent("""
+            Add the -swmixer, -audiowav and -audionull switches, which mix every sound on the CPU.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--midi-timeline",
+        action="store_true",
+        help=textwrap.dedent("""
+            Add the -miditimeline switch, which plays MIDI music from a timeline built when the file is loaded.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--asset-trace",
+        action="store_true",
+        help=textwrap.dedent("""
+            Add the -assettrace switch, which logs every asset load per scene, and the -preload switch, which reads
+            ahead what preload.txt lists for each scene.
+            Not available for builds that must match the original binary."""),
+    )
+    parser.add_argument(
+        "--fixed-step",
+        action="store_true",
+        help=textwrap.dedent("""
+            Add the -fixedstep switch, which runs calc steps off a fixed 60Hz clock however often frames get presented.
+            Not available for builds that must match the original binary."""),
+    )
     parser.add_argument("--object-name", required=False)
     parser.add_argument(
         "target",
@@ -100,7 +298,82 @@ def main():
     elif args.target is not None:
         target = args.target
 
-    build(build_type, args.verbose, args.jobs, target=target)
+    if args.compact_anm_vm and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--compact-anm-vm only applies to normal and tests builds")
+    if args.pipelined_draw and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--pipelined-draw only applies to normal and tests builds")
+    if args.track_allocs and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--track-allocs only applies to normal and tests builds")
+    if args.batch_bullet_collision and build_type not in [
+        BuildType.NORMAL,
+        BuildType.TESTS,
+    ]:
+        parser.error("--batch-bullet-collision only applies to normal and tests builds")
+    if args.predecoded_ecl and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--predecoded-ecl only applies to normal and tests builds")
+    if args.batch_sprites and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--batch-sprites only applies to normal and tests builds")
+    if args.d3d_state_cache and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--d3d-state-cache only applies to normal and tests builds")
+    if args.chain_profiler and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--chain-profiler only applies to normal and tests builds")
+    if args.text_glyph_atlas and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--text-glyph-atlas only applies to normal and tests builds")
+    if args.pixel_kernels and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--pixel-kernels only applies to normal and tests builds")
+    if args.bgm_read_ahead and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--bgm-read-ahead only applies to normal and tests builds")
+    if args.zun_arenas and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--zun-arenas only applies to normal and tests builds")
+    if args.player_bullet_grid and build_type not in [
+        BuildType.NORMAL,
+        BuildType.TESTS,
+    ]:
+        parser.error("--player-bullet-grid only applies to normal and tests builds")
+    if args.anm_idle_skip and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--anm-idle-skip only applies to normal and tests builds")
+    if args.predecoded_anm and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--predecoded-anm only applies to normal and tests builds")
+    if args.software_renderer and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--software-renderer only applies to normal and tests builds")
+    if args.perf_overlay and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--perf-overlay only applies to normal and tests builds")
+    if args.sound_mixer and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--sound-mixer only applies to normal and tests builds")
+    if args.midi_timeline and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--midi-timeline only applies to normal and tests builds")
+    if args.asset_trace and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--asset-trace only applies to normal and tests builds")
+    if args.fixed_step and build_type not in [BuildType.NORMAL, BuildType.TESTS]:
+        parser.error("--fixed-step only applies to normal and tests builds")
+
+    build(
+        build_type,
+        args.verbose,
+        args.jobs,
+        target=target,
+        compact_anm_vm=args.compact_anm_vm,
+        pipelined_draw=args.pipelined_draw,
+        track_allocs=args.track_allocs,
+        batch_bullet_collision=args.batch_bullet_collision,
+        predecoded_ecl=args.predecoded_ecl,
+        batch_sprites=args.batch_sprites,
+        d3d_state_cache=args.d3d_state_cache,
+        chain_profiler=args.chain_profiler,
+        text_glyph_atlas=args.text_glyph_atlas,
+        pixel_kernels=args.pixel_kernels,
+        bgm_read_ahead=args.bgm_read_ahead,
+        zun_arenas=args.zun_arenas,
+        player_bullet_grid=args.player_bullet_grid,
+        anm_idle_skip=args.anm_idle_skip,
+        predecoded_anm=args.predecoded_anm,
+        software_renderer=args.software_renderer,
+        perf_overlay=args.perf_overlay,
+        sound_mixer=args.sound_mixer,
+        midi_timeline=args.midi_timeline,
+        asset_trace=args.asset_trace,
+        fixed_step=args.fixed_step,
+    )
 
 
 if __name__ == "__main__":
@@ -0,0 +1,79 @@
+import argparse
+import csv
+import sys
+
+parser = argparse.ArgumentParser(
+    prog="build_preload_manifest",
+    description="Turn asset traces written with -assettrace into the preload.txt that -preload reads ahead from.",
+)
+parser.add_argument(
+    "-o", "--output", action="store", default="preload.txt", help="Manifest to write"
+)
+parser.add_argument(
+    "--min-us",
+    action="store",
+    type=int,
+    default=0,
+    help="Leave out files that never took this long to read and decode",
+)
+parser.add_argument("input", nargs="+", help="assettrace.csv files, one per run")
+args = parser.parse_args()
+
+# The order AssetTrace numbers its scenes in. Anything opened at boot is before the manifest is loaded.
+SCENES = [
+    "title",
+    "stage1",
+    "stage2",
+    "stage3",
+    "stage4",
+    "stage5",
+    "stage6",
+    "stage7",
+    "result",
+    "musicroom",
+    "ending",
+]
+
+# For each scene and path: how many runs opened it, the sum of where in the scene's order it came, and the longest
+# it took.
+scenes = {}
+for trace in args.input:
+    with open(trace, newline="") as f:
+        seen = {}
+        for row in csv.DictReader(f):
+            # Only archive entries are worth reading ahead; loose files are read as they are.
+            if row["kind"] != "file" or int(row["archive"]) < 0:
+                continue
+            scene_seen = seen.setdefault(row["scene"], [])
+            if row["path"] in scene_seen:
+                continue
+            scene_seen.append(row["path"])
+            # A file that was read ahead only shows how long the hand over took, so keep it in.
+            micros = args.min_us if row["preloaded"] == "1" else int(row["us"])
+            paths = scenes.setdefault(row["scene"], {})
+            stats = paths.setdefault(row["path"], [0, 0.0, 0])
+            stats[0] += 1
+            stats[1] += len(scene_seen) - 1
+            stats[2] = max(stats[2], micros)
+
+with open(args.output, "w", newline="\n") as f:
+    print(
+        "# Made by scripts/build_preload_manifest.py from %d trace(s)."
+        % len(args.input),
+        file=f,
+    )
+    for scene in SCENES:
+        paths = scenes.get(scene)
+        if not paths:
+            continue
+        print("[%s]" % scene, file=f)
+        ordered = sorted(
+            paths.items(), key=lambda item: (item[1][1] / item[1][0], item[0])
+        )
+        for path, stats in ordered:
+            if stats[2] >= args.min_us:
+                print(path, file=f)
+
+unknown = set(scenes) - set(SCENES) - set(["boot"])
+if unknown:
+    print("WARNING: skipped scenes " + ", ".join(sorted(unknown)), file=sys.stderr)
@@ -16,7 +16,30 @@ class BuildType(Enum):
     BINARY_MATCHBUILD = 6
 
 
-def configure(build_type):
+def configure(
+    build_type,
+    compact_anm_vm=False,
+    pipelined_draw=False,
+    track_allocs=False,
+    batch_bullet_collision=False,
+    predecoded_ecl=False,
+    batch_sprites=False,
+    d3d_state_cache=False,
+    chain_profiler=False,
+    text_glyph_atlas=False,
+    pixel_kernels=False,
+    bgm_read_ahead=False,
+    zun_arenas=False,
+    player_bullet_grid=False,
+    anm_idle_skip=False,
+    predecoded_anm=False,
+    software_renderer=False,
+    perf_overlay=False,
+    sound_mixer=False,
+    midi_timeline=False,
+    asset_trace=False,
+    fixed_step=False,
+):
     with (SCRIPTS_DIR.parent / "build.ninja").open("w") as f:
         writer = Writer(f, width=120)
         writer.variable("ninja_required_version", "1.5")
@@ -29,6 +52,48 @@ def configure(build_type):
             cl_common_flags += " /DDIFFBUILD"
         if build_type == BuildType.BINARY_MATCHBUILD:
             cl_common_flags += " /DDBINARYMATCHBUILD"
+        if compact_anm_vm:
+            cl_common_flags += " /DANM_VM_COMPACT"
+        if pipelined_draw:
+            cl_common_flags += " /DPIPELINED_DRAW"
+        if track_allocs:
+            cl_common_flags += " /DZUN_MEMORY_TRACKING"
+        if batch_bullet_collision:
+            cl_common_flags += " /DBATCHED_BULLET_COLLISION"
+        if predecoded_ecl:
+            cl_common_flags += " /DPREDECODED_ECL"
+        if batch_sprites:
+            cl_common_flags += " /DBATCHED_SPRITES"
+        if d3d_state_cache:
+            cl_common_flags += " /DD3D_STATE_CACHE"
+        if chain_profiler:
+            cl_common_flags += " /DCHAIN_PROFILER"
+        if text_glyph_atlas:
+            cl_common_flags += " /DTEXT_GLYPH_ATLAS"
+        if pixel_kernels:
+            cl_common_flags += " /DPIXEL_KERNELS"
+        if bgm_read_ahead:
+            cl_common_flags += " /DBGM_READ_AHEAD"
+        if zun_arenas:
+            cl_common_flags += " /DZUN_ARENAS"
+        if player_bullet_grid:
+            cl_common_flags += " /DPLAYER_BULLET_GRID"
+        if anm_idle_skip:
+            cl_common_flags += " /DANM_IDLE_SKIP"
+        if predecoded_anm:
+            cl_common_flags += " /DPREDECODED_ANM"
+        if software_renderer:
+            cl_common_flags += " /DSOFTWARE_RENDERER"
+        if perf_overlay:
+            cl_common_flags += " /DPERF_OVERLAY"
+        if sound_mixer:
+            cl_common_flags += " /DSOUND_MIXER"
+        if midi_timeline:
+            cl_common_flags += " /DMIDI_TIMELINE"
+        if asset_trace:
+            cl_common_flags += " /DASSET_TRACE"
+        if fixed_step:
+            cl_common_flags += " /DFIXED_STEP"
         writer.variable("cl_common_flags", cl_common_flags)
         writer.variable("cl_flags", "$cl_common_flags /Od /Oi /Ob1 /Op /Gy")
         writer.variable("cl_flags_small_codegen", "$cl_flags /Os")
@@ -119,6 +184,21 @@ def configure(build_type):
             "zwave",
             "BulletData",
             "ZunTimer",
+            "D3dStateCache",
+            "RecordingD3dDevice",
+            "SoftwareD3dDevice",
+            "PipelinedD3dDevice",
+            "ChainProfiler",
+            "PerfStats",
+            "PixelKernels",
+            "SoundMixer",
+            "BgmStream",
+            "MidiTimeline",
+            "PcmAsset",
+            "AssetTrace",
+            "AssetPreload",
+            "ZunMemory",
+            "FixedStep",
         ]
 
         small_codegen_sources = set(
@@ -144,7 +224,25 @@ def configure(build_type):
 
         test_sources = [
             "tests",
+            "test_AnmManager",
+            "test_EclManager",
             "test_Pbg3Archive",
+            "test_PlayerBulletGrid",
+            "test_RecordingD3dDevice",
+            "test_SoftwareD3dDevice",
+            "test_PipelinedD3dDevice",
+            "test_ChainProfiler",
+            "test_PerfStats",
+            "test_TextHelper",
+            "test_PixelKernels",
+            "test_SoundMixer",
+            "test_BgmStream",
+            "test_MidiTimeline",
+            "test_PcmAsset",
+            "test_AssetTrace",
+            "test_ZunMemory",
+            "test_FixedStep",
+            "test_D3dStateCache",
         ]
 
         detours_sources = [
@@ -1,12 +1,18 @@
 #include "AnmManager.hpp"
+#include "AssetTrace.hpp"
+#include "D3dStateCache.hpp"
 #include "FileSystem.hpp"
 #include "GameErrorContext.hpp"
 #include "Rng.hpp"
 #include "Supervisor.hpp"
 #include "TextHelper.hpp"
 #include "ZunMath.hpp"
+#include "ZunMemory.hpp"
 #include "i18n.hpp"
 #include "utils.hpp"
+#ifdef PIXEL_KERNELS
+#include "PixelKernels.hpp"
+#endif
 
 #include <stdio.h>
 
@@ -16,6 +22,14 @@ DIFFABLE_STATIC(VertexTex1Xyzrwh, g_PrimitivesToDrawVertexBuf[4]);
 DIFFABLE_STATIC(VertexTex1DiffuseXyzrwh, g_PrimitivesToDrawNoVertexBuf[4]);
 DIFFABLE_STATIC(VertexTex1DiffuseXyz, g_PrimitivesToDrawUnknown[4]);
 DIFFABLE_STATIC(AnmManager *, g_AnmManager)
+#ifdef BATCHED_SPRITES
+// Two triangles per quad, in the winding of the strips Draw submits.
+DIFFABLE_STATIC_ARRAY(u16, ANM_SPRITE_BATCH_MAX_QUADS * 6, g_SpriteBatchIndices)
+DIFFABLE_STATIC_ARRAY(u16, ANM_SPRITE_BATCH_MAX_QUADS, g_SpriteBatchOrder)
+DIFFABLE_STATIC_ARRAY(u16, ANM_SPRITE_BATCH_MAX_QUADS, g_SpriteBatchOrderScratch)
+DIFFABLE_STATIC_ARRAY(AnmVm *, ANM_SPRITE_BATCH_MAX_QUADS, g_SpriteBatchVmScratch)
+DIFFABLE_STATIC_ARRAY(VertexTex1DiffuseXyzrwh, ANM_SPRITE_BATCH_MAX_QUADS * 4, g_SpriteBatchVertexScratch)
+#endif
 
 #ifndef DIFFBUILD
 D3DFORMAT g_TextureFormatD3D8Mapping[6] = {
@@ -55,6 +69,10 @@ void AnmManager::TakeScreenshotIfRequested()
 
 AnmManager::AnmManager()
 {
+#ifdef BATCHED_SPRITES
+    i32 idx;
+
+#endif
     this->maybeLoadedSpriteCount = 0;
 
     memset(this, 0, sizeof(AnmManager));
@@ -98,6 +116,18 @@ AnmManager::AnmManager()
     this->currentVertexShader = 0;
     this->currentZWriteDisable = 0;
     this->screenshotTextureId = -1;
+
+#ifdef BATCHED_SPRITES
+    for (idx = 0; idx < ANM_SPRITE_BATCH_MAX_QUADS; idx++)
+    {
+        g_SpriteBatchIndices[idx * 6 + 0] = idx * 4 + 0;
+        g_SpriteBatchIndices[idx * 6 + 1] = idx * 4 + 1;
+        g_SpriteBatchIndices[idx * 6 + 2] = idx * 4 + 2;
+        g_SpriteBatchIndices[idx * 6 + 3] = idx * 4 + 2;
+        g_SpriteBatchIndices[idx * 6 + 4] = idx * 4 + 1;
+        g_SpriteBatchIndices[idx * 6 + 5] = idx * 4 + 3;
+    }
+#endif
 }
 
 void AnmManager::SetupVertexBuffer()
@@ -157,6 +187,8 @@ void AnmManager::SetupVertexBuffer()
 
 ZunResult AnmManager::LoadTexture(i32 textureIdx, char *textureName, i32 textureFormat, D3DCOLOR colorKey)
 {
+    ASSET_TRACE_SCOPE(AssetTraceKind_Texture, textureName);
+
     ReleaseTexture(textureIdx);
     this->imageDataArray[textureIdx] = FileSystem::OpenPath(textureName, 0);
 
@@ -189,10 +221,13 @@ ZunResult AnmManager::LoadTexture(i32 textureIdx, char *textureName, i32 texture
     return ZUN_SUCCESS;
 }
 
+#ifndef PIXEL_KERNELS
 #pragma var_order(surfaceDesc, data, lockedRectDst, lockedRectSrc, textureSrc, dstData0, srcData0, y0, x0, dstData1,   \
                   srcData1, y1, x1, dstData2, srcData2, y2, x2)
+#endif
 ZunResult AnmManager::LoadTextureAlphaChannel(i32 textureIdx, char *textureName, i32 textureFormat, D3DCOLOR colorKey)
 {
+#ifndef PIXEL_KERNELS
     struct Argb1555Pixel
     {
         u16 b : 5;
@@ -209,11 +244,13 @@ ZunResult AnmManager::LoadTextureAlphaChannel(i32 textureIdx, char *textureName,
         u16 a : 4;
     };
 
+#endif
     IDirect3DTexture8 *textureSrc;
     D3DSURFACE_DESC surfaceDesc;
     D3DLOCKED_RECT lockedRectDst;
     D3DLOCKED_RECT lockedRectSrc;
     u8 *data;
+#ifndef PIXEL_KERNELS
 
     u8 *dstData0;
     u8 *srcData0;
@@ -227,6 +264,7 @@ ZunResult AnmManager::LoadTextureAlphaChannel(i32 textureIdx, char *textureName,
     Argb4444Pixel *srcData2;
     i32 y2;
     i32 x2;
+#endif
 
     textureSrc = NULL;
     data = FileSystem::OpenPath(textureName, 0);
@@ -260,6 +298,10 @@ ZunResult AnmManager::LoadTextureAlphaChannel(i32 textureIdx, char *textureName,
 
     // Copy over the alpha channel from the source to the destination, taking
     // into account the texture format.
+#ifdef PIXEL_KERNELS
+    PixelKernels::MergeAlpha(surfaceDesc.Format, (u8 *)lockedRectDst.pBits, lockedRectDst.Pitch,
+                             (u8 *)lockedRectSrc.pBits, lockedRectSrc.Pitch, surfaceDesc.Width, surfaceDesc.Height);
+#else
     switch (surfaceDesc.Format)
     {
     case D3DFMT_A8R8G8B8:
@@ -302,6 +344,7 @@ ZunResult AnmManager::LoadTextureAlphaChannel(i32 textureIdx, char *textureName,
         }
         break;
     }
+#endif
 
     textureSrc->UnlockRect(0);
     this->textures[textureIdx]->UnlockRect(0);
@@ -312,7 +355,7 @@ ZunResult AnmManager::LoadTextureAlphaChannel(i32 textureIdx, char *textureName,
         textureSrc = NULL;
     }
 
-    free(data);
+    ZunFree(data);
     return ZUN_SUCCESS;
 
 err:
@@ -322,7 +365,7 @@ err:
         textureSrc = NULL;
     }
 
-    free(data);
+    ZunFree(data);
     return ZUN_ERROR;
 }
 
@@ -334,11 +377,251 @@ ZunResult AnmManager::CreateEmptyTexture(i32 textureIdx, u32 width, u32 height,
     return ZUN_SUCCESS;
 }
 
+#ifdef PREDECODED_ANM
+static AnmRawInstr *NextAnmInstr(AnmRawInstr *instr)
+{
+    return (AnmRawInstr *)((u8 *)instr->args + instr->argsCount);
+}
+
+static ZunBool IsAnmTerminator(u8 opcode)
+{
+    return opcode == AnmOpcode_Exit || opcode == AnmOpcode_ExitHide || opcode == AnmOpcode_Jump ||
+           opcode == AnmOpcode_Stop || opcode == AnmOpcode_StopHide;
+}
+
+static u32 ClosestOffsetAfter(u32 end, u32 start, u32 offset)
+{
+    return offset > start && offset < end ? offset : end;
+}
+
+// Scripts carry no length, so a script is taken to run up to whatever starts next in the file: another script, a
+// sprite, one of the texture names or the embedded texture.
+static u8 *FindAnmScriptEnd(AnmRawEntry *anm, u32 fileSize, u32 scriptOffset)
+{
+    u32 end;
+    u32 *offset;
+    i32 idx;
+
+    end = ClosestOffsetAfter(fileSize, scriptOffset, anm->nameOffset);
+    end = ClosestOffsetAfter(end, scriptOffset, anm->mipmapNameOffset);
+    end = ClosestOffsetAfter(end, scriptOffset, anm->textureOffset);
+    offset = anm->spriteOffsets;
+    for (idx = 0; idx < anm->numSprites; idx++, offset++)
+    {
+        end = ClosestOffsetAfter(end, scriptOffset, *offset);
+    }
+    for (idx = 0; idx < anm->numScripts; idx++, offset += 2)
+    {
+        end = ClosestOffsetAfter(end, scriptOffset, offset[1]);
+    }
+    return (u8 *)anm + end;
+}
+
+static ZunBool IsAnmInstrBoundary(AnmRawInstr *script, u8 *end, u32 targetOffset)
+{
+    AnmRawInstr *instr;
+    u8 *target;
+
+    if (targetOffset >= (u32)(end - (u8 *)script))
+    {
+        return false;
+    }
+    target = (u8 *)script + targetOffset;
+    for (instr = script; (u8 *)instr < target && (u8 *)instr->args <= end; instr = NextAnmInstr(instr))
+    {
+    }
+    return (u8 *)instr == target;
+}
+
+// Walks a script up to its end, checking that every instruction, jump target and sprite it refers to is in range.
+// Leftover bytes that can't hold an instruction are accepted as padding once the script has ended on a terminator.
+// Sets fallsThrough if the last instruction lets execution run on into whatever follows the script.
+static ZunResult ValidateAnmScript(AnmRawInstr *script, u8 *end, i32 spriteIdxOffset, ZunBool *fallsThrough)
+{
+    AnmRawInstr *instr;
+    u32 maxSprite;
+    u8 lastOpcode;
+
+    maxSprite = ARRAY_SIZE(g_AnmManager->sprites) - spriteIdxOffset;
+    lastOpcode = AnmOpcode_Nop;
+    for (instr = script; (u8 *)instr < end; instr = NextAnmInstr(instr))
+    {
+        if ((u8 *)instr->args > end || (u8 *)NextAnmInstr(instr) > end)
+        {
+            if (IsAnmTerminator(lastOpcode))
+            {
+                break;
+            }
+            return ZUN_ERROR;
+        }
+        switch (instr->opcode)
+        {
+        case AnmOpcode_Jump:
+            if (instr->argsCount < 4 || !IsAnmInstrBoundary(script, end, instr->args[0]))
+            {
+                return ZUN_ERROR;
+            }
+            break;
+        case AnmOpcode_SetActiveSprite:
+            if (instr->argsCount < 4 || instr->args[0] >= maxSprite)
+            {
+                return ZUN_ERROR;
+            }
+            break;
+        case AnmOpcode_SetRandomSprite:
+            if (instr->argsCount < 8 || instr->args[0] >= maxSprite ||
+                (u16)instr->args[1] > maxSprite - instr->args[0])
+            {
+                return ZUN_ERROR;
+            }
+            break;
+        }
+        lastOpcode = instr->opcode;
+    }
+    *fallsThrough = !IsAnmTerminator(lastOpcode);
+    return ZUN_SUCCESS;
+}
+
+static void ResolveAnmJumps(AnmRawInstr *script, u8 *end)
+{
+    AnmRawInstr *instr;
+
+    for (instr = script; (u8 *)instr->args <= end && (u8 *)NextAnmInstr(instr) <= end; instr = NextAnmInstr(instr))
+    {
+        if (instr->opcode == AnmOpcode_Jump)
+        {
+            instr->opcode = AnmOpcode_JumpResolved;
+            instr->args[0] = (u32)((u8 *)script + instr->args[0]);
+        }
+    }
+}
+
+// Rejects files whose tables, sprites or scripts point outside of them, and rewrites the jumps of every script that
+// checks out into an AnmOpcode_JumpResolved carrying the absolute address of its target. Jumps are relative to the
+// start of the script the VM was started on, so a script that another one can run on into keeps its jumps for
+// ExecuteScript to resolve as before.
+ZunResult AnmManager::PredecodeScripts(AnmRawEntry *anm, u32 fileSize, i32 spriteIdxOffset)
+{
+    u32 *offset;
+    u32 *scriptOffsets;
+    u32 *otherOffset;
+    u32 tableStart;
+    u32 endOffset;
+    AnmRawSprite *rawSprite;
+    AnmRawInstr *script;
+    i32 idx;
+    i32 otherIdx;
+    ZunBool fallsThrough;
+    ZunResult result;
+    u32 runOnInto[ARRAY_SIZE(g_AnmManager->scripts) / 32];
+
+    tableStart = (u8 *)anm->spriteOffsets - (u8 *)anm;
+    if (fileSize < tableStart || anm->numSprites < 0 || anm->numScripts < 0 || spriteIdxOffset < 0 ||
+        (u32)anm->numSprites + (u32)anm->numScripts * 2 > (fileSize - tableStart) / sizeof(u32) ||
+        anm->nameOffset >= fileSize)
+    {
+        return ZUN_ERROR;
+    }
+
+    offset = anm->spriteOffsets;
+    for (idx = 0; idx < anm->numSprites; idx++, offset++)
+    {
+        rawSprite = (AnmRawSprite *)((u8 *)anm + *offset);
+        if (*offset > fileSize - sizeof(AnmRawSprite) ||
+            rawSprite->id >= ARRAY_SIZE(g_AnmManager->sprites) - spriteIdxOffset)
+        {
+            return ZUN_ERROR;
+        }
+    }
+
+    scriptOffsets = offset;
+    for (idx = 0; idx < anm->numScripts; idx++, offset += 2)
+    {
+        if (offset[0] >= ARRAY_SIZE(g_AnmManager->scripts) - spriteIdxOffset || offset[1] >= fileSize)
+        {
+            return ZUN_ERROR;
+        }
+    }
+
+    // Mark the scripts another one can run on into. A script that fails to validate might run on into anything.
+    result = ZUN_SUCCESS;
+    memset(runOnInto, 0, sizeof(runOnInto));
+    for (idx = 0, offset = scriptOffsets; idx < anm->numScripts; idx++, offset += 2)
+    {
+        script = (AnmRawInstr *)((u8 *)anm + offset[1]);
+        endOffset = FindAnmScriptEnd(anm, fileSize, offset[1]) - (u8 *)anm;
+        if (ValidateAnmScript(script, (u8 *)anm + endOffset, spriteIdxOffset, &fallsThrough) != ZUN_SUCCESS)
+        {
+            result = ZUN_ERROR;
+            fallsThrough = true;
+        }
+        if (!fallsThrough)
+        {
+            continue;
+        }
+        for (otherIdx = 0, otherOffset = scriptOffsets; otherIdx < anm->numScripts; otherIdx++, otherOffset += 2)
+        {
+            if (otherOffset[1] == endOffset)
+            {
+                runOnInto[otherOffset[0] >> 5] |= 1 << (otherOffset[0] & 31);
+            }
+        }
+    }
+
+    for (idx = 0, offset = scriptOffsets; idx < anm->numScripts; idx++, offset += 2)
+    {
+        if ((runOnInto[offset[0] >> 5] >> (offset[0] & 31)) & 1)
+        {
+            continue;
+        }
+        script = (AnmRawInstr *)((u8 *)anm + offset[1]);
+        if (ValidateAnmScript(script, FindAnmScriptEnd(anm, fileSize, offset[1]), spriteIdxOffset, &fallsThrough) ==
+            ZUN_SUCCESS)
+        {
+            ResolveAnmJumps(script, FindAnmScriptEnd(anm, fileSize, offset[1]));
+        }
+    }
+    return result;
+}
+#endif
+
+#ifdef ZUN_ARENAS
+// The game's anm files live in the arena of whatever loads them: Gui keeps its front and portraits for the whole
+// game, and the stage's own are reloaded every stage. Everything else is loaded and released one at a time.
+static ZunArenaIdx GetAnmArena(i32 anmIdx)
+{
+    switch (anmIdx)
+    {
+    case ANM_FILE_STAGEBG:
+    case ANM_FILE_ENEMY:
+    case ANM_FILE_ENEMY2:
+    case ANM_FILE_FACE_STAGE_A:
+    case ANM_FILE_FACE_STAGE_B:
+    case ANM_FILE_FACE_STAGE_C:
+        return ZUN_ARENA_STAGE;
+    case ANM_FILE_FRONT:
+    case ANM_FILE_LOADING:
+    case ANM_FILE_FACE_CHARA_A:
+    case ANM_FILE_FACE_CHARA_B:
+    case ANM_FILE_FACE_CHARA_C:
+        return ZUN_ARENA_SCENE;
+    default:
+        return ZUN_ARENA_COUNT;
+    }
+}
+#endif
+
 #pragma var_order(anm, anmName, rawSprite, index, curSpriteOffset, loadedSprite)
 ZunResult AnmManager::LoadAnm(i32 anmIdx, char *path, i32 spriteIdxOffset)
 {
+    ASSET_TRACE_SCOPE(AssetTraceKind_Anm, path);
+
     this->ReleaseAnm(anmIdx);
+#ifdef ZUN_ARENAS
+    this->anmFiles[anmIdx] = (AnmRawEntry *)FileSystem::OpenPath(path, 0, GetAnmArena(anmIdx));
+#else
     this->anmFiles[anmIdx] = (AnmRawEntry *)FileSystem::OpenPath(path, 0);
+#endif
 
     AnmRawEntry *anm = this->anmFiles[anmIdx];
 
@@ -350,6 +633,14 @@ ZunResult AnmManager::LoadAnm(i32 anmIdx, char *path, i32 spriteIdxOffset)
 
     anm->textureIdx = anmIdx;
 
+#ifdef PREDECODED_ANM
+    // The scripts that failed are left for ExecuteScript to run as they are, like without PREDECODED_ANM.
+    if (AnmManager::PredecodeScripts(anm, g_LastFileSize, spriteIdxOffset) != ZUN_SUCCESS)
+    {
+        utils::DebugPrint2("error : anm predecode failed %s\n", path);
+    }
+#endif
+
     char *anmName = (char *)((u8 *)anm + anm->nameOffset);
 
     if (*anmName == '@')
@@ -431,7 +722,18 @@ void AnmManager::ReleaseAnm(i32 anmIdx)
         AnmRawEntry *entry = this->anmFiles[anmIdx];
         this->ReleaseTexture(entry->textureIdx);
         AnmRawEntry *anmFilePtr = this->anmFiles[anmIdx];
-        free(anmFilePtr);
+#ifdef ZUN_ARENAS
+        if (GetAnmArena(anmIdx) != ZUN_ARENA_COUNT)
+        {
+            ZunFree(anmFilePtr, GetAnmArena(anmIdx));
+        }
+        else
+        {
+            ZunFree(anmFilePtr);
+        }
+#else
+        ZunFree(anmFilePtr);
+#endif
         this->anmFiles[anmIdx] = 0;
         this->currentBlendMode = 0xff;
         this->currentColorOp = 0xff;
@@ -449,7 +751,7 @@ void AnmManager::ReleaseTexture(i32 textureIdx)
     }
 
     void *imageDataArray = this->imageDataArray[textureIdx];
-    free(imageDataArray);
+    ZunFree(imageDataArray);
 
     this->imageDataArray[textureIdx] = NULL;
 }
@@ -483,9 +785,9 @@ ZunResult AnmManager::SetActiveSprite(AnmVm *vm, u32 sprite_index)
 
     vm->activeSpriteIndex = (i16)sprite_index;
     vm->sprite = this->sprites + sprite_index;
-    D3DXMatrixIdentity(&vm->matrix);
-    vm->matrix.m[0][0] = vm->sprite->widthPx / vm->sprite->textureWidth;
-    vm->matrix.m[1][1] = vm->sprite->heightPx / vm->sprite->textureHeight;
+    vm->ResetMatrix();
+    vm->SetMatrixScale(vm->sprite->widthPx / vm->sprite->textureWidth,
+                       vm->sprite->heightPx / vm->sprite->textureHeight);
 
     return ZUN_SUCCESS;
 }
@@ -518,11 +820,11 @@ void AnmManager::SetRenderStateForVm(AnmVm *vm)
         this->currentBlendMode = vm->flags.blendMode;
         if (this->currentBlendMode == AnmVmBlendMode_InvSrcAlpha)
         {
-            g_Supervisor.d3dDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+            D3D_SET_RENDER_STATE(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
         }
         else
         {
-            g_Supervisor.d3dDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_ONE);
+            D3D_SET_RENDER_STATE(D3DRS_DESTBLEND, D3DBLEND_ONE);
         }
     }
     if ((((g_Supervisor.cfg.opts >> GCOS_USE_D3D_HW_TEXTURE_BLENDING) & 1) == 0) &&
@@ -531,11 +833,11 @@ void AnmManager::SetRenderStateForVm(AnmVm *vm)
         this->currentColorOp = vm->flags.colorOp;
         if (this->currentColorOp == AnmVmColorOp_Modulate)
         {
-            g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+            D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
         }
         else
         {
-            g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_ADD);
+            D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_ADD);
         }
     }
     if (((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) == 0)
@@ -543,7 +845,7 @@ void AnmManager::SetRenderStateForVm(AnmVm *vm)
         if (this->currentTextureFactor != vm->color)
         {
             this->currentTextureFactor = vm->color;
-            g_Supervisor.d3dDevice->SetRenderState(D3DRS_TEXTUREFACTOR, this->currentTextureFactor);
+            D3D_SET_RENDER_STATE(D3DRS_TEXTUREFACTOR, this->currentTextureFactor);
         }
     }
     else
@@ -563,11 +865,11 @@ void AnmManager::SetRenderStateForVm(AnmVm *vm)
         this->currentZWriteDisable = vm->flags.zWriteDisable;
         if (this->currentZWriteDisable == 0)
         {
-            g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZWRITEENABLE, 1);
+            D3D_SET_RENDER_STATE(D3DRS_ZWRITEENABLE, 1);
         }
         else
         {
-            g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZWRITEENABLE, 0);
+            D3D_SET_RENDER_STATE(D3DRS_ZWRITEENABLE, 0);
         }
     }
     return;
@@ -575,6 +877,106 @@ void AnmManager::SetRenderStateForVm(AnmVm *vm)
 
 static f32 g_ZeroPointFive = 0.5;
 
+#ifdef BATCHED_SPRITES
+// Rounds and finishes the quad in g_PrimitivesToDrawVertexBuf. Returns whether the sprite, and so possibly the
+// texture, changed since the last quad.
+ZunBool AnmManager::FinishQuad(AnmVm *vm, i32 roundToPixels)
+{
+    if (roundToPixels != 0)
+    {
+        // The same x87 rounding as the original DrawInner, so batched and drawn quads land on the same pixels.
+        __asm {
+            fld g_PrimitivesToDrawVertexBuf[0 * TYPE g_PrimitivesToDrawVertexBuf].position.x
+            frndint
+            fsub g_ZeroPointFive
+            fld g_PrimitivesToDrawVertexBuf[1 * TYPE g_PrimitivesToDrawVertexBuf].position.x
+            frndint
+            fsub g_ZeroPointFive
+            fld g_PrimitivesToDrawVertexBuf[0 * TYPE g_PrimitivesToDrawVertexBuf].position.y
+            frndint
+            fsub g_ZeroPointFive
+            fld g_PrimitivesToDrawVertexBuf[2 * TYPE g_PrimitivesToDrawVertexBuf].position.y
+            frndint
+            fsub g_ZeroPointFive
+            fst g_PrimitivesToDrawVertexBuf[2 * TYPE g_PrimitivesToDrawVertexBuf].position.y
+            fstp g_PrimitivesToDrawVertexBuf[3 * TYPE g_PrimitivesToDrawVertexBuf].position.y
+            fst g_PrimitivesToDrawVertexBuf[0 * TYPE g_PrimitivesToDrawVertexBuf].position.y
+            fstp g_PrimitivesToDrawVertexBuf[1 * TYPE g_PrimitivesToDrawVertexBuf].position.y
+            fst g_PrimitivesToDrawVertexBuf[1 * TYPE g_PrimitivesToDrawVertexBuf].position.x
+            fstp g_PrimitivesToDrawVertexBuf[3 * TYPE g_PrimitivesToDrawVertexBuf].position.x
+            fst g_PrimitivesToDrawVertexBuf[0 * TYPE g_PrimitivesToDrawVertexBuf].position.x
+            fstp g_PrimitivesToDrawVertexBuf[2 * TYPE g_PrimitivesToDrawVertexBuf].position.x
+        }
+    }
+    g_PrimitivesToDrawVertexBuf[0].position.z = g_PrimitivesToDrawVertexBuf[1].position.z =
+        g_PrimitivesToDrawVertexBuf[2].position.z = g_PrimitivesToDrawVertexBuf[3].position.z = vm->pos.z;
+    if (this->currentSprite != vm->sprite)
+    {
+        this->currentSprite = vm->sprite;
+        g_PrimitivesToDrawVertexBuf[0].textureUV.x = g_PrimitivesToDrawVertexBuf[2].textureUV.x =
+            vm->sprite->uvStart.x + vm->uvScrollPos.x;
+        g_PrimitivesToDrawVertexBuf[1].textureUV.x = g_PrimitivesToDrawVertexBuf[3].textureUV.x =
+            vm->sprite->uvEnd.x + vm->uvScrollPos.x;
+        g_PrimitivesToDrawVertexBuf[0].textureUV.y = g_PrimitivesToDrawVertexBuf[1].textureUV.y =
+            vm->sprite->uvStart.y + vm->uvScrollPos.y;
+        g_PrimitivesToDrawVertexBuf[2].textureUV.y = g_PrimitivesToDrawVertexBuf[3].textureUV.y =
+            vm->sprite->uvEnd.y + vm->uvScrollPos.y;
+        return true;
+    }
+    return false;
+}
+
+ZunResult AnmManager::DrawInner(AnmVm *vm, i32 param_3)
+{
+    if (this->FinishQuad(vm, param_3) && this->currentTexture != this->textures[vm->sprite->sourceFileIndex])
+    {
+        this->currentTexture = this->textures[vm->sprite->sourceFileIndex];
+        D3D_SET_TEXTURE(0, this->currentTexture);
+    }
+    if (this->currentVertexShader != 2)
+    {
+        if (((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) == 0)
+        {
+            D3D_SET_VERTEX_SHADER(D3DFVF_TEX1 | D3DFVF_XYZRHW);
+        }
+        else
+        {
+            D3D_SET_VERTEX_SHADER(D3DFVF_TEX1 | D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
+        }
+        this->currentVertexShader = 2;
+    }
+    this->SetRenderStateForVm(vm);
+    if (((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) == 0)
+    {
+        g_Supervisor.d3dDevice->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, g_PrimitivesToDrawVertexBuf, 0x18);
+    }
+    else
+    {
+        g_PrimitivesToDrawNoVertexBuf[0].position.x = g_PrimitivesToDrawVertexBuf[0].position.x;
+        g_PrimitivesToDrawNoVertexBuf[0].position.y = g_PrimitivesToDrawVertexBuf[0].position.y;
+        g_PrimitivesToDrawNoVertexBuf[0].position.z = g_PrimitivesToDrawVertexBuf[0].position.z;
+        g_PrimitivesToDrawNoVertexBuf[1].position.x = g_PrimitivesToDrawVertexBuf[1].position.x;
+        g_PrimitivesToDrawNoVertexBuf[1].position.y = g_PrimitivesToDrawVertexBuf[1].position.y;
+        g_PrimitivesToDrawNoVertexBuf[1].position.z = g_PrimitivesToDrawVertexBuf[1].position.z;
+        g_PrimitivesToDrawNoVertexBuf[2].position.x = g_PrimitivesToDrawVertexBuf[2].position.x;
+        g_PrimitivesToDrawNoVertexBuf[2].position.y = g_PrimitivesToDrawVertexBuf[2].position.y;
+        g_PrimitivesToDrawNoVertexBuf[2].position.z = g_PrimitivesToDrawVertexBuf[2].position.z;
+        g_PrimitivesToDrawNoVertexBuf[3].position.x = g_PrimitivesToDrawVertexBuf[3].position.x;
+        g_PrimitivesToDrawNoVertexBuf[3].position.y = g_PrimitivesToDrawVertexBuf[3].position.y;
+        g_PrimitivesToDrawNoVertexBuf[3].position.z = g_PrimitivesToDrawVertexBuf[3].position.z;
+        g_PrimitivesToDrawNoVertexBuf[0].textureUV.x = g_PrimitivesToDrawNoVertexBuf[2].textureUV.x =
+            vm->sprite->uvStart.x + vm->uvScrollPos.x;
+        g_PrimitivesToDrawNoVertexBuf[1].textureUV.x = g_PrimitivesToDrawNoVertexBuf[3].textureUV.x =
+            vm->sprite->uvEnd.x + vm->uvScrollPos.x;
+        g_PrimitivesToDrawNoVertexBuf[0].textureUV.y = g_PrimitivesToDrawNoVertexBuf[1].textureUV.y =
+            vm->sprite->uvStart.y + vm->uvScrollPos.y;
+        g_PrimitivesToDrawNoVertexBuf[2].textureUV.y = g_PrimitivesToDrawNoVertexBuf[3].textureUV.y =
+            vm->sprite->uvEnd.y + vm->uvScrollPos.y;
+        g_Supervisor.d3dDevice->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, g_PrimitivesToDrawNoVertexBuf, 0x1c);
+    }
+    return ZUN_SUCCESS;
+}
+#else
 ZunResult AnmManager::DrawInner(AnmVm *vm, i32 param_3)
 {
     if (param_3 != 0)
@@ -619,18 +1021,18 @@ ZunResult AnmManager::DrawInner(AnmVm *vm, i32 param_3)
         if (this->currentTexture != this->textures[vm->sprite->sourceFileIndex])
         {
             this->currentTexture = this->textures[vm->sprite->sourceFileIndex];
-            g_Supervisor.d3dDevice->SetTexture(0, this->currentTexture);
+            D3D_SET_TEXTURE(0, this->currentTexture);
         }
     }
     if (this->currentVertexShader != 2)
     {
         if (((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) == 0)
         {
-            g_Supervisor.d3dDevice->SetVertexShader(D3DFVF_TEX1 | D3DFVF_XYZRHW);
+            D3D_SET_VERTEX_SHADER(D3DFVF_TEX1 | D3DFVF_XYZRHW);
         }
         else
         {
-            g_Supervisor.d3dDevice->SetVertexShader(D3DFVF_TEX1 | D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
+            D3D_SET_VERTEX_SHADER(D3DFVF_TEX1 | D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
         }
         this->currentVertexShader = 2;
     }
@@ -665,7 +1067,18 @@ ZunResult AnmManager::DrawInner(AnmVm *vm, i32 param_3)
     }
     return ZUN_SUCCESS;
 }
+#endif
 
+#ifdef BATCHED_SPRITES
+ZunResult AnmManager::DrawNoRotation(AnmVm *vm)
+{
+    if (this->PlaceQuadNoRotation(vm) != ZUN_SUCCESS)
+    {
+        return ZUN_ERROR;
+    }
+    return this->DrawInner(vm, 1);
+}
+#else
 ZunResult AnmManager::DrawNoRotation(AnmVm *vm)
 {
     float fVar2;
@@ -709,6 +1122,53 @@ ZunResult AnmManager::DrawNoRotation(AnmVm *vm)
     }
     return this->DrawInner(vm, 1);
 }
+#endif
+
+#ifdef BATCHED_SPRITES
+ZunResult AnmManager::PlaceQuadNoRotation(AnmVm *vm)
+{
+    float fVar2;
+    float fVar3;
+
+    if (vm->flags.isVisible == 0)
+    {
+        return ZUN_ERROR;
+    }
+    if (vm->flags.flag1 == 0)
+    {
+        return ZUN_ERROR;
+    }
+    if (vm->color == 0)
+    {
+        return ZUN_ERROR;
+    }
+    fVar2 = (vm->sprite->widthPx * vm->scaleX) / 2.0f;
+    fVar3 = (vm->sprite->heightPx * vm->scaleY) / 2.0f;
+    if ((vm->flags.anchor & AnmVmAnchor_Left) == 0)
+    {
+        g_PrimitivesToDrawVertexBuf[0].position.x = g_PrimitivesToDrawVertexBuf[2].position.x = vm->pos.x - fVar2;
+        g_PrimitivesToDrawVertexBuf[1].position.x = g_PrimitivesToDrawVertexBuf[3].position.x = fVar2 + vm->pos.x;
+    }
+    else
+    {
+        g_PrimitivesToDrawVertexBuf[0].position.x = g_PrimitivesToDrawVertexBuf[2].position.x = vm->pos.x;
+        g_PrimitivesToDrawVertexBuf[1].position.x = g_PrimitivesToDrawVertexBuf[3].position.x =
+            fVar2 + vm->pos.x + fVar2;
+    }
+    if ((vm->flags.anchor & AnmVmAnchor_Top) == 0)
+    {
+        g_PrimitivesToDrawVertexBuf[0].position.y = g_PrimitivesToDrawVertexBuf[1].position.y = vm->pos.y - fVar3;
+        g_PrimitivesToDrawVertexBuf[2].position.y = g_PrimitivesToDrawVertexBuf[3].position.y = fVar3 + vm->pos.y;
+    }
+    else
+    {
+        g_PrimitivesToDrawVertexBuf[0].position.y = g_PrimitivesToDrawVertexBuf[1].position.y = vm->pos.y;
+        g_PrimitivesToDrawVertexBuf[2].position.y = g_PrimitivesToDrawVertexBuf[3].position.y =
+            fVar3 + vm->pos.y + fVar3;
+    }
+    return ZUN_SUCCESS;
+}
+#endif
 
 void AnmManager::TranslateRotation(VertexTex1Xyzrwh *param_1, f32 x, f32 y, f32 sine, f32 cosine, f32 xOffset,
                                    f32 yOffset)
@@ -718,6 +1178,20 @@ void AnmManager::TranslateRotation(VertexTex1Xyzrwh *param_1, f32 x, f32 y, f32
     return;
 }
 
+#ifdef BATCHED_SPRITES
+ZunResult AnmManager::Draw(AnmVm *vm)
+{
+    if (vm->rotation.z == 0.0f)
+    {
+        return this->DrawNoRotation(vm);
+    }
+    if (this->PlaceQuadRotated(vm) != ZUN_SUCCESS)
+    {
+        return ZUN_ERROR;
+    }
+    return this->DrawInner(vm, 0);
+}
+#else
 #pragma var_order(spriteXCenter, spriteYCenter, yOffset, xOffset, zSine, z, zCosine)
 ZunResult AnmManager::Draw(AnmVm *vm)
 {
@@ -777,6 +1251,283 @@ ZunResult AnmManager::Draw(AnmVm *vm)
     }
     return this->DrawInner(vm, 0);
 }
+#endif
+
+#ifdef BATCHED_SPRITES
+#pragma var_order(spriteXCenter, spriteYCenter, yOffset, xOffset, zSine, z, zCosine)
+ZunResult AnmManager::PlaceQuadRotated(AnmVm *vm)
+{
+    f32 zSine;
+    f32 zCosine;
+    f32 spriteXCenter;
+    f32 spriteYCenter;
+    f32 xOffset;
+    f32 yOffset;
+    f32 z;
+
+    if (vm->flags.isVisible == 0)
+    {
+        return ZUN_ERROR;
+    }
+    if (vm->flags.flag1 == 0)
+    {
+        return ZUN_ERROR;
+    }
+    if (vm->color == 0)
+    {
+        return ZUN_ERROR;
+    }
+    z = vm->rotation.z;
+    sincos(z, zSine, zCosine);
+    xOffset = rintf(vm->pos.x);
+    yOffset = rintf(vm->pos.y);
+    spriteXCenter = rintf((vm->sprite->widthPx * vm->scaleX) / 2.0f);
+    spriteYCenter = rintf((vm->sprite->heightPx * vm->scaleY) / 2.0f);
+    this->TranslateRotation(&g_PrimitivesToDrawVertexBuf[0], -spriteXCenter - 0.5f, -spriteYCenter - 0.5f, zSine,
+                            zCosine, xOffset, yOffset);
+    this->TranslateRotation(&g_PrimitivesToDrawVertexBuf[1], spriteXCenter - 0.5f, -spriteYCenter - 0.5f, zSine,
+                            zCosine, xOffset, yOffset);
+    this->TranslateRotation(&g_PrimitivesToDrawVertexBuf[2], -spriteXCenter - 0.5f, spriteYCenter - 0.5f, zSine,
+                            zCosine, xOffset, yOffset);
+    this->TranslateRotation(&g_PrimitivesToDrawVertexBuf[3], spriteXCenter - 0.5f, spriteYCenter - 0.5f, zSine, zCosine,
+                            xOffset, yOffset);
+    g_PrimitivesToDrawVertexBuf[0].position.z = g_PrimitivesToDrawVertexBuf[1].position.z =
+        g_PrimitivesToDrawVertexBuf[2].position.z = g_PrimitivesToDrawVertexBuf[3].position.z = vm->pos.z;
+    if ((vm->flags.anchor & AnmVmAnchor_Left) != 0)
+    {
+        g_PrimitivesToDrawVertexBuf[0].position.x += spriteXCenter;
+        g_PrimitivesToDrawVertexBuf[1].position.x += spriteXCenter;
+        g_PrimitivesToDrawVertexBuf[2].position.x += spriteXCenter;
+        g_PrimitivesToDrawVertexBuf[3].position.x += spriteXCenter;
+    }
+    if ((vm->flags.anchor & AnmVmAnchor_Top) != 0)
+    {
+        g_PrimitivesToDrawVertexBuf[0].position.y += spriteYCenter;
+        g_PrimitivesToDrawVertexBuf[1].position.y += spriteYCenter;
+        g_PrimitivesToDrawVertexBuf[2].position.y += spriteYCenter;
+        g_PrimitivesToDrawVertexBuf[3].position.y += spriteYCenter;
+    }
+    return ZUN_SUCCESS;
+}
+
+// The quad Draw would submit for vm, as it would reach the device: with the diffuse color, and with the UVs the
+// current sprite left behind when the vertex buffer path reuses them. Like Draw, this moves currentSprite along.
+ZunResult AnmManager::BuildQuad(AnmVm *vm, VertexTex1DiffuseXyzrwh *quad)
+{
+    i32 idx;
+
+    if (vm->rotation.z == 0.0f)
+    {
+        if (this->PlaceQuadNoRotation(vm) != ZUN_SUCCESS)
+        {
+            return ZUN_ERROR;
+        }
+        this->FinishQuad(vm, 1);
+    }
+    else
+    {
+        if (this->PlaceQuadRotated(vm) != ZUN_SUCCESS)
+        {
+            return ZUN_ERROR;
+        }
+        this->FinishQuad(vm, 0);
+    }
+    for (idx = 0; idx < 4; idx++)
+    {
+        quad[idx].position = g_PrimitivesToDrawVertexBuf[idx].position;
+        quad[idx].diffuse = vm->color;
+        quad[idx].textureUV = g_PrimitivesToDrawVertexBuf[idx].textureUV;
+    }
+    if (((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) != 0)
+    {
+        quad[0].textureUV.x = quad[2].textureUV.x = vm->sprite->uvStart.x + vm->uvScrollPos.x;
+        quad[1].textureUV.x = quad[3].textureUV.x = vm->sprite->uvEnd.x + vm->uvScrollPos.x;
+        quad[0].textureUV.y = quad[1].textureUV.y = vm->sprite->uvStart.y + vm->uvScrollPos.y;
+        quad[2].textureUV.y = quad[3].textureUV.y = vm->sprite->uvEnd.y + vm->uvScrollPos.y;
+    }
+    return ZUN_SUCCESS;
+}
+
+// Orders VMs by what splits a batch run: texture first, then the render state SetRenderStateForVm sets, then the
+// color when it goes through the texture factor.
+static i32 CompareSpriteBatchState(AnmVm *a, AnmVm *b)
+{
+    u32 keyA;
+    u32 keyB;
+
+    keyA = (a->sprite->sourceFileIndex << 3) | (a->flags.blendMode << 2) | (a->flags.colorOp << 1) |
+           a->flags.zWriteDisable;
+    keyB = (b->sprite->sourceFileIndex << 3) | (b->flags.blendMode << 2) | (b->flags.colorOp << 1) |
+           b->flags.zWriteDisable;
+    if (keyA == keyB && ((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) == 0)
+    {
+        keyA = a->color;
+        keyB = b->color;
+    }
+    return keyA < keyB ? -1 : keyA > keyB;
+}
+
+void AnmManager::BeginSpriteBatch(AnmSpriteBatch *batch)
+{
+    batch->quadCount = 0;
+    batch->runCount = 0;
+    batch->layerStart = 0;
+}
+
+// Same vertices as Draw, bit for bit, since they are placed by the same calls in the same order, but written into the
+// batch instead of going to the device one sprite at a time.
+ZunResult AnmManager::BatchSprite(AnmSpriteBatch *batch, AnmVm *vm)
+{
+    if (batch->quadCount >= ANM_SPRITE_BATCH_MAX_QUADS)
+    {
+        this->FlushSpriteBatch(batch);
+    }
+    if (this->BuildQuad(vm, &batch->vertices[batch->quadCount * 4]) != ZUN_SUCCESS)
+    {
+        return ZUN_ERROR;
+    }
+
+    batch->quadVms[batch->quadCount++] = vm;
+    this->AppendToSpriteBatchRun(batch, vm);
+    return ZUN_SUCCESS;
+}
+
+void AnmManager::AppendToSpriteBatchRun(AnmSpriteBatch *batch, AnmVm *vm)
+{
+    AnmSpriteBatchRun *run;
+    IDirect3DTexture8 *texture;
+
+    texture = this->textures[vm->sprite->sourceFileIndex];
+    run = batch->runCount != 0 ? &batch->runs[batch->runCount - 1] : NULL;
+    if (run == NULL || run->texture != texture || CompareSpriteBatchState(run->vm, vm) != 0)
+    {
+        run = &batch->runs[batch->runCount++];
+        run->vm = vm;
+        run->texture = texture;
+        run->quadCount = 0;
+    }
+    run->quadCount++;
+}
+
+// Stable sort of the quads added since the last layer by texture and render state, so that sprites which may be drawn
+// in any order relative to each other (bullets of one priority) end up in as few runs as possible.
+void AnmManager::EndSpriteBatchLayer(AnmSpriteBatch *batch)
+{
+    u16 *order;
+    u16 *scratch;
+    u16 *swap;
+    i32 count;
+    i32 width;
+    i32 lo;
+    i32 mid;
+    i32 hi;
+    i32 i;
+    i32 j;
+    i32 k;
+
+    count = batch->quadCount - batch->layerStart;
+    for (i = batch->layerStart + 1; i < batch->quadCount; i++)
+    {
+        if (CompareSpriteBatchState(batch->quadVms[i - 1], batch->quadVms[i]) > 0)
+        {
+            break;
+        }
+    }
+    if (i >= batch->quadCount)
+    {
+        batch->layerStart = batch->quadCount;
+        return;
+    }
+
+    order = g_SpriteBatchOrder;
+    scratch = g_SpriteBatchOrderScratch;
+    for (i = 0; i < count; i++)
+    {
+        order[i] = batch->layerStart + i;
+    }
+    for (width = 1; width < count; width *= 2)
+    {
+        for (lo = 0; lo < count; lo += width * 2)
+        {
+            mid = ZUN_MIN(lo + width, count);
+            hi = ZUN_MIN(lo + width * 2, count);
+            for (i = lo, j = mid, k = lo; k < hi; k++)
+            {
+                if (i < mid &&
+                    (j >= hi || CompareSpriteBatchState(batch->quadVms[order[i]], batch->quadVms[order[j]]) <= 0))
+                {
+                    scratch[k] = order[i++];
+                }
+                else
+                {
+                    scratch[k] = order[j++];
+                }
+            }
+        }
+        swap = order;
+        order = scratch;
+        scratch = swap;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        memcpy(&g_SpriteBatchVertexScratch[i * 4], &batch->vertices[order[i] * 4], sizeof(batch->vertices[0]) * 4);
+        g_SpriteBatchVmScratch[i] = batch->quadVms[order[i]];
+    }
+    memcpy(&batch->vertices[batch->layerStart * 4], g_SpriteBatchVertexScratch, sizeof(batch->vertices[0]) * 4 * count);
+    memcpy(&batch->quadVms[batch->layerStart], g_SpriteBatchVmScratch, sizeof(batch->quadVms[0]) * count);
+
+    // Drop the layer's runs, splitting the one it may share with the previous layer, and rebuild them.
+    for (i = 0, k = 0; i < batch->runCount && k + batch->runs[i].quadCount <= batch->layerStart; i++)
+    {
+        k += batch->runs[i].quadCount;
+    }
+    batch->runCount = i;
+    if (k < batch->layerStart)
+    {
+        batch->runs[batch->runCount++].quadCount = batch->layerStart - k;
+    }
+    for (i = batch->layerStart; i < batch->quadCount; i++)
+    {
+        this->AppendToSpriteBatchRun(batch, batch->quadVms[i]);
+    }
+    batch->layerStart = batch->quadCount;
+}
+
+// Leaves the device and the AnmManager state caches where drawing the same sprites one by one would have.
+void AnmManager::FlushSpriteBatch(AnmSpriteBatch *batch)
+{
+    VertexTex1DiffuseXyzrwh *vertices;
+    AnmSpriteBatchRun *run;
+    i32 idx;
+
+    if (batch->quadCount == 0)
+    {
+        return;
+    }
+
+    D3D_SET_VERTEX_SHADER(D3DFVF_TEX1 | D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
+    vertices = batch->vertices;
+    for (run = batch->runs, idx = 0; idx < batch->runCount; idx++, run++)
+    {
+        if (this->currentTexture != run->texture)
+        {
+            this->currentTexture = run->texture;
+            D3D_SET_TEXTURE(0, this->currentTexture);
+        }
+        this->SetRenderStateForVm(run->vm);
+        g_Supervisor.d3dDevice->DrawIndexedPrimitiveUP(D3DPT_TRIANGLELIST, 0, run->quadCount * 4, run->quadCount * 2,
+                                                       g_SpriteBatchIndices, D3DFMT_INDEX16, vertices,
+                                                       sizeof(VertexTex1DiffuseXyzrwh));
+        vertices += run->quadCount * 4;
+    }
+
+    this->currentVertexShader = 0xff;
+    batch->quadCount = 0;
+    batch->runCount = 0;
+    batch->layerStart = 0;
+}
+#endif
 
 ZunResult AnmManager::DrawFacingCamera(AnmVm *vm)
 {
@@ -845,7 +1596,7 @@ ZunResult AnmManager::Draw3(AnmVm *vm)
         return ZUN_ERROR;
     }
 
-    worldTransformMatrix = vm->matrix;
+    vm->GetMatrix(&worldTransformMatrix);
     worldTransformMatrix.m[0][0] *= vm->scaleX;
     worldTransformMatrix.m[1][1] *= -vm->scaleY;
 
@@ -896,14 +1647,14 @@ ZunResult AnmManager::Draw3(AnmVm *vm)
     if (this->currentSprite != vm->sprite)
     {
         this->currentSprite = vm->sprite;
-        textureMatrix = vm->matrix;
+        vm->GetMatrix(&textureMatrix);
         textureMatrix.m[2][0] = vm->sprite->uvStart.x + vm->uvScrollPos.x;
         textureMatrix.m[2][1] = vm->sprite->uvStart.y + vm->uvScrollPos.y;
         g_Supervisor.d3dDevice->SetTransform(D3DTS_TEXTURE0, &textureMatrix);
         if (this->currentTexture != this->textures[vm->sprite->sourceFileIndex])
         {
             this->currentTexture = this->textures[vm->sprite->sourceFileIndex];
-            g_Supervisor.d3dDevice->SetTexture(0, this->currentTexture);
+            D3D_SET_TEXTURE(0, this->currentTexture);
         }
     }
 
@@ -912,12 +1663,12 @@ ZunResult AnmManager::Draw3(AnmVm *vm)
     {
         if ((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF & 1) == 0)
         {
-            g_Supervisor.d3dDevice->SetVertexShader(D3DFVF_TEX1 | D3DFVF_XYZ);
+            D3D_SET_VERTEX_SHADER(D3DFVF_TEX1 | D3DFVF_XYZ);
             g_Supervisor.d3dDevice->SetStreamSource(0, this->vertexBuffer, 0x14);
         }
         else
         {
-            g_Supervisor.d3dDevice->SetVertexShader(D3DFVF_TEX1 | D3DFVF_DIFFUSE | D3DFVF_XYZ);
+            D3D_SET_VERTEX_SHADER(D3DFVF_TEX1 | D3DFVF_DIFFUSE | D3DFVF_XYZ);
         }
         this->currentVertexShader = 3;
     }
@@ -963,7 +1714,7 @@ ZunResult AnmManager::Draw2(AnmVm *vm)
         return ZUN_ERROR;
     }
 
-    worldTransformMatrix = vm->matrix;
+    vm->GetMatrix(&worldTransformMatrix);
     worldTransformMatrix.m[3][0] = rintf(vm->pos.x) - 0.5f;
     worldTransformMatrix.m[3][1] = -rintf(vm->pos.y) + 0.5f;
     if ((vm->flags.anchor & AnmVmAnchor_Left) != 0)
@@ -982,25 +1733,25 @@ ZunResult AnmManager::Draw2(AnmVm *vm)
     if (this->currentSprite != vm->sprite)
     {
         this->currentSprite = vm->sprite;
-        textureMatrix = vm->matrix;
+        vm->GetMatrix(&textureMatrix);
         textureMatrix.m[2][0] = vm->sprite->uvStart.x + vm->uvScrollPos.x;
         textureMatrix.m[2][1] = vm->sprite->uvStart.y + vm->uvScrollPos.y;
         g_Supervisor.d3dDevice->SetTransform(D3DTS_TEXTURE0, &textureMatrix);
         if (this->currentTexture != this->textures[vm->sprite->sourceFileIndex])
         {
             this->currentTexture = this->textures[vm->sprite->sourceFileIndex];
-            g_Supervisor.d3dDevice->SetTexture(0, this->currentTexture);
+            D3D_SET_TEXTURE(0, this->currentTexture);
         }
         if (this->currentVertexShader != 3)
         {
             if ((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF & 1) == 0)
             {
-                g_Supervisor.d3dDevice->SetVertexShader(D3DFVF_TEX1 | D3DFVF_XYZ);
+                D3D_SET_VERTEX_SHADER(D3DFVF_TEX1 | D3DFVF_XYZ);
                 g_Supervisor.d3dDevice->SetStreamSource(0, this->vertexBuffer, 0x14);
             }
             else
             {
-                g_Supervisor.d3dDevice->SetVertexShader(D3DFVF_TEX1 | D3DFVF_DIFFUSE | D3DFVF_XYZ);
+                D3D_SET_VERTEX_SHADER(D3DFVF_TEX1 | D3DFVF_DIFFUSE | D3DFVF_XYZ);
             }
             this->currentVertexShader = 3;
         }
@@ -1045,6 +1796,17 @@ i32 AnmManager::ExecuteScript(AnmVm *vm)
     {
         goto yolo;
     }
+#ifdef ANM_IDLE_SKIP
+    if (vm->nextInstrTime > vm->currentTimeInScript.AsFrames())
+    {
+        if (vm->flags.isStopped)
+        {
+            // Same as running the Stop instruction again.
+            vm->currentTimeInScript.Decrement(1);
+        }
+        goto idle;
+    }
+#endif
 
     while (curInstr = vm->currentInstruction, curInstr->time <= vm->currentTimeInScript.AsFrames())
     {
@@ -1081,6 +1843,12 @@ i32 AnmManager::ExecuteScript(AnmVm *vm)
             vm->currentInstruction = (AnmRawInstr *)((i32)vm->beginingOfScript->args + curInstr->args[0] - 4);
             vm->currentTimeInScript.current = vm->currentInstruction->time;
             continue;
+#ifdef PREDECODED_ANM
+        case AnmOpcode_JumpResolved:
+            vm->currentInstruction = (AnmRawInstr *)curInstr->args[0];
+            vm->currentTimeInScript.current = vm->currentInstruction->time;
+            continue;
+#endif
         case AnmOpcode_FlipX:
             vm->flags.flip ^= 1;
             vm->scaleX *= -1.f;
@@ -1103,12 +1871,23 @@ i32 AnmManager::ExecuteScript(AnmVm *vm)
             vm->angleVel.x = *local_14++;
             vm->angleVel.y = *local_14++;
             vm->angleVel.z = *local_14;
+#ifdef ANM_IDLE_SKIP
+            if (vm->angleVel.x != 0.0f || vm->angleVel.y != 0.0f || vm->angleVel.z != 0.0f)
+            {
+                ANM_VM_ADD_WORK(vm, AnmVmWork_AngleVel);
+            }
+            else
+            {
+                ANM_VM_REMOVE_WORK(vm, AnmVmWork_AngleVel);
+            }
+#endif
             break;
         case AnmOpcode_SetScaleSpeed:
             local_18 = (f32 *)&curInstr->args[0];
             vm->scaleInterpFinalX = *local_18++;
             vm->scaleInterpFinalY = *local_18;
             vm->scaleInterpEndTime = 0;
+            ANM_VM_ADD_WORK(vm, AnmVmWork_Scale);
             break;
         case AnmOpcode_ScaleTime:
             local_1c = (f32 *)&curInstr->args[0];
@@ -1118,6 +1897,7 @@ i32 AnmManager::ExecuteScript(AnmVm *vm)
             vm->scaleInterpTime.InitializeForPopup();
             vm->scaleInterpInitialX = vm->scaleX;
             vm->scaleInterpInitialY = vm->scaleY;
+            ANM_VM_ADD_WORK(vm, AnmVmWork_Scale);
             break;
         case AnmOpcode_Fade:
             local_20 = (u32 *)&curInstr->args[0];
@@ -1125,6 +1905,7 @@ i32 AnmManager::ExecuteScript(AnmVm *vm)
             vm->alphaInterpFinal = COLOR_SET_ALPHA2(vm->color, local_20[0]);
             vm->alphaInterpEndTime = local_20[1];
             vm->alphaInterpTime.InitializeForPopup();
+            ANM_VM_ADD_WORK(vm, AnmVmWork_Alpha);
             break;
         case AnmOpcode_SetBlendAdditive:
             vm->flags.blendMode = AnmVmBlendMode_One;
@@ -1165,6 +1946,7 @@ i32 AnmManager::ExecuteScript(AnmVm *vm)
                 D3DXVECTOR3(*(f32 *)&curInstr->args[0], *(f32 *)&curInstr->args[1], *(f32 *)&curInstr->args[2]);
             vm->posInterpEndTime = curInstr->args[3];
             vm->posInterpTime.InitializeForPopup();
+            ANM_VM_ADD_WORK(vm, AnmVmWork_Pos);
             break;
         case AnmOpcode_StopHide:
             vm->flags.isVisible = 0;
@@ -1248,6 +2030,15 @@ i32 AnmManager::ExecuteScript(AnmVm *vm)
     }
 
 stop:
+#ifdef ANM_IDLE_SKIP
+    vm->nextInstrTime = vm->flags.isStopped ? ANM_VM_WAKE_NEVER : vm->currentInstruction->time;
+idle:
+    if (vm->activeWork == 0)
+    {
+        vm->currentTimeInScript.Tick();
+        return 0;
+    }
+#endif
     if (vm->angleVel.x != 0.0f)
     {
         vm->rotation.x =
@@ -1273,6 +2064,7 @@ stop:
             vm->scaleInterpEndTime = 0;
             vm->scaleInterpFinalY = 0.0;
             vm->scaleInterpFinalX = 0.0;
+            ANM_VM_REMOVE_WORK(vm, AnmVmWork_Scale);
         }
         else
         {
@@ -1322,6 +2114,7 @@ stop:
         if (vm->alphaInterpTime.AsFrames() >= vm->alphaInterpEndTime)
         {
             vm->alphaInterpEndTime = 0;
+            ANM_VM_REMOVE_WORK(vm, AnmVmWork_Alpha);
         }
     }
     if (vm->posInterpEndTime != 0)
@@ -1360,6 +2153,7 @@ stop:
         if (vm->posInterpTime.AsFrames() >= vm->posInterpEndTime)
         {
             vm->posInterpEndTime = 0;
+            ANM_VM_REMOVE_WORK(vm, AnmVmWork_Pos);
         }
         vm->posInterpTime.Tick();
     }
@@ -1452,6 +2246,8 @@ void AnmManager::DrawStringFormat2(AnmVm *vm, ZunColor textColor, ZunColor shado
 
 ZunResult AnmManager::LoadSurface(i32 surfaceIdx, char *path)
 {
+    ASSET_TRACE_SCOPE(AssetTraceKind_Surface, path);
+
     if (this->surfaces[surfaceIdx] != NULL)
     {
         this->ReleaseSurface(surfaceIdx);
@@ -1509,7 +2305,7 @@ ZunResult AnmManager::LoadSurface(i32 surfaceIdx, char *path)
         surface->Release();
         surface = NULL;
     }
-    free(data);
+    ZunFree(data);
     return ZUN_SUCCESS;
 
 fail:
@@ -1518,7 +2314,7 @@ fail:
         surface->Release();
         surface = NULL;
     }
-    free(data);
+    ZunFree(data);
     return ZUN_ERROR;
 }
 
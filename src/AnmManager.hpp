@@ -11,6 +11,18 @@
 #include "diffbuild.hpp"
 #include "inttypes.hpp"
 
+// BATCHED_SPRITES has Draw place its quad through the same helpers AnmSpriteBatch builds with, and BulletManager
+// batch its bullets. Draw, DrawNoRotation and DrawInner no longer match the original binary with it.
+#if defined(BATCHED_SPRITES) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "BATCHED_SPRITES splits AnmManager::Draw into PlaceQuad and FinishQuad"
+#endif
+
+// PREDECODED_ANM has LoadAnm check every script of a file and rewrite their jumps to absolute addresses, so
+// ExecuteScript doesn't rebuild them on every jump. LoadAnm no longer matches the original binary with it.
+#if defined(PREDECODED_ANM) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "PREDECODED_ANM rewrites the jumps of loaded anm scripts"
+#endif
+
 namespace th06
 {
 // structure of a vertex with SetVertexShade FVF set to D3DFVF_DIFFUSE | D3DFVF_XYZRHW
@@ -86,6 +98,32 @@ struct RenderVertexInfo
 };
 ZUN_ASSERT_SIZE(RenderVertexInfo, 0x14);
 
+#ifdef BATCHED_SPRITES
+// Enough for every bullet on screen at once.
+#define ANM_SPRITE_BATCH_MAX_QUADS 640
+
+// Consecutive batched quads sharing a texture and the render state SetRenderStateForVm would set for vm.
+struct AnmSpriteBatchRun
+{
+    AnmVm *vm;
+    IDirect3DTexture8 *texture;
+    i32 quadCount;
+};
+
+// Quads that Draw would have submitted one DrawPrimitiveUP at a time, built on the CPU and submitted as one indexed
+// triangle list per run. The VMs must not change between BatchSprite and FlushSpriteBatch.
+struct AnmSpriteBatch
+{
+    i32 quadCount;
+    i32 runCount;
+    // First quad EndSpriteBatchLayer may reorder.
+    i32 layerStart;
+    AnmSpriteBatchRun runs[ANM_SPRITE_BATCH_MAX_QUADS];
+    AnmVm *quadVms[ANM_SPRITE_BATCH_MAX_QUADS];
+    VertexTex1DiffuseXyzrwh vertices[ANM_SPRITE_BATCH_MAX_QUADS * 4];
+};
+#endif
+
 struct AnmManager
 {
     AnmManager();
@@ -157,6 +195,17 @@ struct AnmManager
     void DrawVmTextFmt(AnmVm *vm, ZunColor textColor, ZunColor shadowColor, char *fmt, ...);
     ZunResult DrawNoRotation(AnmVm *vm);
     ZunResult DrawInner(AnmVm *vm, i32 unk);
+#ifdef BATCHED_SPRITES
+    ZunResult PlaceQuadNoRotation(AnmVm *vm);
+    ZunResult PlaceQuadRotated(AnmVm *vm);
+    ZunBool FinishQuad(AnmVm *vm, i32 roundToPixels);
+    ZunResult BuildQuad(AnmVm *vm, VertexTex1DiffuseXyzrwh *quad);
+    void BeginSpriteBatch(AnmSpriteBatch *batch);
+    ZunResult BatchSprite(AnmSpriteBatch *batch, AnmVm *vm);
+    void AppendToSpriteBatchRun(AnmSpriteBatch *batch, AnmVm *vm);
+    void EndSpriteBatchLayer(AnmSpriteBatch *batch);
+    void FlushSpriteBatch(AnmSpriteBatch *batch);
+#endif
     ZunResult DrawFacingCamera(AnmVm *vm);
     ZunResult Draw2(AnmVm *vm);
     ZunResult Draw3(AnmVm *vm);
@@ -175,6 +224,9 @@ struct AnmManager
 
     void ReleaseAnm(i32 anmIdx);
     ZunResult LoadAnm(i32 anmIdx, char *path, i32 spriteIdxOffset);
+#ifdef PREDECODED_ANM
+    static ZunResult PredecodeScripts(AnmRawEntry *anm, u32 fileSize, i32 spriteIdxOffset);
+#endif
     void AnmManager::ExecuteAnmIdx(AnmVm *vm, i32 anmFileIdx)
     {
         vm->anmFileIndex = anmFileIdx;
@@ -10,6 +10,18 @@
 #include "diffbuild.hpp"
 #include "inttypes.hpp"
 
+// ANM_VM_COMPACT shrinks AnmVm, and every struct embedding one, so it can't be used by builds that must match the
+// original binary.
+#if defined(ANM_VM_COMPACT) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "ANM_VM_COMPACT changes the layout of AnmVm"
+#endif
+
+// ANM_IDLE_SKIP keeps track of which parts of AnmManager::ExecuteScript a VM still needs, so VMs waiting on their
+// next instruction with nothing to interpolate only tick their timer. ExecuteScript no longer matches with it.
+#if defined(ANM_IDLE_SKIP) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "ANM_IDLE_SKIP changes AnmManager::ExecuteScript and AnmVm::Initialize"
+#endif
+
 namespace th06
 {
 struct AnmLoadedSprite
@@ -59,6 +71,11 @@ ZUN_ASSERT_SIZE(AnmLoadedSprite, 0x38);
 #define AnmOpcode_SetVisibility 29
 #define AnmOpcode_ScaleTime 30
 #define AnmOpcode_SetZWriteDisable 31
+#ifdef PREDECODED_ANM
+// Never appears in files: AnmManager::PredecodeScripts rewrites jumps into it, with args[0] holding the target's
+// address instead of its offset from the start of the script.
+#define AnmOpcode_JumpResolved 32
+#endif
 
 struct AnmRawInstr
 {
@@ -87,6 +104,27 @@ enum AnmVmFlagsEnum
 
 #define ANM_VM_INITIAL_FLAGS 0x3
 
+#ifdef ANM_IDLE_SKIP
+// Per-frame blocks of ExecuteScript that still have something to do. A VM
+// with none of these set only needs its script timer ticked.
+enum AnmVmWorkEnum
+{
+    AnmVmWork_AngleVel = 1 << 0,
+    AnmVmWork_Scale = 1 << 1,
+    AnmVmWork_Alpha = 1 << 2,
+    AnmVmWork_Pos = 1 << 3,
+};
+
+// Wake time of a stopped VM. Only an interrupt restarts it, and those are checked first.
+#define ANM_VM_WAKE_NEVER 0x7fff
+
+#define ANM_VM_ADD_WORK(vm, work) ((vm)->activeWork |= (work))
+#define ANM_VM_REMOVE_WORK(vm, work) ((vm)->activeWork &= ~(work))
+#else
+#define ANM_VM_ADD_WORK(vm, work)
+#define ANM_VM_REMOVE_WORK(vm, work)
+#endif
+
 enum AnmVmBlendMode
 {
     AnmVmBlendMode_InvSrcAlpha,
@@ -144,11 +182,15 @@ struct AnmVm
         this->scaleInterpEndTime = 0;
         this->alphaInterpEndTime = 0;
         this->color = D3DCOLOR_RGBA(0xff, 0xff, 0xff, 0xff);
-        D3DXMatrixIdentity(&this->matrix);
+        this->ResetMatrix();
         this->flags.flags = AnmVmFlags_Visible | AnmVmFlags_1;
         this->autoRotate = 0;
         this->pendingInterrupt = 0;
         this->posInterpEndTime = 0;
+#ifdef ANM_IDLE_SKIP
+        this->nextInstrTime = 0;
+        this->activeWork = 0;
+#endif
         this->currentTimeInScript.Initialize();
     }
 
@@ -162,6 +204,38 @@ struct AnmVm
         this->flags.isVisible = 0;
     }
 
+    void ResetMatrix()
+    {
+#ifdef ANM_VM_COMPACT
+        this->matrixScale.x = 1.0f;
+        this->matrixScale.y = 1.0f;
+#else
+        D3DXMatrixIdentity(&this->matrix);
+#endif
+    }
+
+    void SetMatrixScale(f32 x, f32 y)
+    {
+#ifdef ANM_VM_COMPACT
+        this->matrixScale.x = x;
+        this->matrixScale.y = y;
+#else
+        this->matrix.m[0][0] = x;
+        this->matrix.m[1][1] = y;
+#endif
+    }
+
+    void GetMatrix(D3DXMATRIX *out)
+    {
+#ifdef ANM_VM_COMPACT
+        D3DXMatrixIdentity(out);
+        out->m[0][0] = this->matrixScale.x;
+        out->m[1][1] = this->matrixScale.y;
+#else
+        *out = this->matrix;
+#endif
+    }
+
     D3DXVECTOR3 rotation;
     D3DXVECTOR3 angleVel;
     f32 scaleY;
@@ -170,7 +244,13 @@ struct AnmVm
     f32 scaleInterpFinalX;
     D3DXVECTOR2 uvScrollPos;
     ZunTimer currentTimeInScript;
+    // Nothing but the two sprite scale terms of this matrix ever leaves identity, so compact VMs only store those and
+    // build the matrix when a draw asks for it.
+#ifdef ANM_VM_COMPACT
+    D3DXVECTOR2 matrixScale;
+#else
     D3DXMATRIX matrix;
+#endif
     ZunColor color;
     AnmVmFlags flags;
 
@@ -179,7 +259,12 @@ struct AnmVm
     i16 autoRotate;
     i16 pendingInterrupt;
     i16 posInterpEndTime;
+#ifdef ANM_IDLE_SKIP
+    // Time of currentInstruction, cached so idle VMs don't touch the script.
+    i16 nextInstrTime;
+#else
     // Two padding bytes
+#endif
     D3DXVECTOR3 pos;
     f32 scaleInterpInitialY;
     f32 scaleInterpInitialX;
@@ -201,7 +286,11 @@ struct AnmVm
     ZunTimer alphaInterpTime;
     u8 fontWidth;
     u8 fontHeight;
+#ifdef ANM_IDLE_SKIP
+    u16 activeWork;
+#else
     // Two final padding bytes
+#endif
 };
 ZUN_ASSERT_SIZE(AnmVm, 0x110);
 }; // namespace th06
@@ -867,11 +867,9 @@ void AsciiManager::DrawPopupsWithHwVertexProcessing()
             this->vm1.sprite = g_AnmManager->sprites + *currentDigit;
             if (*currentDigit >= '\n')
             {
-                this->vm1.matrix.m[0][0] = 0.1875f;
-                this->vm1.matrix.m[1][1] = 0.03125f;
+                this->vm1.SetMatrixScale(0.1875f, 0.03125f);
                 g_AnmManager->Draw2(&this->vm1);
-                this->vm1.matrix.m[0][0] = 0.03125f;
-                this->vm1.matrix.m[1][1] = 0.03125f;
+                this->vm1.SetMatrixScale(0.03125f, 0.03125f);
             }
             else
             {
@@ -919,11 +917,9 @@ void AsciiManager::DrawPopupsWithoutHwVertexProcessing()
             this->vm1.sprite = g_AnmManager->sprites + *currentDigit;
             if (*currentDigit >= '\n')
             {
-                this->vm1.matrix.m[0][0] = 0.1875f;
-                this->vm1.matrix.m[1][1] = 0.03125f;
+                this->vm1.SetMatrixScale(0.1875f, 0.03125f);
                 g_AnmManager->DrawNoRotation(&this->vm1);
-                this->vm1.matrix.m[0][0] = 0.03125f;
-                this->vm1.matrix.m[1][1] = 0.03125f;
+                this->vm1.SetMatrixScale(0.03125f, 0.03125f);
             }
             else
             {
@@ -0,0 +1,245 @@
+#include "AssetPreload.hpp"
+#include "FileSystem.hpp"
+#include "ZunMemory.hpp"
+#include "utils.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace th06
+{
+AssetPreload g_AssetPreload;
+
+AssetPreload::AssetPreload()
+{
+    memset(this, 0, sizeof(AssetPreload));
+    InitializeCriticalSection(&this->archiveLock);
+}
+
+AssetPreload::~AssetPreload()
+{
+    this->Stop();
+    this->ReleaseManifest();
+    if (this->readyEvent != NULL)
+    {
+        CloseHandle(this->readyEvent);
+    }
+    DeleteCriticalSection(&this->archiveLock);
+}
+
+ZunResult AssetPreload::LoadManifest(char *path)
+{
+    u8 *data;
+    char *line;
+    char *next;
+    char *end;
+    i32 scene;
+
+    this->ReleaseManifest();
+    data = FileSystem::OpenPath(path, 1);
+    if (data == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    this->manifestText = (char *)ZunAlloc(g_LastFileSize + 1, "preload");
+    memcpy(this->manifestText, data, g_LastFileSize);
+    this->manifestText[g_LastFileSize] = '\0';
+    ZunFree(data);
+
+    // Cut into lines in place, so the paths can point straight into the text.
+    scene = -1;
+    for (line = this->manifestText; line != NULL; line = next)
+    {
+        next = strchr(line, '\n');
+        if (next != NULL)
+        {
+            *next = '\0';
+            next++;
+        }
+        end = line + strlen(line);
+        while (end > line && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+        {
+            end--;
+        }
+        *end = '\0';
+
+        if (*line == '\0' || *line == '#')
+        {
+            continue;
+        }
+        if (*line == '[' && end[-1] == ']')
+        {
+            end[-1] = '\0';
+            scene = AssetTrace::FindScene(line + 1);
+            if (scene >= 0)
+            {
+                this->sceneFirstPath[scene] = this->numPaths;
+                this->sceneNumPaths[scene] = 0;
+            }
+            continue;
+        }
+        if (scene < 0 || this->numPaths >= ASSET_PRELOAD_MAX_PATHS)
+        {
+            continue;
+        }
+        this->paths[this->numPaths] = line;
+        this->numPaths++;
+        this->sceneNumPaths[scene]++;
+    }
+    utils::DebugPrint2("preload : %d files in %s\n", this->numPaths, path);
+    return ZUN_SUCCESS;
+}
+
+void AssetPreload::ReleaseManifest()
+{
+    this->Stop();
+    ZunFree(this->manifestText);
+    this->manifestText = NULL;
+    this->numPaths = 0;
+    memset(this->sceneNumPaths, 0, sizeof(this->sceneNumPaths));
+}
+
+void AssetPreload::Warm(i32 scene)
+{
+    AssetPreloadEntry *entry;
+    i32 idx;
+
+    this->Stop();
+    if (scene < 0 || scene >= ASSET_SCENE_COUNT || this->sceneNumPaths[scene] == 0)
+    {
+        return;
+    }
+    if (this->readyEvent == NULL)
+    {
+        this->readyEvent = CreateEventA(NULL, 0, 0, NULL);
+    }
+
+    for (idx = 0; idx < this->sceneNumPaths[scene]; idx++)
+    {
+        entry = &this->entries[idx];
+        entry->path = this->paths[this->sceneFirstPath[scene] + idx];
+        entry->data = NULL;
+        entry->size = 0;
+        entry->archive = -1;
+        entry->state = ASSET_PRELOAD_QUEUED;
+    }
+    this->numEntries = this->sceneNumPaths[scene];
+    this->scene = scene;
+    this->hits = 0;
+    this->waits = 0;
+    this->misses = 0;
+    this->isStopping = false;
+    this->thread = CreateThread(NULL, 0, AssetPreload::WarmThread, this, 0, NULL);
+    if (this->thread == NULL)
+    {
+        this->numEntries = 0;
+    }
+}
+
+void AssetPreload::Stop()
+{
+    AssetPreloadEntry *entry;
+    i32 unused;
+    i32 idx;
+
+    if (this->thread != NULL)
+    {
+        InterlockedExchange(&this->isStopping, true);
+        WaitForSingleObject(this->thread, INFINITE);
+        CloseHandle(this->thread);
+        this->thread = NULL;
+    }
+    if (this->numEntries == 0)
+    {
+        return;
+    }
+
+    unused = 0;
+    for (idx = 0; idx < this->numEntries; idx++)
+    {
+        entry = &this->entries[idx];
+        if (entry->state == ASSET_PRELOAD_READY && entry->data != NULL)
+        {
+            ZunFree(entry->data);
+            entry->data = NULL;
+            unused++;
+        }
+    }
+    utils::DebugPrint2("preload : %s, %d read ahead, %d waited on, %d not reached, %d unused\n",
+                       AssetTrace::GetSceneName(this->scene), this->hits, this->waits, this->misses, unused);
+    this->numEntries = 0;
+}
+
+DWORD __stdcall AssetPreload::WarmThread(LPVOID arg)
+{
+    AssetPreload *preload;
+    AssetPreloadEntry *entry;
+    i32 idx;
+
+    preload = (AssetPreload *)arg;
+    for (idx = 0; idx < preload->numEntries && !preload->isStopping; idx++)
+    {
+        entry = &preload->entries[idx];
+        // The game may have got to it first.
+        if (InterlockedCompareExchange(&entry->state, ASSET_PRELOAD_READING, ASSET_PRELOAD_QUEUED) !=
+            ASSET_PRELOAD_QUEUED)
+        {
+            continue;
+        }
+        entry->data = FileSystem::ReadPath(entry->path, 0, &entry->size, &entry->archive, ZUN_ARENA_COUNT);
+        InterlockedExchange(&entry->state, ASSET_PRELOAD_READY);
+        SetEvent(preload->readyEvent);
+    }
+    return 0;
+}
+
+u8 *AssetPreload::Take(char *path, u32 *size, i32 *archive)
+{
+    AssetPreloadEntry *entry;
+    LONG state;
+    u8 *data;
+    i32 idx;
+
+    for (idx = 0; idx < this->numEntries; idx++)
+    {
+        entry = &this->entries[idx];
+        if (strcmp(entry->path, path) != 0)
+        {
+            continue;
+        }
+
+        state = InterlockedCompareExchange(&entry->state, ASSET_PRELOAD_TAKEN, ASSET_PRELOAD_QUEUED);
+        if (state == ASSET_PRELOAD_QUEUED)
+        {
+            this->misses++;
+            return NULL;
+        }
+        if (state == ASSET_PRELOAD_READING)
+        {
+            this->waits++;
+            while (entry->state == ASSET_PRELOAD_READING)
+            {
+                WaitForSingleObject(this->readyEvent, 1);
+            }
+        }
+        else if (state == ASSET_PRELOAD_TAKEN)
+        {
+            // Opened twice in the one scene: the first open got the buffer.
+            continue;
+        }
+
+        data = entry->data;
+        entry->data = NULL;
+        entry->state = ASSET_PRELOAD_TAKEN;
+        if (data == NULL)
+        {
+            return NULL;
+        }
+        this->hits++;
+        *size = entry->size;
+        *archive = entry->archive;
+        return data;
+    }
+    return NULL;
+}
+}; // namespace th06
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "AssetTrace.hpp"
+#include "ZunBool.hpp"
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
+#ifdef ASSET_TRACE
+#define ASSET_PRELOAD_STOP() g_AssetPreload.Stop()
+#else
+#define ASSET_PRELOAD_STOP()
+#endif
+
+namespace th06
+{
+// Over every scene, which between them open a couple of hundred files.
+#define ASSET_PRELOAD_MAX_PATHS 0x200
+
+enum AssetPreloadState
+{
+    ASSET_PRELOAD_QUEUED,
+    ASSET_PRELOAD_READING,
+    ASSET_PRELOAD_READY,
+    ASSET_PRELOAD_TAKEN,
+};
+
+struct AssetPreloadEntry
+{
+    char *path;
+    u8 *data;
+    u32 size;
+    i32 archive;
+    volatile LONG state;
+};
+
+// Reads ahead the files a scene opened on earlier runs, from a manifest that scripts/build_preload_manifest.py makes
+// out of asset traces. When a scene starts, a thread reads and decompresses its files in the order the scene opened
+// them, and FileSystem::OpenPath takes each buffer over as the scene asks for it rather than decoding it itself.
+//
+// The manifest is a [scene] line for each scene, followed by a path per line as OpenPath is given it.
+struct AssetPreload
+{
+    AssetPreload();
+    ~AssetPreload();
+
+    ZunResult LoadManifest(char *path);
+    void ReleaseManifest();
+
+    void Warm(i32 scene);
+    // Waits for the thread, and frees whatever it read that nothing took.
+    void Stop();
+    // The buffer read ahead for path, which is now the caller's to free, or NULL if the caller has to read it itself.
+    // If the thread is reading it right now, waits for it to finish.
+    u8 *Take(char *path, u32 *size, i32 *archive);
+
+    static DWORD __stdcall WarmThread(LPVOID arg);
+
+    ZunBool isEnabled;
+    // Held around every archive read: an archive has the one file handle, which the thread and the game share.
+    CRITICAL_SECTION archiveLock;
+
+    char *manifestText;
+    char *paths[ASSET_PRELOAD_MAX_PATHS];
+    i32 numPaths;
+    i32 sceneFirstPath[ASSET_SCENE_COUNT];
+    i32 sceneNumPaths[ASSET_SCENE_COUNT];
+
+    AssetPreloadEntry entries[ASSET_PRELOAD_MAX_PATHS];
+    i32 numEntries;
+    i32 scene;
+    HANDLE thread;
+    HANDLE readyEvent;
+    volatile LONG isStopping;
+
+    // For the scene being read ahead.
+    u32 hits;
+    u32 waits;
+    u32 misses;
+};
+
+extern AssetPreload g_AssetPreload;
+}; // namespace th06
@@ -0,0 +1,190 @@
+#include "AssetTrace.hpp"
+#include "AssetPreload.hpp"
+#include "ZunMemory.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace th06
+{
+AssetTrace g_AssetTrace;
+
+static const char *g_AssetSceneNames[ASSET_SCENE_COUNT] = {
+    "boot",   "title",  "stage1", "stage2", "stage3",    "stage4",
+    "stage5", "stage6", "stage7", "result", "musicroom", "ending",
+};
+
+static const char *g_AssetTraceKindNames[] = {
+    "file", "anm", "texture", "surface", "sound", "archive",
+};
+
+AssetTraceScope::AssetTraceScope(AssetTraceKind kind, char *path)
+{
+    this->path = path;
+    this->kind = kind;
+    this->archive = -1;
+    this->begin = g_AssetTrace.GetTicks();
+    this->bytesBefore = g_AssetTrace.bytesRead;
+    this->eventsBefore = g_AssetTrace.numEvents;
+}
+
+AssetTraceScope::AssetTraceScope(AssetTraceKind kind, char *path, i32 archive)
+{
+    this->path = path;
+    this->kind = kind;
+    this->archive = archive;
+    this->begin = g_AssetTrace.GetTicks();
+    this->bytesBefore = g_AssetTrace.bytesRead;
+    this->eventsBefore = g_AssetTrace.numEvents;
+}
+
+AssetTraceScope::~AssetTraceScope()
+{
+    AssetTraceEvent *first;
+
+    if (this->begin == 0)
+    {
+        return;
+    }
+    if (this->archive < 0 && g_AssetTrace.numEvents > this->eventsBefore)
+    {
+        first = &g_AssetTrace.events[this->eventsBefore];
+        if (first->kind == AssetTraceKind_File)
+        {
+            this->archive = first->archive;
+        }
+    }
+    g_AssetTrace.Record(this->kind, this->path, this->archive, g_AssetTrace.bytesRead - this->bytesBefore,
+                        this->begin, false);
+}
+
+AssetTrace::AssetTrace()
+{
+    memset(this, 0, sizeof(AssetTrace));
+}
+
+void AssetTrace::Start()
+{
+    LARGE_INTEGER frequency;
+
+    if (this->events == NULL)
+    {
+        this->events = (AssetTraceEvent *)ZunAlloc(ASSET_TRACE_MAX_EVENTS * sizeof(AssetTraceEvent), "asset trace");
+    }
+    QueryPerformanceFrequency(&frequency);
+    this->ticksPerSecond = frequency.QuadPart;
+    this->numEvents = 0;
+    this->droppedEvents = 0;
+    this->bytesRead = 0;
+    this->isEnabled = true;
+}
+
+void AssetTrace::Stop()
+{
+    this->isEnabled = false;
+    ZunFree(this->events);
+    this->events = NULL;
+    this->numEvents = 0;
+}
+
+void AssetTrace::EnterScene(i32 scene)
+{
+#ifdef ZUN_MEMORY_TRACKING
+    g_ZunMemoryTracker.EnterScene(scene);
+#endif
+    this->scene = scene;
+    if (g_AssetPreload.isEnabled)
+    {
+        g_AssetPreload.Warm(scene);
+    }
+}
+
+LONGLONG AssetTrace::GetTicks()
+{
+    LARGE_INTEGER now;
+
+    if (!this->isEnabled)
+    {
+        return 0;
+    }
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+void AssetTrace::Record(AssetTraceKind kind, char *path, i32 archive, u32 bytes, LONGLONG begin,
+                        ZunBool wasPreloaded)
+{
+    AssetTraceEvent *event;
+    LARGE_INTEGER now;
+
+    if (!this->isEnabled || begin == 0)
+    {
+        return;
+    }
+    if (kind == AssetTraceKind_File)
+    {
+        this->bytesRead += bytes;
+    }
+    if (this->numEvents >= ASSET_TRACE_MAX_EVENTS)
+    {
+        this->droppedEvents++;
+        return;
+    }
+
+    QueryPerformanceCounter(&now);
+    event = &this->events[this->numEvents];
+    event->scene = this->scene;
+    event->kind = kind;
+    event->archive = archive;
+    event->wasPreloaded = wasPreloaded;
+    event->bytes = bytes;
+    event->micros = (u32)((now.QuadPart - begin) * 1000000 / this->ticksPerSecond);
+    strncpy(event->path, path, sizeof(event->path) - 1);
+    event->path[sizeof(event->path) - 1] = '\0';
+    this->numEvents++;
+}
+
+ZunResult AssetTrace::WriteCsv(const char *path)
+{
+    AssetTraceEvent *event;
+    FILE *file;
+    i32 idx;
+
+    file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    fprintf(file, "scene,kind,path,archive,bytes,us,preloaded\n");
+    for (event = this->events, idx = 0; idx < this->numEvents; idx++, event++)
+    {
+        fprintf(file, "%s,%s,%s,%d,%u,%u,%d\n", GetSceneName(event->scene), g_AssetTraceKindNames[event->kind],
+                event->path, event->archive, event->bytes, event->micros, event->wasPreloaded);
+    }
+    fclose(file);
+    return ZUN_SUCCESS;
+}
+
+const char *AssetTrace::GetSceneName(i32 scene)
+{
+    if (scene < 0 || scene >= ASSET_SCENE_COUNT)
+    {
+        return "unknown";
+    }
+    return g_AssetSceneNames[scene];
+}
+
+i32 AssetTrace::FindScene(const char *name)
+{
+    i32 scene;
+
+    for (scene = 0; scene < ASSET_SCENE_COUNT; scene++)
+    {
+        if (strcmp(g_AssetSceneNames[scene], name) == 0)
+        {
+            return scene;
+        }
+    }
+    return -1;
+}
+}; // namespace th06
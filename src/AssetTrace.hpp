@@ -0,0 +1,125 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "ZunBool.hpp"
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
+// ASSET_TRACE adds the -assettrace and -preload switches, and has the loaders time themselves and FileSystem::OpenPath
+// hand over what AssetPreload read ahead. None of them match the original binary with it.
+#if defined(ASSET_TRACE) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "ASSET_TRACE changes every asset loader"
+#endif
+
+#ifdef ASSET_TRACE
+#define ASSET_TRACE_SCOPE(kind, path) AssetTraceScope traceScope(kind, path)
+#define ASSET_TRACE_ARCHIVE_SCOPE(path, archive) AssetTraceScope traceScope(AssetTraceKind_Archive, path, archive)
+#else
+#define ASSET_TRACE_SCOPE(kind, path)
+#define ASSET_TRACE_ARCHIVE_SCOPE(path, archive)
+#endif
+
+// ZUN_MEMORY_TRACKING reports its allocations by the scene AssetTrace is in.
+#if defined(ASSET_TRACE) || defined(ZUN_MEMORY_TRACKING)
+#define ASSET_TRACE_ENTER_SCENE(scene) g_AssetTrace.EnterScene(scene)
+#else
+#define ASSET_TRACE_ENTER_SCENE(scene)
+#endif
+
+namespace th06
+{
+// About ten times what a full run through the game opens.
+#define ASSET_TRACE_MAX_EVENTS 0x1000
+#define ASSET_TRACE_PATH_LENGTH 64
+
+// The Supervisor states that load assets, with each stage counted apart. Everything before the title screen is
+// ASSET_SCENE_BOOT.
+enum AssetScene
+{
+    ASSET_SCENE_BOOT,
+    ASSET_SCENE_TITLE,
+    ASSET_SCENE_STAGE1,
+    ASSET_SCENE_STAGE2,
+    ASSET_SCENE_STAGE3,
+    ASSET_SCENE_STAGE4,
+    ASSET_SCENE_STAGE5,
+    ASSET_SCENE_STAGE6,
+    ASSET_SCENE_STAGE7,
+    ASSET_SCENE_RESULT,
+    ASSET_SCENE_MUSICROOM,
+    ASSET_SCENE_ENDING,
+    ASSET_SCENE_COUNT,
+};
+
+enum AssetTraceKind
+{
+    AssetTraceKind_File,
+    AssetTraceKind_Anm,
+    AssetTraceKind_Texture,
+    AssetTraceKind_Surface,
+    AssetTraceKind_Sound,
+    AssetTraceKind_Archive,
+};
+
+struct AssetTraceEvent
+{
+    u8 scene;
+    u8 kind;
+    // Index of the archive in g_Pbg3Archives, or -1 for a file outside any archive.
+    i8 archive;
+    // A file AssetPreload had already read, so micros is only how long it took to hand over.
+    u8 wasPreloaded;
+    u32 bytes;
+    u32 micros;
+    char path[ASSET_TRACE_PATH_LENGTH];
+};
+
+// Times a loader from here to the end of the scope it's declared in, however it returns. The bytes are everything
+// FileSystem::OpenPath read in between, and the archive is the first file's unless set.
+struct AssetTraceScope
+{
+    AssetTraceScope(AssetTraceKind kind, char *path);
+    AssetTraceScope(AssetTraceKind kind, char *path, i32 archive);
+    ~AssetTraceScope();
+
+    char *path;
+    AssetTraceKind kind;
+    i32 archive;
+    LONGLONG begin;
+    u32 bytesBefore;
+    i32 eventsBefore;
+};
+
+// Every file each scene opens, in order, with its size and how long it took to read and decode, for
+// scripts/build_preload_manifest.py to turn into what AssetPreload reads ahead. Only the game thread records.
+struct AssetTrace
+{
+    AssetTrace();
+
+    void Start();
+    void Stop();
+    // Also where AssetPreload starts reading ahead for the scene.
+    void EnterScene(i32 scene);
+
+    // 0 when not recording, so that Record knows to skip whatever was timed from it.
+    LONGLONG GetTicks();
+    void Record(AssetTraceKind kind, char *path, i32 archive, u32 bytes, LONGLONG begin, ZunBool wasPreloaded);
+    // One line per event: scene,kind,path,archive,bytes,us,preloaded.
+    ZunResult WriteCsv(const char *path);
+
+    static const char *GetSceneName(i32 scene);
+    static i32 FindScene(const char *name);
+
+    ZunBool isEnabled;
+    i32 scene;
+    AssetTraceEvent *events;
+    i32 numEvents;
+    u32 droppedEvents;
+    // Everything FileSystem::OpenPath has returned since Start.
+    u32 bytesRead;
+    LONGLONG ticksPerSecond;
+};
+
+extern AssetTrace g_AssetTrace;
+}; // namespace th06
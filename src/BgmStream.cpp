@@ -0,0 +1,167 @@
+#include "BgmStream.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+namespace th06
+{
+BgmStream g_BgmStream;
+
+#define BGM_STREAM_RING_MASK (BGM_STREAM_RING_FRAMES - 1)
+
+BgmStream::BgmStream()
+{
+    this->isPlaying = false;
+    this->thread = NULL;
+    this->stopEvent = NULL;
+}
+
+ZunResult BgmStream::Start(SoundMixerStreamCallback source, void *sourceArg, ZunBool isThreaded)
+{
+    this->Stop();
+    this->source = source;
+    this->sourceArg = sourceArg;
+    this->isSourceDone = false;
+    this->writeFrame = 0;
+    this->readFrame = 0;
+    this->underruns = 0;
+    this->underrunFrames = 0;
+    this->minFillFrames = BGM_STREAM_RING_FRAMES;
+
+    // Start out full, so the first blocks don't wait on the thread.
+    this->Produce();
+    this->isPlaying = true;
+    if (isThreaded)
+    {
+        this->stopEvent = CreateEventA(NULL, 0, 0, NULL);
+        this->thread = CreateThread(NULL, 0, BgmStream::ProducerThread, this, 0, NULL);
+        if (this->thread == NULL)
+        {
+            CloseHandle(this->stopEvent);
+            this->stopEvent = NULL;
+            this->isPlaying = false;
+            return ZUN_ERROR;
+        }
+    }
+    return ZUN_SUCCESS;
+}
+
+void BgmStream::Stop()
+{
+    if (!this->isPlaying)
+    {
+        return;
+    }
+    if (this->thread != NULL)
+    {
+        SetEvent(this->stopEvent);
+        WaitForSingleObject(this->thread, INFINITE);
+        CloseHandle(this->thread);
+        CloseHandle(this->stopEvent);
+        this->thread = NULL;
+        this->stopEvent = NULL;
+    }
+    this->isPlaying = false;
+    utils::DebugPrint2("bgm stream : %d underruns, %d frames short, lowest fill %d frames\n", this->underruns,
+                       this->underrunFrames, this->minFillFrames);
+}
+
+DWORD __stdcall BgmStream::ProducerThread(LPVOID arg)
+{
+    BgmStream *stream;
+
+    stream = (BgmStream *)arg;
+    while (WaitForSingleObject(stream->stopEvent, BGM_STREAM_PRODUCER_INTERVAL_MS) == WAIT_TIMEOUT)
+    {
+        stream->Produce();
+    }
+    return 0;
+}
+
+void BgmStream::Produce()
+{
+    u32 writeFrame;
+    i32 freeFrames;
+    i32 offset;
+    i32 count;
+    i32 written;
+
+    writeFrame = this->writeFrame;
+    freeFrames = BGM_STREAM_RING_FRAMES - (writeFrame - (u32)this->readFrame);
+    while (freeFrames > 0 && !this->isSourceDone)
+    {
+        // Up to the end of the ring, and the rest on the next time round.
+        offset = writeFrame & BGM_STREAM_RING_MASK;
+        count = BGM_STREAM_RING_FRAMES - offset < freeFrames ? BGM_STREAM_RING_FRAMES - offset : freeFrames;
+        written = this->source(this->sourceArg, this->ring + offset * SOUND_MIXER_CHANNELS, count);
+        if (written < 0)
+        {
+            written = 0;
+        }
+        writeFrame += written;
+        freeFrames -= written;
+        InterlockedExchange(&this->writeFrame, writeFrame);
+        if (written < count)
+        {
+            this->isSourceDone = true;
+        }
+    }
+}
+
+i32 BgmStream::GetFillFrames()
+{
+    return (u32)this->writeFrame - (u32)this->readFrame;
+}
+
+i32 BgmStream::Read(void *arg, i16 *frames, i32 frameCount)
+{
+    BgmStream *stream;
+    ZunBool isSourceDone;
+    u32 readFrame;
+    i32 fillFrames;
+    i32 total;
+    i32 offset;
+    i32 count;
+    i32 copied;
+
+    stream = (BgmStream *)arg;
+    if (stream->thread == NULL && stream->GetFillFrames() < frameCount)
+    {
+        stream->Produce();
+    }
+
+    // Checked before the fill, so that frames written just before the source ran out are never missed.
+    isSourceDone = stream->isSourceDone;
+    readFrame = stream->readFrame;
+    fillFrames = stream->GetFillFrames();
+    if (fillFrames < stream->minFillFrames && !isSourceDone)
+    {
+        stream->minFillFrames = fillFrames;
+    }
+
+    total = frameCount < fillFrames ? frameCount : fillFrames;
+    copied = 0;
+    while (copied < total)
+    {
+        offset = (readFrame + copied) & BGM_STREAM_RING_MASK;
+        count = total - copied;
+        if (count > BGM_STREAM_RING_FRAMES - offset)
+        {
+            count = BGM_STREAM_RING_FRAMES - offset;
+        }
+        memcpy(frames + copied * SOUND_MIXER_CHANNELS, stream->ring + offset * SOUND_MIXER_CHANNELS,
+               count * SOUND_MIXER_CHANNELS * sizeof(i16));
+        copied += count;
+    }
+    InterlockedExchange(&stream->readFrame, readFrame + copied);
+
+    if (copied < frameCount && !isSourceDone)
+    {
+        stream->underruns++;
+        stream->underrunFrames += frameCount - copied;
+        memset(frames + copied * SOUND_MIXER_CHANNELS, 0, (frameCount - copied) * SOUND_MIXER_CHANNELS * sizeof(i16));
+        return frameCount;
+    }
+    return copied;
+}
+}; // namespace th06
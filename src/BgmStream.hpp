@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "SoundMixer.hpp"
+#include "ZunBool.hpp"
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
+// BGM_READ_AHEAD also puts the ring in front of the DirectSound CStreamingSound that plays the music without
+// -swmixer. CStreamingSound and SoundPlayer's BGM functions stop matching the original binary.
+#if defined(BGM_READ_AHEAD) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "BGM_READ_AHEAD changes CStreamingSound and how SoundPlayer plays BGM"
+#endif
+
+namespace th06
+{
+// About 740ms of read ahead. A power of two so the frame counters can run freely and wrap.
+#define BGM_STREAM_RING_FRAMES 0x8000
+#define BGM_STREAM_PRODUCER_INTERVAL_MS 10
+
+// Reads the background music ahead of playback into a single producer, single consumer ring. The producer thread
+// is the only one to touch the source, so a slow disk read only eats into the read ahead; the consumer, the mixer or
+// with BGM_READ_AHEAD the CStreamingSound notification thread, only ever copies out of the ring. Without a thread the
+// consumer tops the ring up itself, which is what the headless sinks want: what they hear doesn't depend on how the
+// threads were scheduled.
+struct BgmStream
+{
+    BgmStream();
+
+    // source is read from the start, and is done once it returns short.
+    ZunResult Start(SoundMixerStreamCallback source, void *sourceArg, ZunBool isThreaded);
+    void Stop();
+
+    // A SoundMixerStreamCallback over the ring, with the BgmStream as arg. When the producer is behind, the missing
+    // frames are silence and count as an underrun, rather than ending the stream.
+    static i32 Read(void *arg, i16 *frames, i32 frameCount);
+    i32 GetFillFrames();
+
+    // Producer side.
+    void Produce();
+    static DWORD __stdcall ProducerThread(LPVOID arg);
+
+    ZunBool isPlaying;
+    SoundMixerStreamCallback source;
+    void *sourceArg;
+    // Set by the producer once source has nothing more to give.
+    volatile ZunBool isSourceDone;
+
+    // Frames ever written and read. Each is only advanced by its own side and published with an interlocked
+    // exchange, so the other side never sees a frame count before the frames themselves.
+    volatile LONG writeFrame;
+    volatile LONG readFrame;
+
+    HANDLE thread;
+    HANDLE stopEvent;
+
+    // Consumer side metrics.
+    u32 underruns;
+    u32 underrunFrames;
+    i32 minFillFrames;
+
+    i16 ring[BGM_STREAM_RING_FRAMES * SOUND_MIXER_CHANNELS];
+};
+
+extern BgmStream g_BgmStream;
+}; // namespace th06
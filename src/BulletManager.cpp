@@ -3,6 +3,7 @@
 #include "AsciiManager.hpp"
 #include "Chain.hpp"
 #include "ChainPriorities.hpp"
+#include "D3dStateCache.hpp"
 #include "Enemy.hpp"
 #include "GameManager.hpp"
 #include "Gui.hpp"
@@ -34,6 +35,15 @@ DIFFABLE_STATIC_ARRAY_ASSIGN(u32, 8, g_BulletSpriteOffset32Px) = {0, 1, 1, 2, 2,
 
 DIFFABLE_STATIC_ASSIGN(u32 *, g_EffectsColor) = g_EffectsColorWithTextureBlending;
 
+#ifdef BATCHED_BULLET_COLLISION
+DIFFABLE_STATIC(PlayerCollisionBatch, g_BulletCollisionBatch)
+DIFFABLE_STATIC_ARRAY(i16, ARRAY_SIZE(g_BulletManager.bullets), g_BulletCollisionSlots)
+DIFFABLE_STATIC(PlayerLaserBatch, g_LaserBatch)
+#endif
+#ifdef BATCHED_SPRITES
+DIFFABLE_STATIC(AnmSpriteBatch, g_BulletSpriteBatch)
+#endif
+
 struct BulletTypeInfo
 {
     u32 bulletAnmScriptIdx;
@@ -648,7 +658,229 @@ ZunResult BulletManager::RegisterChain(char *bulletAnmPath)
     return ZUN_SUCCESS;
 }
 
+#ifdef BATCHED_BULLET_COLLISION
+// Applies the ex-flag behaviours and velocity of a fired bullet. Returns false if it left the play area for
+// good and was freed.
+ZunBool BulletManager::MoveBullet(Bullet *curBullet)
+{
+    f32 bulletSpeed;
+
+    if (curBullet->exFlags != 0)
+    {
+        if (curBullet->exFlags & 1)
+        {
+            if ((ZunBool)(curBullet->timer.current <= 16))
+            {
+                bulletSpeed = 5.0f - curBullet->timer.AsFramesFloat() * 5.0f / 16.0f;
+                sincosmul(&curBullet->velocity, curBullet->angle, bulletSpeed + curBullet->speed);
+            }
+            else
+            {
+                curBullet->exFlags ^= 1;
+            }
+        }
+        else if (curBullet->exFlags & 0x10)
+        {
+            if ((ZunBool)(curBullet->timer.current >= curBullet->ex5Int0))
+            {
+                curBullet->exFlags &= ~0x10;
+            }
+            else
+            {
+                curBullet->velocity += curBullet->ex4Acceleration * g_Supervisor.effectiveFramerateMultiplier;
+                curBullet->angle = atan2f(curBullet->velocity.y, curBullet->velocity.x);
+            }
+        }
+        else if (curBullet->exFlags & 0x20)
+        {
+            if ((ZunBool)(curBullet->timer.current >= curBullet->ex5Int0))
+            {
+                curBullet->exFlags &= ~0x20;
+            }
+            else
+            {
+                curBullet->angle = utils::AddNormalizeAngle(
+                    curBullet->angle, g_Supervisor.effectiveFramerateMultiplier * curBullet->ex5Float1);
+                curBullet->speed += g_Supervisor.effectiveFramerateMultiplier * curBullet->ex5Float0;
+                // Has to be done in asm. Just, great.
+                sincosmul(&curBullet->velocity, curBullet->angle, curBullet->speed);
+            }
+        }
+        if (curBullet->exFlags & 0x40)
+        {
+            if ((ZunBool)(curBullet->timer.current >=
+                          curBullet->dirChangeInterval * (curBullet->dirChangeNumTimes + 1)))
+            {
+                curBullet->dirChangeNumTimes++;
+
+                if (curBullet->dirChangeNumTimes >= curBullet->dirChangeMaxTimes)
+                {
+                    curBullet->exFlags &= ~0x40;
+                }
+
+                curBullet->angle = curBullet->angle + curBullet->dirChangeRotation;
+                curBullet->speed = curBullet->dirChangeSpeed;
+                bulletSpeed = curBullet->speed;
+            }
+            else
+            {
+                bulletSpeed =
+                    curBullet->speed - ((curBullet->timer.AsFramesFloat() -
+                                         (curBullet->dirChangeInterval * curBullet->dirChangeNumTimes)) *
+                                        curBullet->speed) /
+                                           curBullet->dirChangeInterval;
+            }
+
+            sincosmul(&curBullet->velocity, curBullet->angle, bulletSpeed);
+        }
+        else if (curBullet->exFlags & 0x100)
+        {
+            if ((ZunBool)(curBullet->timer.current >=
+                          curBullet->dirChangeInterval * (curBullet->dirChangeNumTimes + 1)))
+            {
+                curBullet->dirChangeNumTimes++;
+
+                if (curBullet->dirChangeNumTimes >= curBullet->dirChangeMaxTimes)
+                {
+                    curBullet->exFlags &= ~0x100;
+                }
+
+                curBullet->angle = curBullet->dirChangeRotation;
+                curBullet->speed = curBullet->dirChangeSpeed;
+                bulletSpeed = curBullet->speed;
+            }
+            else
+            {
+                bulletSpeed =
+                    curBullet->speed - ((curBullet->timer.AsFramesFloat() -
+                                         (curBullet->dirChangeInterval * curBullet->dirChangeNumTimes)) *
+                                        curBullet->speed) /
+                                           curBullet->dirChangeInterval;
+            }
+
+            sincosmul(&curBullet->velocity, curBullet->angle, bulletSpeed);
+        }
+        else if (curBullet->exFlags & 0x80)
+        {
+            if ((ZunBool)(curBullet->timer.current >=
+                          curBullet->dirChangeInterval * (curBullet->dirChangeNumTimes + 1)))
+            {
+                curBullet->dirChangeNumTimes++;
+
+                if (curBullet->dirChangeNumTimes >= curBullet->dirChangeMaxTimes)
+                {
+                    curBullet->exFlags &= ~0x80;
+                }
+
+                curBullet->angle = g_Player.AngleToPlayer(&curBullet->pos) + curBullet->dirChangeRotation;
+                curBullet->speed = curBullet->dirChangeSpeed;
+                bulletSpeed = curBullet->speed;
+            }
+            else
+            {
+                bulletSpeed =
+                    curBullet->speed - ((curBullet->timer.AsFramesFloat() -
+                                         (curBullet->dirChangeInterval * curBullet->dirChangeNumTimes)) *
+                                        curBullet->speed) /
+                                           curBullet->dirChangeInterval;
+            }
+            sincosmul(&curBullet->velocity, curBullet->angle, bulletSpeed);
+        }
+        else if (curBullet->exFlags & 0x400)
+        {
+            if (g_GameManager.IsInBounds(curBullet->pos.x, curBullet->pos.y,
+                                         curBullet->sprites.spriteBullet.sprite->widthPx,
+                                         curBullet->sprites.spriteBullet.sprite->heightPx) == 0)
+            {
+                if (curBullet->pos.x < 0.0f || curBullet->pos.x >= 384.0f)
+                {
+                    curBullet->angle = -curBullet->angle - ZUN_PI;
+                    curBullet->angle = utils::AddNormalizeAngle(curBullet->angle, 0.0);
+                }
+
+                if (curBullet->pos.y < 0.0f || curBullet->pos.y >= 448.0f)
+                {
+                    curBullet->angle = -curBullet->angle;
+                }
+
+                curBullet->speed = curBullet->dirChangeSpeed;
+                bulletSpeed = curBullet->speed;
+                sincosmul(&curBullet->velocity, curBullet->angle, bulletSpeed);
+                curBullet->dirChangeNumTimes++;
+
+                if (curBullet->dirChangeNumTimes >= curBullet->dirChangeMaxTimes)
+                {
+                    curBullet->exFlags &= ~0x400;
+                }
+            }
+        }
+        else if (curBullet->exFlags & 0x800)
+        {
+            if (g_GameManager.IsInBounds(curBullet->pos.x, curBullet->pos.y,
+                                         curBullet->sprites.spriteBullet.sprite->widthPx,
+                                         curBullet->sprites.spriteBullet.sprite->heightPx) == 0)
+            {
+                if (curBullet->pos.x < 0.0f || curBullet->pos.x >= 384.0f)
+                {
+                    curBullet->angle = -curBullet->angle - ZUN_PI;
+                    curBullet->angle = utils::AddNormalizeAngle(curBullet->angle, 0.0f);
+                }
+
+                if (curBullet->pos.y < 0.0f)
+                {
+                    curBullet->angle = -curBullet->angle;
+                }
+
+                curBullet->speed = curBullet->dirChangeSpeed;
+                bulletSpeed = curBullet->speed;
+                sincosmul(&curBullet->velocity, curBullet->angle, bulletSpeed);
+                curBullet->dirChangeNumTimes++;
+
+                if (curBullet->dirChangeNumTimes >= curBullet->dirChangeMaxTimes)
+                {
+                    curBullet->exFlags &= ~0x800;
+                }
+            }
+        }
+    }
+
+    curBullet->pos += curBullet->velocity * g_Supervisor.effectiveFramerateMultiplier;
+    if (g_GameManager.IsInBounds(curBullet->pos.x, curBullet->pos.y,
+                                 curBullet->sprites.spriteBullet.sprite->widthPx,
+                                 curBullet->sprites.spriteBullet.sprite->heightPx) == 0)
+    {
+        if ((curBullet->exFlags & 0x40) == 0 && (curBullet->exFlags & 0x100) == 0 &&
+            (curBullet->exFlags & 0x80) == 0 && (curBullet->exFlags & 0x400) == 0 &&
+            (curBullet->exFlags & 0x800) == 0 && curBullet->unk_5c0 == 0)
+        {
+            memset(curBullet, 0, sizeof(Bullet));
+            return false;
+        }
+        else
+        {
+            curBullet->unk_5c0++;
+
+            if (curBullet->unk_5c0 >= 0x100)
+            {
+                memset(curBullet, 0, sizeof(Bullet));
+                return false;
+            }
+        }
+    }
+    else
+    {
+        curBullet->unk_5c0 = 0;
+    }
+    return true;
+}
+#endif
+
+#ifdef BATCHED_BULLET_COLLISION
+#pragma var_order(grazeState, idx, local_14, laserSize, curBullet, laserColor, curLaser, laserCenter, res,             \
+                  collisionSlot)
+#else
 #pragma var_order(grazeState, idx, bulletSpeed, local_14, laserSize, curBullet, laserColor, curLaser, laserCenter, res)
+#endif
 ChainCallbackResult BulletManager::OnUpdate(BulletManager *mgr)
 {
     i32 res;
@@ -659,9 +891,14 @@ ChainCallbackResult BulletManager::OnUpdate(BulletManager *mgr)
 
     Bullet *curBullet;
     Laser *curLaser;
+#ifndef BATCHED_BULLET_COLLISION
     f32 bulletSpeed;
+#endif
     i32 idx;
     i32 grazeState;
+#ifdef BATCHED_BULLET_COLLISION
+    i32 collisionSlot;
+#endif
 
     curBullet = &mgr->bullets[0];
 
@@ -672,6 +909,123 @@ ChainCallbackResult BulletManager::OnUpdate(BulletManager *mgr)
 
     g_ItemManager.OnUpdate();
     mgr->bulletCount = 0;
+#ifdef BATCHED_BULLET_COLLISION
+    // Moving a bullet that was already fired doesn't depend on anything the collision side effects touch, so
+    // those are moved first and their hitboxes classified in a single batch. The second loop below then runs
+    // everything with side effects (ANM scripts, grazes, deaths, items) in the original order.
+    g_BulletCollisionBatch.Reset();
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->bullets); idx++, curBullet++)
+    {
+        g_BulletCollisionSlots[idx] = -1;
+        if (curBullet->state != BULLET_STATE_FIRED)
+        {
+            continue;
+        }
+        if (!BulletManager::MoveBullet(curBullet))
+        {
+            mgr->bulletCount++;
+            continue;
+        }
+        if (curBullet->isGrazed == 0 || curBullet->isGrazed == 1)
+        {
+            g_BulletCollisionSlots[idx] = g_BulletCollisionBatch.Push(&curBullet->pos, &curBullet->sprites.grazeSize);
+        }
+    }
+    g_Player.CalcBulletCollisionBatch(&g_BulletCollisionBatch);
+
+    curBullet = &mgr->bullets[0];
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->bullets); idx++, curBullet++)
+    {
+        if (curBullet->state == BULLET_STATE_UNUSED)
+            continue;
+
+        mgr->bulletCount++;
+        switch (curBullet->state)
+        {
+        case BULLET_STATE_SPAWNING_FAST:
+            curBullet->pos += curBullet->velocity / 2.0f * g_Supervisor.effectiveFramerateMultiplier;
+
+            if (g_AnmManager->ExecuteScript(&curBullet->sprites.spriteSpawnEffectFast) == 0)
+            {
+                break;
+            }
+            goto HELL;
+        case BULLET_STATE_SPAWNING_NORMAL:
+            curBullet->pos += curBullet->velocity / 2.5f * g_Supervisor.effectiveFramerateMultiplier;
+
+            if (g_AnmManager->ExecuteScript(&curBullet->sprites.spriteSpawnEffectNormal) == 0)
+            {
+                break;
+            }
+            goto HELL;
+        case BULLET_STATE_SPAWNING_SLOW:
+            curBullet->pos += curBullet->velocity / 3.0f * g_Supervisor.effectiveFramerateMultiplier;
+
+            if (g_AnmManager->ExecuteScript(&curBullet->sprites.spriteSpawnEffectSlow) == 0)
+            {
+                break;
+            }
+        HELL:
+            curBullet->state = BULLET_STATE_FIRED;
+            curBullet->timer.InitializeForPopup();
+
+            // Bullets that just finished spawning weren't part of the batch, check them directly.
+            if (!BulletManager::MoveBullet(curBullet))
+            {
+                continue;
+            }
+            collisionSlot = -1;
+            goto checkCollision;
+        case BULLET_STATE_FIRED:
+            collisionSlot = g_BulletCollisionSlots[idx];
+        checkCollision:
+            if (curBullet->isGrazed == 0)
+            {
+                grazeState = collisionSlot >= 0
+                                 ? g_Player.ResolveBatchedGraze(&g_BulletCollisionBatch, collisionSlot, &curBullet->pos)
+                                 : g_Player.CheckGraze(&curBullet->pos, &curBullet->sprites.grazeSize);
+
+                if (grazeState == 1)
+                {
+                    curBullet->isGrazed = 1;
+                    goto bulletGrazed;
+                }
+                else if (grazeState == 2)
+                {
+                    curBullet->state = BULLET_STATE_DESPAWNING;
+                    g_ItemManager.SpawnItem(&curBullet->pos, ITEM_POINT_BULLET, 1);
+                }
+            }
+            else if (curBullet->isGrazed == 1)
+            {
+            bulletGrazed:
+                grazeState =
+                    collisionSlot >= 0
+                        ? g_Player.ResolveBatchedKillBoxCollision(&g_BulletCollisionBatch, collisionSlot)
+                        : g_Player.CalcKillBoxCollision(&curBullet->pos, &curBullet->sprites.grazeSize);
+                if (grazeState != 0)
+                {
+                    curBullet->state = BULLET_STATE_DESPAWNING;
+                    if (grazeState == 2)
+                    {
+                        g_ItemManager.SpawnItem(&curBullet->pos, ITEM_POINT_BULLET, 1);
+                    }
+                }
+            }
+            g_AnmManager->ExecuteScript(&curBullet->sprites.spriteBullet);
+            break;
+        case BULLET_STATE_DESPAWNING:
+            curBullet->pos += curBullet->velocity / 2.0f * g_Supervisor.effectiveFramerateMultiplier;
+            if (g_AnmManager->ExecuteScript(&curBullet->sprites.spriteSpawnEffectDonut) != 0)
+            {
+                memset(curBullet, 0, sizeof(Bullet));
+                continue;
+            }
+            break;
+        }
+        curBullet->timer.Tick();
+    }
+#else
     for (idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->bullets); idx++, curBullet++)
     {
         if (curBullet->state == BULLET_STATE_UNUSED)
@@ -955,6 +1309,25 @@ ChainCallbackResult BulletManager::OnUpdate(BulletManager *mgr)
         }
         curBullet->timer.Tick();
     }
+#endif
+
+#ifdef BATCHED_BULLET_COLLISION
+    // Nothing moves the player or turns a laser while they are updated, so the player's hitbox is rotated into
+    // every laser's frame at once.
+    curLaser = &mgr->lasers[0];
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->lasers); idx++, curLaser++)
+    {
+        if (!curLaser->inUse)
+        {
+            continue;
+        }
+        g_LaserBatch.posX[idx] = curLaser->pos.x;
+        g_LaserBatch.posY[idx] = curLaser->pos.y;
+        g_LaserBatch.sine[idx] = sinf(curLaser->angle);
+        g_LaserBatch.cosine[idx] = cosf(curLaser->angle);
+    }
+    g_Player.CalcLaserPlayerBoxes(&g_LaserBatch);
+#endif
 
     curLaser = &mgr->lasers[0];
     for (idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->lasers); idx++, curLaser++)
@@ -1020,8 +1393,13 @@ ChainCallbackResult BulletManager::OnUpdate(BulletManager *mgr)
 
             if ((ZunBool)(curLaser->timer.current >= curLaser->hitboxStartTime))
             {
+#ifdef BATCHED_BULLET_COLLISION
+                g_Player.CalcLaserHitboxBatched(&g_LaserBatch, idx, &laserCenter, &laserSize,
+                                                curLaser->timer.AsFrames() % 12 == 0);
+#else
                 g_Player.CalcLaserHitbox(&laserCenter, &laserSize, &curLaser->pos, curLaser->angle,
                                          curLaser->timer.AsFrames() % 12 == 0);
+#endif
             }
 
             if ((ZunBool)(curLaser->timer.current < curLaser->startTime))
@@ -1032,8 +1410,13 @@ ChainCallbackResult BulletManager::OnUpdate(BulletManager *mgr)
             curLaser->timer.InitializeForPopup();
             curLaser->state++;
         case 1:
+#ifdef BATCHED_BULLET_COLLISION
+            g_Player.CalcLaserHitboxBatched(&g_LaserBatch, idx, &laserCenter, &laserSize,
+                                            curLaser->timer.AsFrames() % 12 == 0);
+#else
             g_Player.CalcLaserHitbox(&laserCenter, &laserSize, &curLaser->pos, curLaser->angle,
                                      curLaser->timer.AsFrames() % 12 == 0);
+#endif
 
             if ((ZunBool)(curLaser->timer.current < curLaser->duration))
             {
@@ -1077,8 +1460,13 @@ ChainCallbackResult BulletManager::OnUpdate(BulletManager *mgr)
 
             if ((ZunBool)(curLaser->timer.current < curLaser->hitboxEndDelay))
             {
+#ifdef BATCHED_BULLET_COLLISION
+                g_Player.CalcLaserHitboxBatched(&g_LaserBatch, idx, &laserCenter, &laserSize,
+                                                curLaser->timer.AsFrames() % 12 == 0);
+#else
                 g_Player.CalcLaserHitbox(&laserCenter, &laserSize, &curLaser->pos, curLaser->angle,
                                          curLaser->timer.AsFrames() % 12 == 0);
+#endif
             }
 
             if ((ZunBool)(curLaser->timer.current < curLaser->despawnDuration))
@@ -1114,7 +1502,7 @@ ChainCallbackResult BulletManager::OnDraw(BulletManager *mgr)
     Bullet *curBullet1;
     Bullet *curBullet2;
 
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_ALWAYS);
+    D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_ALWAYS);
 
     for (curLaser = &mgr->lasers[0], idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->lasers); idx++, curLaser++)
     {
@@ -1213,6 +1601,9 @@ ChainCallbackResult BulletManager::OnDraw(BulletManager *mgr)
     }
     else
     {
+#ifdef BATCHED_SPRITES
+        g_AnmManager->BeginSpriteBatch(&g_BulletSpriteBatch);
+#endif
         for (curBullet2 = &mgr->bullets[0], idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->bullets); idx++, curBullet2++)
         {
             if (curBullet2->state == BULLET_STATE_UNUSED)
@@ -1225,6 +1616,9 @@ ChainCallbackResult BulletManager::OnDraw(BulletManager *mgr)
                 BulletManager::DrawBulletNoHwVertex(curBullet2);
             }
         }
+#ifdef BATCHED_SPRITES
+        g_AnmManager->EndSpriteBatchLayer(&g_BulletSpriteBatch);
+#endif
 
         for (curBullet2 = &mgr->bullets[0], idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->bullets); idx++, curBullet2++)
         {
@@ -1240,6 +1634,9 @@ ChainCallbackResult BulletManager::OnDraw(BulletManager *mgr)
                 BulletManager::DrawBulletNoHwVertex(curBullet2);
             }
         }
+#ifdef BATCHED_SPRITES
+        g_AnmManager->EndSpriteBatchLayer(&g_BulletSpriteBatch);
+#endif
 
         for (curBullet2 = &mgr->bullets[0], idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->bullets); idx++, curBullet2++)
         {
@@ -1255,6 +1652,9 @@ ChainCallbackResult BulletManager::OnDraw(BulletManager *mgr)
                 BulletManager::DrawBulletNoHwVertex(curBullet2);
             }
         }
+#ifdef BATCHED_SPRITES
+        g_AnmManager->EndSpriteBatchLayer(&g_BulletSpriteBatch);
+#endif
 
         for (curBullet2 = &mgr->bullets[0], idx = 0; idx < ARRAY_SIZE_SIGNED(mgr->bullets); idx++, curBullet2++)
         {
@@ -1268,9 +1668,15 @@ ChainCallbackResult BulletManager::OnDraw(BulletManager *mgr)
                 BulletManager::DrawBulletNoHwVertex(curBullet2);
             }
         }
+#ifdef BATCHED_SPRITES
+        g_AnmManager->EndSpriteBatchLayer(&g_BulletSpriteBatch);
+#endif
+#ifdef BATCHED_SPRITES
+        g_AnmManager->FlushSpriteBatch(&g_BulletSpriteBatch);
+#endif
     }
 
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
+    D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
 
     return CHAIN_CALLBACK_RESULT_CONTINUE;
 }
@@ -1344,7 +1750,11 @@ void BulletManager::DrawBulletNoHwVertex(Bullet *bullet)
         anmVm->rotation.z = (ZUN_PI / 2.0f) - bullet->angle;
     }
 
+#ifdef BATCHED_SPRITES
+    g_AnmManager->BatchSprite(&g_BulletSpriteBatch, anmVm);
+#else
     g_AnmManager->Draw(anmVm);
+#endif
 }
 
 ZunResult BulletManager::AddedCallback(BulletManager *mgr)
@@ -6,6 +6,13 @@
 #include "diffbuild.hpp"
 #include "inttypes.hpp"
 
+// BATCHED_BULLET_COLLISION moves every fired bullet before any of them is checked against the player, so their
+// hitboxes can be classified together, and rotates the player's hitbox into every laser's frame once per frame.
+// BulletManager::OnUpdate no longer matches the original binary with it.
+#if defined(BATCHED_BULLET_COLLISION) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "BATCHED_BULLET_COLLISION rewrites BulletManager::OnUpdate"
+#endif
+
 namespace th06
 {
 struct EnemyBulletShooter;
@@ -109,6 +116,10 @@ struct BulletManager
     static ChainCallbackResult OnUpdate(BulletManager *mgr);
     static ChainCallbackResult OnDraw(BulletManager *mgr);
 
+#ifdef BATCHED_BULLET_COLLISION
+    static ZunBool MoveBullet(Bullet *bullet);
+#endif
+
     static void DrawBulletNoHwVertex(Bullet *bullet);
     static void DrawBullet(Bullet *bullet);
 
@@ -1,4 +1,5 @@
 #include "Chain.hpp"
+#include "ChainProfiler.hpp"
 #include "utils.hpp"
 
 #include <new>
@@ -146,6 +147,14 @@ int Chain::RunCalcChain(void)
     ChainElem *tmp1;
     ChainElem *current;
     int updatedCount;
+#ifdef CHAIN_PROFILER
+    ChainCallbackResult result;
+
+    if (g_ChainProfiler.isEnabled)
+    {
+        g_ChainProfiler.frame++;
+    }
+#endif
 
 restart_from_first_job:
     updatedCount = 0;
@@ -156,7 +165,19 @@ restart_from_first_job:
         if (current->callback != NULL)
         {
         execute_again:
+#ifdef CHAIN_PROFILER
+            if (g_ChainProfiler.isEnabled)
+            {
+                result = g_ChainProfiler.RunCallback(current, ChainProfileChain_Calc);
+            }
+            else
+            {
+                result = current->callback(current->arg);
+            }
+            switch (result)
+#else
             switch (current->callback(current->arg))
+#endif
             {
             case CHAIN_CALLBACK_RESULT_CONTINUE_AND_REMOVE_JOB:
                 tmp1 = current;
@@ -199,6 +220,9 @@ int Chain::RunDrawChain(void)
     ChainElem *tmp1;
     ChainElem *current;
     int updatedCount;
+#ifdef CHAIN_PROFILER
+    ChainCallbackResult result;
+#endif
 
     updatedCount = 0;
     current = &this->drawChain;
@@ -208,7 +232,19 @@ int Chain::RunDrawChain(void)
         if (current->callback != NULL)
         {
         execute_again:
+#ifdef CHAIN_PROFILER
+            if (g_ChainProfiler.isEnabled)
+            {
+                result = g_ChainProfiler.RunCallback(current, ChainProfileChain_Draw);
+            }
+            else
+            {
+                result = current->callback(current->arg);
+            }
+            switch (result)
+#else
             switch (current->callback(current->arg))
+#endif
             {
             case CHAIN_CALLBACK_RESULT_CONTINUE_AND_REMOVE_JOB:
                 tmp1 = current;
@@ -0,0 +1,275 @@
+#include "ChainProfiler.hpp"
+#include "ChainPriorities.hpp"
+#include "ZunMemory.hpp"
+#include "utils.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace th06
+{
+ChainProfiler g_ChainProfiler;
+
+#define CHAIN_PROFILER_MAX_BINARY_NAMES 64
+
+struct ChainProfileDefaultName
+{
+    i16 chain;
+    i16 priority;
+    const char *name;
+};
+
+static ChainProfileDefaultName g_ChainProfileDefaultNames[] = {
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_SUPERVISOR, "Supervisor"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_ASCIIMANAGER, "AsciiManager"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_MAINMENU, "MainMenu"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_ENDING, "Ending"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_GAMEMANAGER, "GameManager"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_LOW_PRIO_REPLAYMANAGER_DEMO, "ReplayManager (demo)"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_STAGE, "Stage"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_PLAYER, "Player"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_ENEMYMANAGER, "EnemyManager"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_EFFECTMANAGER, "EffectManager"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_BULLETMANAGER, "BulletManager"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_GUI, "Gui"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_RESULTSCREEN, "ResultScreen"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_SCREENEFFECT, "ScreenEffect"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_REPLAYMANAGER, "ReplayManager"},
+    {ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_HIGH_PRIO_REPLAYMANAGER_DEMO, "ReplayManager (demo input)"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_MAINMENU, "MainMenu"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_ENDING, "Ending"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_GAMEMANAGER, "GameManager"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_HIGH_PRIO_STAGE, "Stage"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_LOW_PRIO_STAGE, "Stage (foreground)"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_LOW_PRIO_PLAYER, "Player"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_ENEMYMANAGER, "EnemyManager"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_HIGH_PRIO_PLAYER, "Player (hitbox)"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_EFFECTMANAGER, "EffectManager"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_BULLETMANAGER, "BulletManager"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_ASCIIMANAGER_POPUPS, "AsciiManager (popups)"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_GUI, "Gui"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_RESULTSCREEN, "ResultScreen"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_REPLAYMANAGER, "ReplayManager"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_SUPERVISOR, "Supervisor"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_ASCIIMANAGER_MENUS, "AsciiManager (menus)"},
+    {ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_SCREENEFFECT, "ScreenEffect"},
+};
+
+void ChainProfiler::Start()
+{
+    LARGE_INTEGER frequency;
+
+    if (this->ring == NULL)
+    {
+        this->ring = (ChainProfileEvent *)ZunAlloc(CHAIN_PROFILER_RING_SIZE * sizeof(ChainProfileEvent), "profiler");
+    }
+    memset(this->ring, 0, CHAIN_PROFILER_RING_SIZE * sizeof(ChainProfileEvent));
+    QueryPerformanceFrequency(&frequency);
+    this->ticksPerSecond = frequency.QuadPart;
+    this->written = 0;
+    this->frame = 0;
+    this->isEnabled = true;
+}
+
+// The events stay around for exporting.
+void ChainProfiler::Stop()
+{
+    this->isEnabled = false;
+}
+
+// NULL for a priority nothing in the game uses.
+const char *ChainProfiler::GetName(i32 chain, i32 priority)
+{
+    i32 idx;
+
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_ChainProfileDefaultNames); idx++)
+    {
+        if (g_ChainProfileDefaultNames[idx].chain == chain && g_ChainProfileDefaultNames[idx].priority == priority)
+        {
+            return g_ChainProfileDefaultNames[idx].name;
+        }
+    }
+    return NULL;
+}
+
+ChainCallbackResult ChainProfiler::RunCallback(ChainElem *elem, i32 chain)
+{
+    // The callback may cut and free its own element, so take what the event needs first.
+    ChainCallback callback = elem->callback;
+    i16 priority = elem->priority;
+    LARGE_INTEGER begin;
+    LARGE_INTEGER end;
+    ChainCallbackResult result;
+    ChainProfileEvent *event;
+    LONG idx;
+
+    QueryPerformanceCounter(&begin);
+    result = callback(elem->arg);
+    QueryPerformanceCounter(&end);
+
+    idx = this->written;
+    event = &this->ring[idx & (CHAIN_PROFILER_RING_SIZE - 1)];
+    InterlockedExchange(&event->sequence, 0);
+    event->frame = this->frame;
+    event->priority = priority;
+    event->chain = chain;
+    event->callback = callback;
+    event->begin = begin.QuadPart;
+    event->duration = (u32)(end.QuadPart - begin.QuadPart);
+    InterlockedExchange(&event->sequence, idx + 1);
+    InterlockedExchange(&this->written, idx + 1);
+    return result;
+}
+
+i32 ChainProfiler::Snapshot(ChainProfileEvent *events, i32 maxCount)
+{
+    ChainProfileEvent *event;
+    LONG written;
+    LONG first;
+    LONG idx;
+    i32 count;
+
+    if (this->ring == NULL)
+    {
+        return 0;
+    }
+    written = this->written;
+    first = written - ZUN_MIN(maxCount, CHAIN_PROFILER_RING_SIZE);
+    if (first < 0)
+    {
+        first = 0;
+    }
+    count = 0;
+    for (idx = first; idx < written; idx++)
+    {
+        event = &this->ring[idx & (CHAIN_PROFILER_RING_SIZE - 1)];
+        if (event->sequence != idx + 1)
+        {
+            continue;
+        }
+        events[count] = *event;
+        // Overwritten by the game thread while being copied.
+        if (event->sequence != idx + 1)
+        {
+            continue;
+        }
+        count++;
+    }
+    return count;
+}
+
+ZunResult ChainProfiler::ExportChromeTrace(const char *path)
+{
+    ChainProfileEvent *events;
+    ChainProfileEvent *event;
+    const char *name;
+    FILE *file;
+    f64 ticksPerMicrosecond;
+    i32 count;
+    i32 idx;
+
+    file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    events = (ChainProfileEvent *)ZunAlloc(CHAIN_PROFILER_RING_SIZE * sizeof(ChainProfileEvent), "profiler");
+    count = this->Snapshot(events, CHAIN_PROFILER_RING_SIZE);
+    ticksPerMicrosecond = this->ticksPerSecond / 1000000.0;
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"calc chain\"}},\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"draw chain\"}}");
+    for (event = events, idx = 0; idx < count; idx++, event++)
+    {
+        name = this->GetName(event->chain, event->priority);
+        fprintf(file, ",\n{\"name\":\"");
+        if (name != NULL)
+        {
+            fprintf(file, "%s", name);
+        }
+        else
+        {
+            fprintf(file, "%s %d", event->chain == ChainProfileChain_Calc ? "calc" : "draw", event->priority);
+        }
+        fprintf(file, "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,",
+                event->chain == ChainProfileChain_Calc ? "calc" : "draw", event->chain + 1,
+                (event->begin - events[0].begin) / ticksPerMicrosecond, event->duration / ticksPerMicrosecond);
+        fprintf(file, "\"args\":{\"priority\":%d,\"frame\":%u}}", event->priority, event->frame);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    ZunFree(events);
+    fclose(file);
+    return ZUN_SUCCESS;
+}
+
+ZunResult ChainProfiler::ExportBinary(const char *path)
+{
+    ChainProfileBinaryHeader header;
+    ChainProfileBinaryName binaryNames[CHAIN_PROFILER_MAX_BINARY_NAMES];
+    ChainProfileBinaryEvent binaryEvent;
+    ChainProfileEvent *events;
+    ChainProfileEvent *event;
+    const char *name;
+    FILE *file;
+    i32 nameIdx;
+    i32 count;
+    i32 idx;
+
+    file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    events = (ChainProfileEvent *)ZunAlloc(CHAIN_PROFILER_RING_SIZE * sizeof(ChainProfileEvent), "profiler");
+    count = this->Snapshot(events, CHAIN_PROFILER_RING_SIZE);
+
+    // One name per chain and priority that shows up, whichever callback ran there first.
+    memset(binaryNames, 0, sizeof(binaryNames));
+    header.nameCount = 0;
+    for (event = events, idx = 0; idx < count; idx++, event++)
+    {
+        for (nameIdx = 0; nameIdx < (i32)header.nameCount; nameIdx++)
+        {
+            if (binaryNames[nameIdx].chain == event->chain && binaryNames[nameIdx].priority == event->priority)
+            {
+                break;
+            }
+        }
+        if (nameIdx < (i32)header.nameCount || header.nameCount >= ARRAY_SIZE(binaryNames))
+        {
+            continue;
+        }
+        name = this->GetName(event->chain, event->priority);
+        binaryNames[nameIdx].chain = event->chain;
+        binaryNames[nameIdx].priority = event->priority;
+        if (name != NULL)
+        {
+            strncpy(binaryNames[nameIdx].name, name, sizeof(binaryNames[nameIdx].name) - 1);
+        }
+        header.nameCount++;
+    }
+
+    memcpy(header.magic, "CHPF", sizeof(header.magic));
+    header.version = 1;
+    header.ticksPerSecond = this->ticksPerSecond;
+    header.eventCount = count;
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(binaryNames, sizeof(ChainProfileBinaryName), header.nameCount, file);
+    for (event = events, idx = 0; idx < count; idx++, event++)
+    {
+        binaryEvent.begin = event->begin;
+        binaryEvent.duration = event->duration;
+        binaryEvent.frame = event->frame;
+        binaryEvent.priority = event->priority;
+        binaryEvent.chain = event->chain;
+        binaryEvent.unused = 0;
+        fwrite(&binaryEvent, sizeof(binaryEvent), 1, file);
+    }
+
+    ZunFree(events);
+    fclose(file);
+    return ZUN_SUCCESS;
+}
+}; // namespace th06
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "Chain.hpp"
+#include "ZunBool.hpp"
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
+// CHAIN_PROFILER has Chain::RunCalcChain and Chain::RunDrawChain time their callbacks through g_ChainProfiler, so
+// neither matches the original binary any more.
+#if defined(CHAIN_PROFILER) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "CHAIN_PROFILER changes the chain loops"
+#endif
+
+namespace th06
+{
+// Power of two; at about 30 callbacks a frame this holds the last half minute of play.
+#define CHAIN_PROFILER_RING_SIZE 0x10000
+
+enum ChainProfileChain
+{
+    ChainProfileChain_Calc,
+    ChainProfileChain_Draw,
+};
+
+struct ChainProfileEvent
+{
+    // Written last; an event is only valid when this matches the ring position it was read from.
+    volatile LONG sequence;
+    u32 frame;
+    i16 priority;
+    u8 chain;
+    u8 unused;
+    ChainCallback callback;
+    // QueryPerformanceCounter ticks.
+    LONGLONG begin;
+    u32 duration;
+};
+
+// The compact export is this header, nameCount ChainProfileBinaryName, then eventCount ChainProfileBinaryEvent, all
+// little endian. Events are in the order they ran.
+struct ChainProfileBinaryHeader
+{
+    char magic[4];
+    u32 version;
+    LONGLONG ticksPerSecond;
+    u32 nameCount;
+    u32 eventCount;
+};
+
+struct ChainProfileBinaryName
+{
+    u8 chain;
+    u8 unused;
+    i16 priority;
+    char name[28];
+};
+
+struct ChainProfileBinaryEvent
+{
+    LONGLONG begin;
+    u32 duration;
+    u32 frame;
+    i16 priority;
+    u8 chain;
+    u8 unused;
+};
+
+// Times every callback the chains run while enabled. The game thread is the only writer and never waits: events go
+// into a ring that overwrites its oldest entries, and an export, from any thread, takes whatever is complete at the
+// time.
+//
+// Callbacks are named after their chain priority in ChainPriorities.hpp.
+struct ChainProfiler
+{
+    void Start();
+    void Stop();
+    const char *GetName(i32 chain, i32 priority);
+
+    ChainCallbackResult RunCallback(ChainElem *elem, i32 chain);
+    // Copies out the events still in the ring, oldest first, and returns how many there were.
+    i32 Snapshot(ChainProfileEvent *events, i32 maxCount);
+
+    ZunResult ExportChromeTrace(const char *path);
+    ZunResult ExportBinary(const char *path);
+
+    ZunBool isEnabled;
+    u32 frame;
+    LONGLONG ticksPerSecond;
+    ChainProfileEvent *ring;
+    // Events ever written; the newest is at (written - 1) % CHAIN_PROFILER_RING_SIZE.
+    volatile LONG written;
+};
+
+extern ChainProfiler g_ChainProfiler;
+}; // namespace th06
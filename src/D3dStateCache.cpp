@@ -0,0 +1,85 @@
+#include "D3dStateCache.hpp"
+#include "Supervisor.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+namespace th06
+{
+D3dStateCache g_D3dStateCache;
+
+void D3dStateCache::Invalidate()
+{
+    memset(this->renderStateKnown, 0, sizeof(this->renderStateKnown));
+    memset(this->textureStageStateKnown, 0, sizeof(this->textureStageStateKnown));
+    memset(this->textureKnown, 0, sizeof(this->textureKnown));
+    this->vertexShaderKnown = false;
+}
+
+void D3dStateCache::EndFrame()
+{
+    this->lastFrame = this->thisFrame;
+    memset(&this->thisFrame, 0, sizeof(this->thisFrame));
+}
+
+void D3dStateCache::SetRenderState(D3DRENDERSTATETYPE state, DWORD value)
+{
+    if ((u32)state < ARRAY_SIZE(this->renderStates))
+    {
+        if (this->renderStateKnown[state] && this->renderStates[state] == value)
+        {
+            this->thisFrame.redundant++;
+            return;
+        }
+        this->renderStates[state] = value;
+        this->renderStateKnown[state] = true;
+    }
+    this->thisFrame.renderStates++;
+    g_Supervisor.d3dDevice->SetRenderState(state, value);
+}
+
+void D3dStateCache::SetTextureStageState(DWORD stage, D3DTEXTURESTAGESTATETYPE type, DWORD value)
+{
+    if (stage < ARRAY_SIZE(this->textureStageStates) && (u32)type < ARRAY_SIZE(this->textureStageStates[0]))
+    {
+        if (this->textureStageStateKnown[stage][type] && this->textureStageStates[stage][type] == value)
+        {
+            this->thisFrame.redundant++;
+            return;
+        }
+        this->textureStageStates[stage][type] = value;
+        this->textureStageStateKnown[stage][type] = true;
+    }
+    this->thisFrame.textureStageStates++;
+    g_Supervisor.d3dDevice->SetTextureStageState(stage, type, value);
+}
+
+void D3dStateCache::SetTexture(DWORD stage, IDirect3DBaseTexture8 *texture)
+{
+    if (stage < ARRAY_SIZE(this->textures))
+    {
+        if (this->textureKnown[stage] && this->textures[stage] == texture)
+        {
+            this->thisFrame.redundant++;
+            return;
+        }
+        this->textures[stage] = texture;
+        this->textureKnown[stage] = true;
+    }
+    this->thisFrame.textures++;
+    g_Supervisor.d3dDevice->SetTexture(stage, texture);
+}
+
+void D3dStateCache::SetVertexShader(DWORD handle)
+{
+    if (this->vertexShaderKnown && this->vertexShader == handle)
+    {
+        this->thisFrame.redundant++;
+        return;
+    }
+    this->vertexShader = handle;
+    this->vertexShaderKnown = true;
+    this->thisFrame.vertexShaders++;
+    g_Supervisor.d3dDevice->SetVertexShader(handle);
+}
+}; // namespace th06
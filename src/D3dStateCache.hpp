@@ -0,0 +1,70 @@
+#pragma once
+
+#include <d3d8.h>
+
+#include "inttypes.hpp"
+
+// D3D_STATE_CACHE sends the game's SetRenderState, SetTextureStageState, SetTexture and SetVertexShader calls through
+// g_D3dStateCache instead of straight to the device. Every function making them stops matching the original binary.
+#if defined(D3D_STATE_CACHE) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "D3D_STATE_CACHE changes every call site that sets device state"
+#endif
+
+// The call sites use these, so that without D3D_STATE_CACHE they expand to the original device calls.
+#ifdef D3D_STATE_CACHE
+#define D3D_SET_RENDER_STATE(state, value) g_D3dStateCache.SetRenderState(state, value)
+#define D3D_SET_TEXTURE_STAGE_STATE(stage, type, value) g_D3dStateCache.SetTextureStageState(stage, type, value)
+#define D3D_SET_TEXTURE(stage, texture) g_D3dStateCache.SetTexture(stage, texture)
+#define D3D_SET_VERTEX_SHADER(handle) g_D3dStateCache.SetVertexShader(handle)
+#else
+#define D3D_SET_RENDER_STATE(state, value) g_Supervisor.d3dDevice->SetRenderState(state, value)
+#define D3D_SET_TEXTURE_STAGE_STATE(stage, type, value) g_Supervisor.d3dDevice->SetTextureStageState(stage, type, value)
+#define D3D_SET_TEXTURE(stage, texture) g_Supervisor.d3dDevice->SetTexture(stage, texture)
+#define D3D_SET_VERTEX_SHADER(handle) g_Supervisor.d3dDevice->SetVertexShader(handle)
+#endif
+
+namespace th06
+{
+#define D3D_STATE_CACHE_RENDER_STATES 256
+#define D3D_STATE_CACHE_STAGES 8
+#define D3D_STATE_CACHE_STAGE_STATES 32
+
+struct D3dStateCounters
+{
+    // Calls that reached the device.
+    i32 renderStates;
+    i32 textureStageStates;
+    i32 textures;
+    i32 vertexShaders;
+    // Calls dropped because the device already had that value.
+    i32 redundant;
+};
+
+// Shadow of the device state the game changes per draw. With D3D_STATE_CACHE every SetRenderState,
+// SetTextureStageState, SetTexture and SetVertexShader goes through here, so a value the device already holds is never
+// sent twice, whichever manager set it last. Anything that resets the device behind its back must call Invalidate.
+struct D3dStateCache
+{
+    void Invalidate();
+    void EndFrame();
+
+    void SetRenderState(D3DRENDERSTATETYPE state, DWORD value);
+    void SetTextureStageState(DWORD stage, D3DTEXTURESTAGESTATETYPE type, DWORD value);
+    void SetTexture(DWORD stage, IDirect3DBaseTexture8 *texture);
+    void SetVertexShader(DWORD handle);
+
+    DWORD renderStates[D3D_STATE_CACHE_RENDER_STATES];
+    DWORD textureStageStates[D3D_STATE_CACHE_STAGES][D3D_STATE_CACHE_STAGE_STATES];
+    IDirect3DBaseTexture8 *textures[D3D_STATE_CACHE_STAGES];
+    DWORD vertexShader;
+    u8 renderStateKnown[D3D_STATE_CACHE_RENDER_STATES];
+    u8 textureStageStateKnown[D3D_STATE_CACHE_STAGES][D3D_STATE_CACHE_STAGE_STATES];
+    u8 textureKnown[D3D_STATE_CACHE_STAGES];
+    u8 vertexShaderKnown;
+
+    D3dStateCounters thisFrame;
+    D3dStateCounters lastFrame;
+};
+
+extern D3dStateCache g_D3dStateCache;
+}; // namespace th06
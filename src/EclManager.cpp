@@ -11,6 +11,7 @@
 #include "Player.hpp"
 #include "Rng.hpp"
 #include "Stage.hpp"
+#include "ZunMemory.hpp"
 #include "utils.hpp"
 
 namespace th06
@@ -40,12 +41,17 @@ DIFFABLE_STATIC_ARRAY_ASSIGN(ExInsn, 17, g_EclExInsn) = {EnemyEclInstr::ExInsCir
                                                          EnemyEclInstr::ExInsStageXFunc14,
                                                          EnemyEclInstr::ExInsStageXFunc15,
                                                          EnemyEclInstr::ExInsFlandreFinalContextUpdate};
+EclProgram g_EclProgram;
 
 ZunResult EclManager::Load(char *eclPath)
 {
     i32 idx;
 
+#ifdef ZUN_ARENAS
+    this->eclFile = (EclRawHeader *)FileSystem::OpenPath(eclPath, false, ZUN_ARENA_STAGE);
+#else
     this->eclFile = (EclRawHeader *)FileSystem::OpenPath(eclPath, false);
+#endif
     if (this->eclFile == NULL)
     {
         g_GameErrorContext.Log(TH_ERR_ECLMANAGER_ENEMY_DATA_CORRUPT);
@@ -59,6 +65,12 @@ ZunResult EclManager::Load(char *eclPath)
         this->subTable[idx] = (EclRawInstr *)((int)this->subTable[idx] + (int)this->eclFile);
     }
     this->timeline = this->eclFile->timelineOffsets[0];
+#ifdef PREDECODED_ECL
+    if (this->Predecode(g_LastFileSize) != ZUN_SUCCESS)
+    {
+        utils::DebugPrint2("error : ecl predecode failed\n");
+    }
+#endif
     return ZUN_SUCCESS;
 }
 
@@ -66,10 +78,17 @@ void EclManager::Unload()
 {
     EclRawHeader *file;
 
+#ifdef PREDECODED_ECL
+    this->ReleasePredecoded();
+#endif
     if (this->eclFile != NULL)
     {
         file = this->eclFile;
+#ifdef ZUN_ARENAS
+        ZunFree(file, ZUN_ARENA_STAGE);
+#else
         free(file);
+#endif
     }
     this->eclFile = NULL;
     return;
@@ -83,13 +102,514 @@ ZunResult EclManager::CallEclSub(EnemyEclContext *ctx, i16 subId)
     return ZUN_SUCCESS;
 }
 
+static i32 *ResolveOperand(Enemy *enemy, EclOperand *operand)
+{
+    if (operand->literal != NULL)
+    {
+        return operand->literal;
+    }
+    return (i32 *)((u8 *)enemy + operand->enemyOffset);
+}
+
+static ZunBool EclSetInt(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *ResolveOperand(enemy, &decoded->res) = *ResolveOperand(enemy, &decoded->lhs);
+    return false;
+}
+
+static ZunBool EclSetFloat(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *(f32 *)ResolveOperand(enemy, &decoded->res) = *(f32 *)ResolveOperand(enemy, &decoded->lhs);
+    return false;
+}
+
+static ZunBool EclAddInt(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *ResolveOperand(enemy, &decoded->res) =
+        *ResolveOperand(enemy, &decoded->lhs) + *ResolveOperand(enemy, &decoded->rhs);
+    return false;
+}
+
+static ZunBool EclAddFloat(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *(f32 *)ResolveOperand(enemy, &decoded->res) =
+        *(f32 *)ResolveOperand(enemy, &decoded->lhs) + *(f32 *)ResolveOperand(enemy, &decoded->rhs);
+    return false;
+}
+
+static ZunBool EclSubInt(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *ResolveOperand(enemy, &decoded->res) =
+        *ResolveOperand(enemy, &decoded->lhs) - *ResolveOperand(enemy, &decoded->rhs);
+    return false;
+}
+
+static ZunBool EclSubFloat(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *(f32 *)ResolveOperand(enemy, &decoded->res) =
+        *(f32 *)ResolveOperand(enemy, &decoded->lhs) - *(f32 *)ResolveOperand(enemy, &decoded->rhs);
+    return false;
+}
+
+static ZunBool EclMulInt(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *ResolveOperand(enemy, &decoded->res) =
+        *ResolveOperand(enemy, &decoded->lhs) * *ResolveOperand(enemy, &decoded->rhs);
+    return false;
+}
+
+static ZunBool EclMulFloat(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *(f32 *)ResolveOperand(enemy, &decoded->res) =
+        *(f32 *)ResolveOperand(enemy, &decoded->lhs) * *(f32 *)ResolveOperand(enemy, &decoded->rhs);
+    return false;
+}
+
+static ZunBool EclDivInt(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *ResolveOperand(enemy, &decoded->res) =
+        *ResolveOperand(enemy, &decoded->lhs) / *ResolveOperand(enemy, &decoded->rhs);
+    return false;
+}
+
+static ZunBool EclDivFloat(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *(f32 *)ResolveOperand(enemy, &decoded->res) =
+        *(f32 *)ResolveOperand(enemy, &decoded->lhs) / *(f32 *)ResolveOperand(enemy, &decoded->rhs);
+    return false;
+}
+
+static ZunBool EclModInt(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *ResolveOperand(enemy, &decoded->res) =
+        *ResolveOperand(enemy, &decoded->lhs) % *ResolveOperand(enemy, &decoded->rhs);
+    return false;
+}
+
+static ZunBool EclModFloat(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *(f32 *)ResolveOperand(enemy, &decoded->res) =
+        fmodf(*(f32 *)ResolveOperand(enemy, &decoded->lhs), *(f32 *)ResolveOperand(enemy, &decoded->rhs));
+    return false;
+}
+
+static ZunBool EclInc(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *ResolveOperand(enemy, &decoded->res) += 1;
+    return false;
+}
+
+static ZunBool EclDec(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    *ResolveOperand(enemy, &decoded->res) -= 1;
+    return false;
+}
+
+static ZunBool EclCmpInt(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    i32 lhs = *ResolveOperand(enemy, &decoded->lhs);
+    i32 rhs = *ResolveOperand(enemy, &decoded->rhs);
+
+    enemy->currentContext.compareRegister = lhs == rhs ? 0 : lhs < rhs ? -1 : 1;
+    return false;
+}
+
+static ZunBool EclCmpFloat(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    f32 lhs = *(f32 *)ResolveOperand(enemy, &decoded->lhs);
+    f32 rhs = *(f32 *)ResolveOperand(enemy, &decoded->rhs);
+
+    enemy->currentContext.compareRegister = lhs == rhs ? 0 : (lhs < rhs ? -1 : 1);
+    return false;
+}
+
+static ZunBool EclJumpDec(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    i32 *counter;
+    i32 *value;
+    i32 remaining;
+
+    counter = ResolveOperand(enemy, &decoded->res);
+    remaining = *counter - 1;
+    // SetVar reads its source through GetVar too, so a count that lands on a variable id copies that variable.
+    value = EnemyEclInstr::GetVar(enemy, (EclVarId *)&remaining, NULL);
+    if (decoded->res.valueType == ECL_VALUE_TYPE_INT)
+    {
+        *counter = *value;
+    }
+    else if (decoded->res.valueType == ECL_VALUE_TYPE_FLOAT)
+    {
+        *(f32 *)counter = *(f32 *)value;
+    }
+    return remaining > 0;
+}
+
+static ZunBool EclJump(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    return true;
+}
+
+static ZunBool EclJumpLss(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    return enemy->currentContext.compareRegister < 0;
+}
+
+static ZunBool EclJumpLeq(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    return enemy->currentContext.compareRegister <= 0;
+}
+
+static ZunBool EclJumpEqu(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    return enemy->currentContext.compareRegister == 0;
+}
+
+static ZunBool EclJumpGre(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    return enemy->currentContext.compareRegister > 0;
+}
+
+static ZunBool EclJumpGeq(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    return enemy->currentContext.compareRegister >= 0;
+}
+
+static ZunBool EclJumpNeq(Enemy *enemy, EclDecodedInstr *decoded)
+{
+    return enemy->currentContext.compareRegister != 0;
+}
+
+// Indexed by (opcode - ECL_OPCODE_MATHINTADD) % 7 for the integer and float math opcodes.
+static EclHandler g_EclIntMathHandlers[5] = {EclAddInt, EclSubInt, EclMulInt, EclDivInt, EclModInt};
+static EclHandler g_EclFloatMathHandlers[5] = {EclAddFloat, EclSubFloat, EclMulFloat, EclDivFloat, EclModFloat};
+static EclHandler g_EclJumpHandlers[6] = {EclJumpLss, EclJumpLeq, EclJumpEqu, EclJumpGre, EclJumpGeq, EclJumpNeq};
+
+// Resolves varId the way GetVar would for an operand stored at arg. Fails for operands that must keep going through
+// GetVar at run time.
+static ZunBool DecodeOperand(EclOperand *operand, i32 *arg, i32 varId)
+{
+    EclValueType valueType;
+    Enemy *probe;
+    i32 *var;
+
+    operand->literal = NULL;
+    operand->enemyOffset = 0;
+    operand->valueType = ECL_VALUE_TYPE_UNDEFINED;
+    if (varId > ECL_VAR_I32_0 || varId < ECL_VAR_PLAYER_SHOT)
+    {
+        operand->literal = arg;
+        return true;
+    }
+    if (varId == ECL_VAR_PLAYER_ANGLE || varId == ECL_VAR_PLAYER_DISTANCE || varId == ECL_VAR_PLAYER_SHOT)
+    {
+        return false;
+    }
+
+    // Ask GetVar itself where the variable lives, so the two can never disagree.
+    probe = &g_EnemyManager.enemies[0];
+    var = EnemyEclInstr::GetVar(probe, (EclVarId *)&varId, &valueType);
+    if ((u8 *)var < (u8 *)probe || (u8 *)var >= (u8 *)(probe + 1))
+    {
+        return false;
+    }
+    operand->enemyOffset = (u8 *)var - (u8 *)probe;
+    operand->valueType = valueType;
+    return true;
+}
+
+static ZunBool DecodeIntOperand(EclOperand *operand, i32 *arg)
+{
+    return DecodeOperand(operand, arg, *arg);
+}
+
+static ZunBool DecodeFloatOperand(EclOperand *operand, f32 *arg)
+{
+    // Matches GetVarFloat, which truncates the float to find the variable id.
+    return DecodeOperand(operand, (i32 *)arg, (i32)*arg);
+}
+
+static EclHandler DecodeHandler(EclDecodedInstr *decoded)
+{
+    EclRawInstrArgs *args = &decoded->raw->args;
+    i16 opCode = decoded->raw->opCode;
+
+    switch (opCode)
+    {
+    case ECL_OPCODE_JUMP:
+        return EclJump;
+    case ECL_OPCODE_JUMPDEC:
+        if (!DecodeIntOperand(&decoded->res, (i32 *)&args->jump.var))
+        {
+            return NULL;
+        }
+        return EclJumpDec;
+    case ECL_OPCODE_JUMPLSS:
+    case ECL_OPCODE_JUMPLEQ:
+    case ECL_OPCODE_JUMPEQU:
+    case ECL_OPCODE_JUMPGRE:
+    case ECL_OPCODE_JUMPGEQ:
+    case ECL_OPCODE_JUMPNEQ:
+        return g_EclJumpHandlers[opCode - ECL_OPCODE_JUMPLSS];
+    case ECL_OPCODE_SETINT:
+    case ECL_OPCODE_SETFLOAT:
+        if (!DecodeIntOperand(&decoded->res, (i32 *)&args->alu.res) ||
+            !DecodeIntOperand(&decoded->lhs, &args->alu.arg1.i32))
+        {
+            return NULL;
+        }
+        if (decoded->res.valueType == ECL_VALUE_TYPE_INT)
+        {
+            return EclSetInt;
+        }
+        if (decoded->res.valueType == ECL_VALUE_TYPE_FLOAT)
+        {
+            return EclSetFloat;
+        }
+        return NULL;
+    case ECL_OPCODE_MATHINTADD:
+    case ECL_OPCODE_MATHINTSUB:
+    case ECL_OPCODE_MATHINTMUL:
+    case ECL_OPCODE_MATHINTDIV:
+    case ECL_OPCODE_MATHINTMOD:
+    case ECL_OPCODE_MATHFLOATADD:
+    case ECL_OPCODE_MATHFLOATSUB:
+    case ECL_OPCODE_MATHFLOATMUL:
+    case ECL_OPCODE_MATHFLOATDIV:
+    case ECL_OPCODE_MATHFLOATMOD:
+        // Like the EnemyEclInstr::Math* helpers, the output variable's type picks the arithmetic, not the opcode.
+        if (!DecodeIntOperand(&decoded->res, (i32 *)&args->alu.res))
+        {
+            return NULL;
+        }
+        if (decoded->res.valueType == ECL_VALUE_TYPE_INT)
+        {
+            if (!DecodeIntOperand(&decoded->lhs, &args->alu.arg1.i32) ||
+                !DecodeIntOperand(&decoded->rhs, &args->alu.arg2.i32))
+            {
+                return NULL;
+            }
+            return g_EclIntMathHandlers[(opCode - ECL_OPCODE_MATHINTADD) % 7];
+        }
+        if (decoded->res.valueType == ECL_VALUE_TYPE_FLOAT)
+        {
+            if (!DecodeFloatOperand(&decoded->lhs, &args->alu.arg1.f32) ||
+                !DecodeFloatOperand(&decoded->rhs, &args->alu.arg2.f32))
+            {
+                return NULL;
+            }
+            return g_EclFloatMathHandlers[(opCode - ECL_OPCODE_MATHINTADD) % 7];
+        }
+        return NULL;
+    case ECL_OPCODE_MATHINC:
+    case ECL_OPCODE_MATHDEC:
+        // A literal operand here would be modified in place, so only variables are handled.
+        if (!DecodeIntOperand(&decoded->res, (i32 *)&args->alu.res) || decoded->res.literal != NULL)
+        {
+            return NULL;
+        }
+        return opCode == ECL_OPCODE_MATHINC ? EclInc : EclDec;
+    case ECL_OPCODE_CMPINT:
+        if (!DecodeIntOperand(&decoded->lhs, &args->cmp.lhs.i32) ||
+            !DecodeIntOperand(&decoded->rhs, &args->cmp.rhs.i32))
+        {
+            return NULL;
+        }
+        return EclCmpInt;
+    case ECL_OPCODE_CMPFLOAT:
+        if (!DecodeFloatOperand(&decoded->lhs, &args->cmp.lhs.f32) ||
+            !DecodeFloatOperand(&decoded->rhs, &args->cmp.rhs.f32))
+        {
+            return NULL;
+        }
+        return EclCmpFloat;
+    }
+    return NULL;
+}
+
+static EclDecodedInstr *FindDecoded(EclRawInstr *instr)
+{
+    EclDecodedInstr *decoded;
+    u32 offset;
+
+    if (g_EclProgram.decodedIdx == NULL)
+    {
+        return NULL;
+    }
+    offset = (u8 *)instr - (u8 *)g_EclManager.eclFile;
+    if (offset >= (u32)(g_EclProgram.fileEnd - (u8 *)g_EclManager.eclFile) ||
+        g_EclProgram.decodedIdx[offset] >= g_EclProgram.count)
+    {
+        return NULL;
+    }
+    decoded = &g_EclProgram.instrs[g_EclProgram.decodedIdx[offset]];
+    return decoded->raw == instr ? decoded : NULL;
+}
+
+static ZunBool IsInstrInFile(EclRawInstr *instr)
+{
+    return (u8 *)instr >= (u8 *)g_EclManager.eclFile && (u8 *)&instr->args <= g_EclProgram.fileEnd;
+}
+
+static EclDecodedInstr *FindDecodedInFile(EclRawInstr *instr)
+{
+    if (!IsInstrInFile(instr))
+    {
+        return NULL;
+    }
+    return FindDecoded(instr);
+}
+
+// Skipping an instruction on this difficulty only falls through to the next one, and only once its time comes up.
+// When the next instruction has that same time, arriving at either one behaves identically, so the skipped one can
+// be stepped over ahead of time.
+static EclRawInstr *SkipPruned(EclRawInstr *instr, i32 difficultyMask)
+{
+    EclRawInstr *next;
+
+    while (FindDecodedInFile(instr) != NULL && !(instr->skipForDifficulty & difficultyMask))
+    {
+        next = (EclRawInstr *)((u8 *)instr + instr->offsetToNext);
+        if (FindDecodedInFile(next) == NULL || next->time != instr->time)
+        {
+            break;
+        }
+        instr = next;
+        g_EclProgram.prunedCount++;
+    }
+    return instr;
+}
+
+static ZunBool IsDecodableInstr(EclRawInstr *instr)
+{
+    // Each sub ends with an instruction whose time is -1.
+    return IsInstrInFile(instr) && instr->time != -1 && instr->offsetToNext >= (i32)offsetof(EclRawInstr, args) &&
+           (u8 *)instr + instr->offsetToNext <= g_EclProgram.fileEnd;
+}
+
+ZunResult EclManager::Predecode(u32 fileSize)
+{
+    EclRawInstr *instr;
+    EclDecodedInstr *decoded;
+    i32 subIdx;
+    i32 idx;
+    i32 pass;
+    i32 difficultyMask;
+
+    this->ReleasePredecoded();
+    g_EclProgram.difficulty = g_GameManager.difficulty;
+    difficultyMask = 1 << g_GameManager.difficulty;
+#ifdef ZUN_ARENAS
+    g_EclProgram.decodedIdx = (u16 *)ZunAlloc(fileSize * sizeof(u16), ZUN_ARENA_STAGE);
+#else
+    g_EclProgram.decodedIdx = (u16 *)ZunAlloc(fileSize * sizeof(u16), "ecl program");
+#endif
+    if (g_EclProgram.decodedIdx == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    memset(g_EclProgram.decodedIdx, 0, fileSize * sizeof(u16));
+    g_EclProgram.fileEnd = (u8 *)this->eclFile + fileSize;
+
+    // Walk every sub twice: once to count its instructions, then again to fill them in.
+    for (pass = 0; pass < 2; pass++)
+    {
+        idx = 0;
+        for (subIdx = 0; subIdx < this->eclFile->subCount; subIdx++)
+        {
+            for (instr = this->subTable[subIdx]; IsDecodableInstr(instr);
+                 instr = (EclRawInstr *)((u8 *)instr + instr->offsetToNext))
+            {
+                if (pass == 0)
+                {
+                    idx++;
+                    continue;
+                }
+                // Subs sharing a tail only need it decoded once.
+                if (FindDecoded(instr) != NULL)
+                {
+                    break;
+                }
+                g_EclProgram.decodedIdx[(u8 *)instr - (u8 *)this->eclFile] = idx;
+                g_EclProgram.instrs[idx].raw = instr;
+                g_EclProgram.count = ++idx;
+            }
+        }
+        if (pass == 0)
+        {
+            if (idx > 0xffff)
+            {
+                return ZUN_ERROR;
+            }
+#ifdef ZUN_ARENAS
+            g_EclProgram.instrs = (EclDecodedInstr *)ZunAlloc(idx * sizeof(EclDecodedInstr), ZUN_ARENA_STAGE);
+#else
+            g_EclProgram.instrs = (EclDecodedInstr *)ZunAlloc(idx * sizeof(EclDecodedInstr), "ecl program");
+#endif
+            if (g_EclProgram.instrs == NULL)
+            {
+                return ZUN_ERROR;
+            }
+            memset(g_EclProgram.instrs, 0, idx * sizeof(EclDecodedInstr));
+        }
+    }
+
+    for (idx = 0, decoded = g_EclProgram.instrs; idx < g_EclProgram.count; idx++, decoded++)
+    {
+        instr = decoded->raw;
+        decoded->next = SkipPruned((EclRawInstr *)((u8 *)instr + instr->offsetToNext), difficultyMask);
+        if (instr->opCode == ECL_OPCODE_JUMP || instr->opCode == ECL_OPCODE_JUMPDEC ||
+            (instr->opCode >= ECL_OPCODE_JUMPLSS && instr->opCode <= ECL_OPCODE_JUMPNEQ))
+        {
+            decoded->jumpTarget =
+                SkipPruned((EclRawInstr *)((u8 *)instr + instr->args.jump.offset), difficultyMask);
+        }
+        decoded->handler = DecodeHandler(decoded);
+        if (decoded->handler != NULL)
+        {
+            g_EclProgram.handlerCount++;
+        }
+    }
+    return ZUN_SUCCESS;
+}
+
+void EclManager::ReleasePredecoded()
+{
+    if (g_EclProgram.instrs != NULL)
+    {
+#ifdef ZUN_ARENAS
+        ZunFree(g_EclProgram.instrs, ZUN_ARENA_STAGE);
+#else
+        ZunFree(g_EclProgram.instrs);
+#endif
+    }
+    if (g_EclProgram.decodedIdx != NULL)
+    {
+#ifdef ZUN_ARENAS
+        ZunFree(g_EclProgram.decodedIdx, ZUN_ARENA_STAGE);
+#else
+        ZunFree(g_EclProgram.decodedIdx);
+#endif
+    }
+    memset(&g_EclProgram, 0, sizeof(g_EclProgram));
+}
+
+#ifdef PREDECODED_ECL
+#pragma var_order(local_8, local_14, local_18, args, instruction, local_24, local_28, local_2c, local_30, local_34,    \
+                  local_38, local_3c, local_40, local_44, local_48, local_4c, local_50, local_54, local_58, local_5c,  \
+                  local_60, local_64, local_68, local_6c, local_70, local_74, csum, scoreIncrease, local_80, local_84, \
+                  local_88, local_8c, local_98, local_b0, local_b4, local_b8, local_bc, local_c0, decoded)
+#else
 #pragma var_order(local_8, local_14, local_18, args, instruction, local_24, local_28, local_2c, local_30, local_34,    \
                   local_38, local_3c, local_40, local_44, local_48, local_4c, local_50, local_54, local_58, local_5c,  \
                   local_60, local_64, local_68, local_6c, local_70, local_74, csum, scoreIncrease, local_80, local_84, \
                   local_88, local_8c, local_98, local_b0, local_b4, local_b8, local_bc, local_c0)
+#endif
 ZunResult EclManager::RunEcl(Enemy *enemy)
 {
     EclRawInstr *instruction;
+#ifdef PREDECODED_ECL
+    EclDecodedInstr *decoded;
+#endif
     EclRawInstrArgs *args;
     ZunVec3 local_8;
     i32 local_14, local_24, local_28, local_2c, *local_3c, *local_40, local_44, local_48, local_68, local_74, csum,
@@ -117,12 +637,25 @@ ZunResult EclManager::RunEcl(Enemy *enemy)
     YOLO:
         if ((ZunBool)(enemy->currentContext.time.current == instruction->time))
         {
+#ifdef PREDECODED_ECL
+            decoded = g_EclProgram.difficulty == g_GameManager.difficulty ? FindDecoded(instruction) : NULL;
+#endif
             if (!(instruction->skipForDifficulty & (1 << g_GameManager.difficulty)))
             {
                 goto NEXT_INSN;
             }
 
             args = &instruction->args;
+#ifdef PREDECODED_ECL
+            if (decoded != NULL && decoded->handler != NULL)
+            {
+                if (decoded->handler(enemy, decoded))
+                {
+                    goto HANDLE_JUMP;
+                }
+                goto NEXT_INSN;
+            }
+#endif
             switch (instruction->opCode)
             {
             case ECL_OPCODE_UNIMP:
@@ -136,7 +669,18 @@ ZunResult EclManager::RunEcl(Enemy *enemy)
             case ECL_OPCODE_JUMP:
             HANDLE_JUMP:
                 enemy->currentContext.time.current = instruction->args.jump.time;
+#ifdef PREDECODED_ECL
+                if (decoded != NULL)
+                {
+                    instruction = decoded->jumpTarget;
+                }
+                else
+                {
+                    instruction = (EclRawInstr *)((int)instruction + args->jump.offset);
+                }
+#else
                 instruction = (EclRawInstr *)((int)instruction + args->jump.offset);
+#endif
                 goto YOLO;
             case ECL_OPCODE_SETINT:
             case ECL_OPCODE_SETFLOAT:
@@ -925,7 +1469,18 @@ ZunResult EclManager::RunEcl(Enemy *enemy)
                 break;
             }
         NEXT_INSN:
+#ifdef PREDECODED_ECL
+            if (decoded != NULL)
+            {
+                instruction = decoded->next;
+            }
+            else
+            {
+                instruction = (EclRawInstr *)((u8 *)instruction + instruction->offsetToNext);
+            }
+#else
             instruction = (EclRawInstr *)((u8 *)instruction + instruction->offsetToNext);
+#endif
             goto YOLO;
         }
         else
@@ -11,6 +11,12 @@
 #include <Windows.h>
 #include <d3dx8math.h>
 
+// PREDECODED_ECL has EclManager::Load decode every sub up front, and RunEcl run what it could decode through
+// EclDecodedInstr handlers instead of its switch. RunEcl no longer matches the original binary with it.
+#if defined(PREDECODED_ECL) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "PREDECODED_ECL changes how EclManager::RunEcl dispatches instructions"
+#endif
+
 namespace th06
 {
 // Forward declaration to avoid include loop.
@@ -486,12 +492,54 @@ enum EclRawInstrOpcode
     ECL_OPCODE_SPELLCARDFLAGTIMEOUT,
 };
 
+// A variable operand resolved at load time: either a literal stored in the raw instruction, or a byte offset into
+// the Enemy running it. Operands naming globals or the player-relative variables that GetVar computes on access are
+// never resolved, and instructions using them keep going through RunEcl's switch.
+struct EclOperand
+{
+    i32 *literal;
+    u16 enemyOffset;
+    u16 valueType;
+};
+
+struct EclDecodedInstr;
+// Returns true when the instruction takes its jump.
+typedef ZunBool (*EclHandler)(Enemy *enemy, EclDecodedInstr *decoded);
+
+struct EclDecodedInstr
+{
+    EclRawInstr *raw;
+    // Next instruction to consider, past any that the current difficulty skips at the same time.
+    EclRawInstr *next;
+    // Jump destination for the jump opcodes, pruned the same way.
+    EclRawInstr *jumpTarget;
+    // NULL for opcodes that are still handled by RunEcl's switch.
+    EclHandler handler;
+    EclOperand res;
+    EclOperand lhs;
+    EclOperand rhs;
+};
+
+struct EclProgram
+{
+    EclDecodedInstr *instrs;
+    i32 count;
+    // Index into instrs of the instruction starting at each byte of the file, so the file itself is left as loaded.
+    u16 *decodedIdx;
+    u8 *fileEnd;
+    i32 difficulty;
+    i32 prunedCount;
+    i32 handlerCount;
+};
+
 struct EclManager
 {
     ZunResult Load(char *ecl);
     void Unload();
     ZunResult RunEcl(Enemy *enemy);
     ZunResult CallEclSub(EnemyEclContext *enemyEcl, i16 subId);
+    ZunResult Predecode(u32 fileSize);
+    void ReleasePredecoded();
 
     EclRawHeader *eclFile;
     EclRawInstr **subTable;
@@ -500,4 +548,5 @@ struct EclManager
 ZUN_ASSERT_SIZE(EclManager, 0xc);
 
 DIFFABLE_EXTERN(EclManager, g_EclManager);
+extern EclProgram g_EclProgram;
 }; // namespace th06
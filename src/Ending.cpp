@@ -1,6 +1,7 @@
 #include "Ending.hpp"
 #include "AnmIdx.hpp"
 #include "AnmManager.hpp"
+#include "AssetTrace.hpp"
 #include "Chain.hpp"
 #include "ChainPriorities.hpp"
 #include "FileSystem.hpp"
@@ -445,7 +446,7 @@ ZunResult Ending::LoadEnding(char *endFilePath)
         this->timer1.InitializeForPopup();
         if (endFileDat != NULL)
         {
-            free(endFileDat);
+            ZunFree(endFileDat);
         }
         return ZUN_SUCCESS;
     }
@@ -455,6 +456,7 @@ ZunResult Ending::RegisterChain()
 {
     Ending *ending;
 
+    ASSET_TRACE_ENTER_SCENE(ASSET_SCENE_ENDING);
     ending = new Ending();
     ending->calcChain = g_Chain.CreateElem((ChainCallback)Ending::OnUpdate);
     ending->calcChain->arg = ending;
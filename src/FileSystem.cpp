@@ -2,6 +2,8 @@
 #include <string.h>
 
 #include "FileSystem.hpp"
+#include "AssetPreload.hpp"
+#include "AssetTrace.hpp"
 #include "pbg3/Pbg3Archive.hpp"
 #include "utils.hpp"
 
@@ -9,6 +11,56 @@ namespace th06
 {
 DIFFABLE_STATIC(u32, g_LastFileSize)
 
+#if defined(ASSET_TRACE) || defined(ZUN_ARENAS)
+#ifdef ZUN_ARENAS
+u8 *FileSystem::OpenPath(char *filepath, int isExternalResource)
+{
+    return OpenPath(filepath, isExternalResource, ZUN_ARENA_COUNT);
+}
+
+u8 *FileSystem::OpenPath(char *filepath, int isExternalResource, ZunArenaIdx arena)
+#else
+u8 *FileSystem::OpenPath(char *filepath, int isExternalResource)
+#endif
+{
+    u8 *data;
+    u32 size;
+    i32 archive;
+#ifdef ASSET_TRACE
+    LONGLONG begin;
+
+    begin = g_AssetTrace.GetTicks();
+    if (isExternalResource == 0 && g_AssetPreload.isEnabled)
+    {
+#ifdef ZUN_ARENAS
+        // The preload thread already decoded this one onto the heap. It's handed over as is, rather than copied into
+        // arena; ZunFree(data, arena) frees it all the same.
+#endif
+        data = g_AssetPreload.Take(filepath, &size, &archive);
+        if (data != NULL)
+        {
+            g_LastFileSize = size;
+            g_AssetTrace.Record(AssetTraceKind_File, filepath, archive, size, begin, true);
+            return data;
+        }
+    }
+#endif
+    size = g_LastFileSize;
+#ifdef ZUN_ARENAS
+    data = ReadPath(filepath, isExternalResource, &size, &archive, arena);
+#else
+    data = ReadPath(filepath, isExternalResource, &size, &archive, ZUN_ARENA_COUNT);
+#endif
+    g_LastFileSize = size;
+#ifdef ASSET_TRACE
+    if (data != NULL)
+    {
+        g_AssetTrace.Record(AssetTraceKind_File, filepath, archive, size, begin, false);
+    }
+#endif
+    return data;
+}
+#else
 #pragma var_order(pbg3Idx, entryname, entryIdx, fsize, data, file)
 u8 *FileSystem::OpenPath(char *filepath, int isExternalResource)
 {
@@ -80,7 +132,118 @@ u8 *FileSystem::OpenPath(char *filepath, int isExternalResource)
             fsize = ftell(file);
             g_LastFileSize = fsize;
             fseek(file, 0, SEEK_SET);
-            data = (u8 *)malloc(fsize);
+            data = (u8 *)ZunAlloc(fsize, ZunMemoryTracker::GetFileTag(filepath));
+            fread(data, 1, fsize, file);
+            fclose(file);
+        }
+    }
+    return data;
+}
+#endif
+
+#pragma var_order(pbg3Idx, entryname, entryIdx, fsize, data, file)
+u8 *FileSystem::ReadPath(char *filepath, int isExternalResource, u32 *size, i32 *archive, ZunArenaIdx arena)
+{
+    u8 *data;
+    FILE *file;
+    size_t fsize;
+    i32 entryIdx;
+    char *entryname;
+    i32 pbg3Idx;
+
+    entryIdx = -1;
+    *archive = -1;
+    if (isExternalResource == 0)
+    {
+        entryname = strrchr(filepath, '\\');
+        if (entryname == (char *)0x0)
+        {
+            entryname = filepath;
+        }
+        else
+        {
+            entryname = entryname + 1;
+        }
+        entryname = strrchr(entryname, '/');
+        if (entryname == (char *)0x0)
+        {
+            entryname = filepath;
+        }
+        else
+        {
+            entryname = entryname + 1;
+        }
+        EnterCriticalSection(&g_AssetPreload.archiveLock);
+        if (g_Pbg3Archives != NULL)
+        {
+            for (pbg3Idx = 0; pbg3Idx < 0x10; pbg3Idx += 1)
+            {
+                if (g_Pbg3Archives[pbg3Idx] != NULL)
+                {
+                    entryIdx = g_Pbg3Archives[pbg3Idx]->FindEntry(entryname);
+                    if (entryIdx >= 0)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+        if (entryIdx < 0)
+        {
+            LeaveCriticalSection(&g_AssetPreload.archiveLock);
+            return NULL;
+        }
+    }
+    if (entryIdx >= 0)
+    {
+        utils::DebugPrint2("%s Decode ... \n", entryname);
+        *size = g_Pbg3Archives[pbg3Idx]->GetEntrySize(entryIdx);
+#ifdef ZUN_ARENAS
+        if (arena != ZUN_ARENA_COUNT)
+        {
+            data = (u8 *)ZunAlloc(*size, arena);
+            if (data != NULL)
+            {
+                data = g_Pbg3Archives[pbg3Idx]->ReadDecompressEntry(entryIdx, entryname, data);
+            }
+        }
+        else
+        {
+            data = g_Pbg3Archives[pbg3Idx]->ReadDecompressEntry(entryIdx, entryname);
+        }
+#else
+        data = g_Pbg3Archives[pbg3Idx]->ReadDecompressEntry(entryIdx, entryname);
+#endif
+        *archive = pbg3Idx;
+        LeaveCriticalSection(&g_AssetPreload.archiveLock);
+    }
+    else
+    {
+        utils::DebugPrint2("%s Load ... \n", filepath);
+        file = fopen(filepath, "rb");
+        if (file == NULL)
+        {
+            utils::DebugPrint2("error : %s is not found.\n", filepath);
+            return NULL;
+        }
+        else
+        {
+            fseek(file, 0, SEEK_END);
+            fsize = ftell(file);
+            *size = fsize;
+            fseek(file, 0, SEEK_SET);
+#ifdef ZUN_ARENAS
+            if (arena != ZUN_ARENA_COUNT)
+            {
+                data = (u8 *)ZunAlloc(fsize, arena);
+            }
+            else
+            {
+                data = (u8 *)ZunAlloc(fsize, ZunMemoryTracker::GetFileTag(filepath));
+            }
+#else
+            data = (u8 *)ZunAlloc(fsize, ZunMemoryTracker::GetFileTag(filepath));
+#endif
             fread(data, 1, fsize, file);
             fclose(file);
         }
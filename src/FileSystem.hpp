@@ -2,6 +2,7 @@
 
 #include <Windows.h>
 
+#include "ZunMemory.hpp"
 #include "ZunResult.hpp"
 #include "diffbuild.hpp"
 #include "inttypes.hpp"
@@ -11,6 +12,15 @@ namespace th06
 namespace FileSystem
 {
 u8 *OpenPath(char *filepath, int isExternalResource);
+#ifdef ZUN_ARENAS
+// OpenPath, with the file read or decoded straight into arena, or onto the heap for ZUN_ARENA_COUNT. Free with
+// ZunFree(data, arena).
+u8 *OpenPath(char *filepath, int isExternalResource, ZunArenaIdx arena);
+#endif
+// OpenPath without g_LastFileSize, the asset trace or the preload, so it can run off the game thread, which must then
+// pass ZUN_ARENA_COUNT. archive is the index of the archive the file came from, or -1. Without ZUN_ARENAS the file
+// always goes on the heap.
+u8 *ReadPath(char *filepath, int isExternalResource, u32 *size, i32 *archive, ZunArenaIdx arena);
 int WriteDataToFile(char *path, void *data, size_t size);
 } // namespace FileSystem
 DIFFABLE_EXTERN(u32, g_LastFileSize)
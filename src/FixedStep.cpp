@@ -0,0 +1,73 @@
+#include "FixedStep.hpp"
+
+namespace th06
+{
+FixedStep g_FixedStep;
+
+void FixedStep::Start()
+{
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceFrequency(&frequency);
+    this->ticksPerSecond = frequency.QuadPart;
+    this->numSteps = 0;
+    this->numDroppedSteps = 0;
+    this->Resync();
+    this->isEnabled = true;
+}
+
+void FixedStep::Resync()
+{
+    LARGE_INTEGER now;
+
+    QueryPerformanceCounter(&now);
+    this->lastTicks = now.QuadPart;
+    this->accumulator = 0;
+    this->lastSteps = 0;
+}
+
+i32 FixedStep::Poll()
+{
+    LARGE_INTEGER now;
+
+    QueryPerformanceCounter(&now);
+    return this->Advance(now.QuadPart);
+}
+
+i32 FixedStep::Advance(LONGLONG ticks)
+{
+    LONGLONG steps;
+
+    if (ticks < this->lastTicks)
+    {
+        this->lastTicks = ticks;
+    }
+    this->accumulator += (ticks - this->lastTicks) * FIXED_STEP_HZ;
+    this->lastTicks = ticks;
+
+    steps = this->accumulator / this->ticksPerSecond;
+    this->accumulator -= steps * this->ticksPerSecond;
+    if (steps > FIXED_STEP_MAX_STEPS)
+    {
+        this->numDroppedSteps += (u32)(steps - FIXED_STEP_MAX_STEPS);
+        steps = FIXED_STEP_MAX_STEPS;
+    }
+    this->numSteps += (u32)steps;
+    this->lastSteps = (i32)steps;
+    return this->lastSteps;
+}
+
+void FixedStep::Wait()
+{
+    LONGLONG ms;
+
+    ms = (this->ticksPerSecond - this->accumulator) * 1000 / (this->ticksPerSecond * FIXED_STEP_HZ);
+    // Sleep can overshoot by its whole period, so the last millisecond is left to Poll.
+    if (ms >= 2)
+    {
+        timeBeginPeriod(1);
+        Sleep((DWORD)ms - 1);
+        timeEndPeriod(1);
+    }
+}
+}; // namespace th06
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "ZunBool.hpp"
+#include "inttypes.hpp"
+
+// FIXED_STEP adds the -fixedstep switch, which has GameWindow::Render run the game off g_FixedStep. WinMain,
+// GameWindow::Render and Supervisor::DrawFpsCounter no longer match the original binary with it.
+#if defined(FIXED_STEP) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "FIXED_STEP changes the main loop"
+#endif
+
+namespace th06
+{
+#define FIXED_STEP_HZ 60
+// The most calc steps one GameWindow::Render runs. Past that the game falls behind rather than trying to catch up on
+// a frame that got slower for having more to do.
+#define FIXED_STEP_MAX_STEPS 4
+
+// The clock -fixedstep runs the game by. Time passing adds up in an accumulator, and every 1/FIXED_STEP_HZ of a
+// second in it is one calc step due, so the game runs at the same speed however often frames get presented, and the
+// framerate multipliers stay at 1 for replays to play back the same.
+struct FixedStep
+{
+    void Start();
+    // Forgets the time that has passed, for when the game wasn't running.
+    void Resync();
+
+    // How many calc steps are due, at most FIXED_STEP_MAX_STEPS.
+    i32 Poll();
+    i32 Advance(LONGLONG ticks);
+    // Sleeps until the next step is due, give or take a millisecond.
+    void Wait();
+
+    ZunBool isEnabled;
+    LONGLONG ticksPerSecond;
+    LONGLONG lastTicks;
+    // In ticks times FIXED_STEP_HZ, so a step is exactly ticksPerSecond of it.
+    LONGLONG accumulator;
+    // What the last Poll returned, which is what the frame drawn after it stands for.
+    i32 lastSteps;
+    u32 numSteps;
+    u32 numDroppedSteps;
+};
+
+extern FixedStep g_FixedStep;
+}; // namespace th06
@@ -1,5 +1,6 @@
 #include "GameManager.hpp"
 #include "AsciiManager.hpp"
+#include "AssetTrace.hpp"
 #include "BulletManager.hpp"
 #include "ChainPriorities.hpp"
 #include "EclManager.hpp"
@@ -14,6 +15,7 @@
 #include "SoundPlayer.hpp"
 #include "Stage.hpp"
 #include "Supervisor.hpp"
+#include "ZunMemory.hpp"
 #include "utils.hpp"
 
 #include <d3d8types.h>
@@ -387,6 +389,8 @@ ZunResult GameManager::AddedCallback(GameManager *mgr)
     }
     g_Supervisor.LoadPbg3(CM_PBG3_INDEX, TH_CM_DAT_FILE);
     g_Supervisor.LoadPbg3(ST_PBG3_INDEX, TH_ST_DAT_FILE);
+    // After the archives, so that what's read ahead can be found in them.
+    ASSET_TRACE_ENTER_SCENE(ASSET_SCENE_STAGE1 + mgr->currentStage - 1);
     if (g_GameManager.isInReplay == 1)
     {
         if (ReplayManager::RegisterChain(1, g_GameManager.replayFile) != ZUN_SUCCESS)
@@ -486,6 +490,14 @@ ZunResult GameManager::DeletedCallback(GameManager *mgr)
     EffectManager::CutChain();
     Gui::CutChain();
     ReplayManager::StopRecording();
+#ifdef ZUN_ARENAS
+    // Everything that went into the arenas has been let go of by now.
+    g_ZunArenas[ZUN_ARENA_STAGE].Reset();
+    if (g_Supervisor.curState != SUPERVISOR_STATE_GAMEMANAGER_REINIT)
+    {
+        g_ZunArenas[ZUN_ARENA_SCENE].Reset();
+    }
+#endif
     mgr->isInMenu = 0;
     g_AsciiManager.InitializeVms();
     return ZUN_SUCCESS;
@@ -1,12 +1,31 @@
 #include "GameWindow.hpp"
 #include "AnmManager.hpp"
+#include "D3dStateCache.hpp"
+#include "FixedStep.hpp"
 #include "GameErrorContext.hpp"
+#include "PerfStats.hpp"
 #include "ScreenEffect.hpp"
+#include "SoftwareD3dDevice.hpp"
 #include "SoundPlayer.hpp"
 #include "Stage.hpp"
 #include "Supervisor.hpp"
 #include "diffbuild.hpp"
 #include "i18n.hpp"
+#ifdef PIPELINED_DRAW
+#include "PipelinedD3dDevice.hpp"
+#endif
+
+// With PIPELINED_DRAW the draw chain only records its device calls and a render thread submits them. The two threads
+// never call the device at the same time, but Direct3D still references the bound textures on the render thread while
+// the game may release them, so the device has to be created thread safe.
+#ifdef PIPELINED_DRAW
+#if defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD)
+#error "PIPELINED_DRAW changes how the game talks to Direct3D"
+#endif
+#define EXTRA_D3DCREATE_FLAGS D3DCREATE_MULTITHREADED
+#else
+#define EXTRA_D3DCREATE_FLAGS 0
+#endif
 
 namespace th06
 {
@@ -28,8 +47,20 @@ RenderResult GameWindow::Render()
 
     if (this->lastActiveAppValue == 0)
     {
+#ifdef FIXED_STEP
+        if (g_FixedStep.isEnabled)
+        {
+            g_FixedStep.Resync();
+        }
+#endif
         return RENDER_RESULT_KEEP_RUNNING;
     }
+#ifdef FIXED_STEP
+    if (g_FixedStep.isEnabled)
+    {
+        return this->RenderFixedStep();
+    }
+#endif
 
     if (this->curFrame == 0)
     {
@@ -48,10 +79,15 @@ RenderResult GameWindow::Render()
                 g_Supervisor.d3dDevice->Clear(0, NULL, 3, g_Stage.skyFog.color, 1.0, 0);
                 g_Supervisor.d3dDevice->SetViewport(&g_Supervisor.viewport);
             }
+            PERF_STATS_BEGIN(PerfSection_Draw);
             g_Supervisor.d3dDevice->BeginScene();
             g_Chain.RunDrawChain();
             g_Supervisor.d3dDevice->EndScene();
-            g_Supervisor.d3dDevice->SetTexture(0, NULL);
+            PERF_STATS_END(PerfSection_Draw);
+            D3D_SET_TEXTURE(0, NULL);
+#ifdef D3D_STATE_CACHE
+            g_D3dStateCache.EndFrame();
+#endif
         }
 
         g_Supervisor.viewport.X = 0;
@@ -59,8 +95,10 @@ RenderResult GameWindow::Render()
         g_Supervisor.viewport.Width = 640;
         g_Supervisor.viewport.Height = 480;
         g_Supervisor.d3dDevice->SetViewport(&g_Supervisor.viewport);
+        PERF_STATS_BEGIN(PerfSection_Calc);
         res = g_Chain.RunCalcChain();
         g_SoundPlayer.PlaySounds();
+        PERF_STATS_END(PerfSection_Calc);
         if (res == 0)
         {
             return RENDER_RESULT_EXIT_SUCCESS;
@@ -152,9 +190,78 @@ RenderResult GameWindow::Render()
     return RENDER_RESULT_KEEP_RUNNING;
 }
 
+#ifdef FIXED_STEP
+// Runs whatever calc steps g_FixedStep has due, then draws and presents once. How often that happens is up to the
+// display and the GPU, but not how fast the game goes: a slow frame only means more steps before the next one, and
+// frameskip and the slowdown compensation have nothing left to do.
+RenderResult GameWindow::RenderFixedStep()
+{
+    D3DVIEWPORT8 viewport;
+    i32 steps;
+    i32 res;
+
+    steps = g_FixedStep.Poll();
+    if (steps == 0)
+    {
+        // Nothing would look any different from the last present.
+        g_FixedStep.Wait();
+        return RENDER_RESULT_KEEP_RUNNING;
+    }
+
+    for (; steps > 0; steps--)
+    {
+        // Set again every step, since the menus change them for high refresh displays.
+        g_Supervisor.framerateMultiplier = 1.0;
+        g_Supervisor.effectiveFramerateMultiplier = 1.0;
+        g_Supervisor.viewport.X = 0;
+        g_Supervisor.viewport.Y = 0;
+        g_Supervisor.viewport.Width = 640;
+        g_Supervisor.viewport.Height = 480;
+        g_Supervisor.d3dDevice->SetViewport(&g_Supervisor.viewport);
+        PERF_STATS_BEGIN(PerfSection_Calc);
+        res = g_Chain.RunCalcChain();
+        g_SoundPlayer.PlaySounds();
+        PERF_STATS_END(PerfSection_Calc);
+        if (res == 0)
+        {
+            return RENDER_RESULT_EXIT_SUCCESS;
+        }
+        if (res == -1)
+        {
+            return RENDER_RESULT_EXIT_ERROR;
+        }
+    }
+
+    if (g_Supervisor.IsUnknown())
+    {
+        viewport.X = 0;
+        viewport.Y = 0;
+        viewport.Width = 640;
+        viewport.Height = 480;
+        viewport.MinZ = 0.0;
+        viewport.MaxZ = 1.0;
+        g_Supervisor.d3dDevice->SetViewport(&viewport);
+        g_Supervisor.d3dDevice->Clear(0, NULL, 3, g_Stage.skyFog.color, 1.0, 0);
+        g_Supervisor.d3dDevice->SetViewport(&g_Supervisor.viewport);
+    }
+    PERF_STATS_BEGIN(PerfSection_Draw);
+    g_Supervisor.d3dDevice->BeginScene();
+    g_Chain.RunDrawChain();
+    g_Supervisor.d3dDevice->EndScene();
+    PERF_STATS_END(PerfSection_Draw);
+    D3D_SET_TEXTURE(0, NULL);
+#ifdef D3D_STATE_CACHE
+    g_D3dStateCache.EndFrame();
+#endif
+    Present();
+    return RENDER_RESULT_KEEP_RUNNING;
+}
+#endif
+
 void GameWindow::Present()
 {
     i32 unused;
+    PERF_STATS_BEGIN(PerfSection_Present);
     if (g_Supervisor.d3dDevice->Present(NULL, NULL, NULL, NULL) < 0)
     {
         g_AnmManager->ReleaseSurfaces();
@@ -162,6 +269,8 @@ void GameWindow::Present()
         InitD3dDevice();
         g_Supervisor.unk198 = 2;
     }
+    PERF_STATS_END(PerfSection_Present);
+    PERF_STATS_END_FRAME();
     g_AnmManager->TakeScreenshotIfRequested();
     if (g_Supervisor.unk198 != 0)
     {
@@ -354,19 +463,19 @@ i32 GameWindow::InitD3dRendering(void)
         else
         {
             if (g_Supervisor.d3dIface->CreateDevice(0, D3DDEVTYPE_HAL, g_GameWindow.window,
-                                                    D3DCREATE_HARDWARE_VERTEXPROCESSING, &present_params,
-                                                    &g_Supervisor.d3dDevice) < 0)
+                                                    D3DCREATE_HARDWARE_VERTEXPROCESSING | EXTRA_D3DCREATE_FLAGS,
+                                                    &present_params, &g_Supervisor.d3dDevice) < 0)
             {
                 g_GameErrorContext.Log(TH_ERR_TL_HAL_UNAVAILABLE);
                 if (g_Supervisor.d3dIface->CreateDevice(0, D3DDEVTYPE_HAL, g_GameWindow.window,
-                                                        D3DCREATE_SOFTWARE_VERTEXPROCESSING, &present_params,
-                                                        &g_Supervisor.d3dDevice) < 0)
+                                                        D3DCREATE_SOFTWARE_VERTEXPROCESSING | EXTRA_D3DCREATE_FLAGS,
+                                                        &present_params, &g_Supervisor.d3dDevice) < 0)
                 {
                     g_GameErrorContext.Log(TH_ERR_HAL_UNAVAILABLE);
                 REFERENCE_RASTERIZER_MODE:
                     if (g_Supervisor.d3dIface->CreateDevice(0, D3DDEVTYPE_REF, g_GameWindow.window,
-                                                            D3DCREATE_SOFTWARE_VERTEXPROCESSING, &present_params,
-                                                            &g_Supervisor.d3dDevice) < 0)
+                                                            D3DCREATE_SOFTWARE_VERTEXPROCESSING | EXTRA_D3DCREATE_FLAGS,
+                                                            &present_params, &g_Supervisor.d3dDevice) < 0)
                     {
                         if (((g_Supervisor.cfg.opts >> GCOS_FORCE_60FPS) & 1) != 0 && !g_Supervisor.vsyncEnabled)
                         {
@@ -419,6 +528,11 @@ i32 GameWindow::InitD3dRendering(void)
         }
     }
 
+#ifdef PIPELINED_DRAW
+    g_PipelinedD3dDevice = new PipelinedD3dDevice(g_Supervisor.d3dDevice);
+    g_Supervisor.d3dDevice = g_PipelinedD3dDevice;
+#endif
+
     half_width = (float)GAME_WINDOW_WIDTH / 2.0;
     half_height = (float)GAME_WINDOW_HEIGHT / 2.0;
     aspect_ratio = (float)GAME_WINDOW_WIDTH / (float)GAME_WINDOW_HEIGHT;
@@ -473,6 +587,35 @@ i32 GameWindow::InitD3dRendering(void)
     return 0;
 }
 
+#ifdef SOFTWARE_RENDERER
+ZunResult GameWindow::InitSoftwareRendering()
+{
+    SoftwareD3dDevice *device;
+
+    device = new SoftwareD3dDevice(GAME_WINDOW_WIDTH, GAME_WINDOW_HEIGHT, 0);
+    if (device->OpenFrameDump("frames.y4m", SoftwareFrameDump_Y4m) != ZUN_SUCCESS)
+    {
+        delete device;
+        return ZUN_ERROR;
+    }
+    device->direct3d = g_Supervisor.d3dIface;
+    device->direct3d->AddRef();
+    g_Supervisor.d3dDevice->Release();
+    g_Supervisor.d3dDevice = device;
+    g_Supervisor.hasD3dHardwareVertexProcessing = 0;
+    g_SoftwareD3dDevice = device;
+
+    // The part of InitD3dRendering that set up the device it replaces.
+    g_Supervisor.d3dDevice->SetTransform(D3DTS_VIEW, &g_Supervisor.viewMatrix);
+    g_Supervisor.d3dDevice->SetTransform(D3DTS_PROJECTION, &g_Supervisor.projectionMatrix);
+    g_Supervisor.d3dDevice->GetViewport(&g_Supervisor.viewport);
+    g_Supervisor.d3dDevice->GetDeviceCaps(&g_Supervisor.d3dCaps);
+    InitD3dDevice();
+    ScreenEffect::SetViewport(0);
+    return ZUN_SUCCESS;
+}
+#endif
+
 #pragma var_order(fogVal, fogDensity, anm1, anm2, anm3, anm4)
 void GameWindow::InitD3dDevice(void)
 {
@@ -483,95 +626,98 @@ void GameWindow::InitD3dDevice(void)
     AnmManager *anm3;
     AnmManager *anm4;
 
+#ifdef D3D_STATE_CACHE
+    g_D3dStateCache.Invalidate();
+#endif
     if (((g_Supervisor.cfg.opts >> GCOS_TURN_OFF_DEPTH_TEST) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZENABLE, TRUE);
+        D3D_SET_RENDER_STATE(D3DRS_ZENABLE, TRUE);
     }
     else
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZENABLE, FALSE);
+        D3D_SET_RENDER_STATE(D3DRS_ZENABLE, FALSE);
     }
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_LIGHTING, FALSE);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+    D3D_SET_RENDER_STATE(D3DRS_LIGHTING, FALSE);
+    D3D_SET_RENDER_STATE(D3DRS_CULLMODE, D3DCULL_NONE);
+    D3D_SET_RENDER_STATE(D3DRS_ALPHABLENDENABLE, TRUE);
     if (((g_Supervisor.cfg.opts >> GCOS_SUPPRESS_USE_OF_GOROUD_SHADING) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_SHADEMODE, D3DSHADE_GOURAUD);
+        D3D_SET_RENDER_STATE(D3DRS_SHADEMODE, D3DSHADE_GOURAUD);
     }
     else
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_SHADEMODE, D3DSHADE_FLAT);
+        D3D_SET_RENDER_STATE(D3DRS_SHADEMODE, D3DSHADE_FLAT);
     }
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+    D3D_SET_RENDER_STATE(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+    D3D_SET_RENDER_STATE(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
     if (((g_Supervisor.cfg.opts >> GCOS_TURN_OFF_DEPTH_TEST) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
+        D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
     }
     else
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_ALWAYS);
+        D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_ALWAYS);
     }
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_ALPHATESTENABLE, TRUE);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_ALPHAREF, 4);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_ALPHAFUNC, D3DCMP_GREATEREQUAL);
+    D3D_SET_RENDER_STATE(D3DRS_ALPHATESTENABLE, TRUE);
+    D3D_SET_RENDER_STATE(D3DRS_ALPHAREF, 4);
+    D3D_SET_RENDER_STATE(D3DRS_ALPHAFUNC, D3DCMP_GREATEREQUAL);
     if (((g_Supervisor.cfg.opts >> GCOS_DONT_USE_FOG) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGENABLE, TRUE);
+        D3D_SET_RENDER_STATE(D3DRS_FOGENABLE, TRUE);
     }
     else
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGENABLE, FALSE);
+        D3D_SET_RENDER_STATE(D3DRS_FOGENABLE, FALSE);
     }
     fogDensity = 1.0;
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGDENSITY, *(u32 *)&fogDensity);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGTABLEMODE, D3DFOG_LINEAR);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGCOLOR, 0xffa0a0a0);
+    D3D_SET_RENDER_STATE(D3DRS_FOGDENSITY, *(u32 *)&fogDensity);
+    D3D_SET_RENDER_STATE(D3DRS_FOGTABLEMODE, D3DFOG_LINEAR);
+    D3D_SET_RENDER_STATE(D3DRS_FOGCOLOR, 0xffa0a0a0);
     fogVal = 1000.0;
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGSTART, *(u32 *)&fogVal);
+    D3D_SET_RENDER_STATE(D3DRS_FOGSTART, *(u32 *)&fogVal);
     fogVal = 5000.0;
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGEND, *(u32 *)&fogVal);
+    D3D_SET_RENDER_STATE(D3DRS_FOGEND, *(u32 *)&fogVal);
     if (((g_Supervisor.cfg.opts >> GCOS_NO_COLOR_COMP) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
     }
     else
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
     }
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
     if (((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_TFACTOR);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG2, D3DTA_TFACTOR);
     }
     else
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
     }
     if (((g_Supervisor.cfg.opts >> GCOS_NO_COLOR_COMP) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
     }
     else
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
     }
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
     if (((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_TFACTOR);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG2, D3DTA_TFACTOR);
     }
     else
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
     }
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_MIPFILTER, D3DTEXF_NONE);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_MAGFILTER, D3DTEXF_LINEAR);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_MINFILTER, D3DTEXF_LINEAR);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_COUNT2);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ADDRESSW, D3DTADDRESS_CLAMP);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ADDRESSU, D3DTADDRESS_WRAP);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ADDRESSV, D3DTADDRESS_WRAP);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_MIPFILTER, D3DTEXF_NONE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_MAGFILTER, D3DTEXF_LINEAR);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_MINFILTER, D3DTEXF_LINEAR);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_COUNT2);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ADDRESSW, D3DTADDRESS_CLAMP);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ADDRESSU, D3DTADDRESS_WRAP);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ADDRESSV, D3DTADDRESS_WRAP);
     if (g_AnmManager != NULL)
     {
         anm1 = g_AnmManager;
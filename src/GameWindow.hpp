@@ -1,5 +1,6 @@
 #pragma once
 
+#include "ZunResult.hpp"
 #include "diffbuild.hpp"
 #include "inttypes.hpp"
 #include <windows.h>
@@ -19,11 +20,22 @@ enum RenderResult
 struct GameWindow
 {
     RenderResult Render();
+#ifdef FIXED_STEP
+    // Render for -fixedstep.
+    RenderResult RenderFixedStep();
+#endif
     static void Present();
 
     static i32 InitD3dInterface();
     static void CreateGameWindow(HINSTANCE hInstance);
     static i32 InitD3dRendering();
+#ifdef SOFTWARE_RENDERER
+    // For -swrender: swaps the device InitD3dRendering created for a SoftwareD3dDevice, so the game draws on the CPU
+    // and every presented frame goes to frames.y4m instead of the window, and a replay can be rendered out without a
+    // GPU. Direct3D itself is still needed, for D3DX to check texture formats against. Keeps the real device if the
+    // dump can't be opened.
+    static ZunResult InitSoftwareRendering();
+#endif
     static void InitD3dDevice();
     static LRESULT __stdcall WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
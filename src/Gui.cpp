@@ -6,12 +6,14 @@
 #include "AsciiManager.hpp"
 #include "Chain.hpp"
 #include "ChainPriorities.hpp"
+#include "D3dStateCache.hpp"
 #include "FileSystem.hpp"
 #include "GameManager.hpp"
 #include "Player.hpp"
 #include "SoundPlayer.hpp"
 #include "Stage.hpp"
 #include "ZunColor.hpp"
+#include "ZunMemory.hpp"
 #include "utils.hpp"
 
 namespace th06
@@ -84,7 +86,7 @@ ChainCallbackResult Gui::OnDraw(Gui *gui)
     char spellCardBonusStr[32];
     D3DXVECTOR3 stringPos;
 
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_ALWAYS);
+    D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_ALWAYS);
     if (gui->impl->finishedStage)
     {
         stringPos.x = GAME_REGION_LEFT + 42.0f;
@@ -212,7 +214,7 @@ ChainCallbackResult Gui::OnDraw(Gui *gui)
         g_AsciiManager.color = COLOR_WHITE;
     }
     g_AsciiManager.isGui = 0;
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
+    D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
     return CHAIN_CALLBACK_RESULT_CONTINUE;
 }
 
@@ -458,7 +460,11 @@ ZunResult Gui::LoadMsg(char *path)
     i32 idx;
 
     this->FreeMsgFile();
+#ifdef ZUN_ARENAS
+    this->impl->msg.msgFile = (MsgRawHeader *)FileSystem::OpenPath(path, 0, ZUN_ARENA_STAGE);
+#else
     this->impl->msg.msgFile = (MsgRawHeader *)FileSystem::OpenPath(path, 0);
+#endif
     if (this->impl->msg.msgFile == NULL)
     {
         g_GameErrorContext.Log(TH_ERR_GUI_MSG_FILE_CORRUPTED, path);
@@ -480,7 +486,11 @@ void Gui::FreeMsgFile()
     if ((this->impl->msg).msgFile != NULL)
     {
         msg = (this->impl->msg).msgFile;
+#ifdef ZUN_ARENAS
+        ZunFree(msg, ZUN_ARENA_STAGE);
+#else
         free(msg);
+#endif
         (this->impl->msg).msgFile = NULL;
     }
 }
@@ -753,16 +763,16 @@ ZunResult GuiImpl::DrawDialogue()
     g_AnmManager->DrawNoRotation(&this->msg.portraits[1]);
     if (((g_Supervisor.cfg.opts >> GCOS_NO_COLOR_COMP) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
     }
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
     if (((g_Supervisor.cfg.opts >> GCOS_TURN_OFF_DEPTH_TEST) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZWRITEENABLE, 0);
+        D3D_SET_RENDER_STATE(D3DRS_ZWRITEENABLE, 0);
     }
-    g_Supervisor.d3dDevice->SetVertexShader(D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
+    D3D_SET_VERTEX_SHADER(D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
     g_Supervisor.d3dDevice->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, vertices, sizeof(vertices[0]));
     g_AnmManager->SetCurrentVertexShader(0xff);
     g_AnmManager->SetCurrentColorOp(0xff);
@@ -770,11 +780,11 @@ ZunResult GuiImpl::DrawDialogue()
     g_AnmManager->SetCurrentZWriteDisable(0xff);
     if (((g_Supervisor.cfg.opts >> GCOS_NO_COLOR_COMP) & 1) == 0)
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, 4);
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, 4);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, 4);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, 4);
     }
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAARG1, 2);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLORARG1, 2);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG1, 2);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG1, 2);
     g_AnmManager->DrawNoRotation(&this->msg.dialogueLines[0]);
     g_AnmManager->DrawNoRotation(&this->msg.dialogueLines[1]);
     g_AnmManager->DrawNoRotation(&this->msg.introLines[0]);
@@ -1166,17 +1176,17 @@ void Gui::DrawGameScene()
 
             if ((g_Supervisor.cfg.opts >> 8 & 1) == 0)
             {
-                g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
-                g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+                D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+                D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
             }
-            g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
-            g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+            D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
+            D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
             if ((g_Supervisor.cfg.opts >> GCOS_TURN_OFF_DEPTH_TEST & 1) == 0)
             {
-                g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_ALWAYS);
-                g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+                D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_ALWAYS);
+                D3D_SET_RENDER_STATE(D3DRS_ZWRITEENABLE, FALSE);
             }
-            g_Supervisor.d3dDevice->SetVertexShader(D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
+            D3D_SET_VERTEX_SHADER(D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
             g_Supervisor.d3dDevice->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, vertices, sizeof(VertexDiffuseXyzrwh));
             g_AnmManager->SetCurrentVertexShader(0xff);
             g_AnmManager->SetCurrentColorOp(0xff);
@@ -1184,11 +1194,11 @@ void Gui::DrawGameScene()
             g_AnmManager->SetCurrentZWriteDisable(0xff);
             if ((g_Supervisor.cfg.opts >> GCOS_NO_COLOR_COMP & 1) == 0)
             {
-                g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
-                g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+                D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+                D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
             }
-            g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-            g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+            D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+            D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
             if (128 <= g_GameManager.currentPower)
             {
                 vm = &this->impl->vms[18];
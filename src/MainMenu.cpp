@@ -7,6 +7,7 @@
 
 #include "AnmManager.hpp"
 #include "AsciiManager.hpp"
+#include "AssetTrace.hpp"
 #include "ChainPriorities.hpp"
 #include "Filesystem.hpp"
 #include "GameErrorContext.hpp"
@@ -18,6 +19,7 @@
 #include "SoundPlayer.hpp"
 #include "Supervisor.hpp"
 #include "ZunColor.hpp"
+#include "ZunMemory.hpp"
 #include "i18n.hpp"
 #include "utils.hpp"
 
@@ -1300,7 +1302,7 @@ i32 MainMenu::ReplayHandling()
                         sprintf(this->replayFileName[replayFileIdx], "No.%.2d", cur + 1);
                         replayFileIdx++;
                     }
-                    free(replayData);
+                    ZunFree(replayData);
                 }
                 _mkdir("./replay");
                 _chdir("./replay");
@@ -1321,7 +1323,7 @@ i32 MainMenu::ReplayHandling()
                             sprintf(this->replayFileName[replayFileIdx], "User ");
                             replayFileIdx++;
                         }
-                        free(replayData);
+                        ZunFree(replayData);
                         if (!FindNextFileA(replayFileHandle, &replayFileInfo))
                             break;
                     }
@@ -1452,7 +1454,7 @@ i32 MainMenu::ReplayHandling()
             g_GameManager.livesRemaining = this->currentReplay->stageReplayData[cur]->livesRemaining;
             g_GameManager.bombsRemaining = this->currentReplay->stageReplayData[cur]->bombsRemaining;
             ReplayData *uh = this->currentReplay;
-            free(uh);
+            ZunFree(uh);
             this->currentReplay = NULL;
             g_GameManager.currentStage = this->cursor;
             g_Supervisor.curState = SUPERVISOR_STATE_GAMEMANAGER;
@@ -1461,7 +1463,7 @@ i32 MainMenu::ReplayHandling()
         if (WAS_PRESSED(TH_BUTTON_RETURNMENU))
         {
             ReplayData *uh2 = this->currentReplay;
-            free(uh2);
+            ZunFree(uh2);
             this->currentReplay = NULL;
             this->gameState = STATE_REPLAY_ANIM;
             this->stateTimer = 0;
@@ -2190,6 +2192,7 @@ ZunResult MainMenu::RegisterChain(u32 isDemo)
 {
     MainMenu *menu = &g_MainMenu;
 
+    ASSET_TRACE_ENTER_SCENE(ASSET_SCENE_TITLE);
     memset(menu, 0, sizeof(MainMenu));
     g_GameManager.isInGameMenu = 0;
     utils::DebugPrint(TH_DBG_MAINMENU_VRAM, g_Supervisor.d3dDevice->GetAvailableTextureMem());
@@ -2322,7 +2325,7 @@ ZunResult MainMenu::DeletedCallback(MainMenu *menu)
     menu->chainDraw = NULL;
 
     replay = menu->currentReplay;
-    free(replay);
+    ZunFree(replay);
     return ZUN_SUCCESS;
 }
 
@@ -5,6 +5,7 @@
 
 #include "FileSystem.hpp"
 #include "MidiOutput.hpp"
+#include "MidiTimeline.hpp"
 #include "Supervisor.hpp"
 #include "ZunMemory.hpp"
 #include "i18n.hpp"
@@ -255,6 +256,12 @@ void MidiOutput::ClearTracks()
     ZunFree(this->tracks);
     this->tracks = NULL;
     this->numTracks = 0;
+#ifdef MIDI_TIMELINE
+    if (g_MidiTimeline.isEnabled)
+    {
+        g_MidiTimeline.Release();
+    }
+#endif
 }
 
 #pragma var_order(trackIdx, currentCursor, currentCursorTrack, fileData, hdrLength, hdrRaw, trackLength,               \
@@ -303,7 +310,7 @@ ZunResult MidiOutput::ParseFile(i32 fileIdx)
     this->numTracks = MidiOutput::Ntohs(*(u16 *)(endOfHeaderPointer + 2));
 
     // Allocate this->divisions * 32 bytes.
-    this->tracks = (MidiTrack *)ZunAlloc(sizeof(MidiTrack) * this->numTracks);
+    this->tracks = (MidiTrack *)ZunAlloc(sizeof(MidiTrack) * this->numTracks, "midi");
     memset(this->tracks, 0, sizeof(MidiTrack) * this->numTracks);
     for (trackIdx = 0; trackIdx < this->numTracks; trackIdx += 1)
     {
@@ -315,12 +322,18 @@ ZunResult MidiOutput::ParseFile(i32 fileIdx)
         // First, read the length of the chunk
         trackLength = MidiOutput::Ntohl(*(u32 *)(currentCursorTrack + 4));
         this->tracks[trackIdx].trackLength = trackLength;
-        this->tracks[trackIdx].trackData = (u8 *)ZunAlloc(trackLength);
+        this->tracks[trackIdx].trackData = (u8 *)ZunAlloc(trackLength, "midi");
         this->tracks[trackIdx].trackPlaying = 1;
         memcpy(this->tracks[trackIdx].trackData, currentCursor, trackLength);
         currentCursor += trackLength;
     }
     this->tempo = 1000000;
+#ifdef MIDI_TIMELINE
+    if (g_MidiTimeline.isEnabled)
+    {
+        return g_MidiTimeline.Build(this->tracks, this->numTracks, this->divisions);
+    }
+#endif
     return ZUN_SUCCESS;
 }
 
@@ -355,6 +368,12 @@ void MidiOutput::LoadTracks()
         track->trackPlaying = 1;
         track->trackLengthOther = MidiOutput::SkipVariableLength(&track->curTrackDataCursor);
     }
+#ifdef MIDI_TIMELINE
+    if (g_MidiTimeline.isEnabled)
+    {
+        g_MidiTimeline.Rewind();
+    }
+#endif
 }
 
 ZunResult MidiOutput::Play()
@@ -448,6 +467,13 @@ void MidiOutput::OnTimerElapsed()
     i32 trackIndex;
     BOOL trackLoaded;
 
+#ifdef MIDI_TIMELINE
+    if (g_MidiTimeline.isEnabled)
+    {
+        this->OnTimelineTimerElapsed();
+        return;
+    }
+#endif
     trackLoaded = false;
     // longlong multiplication. Oh god.
     local_14 = this->unk130 + (this->volume * this->divisions * 1000) / this->tempo;
@@ -532,10 +558,10 @@ void MidiOutput::ProcessMsg(MidiTrack *track)
             {
                 this->UnprepareHeader(this->midiHeaders[this->midiHeadersCursor]);
             }
-            midiHdr = this->midiHeaders[this->midiHeadersCursor] = (MIDIHDR *)ZunAlloc(sizeof(MIDIHDR));
+            midiHdr = this->midiHeaders[this->midiHeadersCursor] = (MIDIHDR *)ZunAlloc(sizeof(MIDIHDR), "midi");
             curTrackLength = MidiOutput::SkipVariableLength(&track->curTrackDataCursor);
             memset(midiHdr, 0, sizeof(MIDIHDR));
-            midiHdr->lpData = (LPSTR)ZunAlloc(curTrackLength + 1);
+            midiHdr->lpData = (LPSTR)ZunAlloc(curTrackLength + 1, "midi");
             midiHdr->lpData[0] = -0x10;
             midiHdr->dwFlags = 0;
             midiHdr->dwBufferLength = curTrackLength + 1;
@@ -687,6 +713,149 @@ void MidiOutput::ProcessMsg(MidiTrack *track)
     return;
 }
 
+#ifdef MIDI_TIMELINE
+// Each tick is a millisecond, as in OnTimerElapsed, but the events due are only ever the next ones in the timeline.
+void MidiOutput::OnTimelineTimerElapsed()
+{
+    MidiTimeline *timeline;
+
+    timeline = &g_MidiTimeline;
+    if (this->fadeOutFlag != 0)
+    {
+        if (this->fadeOutElapsedMS < this->fadeOutInterval)
+        {
+            this->fadeOutVolumeMultiplier = 1.0f - (f32)this->fadeOutElapsedMS / (f32)this->fadeOutInterval;
+            if ((u32)(this->fadeOutVolumeMultiplier * 128.0f) != this->fadeOutLastSetVolume)
+            {
+                this->FadeOutSetVolume(0);
+            }
+            this->fadeOutLastSetVolume = this->fadeOutVolumeMultiplier * 128.0f;
+            this->fadeOutElapsedMS = this->fadeOutElapsedMS + 1;
+        }
+        else
+        {
+            this->fadeOutVolumeMultiplier = 0.0;
+            return;
+        }
+    }
+    if (timeline->isFinished)
+    {
+        this->LoadTracks();
+        return;
+    }
+    while (timeline->cursor < timeline->numEvents && timeline->events[timeline->cursor].time <= timeline->time)
+    {
+        timeline->cursor++;
+        this->SendTimelineEvent(&timeline->events[timeline->cursor - 1]);
+    }
+    if (timeline->cursor >= timeline->numEvents && timeline->time >= timeline->endTime)
+    {
+        timeline->isFinished = true;
+    }
+    timeline->time += 1000;
+}
+
+void MidiOutput::SendTimelineEvent(MidiEvent *event)
+{
+    MidiTimeline *timeline;
+    MIDIHDR *midiHdr;
+    i32 lVar5;
+    u8 opcodeHigh;
+    u8 opcodeLow;
+    u8 arg1;
+    u8 arg2;
+
+    timeline = &g_MidiTimeline;
+    if (event->status == MIDI_OPCODE_SYSTEM_EXCLUSIVE)
+    {
+        if (this->midiHeaders[this->midiHeadersCursor] != NULL)
+        {
+            this->UnprepareHeader(this->midiHeaders[this->midiHeadersCursor]);
+        }
+        midiHdr = this->midiHeaders[this->midiHeadersCursor] = (MIDIHDR *)ZunAlloc(sizeof(MIDIHDR), "midi");
+        memset(midiHdr, 0, sizeof(MIDIHDR));
+        midiHdr->lpData = (LPSTR)ZunAlloc(event->sysexLength + 1, "midi");
+        midiHdr->lpData[0] = -0x10;
+        memcpy(midiHdr->lpData + 1, timeline->sysexData + event->sysexOffset, event->sysexLength);
+        midiHdr->dwBufferLength = event->sysexLength + 1;
+        if (this->midiOutDev.SendLongMsg(midiHdr))
+        {
+            ZunFree(midiHdr->lpData);
+            ZunFree(midiHdr);
+            this->midiHeaders[this->midiHeadersCursor] = NULL;
+        }
+        this->midiHeadersCursor = (this->midiHeadersCursor + 1) % 32;
+        return;
+    }
+
+    opcodeHigh = event->status & 0xf0;
+    opcodeLow = event->status & 0x0f;
+    arg1 = event->arg1;
+    arg2 = event->arg2;
+    switch (opcodeHigh)
+    {
+    case MIDI_OPCODE_NOTE_ON:
+        if (arg2 != 0)
+        {
+            arg1 += this->unk2c4;
+            this->channels[opcodeLow].keyPressedFlags[arg1 >> 3] |= (1 << (arg1 & 7)) & 0xff;
+            break;
+        }
+    case MIDI_OPCODE_NOTE_OFF:
+        arg1 += this->unk2c4;
+        this->channels[opcodeLow].keyPressedFlags[arg1 >> 3] &= (~(1 << (arg1 & 7))) & 0xff;
+        break;
+    case MIDI_OPCODE_PROGRAM_CHANGE:
+        this->channels[opcodeLow].instrument = arg1;
+        break;
+    case MIDI_OPCODE_MODE_CHANGE:
+        switch (arg1)
+        {
+        case 0:
+            this->channels[opcodeLow].instrumentBank = arg2;
+            break;
+        case 7:
+            this->channels[opcodeLow].channelVolume = arg2;
+            lVar5 = (f32)arg2 * this->fadeOutVolumeMultiplier;
+            if (lVar5 < 0)
+            {
+                lVar5 = 0;
+            }
+            else if (0x7f < lVar5)
+            {
+                lVar5 = 0x7f;
+            }
+            arg2 = this->channels[opcodeLow].modifiedVolume = lVar5;
+            break;
+        case 91:
+            this->channels[opcodeLow].effectOneDepth = arg2;
+            break;
+        case 93:
+            this->channels[opcodeLow].effectThreeDepth = arg2;
+            break;
+        case 10:
+            this->channels[opcodeLow].pan = arg2;
+            break;
+        case 2:
+            // Breath control marks the loop start, just after this event.
+            timeline->loopCursor = timeline->cursor;
+            timeline->loopTime = event->time;
+            break;
+        case 4:
+            // Foot controller jumps back to it. A jump to the same instant would never get past this tick.
+            if (timeline->loopTime < event->time)
+            {
+                timeline->cursor = timeline->loopCursor;
+                timeline->time = timeline->loopTime;
+            }
+            break;
+        }
+        break;
+    }
+    this->midiOutDev.SendShortMsg(event->status, arg1, arg2);
+}
+#endif
+
 #pragma var_order(arg1, idx, volumeByte, midiStatus, volumeClamped)
 void MidiOutput::FadeOutSetVolume(i32 volume)
 {
@@ -2,6 +2,7 @@
 
 #include "ZunBool.hpp"
 #include "ZunResult.hpp"
+#include "diffbuild.hpp"
 #include "inttypes.hpp"
 #include <Windows.h>
 
@@ -106,6 +107,10 @@ struct MidiChannel
     u8 modifiedVolume;
 };
 
+#ifdef MIDI_TIMELINE
+struct MidiEvent;
+#endif
+
 struct MidiOutput : MidiTimer
 {
     MidiOutput();
@@ -123,6 +128,12 @@ struct MidiOutput : MidiTimer
     void ParseFile(u32 idx);
     void ProcessMsg(MidiTrack *track);
 
+#ifdef MIDI_TIMELINE
+    // OnTimerElapsed and ProcessMsg, playing g_MidiTimeline instead of the raw tracks.
+    void OnTimelineTimerElapsed();
+    void SendTimelineEvent(MidiEvent *event);
+#endif
+
     ZunResult ParseFile(i32 idx);
     ZunResult LoadFile(char *midiPath);
     ZunResult Play();
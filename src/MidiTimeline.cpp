@@ -0,0 +1,261 @@
+#include "MidiTimeline.hpp"
+#include "ZunMemory.hpp"
+
+#include <string.h>
+
+namespace th06
+{
+MidiTimeline g_MidiTimeline;
+
+// MidiOutput::ParseFile doesn't read a tempo from the file until the first Set Tempo; this is what it starts with.
+#define MIDI_TIMELINE_INITIAL_TEMPO 1000000
+
+struct MidiTimelineTrack
+{
+    u8 *cursor;
+    u8 *end;
+    u32 nextTick;
+    u8 runningStatus;
+    ZunBool isPlaying;
+};
+
+MidiTimeline::MidiTimeline()
+{
+    memset(this, 0, sizeof(MidiTimeline));
+}
+
+MidiTimeline::~MidiTimeline()
+{
+    this->Release();
+}
+
+void MidiTimeline::Release()
+{
+    ZunFree(this->events);
+    ZunFree(this->sysexData);
+    this->events = NULL;
+    this->sysexData = NULL;
+    this->numEvents = 0;
+    this->sysexSize = 0;
+    this->endTime = 0;
+    this->Rewind();
+}
+
+void MidiTimeline::Rewind()
+{
+    this->cursor = 0;
+    this->time = 0;
+    this->loopCursor = 0;
+    this->loopTime = 0;
+    this->isFinished = false;
+}
+
+// Plays the tracks through without waiting, always taking the event with the lowest tick next and the lowest track
+// on a tie, as the timer would have reached them. Only counts the events and the sysex bytes when timeline has
+// nowhere to put them yet.
+static void FlattenTracks(MidiTimeline *timeline, MidiTimelineTrack *trackStates, i32 numTracks, i32 divisions)
+{
+    MidiTimelineTrack *track;
+    MidiEvent *event;
+    i32 trackIdx;
+    i32 pick;
+    u32 tempo;
+    u32 tempoTick;
+    u32 tempoTime;
+    u32 time;
+    u32 length;
+    u32 idx;
+    u8 status;
+    u8 metaType;
+
+    tempo = MIDI_TIMELINE_INITIAL_TEMPO;
+    tempoTick = 0;
+    tempoTime = 0;
+    timeline->numEvents = 0;
+    timeline->sysexSize = 0;
+    timeline->endTime = 0;
+    for (;;)
+    {
+        pick = -1;
+        for (trackIdx = 0; trackIdx < numTracks; trackIdx++)
+        {
+            if (trackStates[trackIdx].isPlaying &&
+                (pick < 0 || trackStates[trackIdx].nextTick < trackStates[pick].nextTick))
+            {
+                pick = trackIdx;
+            }
+        }
+        if (pick < 0)
+        {
+            break;
+        }
+
+        track = &trackStates[pick];
+        time = tempoTime + (u32)((LONGLONG)(track->nextTick - tempoTick) * tempo / divisions);
+        if (track->cursor >= track->end)
+        {
+            // Ran off the end without an End of Track.
+            track->isPlaying = false;
+            timeline->endTime = time > timeline->endTime ? time : timeline->endTime;
+            continue;
+        }
+
+        status = *track->cursor;
+        if (status < MIDI_OPCODE_NOTE_OFF)
+        {
+            status = track->runningStatus;
+        }
+        else
+        {
+            track->cursor++;
+        }
+
+        event = NULL;
+        switch (status & 0xf0)
+        {
+        case MIDI_OPCODE_SYSTEM_EXCLUSIVE:
+            if (status == MIDI_OPCODE_SYSTEM_EXCLUSIVE)
+            {
+                length = MidiOutput::SkipVariableLength(&track->cursor);
+                if (timeline->events != NULL)
+                {
+                    event = &timeline->events[timeline->numEvents];
+                    event->sysexOffset = timeline->sysexSize;
+                    event->sysexLength = length;
+                    memcpy(timeline->sysexData + timeline->sysexSize, track->cursor, length);
+                }
+                timeline->numEvents++;
+                timeline->sysexSize += length;
+                track->cursor += length;
+            }
+            else if (status == MIDI_OPCODE_SYSTEM_RESET)
+            {
+                metaType = *track->cursor;
+                track->cursor++;
+                length = MidiOutput::SkipVariableLength(&track->cursor);
+                // End of Track
+                if (metaType == 0x2f)
+                {
+                    track->isPlaying = false;
+                    timeline->endTime = time > timeline->endTime ? time : timeline->endTime;
+                    continue;
+                }
+                // Set Tempo. Each byte is added in on top of the running total shifted up, not just shifted in,
+                // which makes every tempo a little slower than the file says. It's kept so the timing is the same.
+                if (metaType == 0x51)
+                {
+                    tempoTick = track->nextTick;
+                    tempoTime = time;
+                    tempo = 0;
+                    for (idx = 0; idx < length; idx++)
+                    {
+                        tempo += tempo * 0x100 + *track->cursor;
+                        track->cursor++;
+                    }
+                    break;
+                }
+                track->cursor += length;
+            }
+            break;
+        case MIDI_OPCODE_NOTE_OFF:
+        case MIDI_OPCODE_NOTE_ON:
+        case MIDI_OPCODE_POLYPHONIC_AFTERTOUCH:
+        case MIDI_OPCODE_MODE_CHANGE:
+        case MIDI_OPCODE_PITCH_BEND_CHANGE:
+            if (timeline->events != NULL)
+            {
+                event = &timeline->events[timeline->numEvents];
+                event->arg1 = track->cursor[0];
+                event->arg2 = track->cursor[1];
+            }
+            timeline->numEvents++;
+            track->cursor += 2;
+            break;
+        case MIDI_OPCODE_PROGRAM_CHANGE:
+        case MIDI_OPCODE_CHANNEL_AFTERTOUCH:
+            if (timeline->events != NULL)
+            {
+                event = &timeline->events[timeline->numEvents];
+                event->arg1 = track->cursor[0];
+                event->arg2 = 0;
+            }
+            timeline->numEvents++;
+            track->cursor += 1;
+            break;
+        }
+        if (event != NULL)
+        {
+            event->time = time;
+            event->status = status;
+            event->unused = 0;
+        }
+        track->runningStatus = status;
+        track->nextTick += MidiOutput::SkipVariableLength(&track->cursor);
+    }
+}
+
+static void ResetTrackStates(MidiTimelineTrack *trackStates, MidiTrack *tracks, i32 numTracks)
+{
+    i32 trackIdx;
+
+    for (trackIdx = 0; trackIdx < numTracks; trackIdx++)
+    {
+        trackStates[trackIdx].cursor = tracks[trackIdx].trackData;
+        trackStates[trackIdx].end = tracks[trackIdx].trackData + tracks[trackIdx].trackLength;
+        trackStates[trackIdx].runningStatus = 0;
+        trackStates[trackIdx].isPlaying = tracks[trackIdx].trackLength != 0;
+        trackStates[trackIdx].nextTick =
+            trackStates[trackIdx].isPlaying ? MidiOutput::SkipVariableLength(&trackStates[trackIdx].cursor) : 0;
+    }
+}
+
+ZunResult MidiTimeline::Build(MidiTrack *tracks, i32 numTracks, i32 divisions)
+{
+    MidiTimelineTrack *trackStates;
+
+    this->Release();
+    if (numTracks <= 0 || divisions <= 0)
+    {
+        return ZUN_ERROR;
+    }
+    trackStates = (MidiTimelineTrack *)ZunAlloc(sizeof(MidiTimelineTrack) * numTracks, "midi");
+
+    // Once to size the arrays, once to fill them.
+    ResetTrackStates(trackStates, tracks, numTracks);
+    FlattenTracks(this, trackStates, numTracks, divisions);
+    this->events = (MidiEvent *)ZunAlloc(sizeof(MidiEvent) * (this->numEvents + 1), "midi");
+    this->sysexData = (u8 *)ZunAlloc(this->sysexSize + 1, "midi");
+    memset(this->events, 0, sizeof(MidiEvent) * (this->numEvents + 1));
+    ResetTrackStates(trackStates, tracks, numTracks);
+    FlattenTracks(this, trackStates, numTracks, divisions);
+
+    ZunFree(trackStates);
+    return ZUN_SUCCESS;
+}
+
+void MidiTimeline::Dump(FILE *file)
+{
+    MidiEvent *event;
+    i32 idx;
+    u32 byteIdx;
+
+    for (idx = 0; idx < this->numEvents; idx++)
+    {
+        event = &this->events[idx];
+        fprintf(file, "%10u %02x", event->time, event->status);
+        if (event->status == MIDI_OPCODE_SYSTEM_EXCLUSIVE)
+        {
+            for (byteIdx = 0; byteIdx < event->sysexLength; byteIdx++)
+            {
+                fprintf(file, " %02x", this->sysexData[event->sysexOffset + byteIdx]);
+            }
+        }
+        else
+        {
+            fprintf(file, " %02x %02x", event->arg1, event->arg2);
+        }
+        fprintf(file, "\n");
+    }
+    fprintf(file, "%10u end\n", this->endTime);
+}
+}; // namespace th06
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "MidiOutput.hpp"
+#include "ZunBool.hpp"
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
+// MIDI_TIMELINE adds the -miditimeline switch, which has MidiOutput play g_MidiTimeline instead of its raw tracks.
+// WinMain, MidiOutput::OnTimerElapsed and the functions loading and rewinding tracks no longer match the original
+// binary with it.
+#if defined(MIDI_TIMELINE) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "MIDI_TIMELINE changes MidiOutput"
+#endif
+
+namespace th06
+{
+// A channel message or system exclusive message, with tempo changes already applied to its time. Meta-events
+// don't appear: tempo is in the times, and the end of the tracks is MidiTimeline::endTime.
+struct MidiEvent
+{
+    // Microseconds from the start of the file.
+    u32 time;
+    u8 status;
+    u8 arg1;
+    u8 arg2;
+    u8 unused;
+    // For MIDI_OPCODE_SYSTEM_EXCLUSIVE, the bytes that follow the F0, in MidiTimeline::sysexData.
+    u32 sysexOffset;
+    u32 sysexLength;
+};
+
+// Every track of a MIDI file merged into one time-sorted array of events, so that MidiOutput's timer only has to
+// move a cursor along it instead of parsing the raw tracks as they play. Timing follows
+// MidiOutput::ProcessMsg: a file starts at 1000000us per quarter note, and a Set Tempo's bytes are added up the way
+// it adds them.
+struct MidiTimeline
+{
+    MidiTimeline();
+    ~MidiTimeline();
+
+    ZunResult Build(MidiTrack *tracks, i32 numTracks, i32 divisions);
+    void Release();
+    // One line per event, for checking a file's schedule without a MIDI device.
+    void Dump(FILE *file);
+
+    // Back to the start, as MidiOutput::LoadTracks does for the raw tracks.
+    void Rewind();
+
+    ZunBool isEnabled;
+
+    MidiEvent *events;
+    i32 numEvents;
+    u8 *sysexData;
+    u32 sysexSize;
+    // When the last track ends. Playback starts over on the tick after it.
+    u32 endTime;
+
+    // Playback. The timer callback is the only thing that touches these while the timer runs.
+    i32 cursor;
+    u32 time;
+    // Where a Breath Control (CC 2) marked and a Foot Controller (CC 4) jumps back to.
+    i32 loopCursor;
+    u32 loopTime;
+    ZunBool isFinished;
+};
+
+extern MidiTimeline g_MidiTimeline;
+}; // namespace th06
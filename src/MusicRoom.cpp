@@ -1,10 +1,12 @@
 #include "MusicRoom.hpp"
 #include "AnmManager.hpp"
 #include "AsciiManager.hpp"
+#include "AssetTrace.hpp"
 #include "Chain.hpp"
 #include "ChainPriorities.hpp"
 #include "Controller.hpp"
 #include "FileSystem.hpp"
+#include "ZunMemory.hpp"
 #include "utils.hpp"
 #include <string.h>
 
@@ -113,6 +115,7 @@ ZunResult MusicRoom::RegisterChain()
     static MusicRoom g_MusicRoom;
     MusicRoom *musicRoom;
 
+    ASSET_TRACE_ENTER_SCENE(ASSET_SCENE_MUSICROOM);
     musicRoom = &g_MusicRoom;
     memset(musicRoom, 0, sizeof(MusicRoom));
 
@@ -398,7 +401,7 @@ finishMusiccmtRead:
         musicRoom->descriptionSprites[i].flags.anchor = AnmVmAnchor_TopLeft;
     }
 
-    free(fileBase);
+    ZunFree(fileBase);
 
     return ZUN_SUCCESS;
 }
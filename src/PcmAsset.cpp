@@ -0,0 +1,114 @@
+#include "PcmAsset.hpp"
+#include "ZunMemory.hpp"
+#include "utils.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace th06
+{
+PcmAssetCache g_PcmAssetCache;
+
+PcmAssetCache::PcmAssetCache()
+{
+    memset(this, 0, sizeof(PcmAssetCache));
+}
+
+PcmAsset *PcmAssetCache::FindPath(char *path)
+{
+    i32 idx;
+
+    for (idx = 0; idx < PCM_ASSET_MAX_ASSETS; idx++)
+    {
+        if (this->assets[idx].refCount > 0 && strcmp(this->assets[idx].path, path) == 0)
+        {
+            this->assets[idx].refCount++;
+            return &this->assets[idx];
+        }
+    }
+    return NULL;
+}
+
+// FNV-1a. Only has to tell sounds apart well enough that the memcmp rarely runs for nothing.
+u32 PcmAssetCache::HashPcm(u8 *pcm, u32 pcmSize)
+{
+    u32 hash;
+    u32 idx;
+
+    hash = 0x811c9dc5;
+    for (idx = 0; idx < pcmSize; idx++)
+    {
+        hash = (hash ^ pcm[idx]) * 0x01000193;
+    }
+    return hash;
+}
+
+// Only the fields that change how the samples sound. A "fmt " chunk of a plain PCM file ends before cbSize, so what's
+// there is whatever follows the chunk.
+ZunBool PcmAssetCache::IsSameFormat(WAVEFORMATEX *a, WAVEFORMATEX *b)
+{
+    return a->wFormatTag == b->wFormatTag && a->nChannels == b->nChannels && a->nSamplesPerSec == b->nSamplesPerSec &&
+           a->wBitsPerSample == b->wBitsPerSample;
+}
+
+PcmAsset *PcmAssetCache::Adopt(char *path, u8 *fileData, WAVEFORMATEX *format, u8 *pcm, u32 pcmSize)
+{
+    PcmAsset *asset;
+    PcmAsset *freeSlot;
+    u32 hash;
+    i32 idx;
+
+    hash = HashPcm(pcm, pcmSize);
+    freeSlot = NULL;
+    for (idx = 0; idx < PCM_ASSET_MAX_ASSETS; idx++)
+    {
+        asset = &this->assets[idx];
+        if (asset->refCount <= 0)
+        {
+            if (freeSlot == NULL)
+            {
+                freeSlot = asset;
+            }
+            continue;
+        }
+        if (asset->hash == hash && asset->pcmSize == pcmSize && IsSameFormat(&asset->format, format) &&
+            memcmp(asset->pcm, pcm, pcmSize) == 0)
+        {
+            utils::DebugPrint2("pcm : %s has the same samples as %s\n", path, asset->path);
+            this->sharedBytes += pcmSize;
+            ZunFree(fileData);
+            asset->refCount++;
+            return asset;
+        }
+    }
+    if (freeSlot == NULL)
+    {
+        return NULL;
+    }
+
+    freeSlot->path = path;
+    freeSlot->format = *format;
+    freeSlot->format.cbSize = 0;
+    freeSlot->pcm = pcm;
+    freeSlot->pcmSize = pcmSize;
+    freeSlot->hash = hash;
+    freeSlot->refCount = 1;
+    freeSlot->fileData = fileData;
+    return freeSlot;
+}
+
+void PcmAssetCache::AddRef(PcmAsset *asset)
+{
+    asset->refCount++;
+}
+
+void PcmAssetCache::Release(PcmAsset *asset)
+{
+    if (asset == NULL || --asset->refCount > 0)
+    {
+        return;
+    }
+    ZunFree(asset->fileData);
+    memset(asset, 0, sizeof(PcmAsset));
+}
+}; // namespace th06
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Windows.h>
+#include <mmsystem.h>
+
+#include "ZunBool.hpp"
+#include "inttypes.hpp"
+
+namespace th06
+{
+// As many as SoundPlayer has sound buffers.
+#define PCM_ASSET_MAX_ASSETS 0x80
+
+// The samples of a WAV file, left where FileSystem::OpenPath loaded them instead of copied out. Whoever holds a
+// reference reads pcm in place, and the file's buffer is freed with the last reference.
+struct PcmAsset
+{
+    // Not copied: the caller's string has to last as long as the asset, as g_SFXList's do.
+    char *path;
+    WAVEFORMATEX format;
+    u8 *pcm;
+    u32 pcmSize;
+    u32 hash;
+    i32 refCount;
+    // What FileSystem::OpenPath returned, with pcm somewhere inside it.
+    u8 *fileData;
+};
+
+// Every PcmAsset loaded, so that a path already loaded isn't read again and files with identical samples share one
+// copy of them.
+struct PcmAssetCache
+{
+    PcmAssetCache();
+
+    // A new reference to the asset loaded from path, or NULL if it isn't loaded.
+    PcmAsset *FindPath(char *path);
+    // Takes ownership of fileData and returns a reference to its samples. If another file had the same samples, the
+    // reference is to that file's asset, and fileData is freed straight away. NULL, with fileData still the
+    // caller's, when every slot is taken.
+    PcmAsset *Adopt(char *path, u8 *fileData, WAVEFORMATEX *format, u8 *pcm, u32 pcmSize);
+    void AddRef(PcmAsset *asset);
+    void Release(PcmAsset *asset);
+
+    static u32 HashPcm(u8 *pcm, u32 pcmSize);
+    static ZunBool IsSameFormat(WAVEFORMATEX *a, WAVEFORMATEX *b);
+
+    PcmAsset assets[PCM_ASSET_MAX_ASSETS];
+    // Bytes of samples that didn't need keeping because another file already had them.
+    u32 sharedBytes;
+};
+
+extern PcmAssetCache g_PcmAssetCache;
+}; // namespace th06
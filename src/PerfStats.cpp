@@ -0,0 +1,288 @@
+#include "PerfStats.hpp"
+#include "AnmManager.hpp"
+#include "AsciiManager.hpp"
+#include "BulletManager.hpp"
+#include "D3dStateCache.hpp"
+#include "EffectManager.hpp"
+#include "EnemyManager.hpp"
+#include "ItemManager.hpp"
+#include "Player.hpp"
+#include "Supervisor.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+namespace th06
+{
+PerfStats g_PerfStats;
+
+#define PERF_OVERLAY_LEFT 432.0f
+#define PERF_OVERLAY_BOTTOM 392.0f
+#define PERF_OVERLAY_HEIGHT 64.0f
+// Frames drawn, one pixel wide each.
+#define PERF_OVERLAY_FRAMES 192
+#define PERF_OVERLAY_PIXELS_PER_MS 2.0f
+// Background, the 16.6ms line, and a bar per section per frame, as triangle list quads.
+#define PERF_OVERLAY_MAX_QUADS (2 + PERF_OVERLAY_FRAMES * PerfSection_Count)
+
+static D3DCOLOR g_PerfSectionColors[PerfSection_Count] = {0xc040ff40, 0xc04080ff, 0xc0ff4040};
+static VertexDiffuseXyzrwh g_PerfOverlayVertices[PERF_OVERLAY_MAX_QUADS * 6];
+
+void PerfStats::Start(ZunBool showOverlay)
+{
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceFrequency(&frequency);
+    this->ticksPerSecond = frequency.QuadPart;
+    memset(this->sectionTicks, 0, sizeof(this->sectionTicks));
+    this->frameCount = 0;
+    this->isOverlayEnabled = showOverlay;
+    this->isEnabled = true;
+}
+
+ZunResult PerfStats::OpenCsv(const char *path)
+{
+    this->CloseCsv();
+    this->csvFile = fopen(path, "w");
+    if (this->csvFile == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    fprintf(this->csvFile, "frame,calc_ms,draw_ms,present_ms,bullets,enemies,items,effects,lasers,player_bullets\n");
+    return ZUN_SUCCESS;
+}
+
+void PerfStats::CloseCsv()
+{
+    if (this->csvFile != NULL)
+    {
+        fclose(this->csvFile);
+        this->csvFile = NULL;
+    }
+}
+
+void PerfStats::Begin(i32 section)
+{
+    LARGE_INTEGER now;
+
+    if (!this->isEnabled)
+    {
+        return;
+    }
+    QueryPerformanceCounter(&now);
+    this->sectionBegin[section] = now.QuadPart;
+}
+
+void PerfStats::End(i32 section)
+{
+    LARGE_INTEGER now;
+
+    if (!this->isEnabled)
+    {
+        return;
+    }
+    QueryPerformanceCounter(&now);
+    this->sectionTicks[section] += now.QuadPart - this->sectionBegin[section];
+}
+
+void PerfStats::EndFrame()
+{
+    PerfFrameStats stats;
+    i32 idx;
+
+    if (!this->isEnabled)
+    {
+        return;
+    }
+    for (idx = 0; idx < PerfSection_Count; idx++)
+    {
+        stats.ms[idx] = (f32)(this->sectionTicks[idx] * 1000.0 / this->ticksPerSecond);
+        this->sectionTicks[idx] = 0;
+    }
+
+    // The managers keep these counts up to date in their own updates; only lasers and player bullets need a walk.
+    stats.bullets = g_BulletManager.bulletCount;
+    stats.enemies = g_EnemyManager.enemyCount;
+    stats.items = g_ItemManager.itemCount;
+    stats.effects = g_EffectManager.activeEffects;
+    stats.lasers = 0;
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_BulletManager.lasers); idx++)
+    {
+        if (g_BulletManager.lasers[idx].inUse)
+        {
+            stats.lasers++;
+        }
+    }
+    stats.playerBullets = 0;
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_Player.bullets); idx++)
+    {
+        if (g_Player.bullets[idx].bulletState != PLAYER_BULLET_STATE_UNUSED)
+        {
+            stats.playerBullets++;
+        }
+    }
+    this->PushFrame(&stats);
+}
+
+void PerfStats::PushFrame(PerfFrameStats *stats)
+{
+    stats->frame = this->frameCount;
+    this->history[this->frameCount & (PERF_STATS_HISTORY - 1)] = *stats;
+    this->frameCount++;
+    if (this->csvFile != NULL)
+    {
+        fprintf(this->csvFile, "%u,%.3f,%.3f,%.3f,%d,%d,%d,%d,%d,%d\n", stats->frame, stats->ms[PerfSection_Calc],
+                stats->ms[PerfSection_Draw], stats->ms[PerfSection_Present], stats->bullets, stats->enemies,
+                stats->items, stats->effects, stats->lasers, stats->playerBullets);
+    }
+}
+
+PerfFrameStats *PerfStats::GetFrame(i32 age)
+{
+    if (age < 0 || age >= PERF_STATS_HISTORY || (u32)age >= this->frameCount)
+    {
+        return NULL;
+    }
+    return &this->history[(this->frameCount - 1 - age) & (PERF_STATS_HISTORY - 1)];
+}
+
+f32 PerfStats::GetFrameMs(PerfFrameStats *stats)
+{
+    return stats->ms[PerfSection_Calc] + stats->ms[PerfSection_Draw] + stats->ms[PerfSection_Present];
+}
+
+PerfFrameStats *PerfStats::GetWorstFrame(i32 frames)
+{
+    PerfFrameStats *worst;
+    PerfFrameStats *stats;
+    i32 age;
+
+    worst = NULL;
+    for (age = 0; age < frames; age++)
+    {
+        stats = this->GetFrame(age);
+        if (stats == NULL)
+        {
+            break;
+        }
+        if (worst == NULL || this->GetFrameMs(stats) > this->GetFrameMs(worst))
+        {
+            worst = stats;
+        }
+    }
+    return worst;
+}
+
+static VertexDiffuseXyzrwh *AddPerfOverlayQuad(VertexDiffuseXyzrwh *vertices, f32 left, f32 top, f32 right,
+                                               f32 bottom, D3DCOLOR color)
+{
+    i32 idx;
+
+    vertices[0].position = D3DXVECTOR4(left, top, 0.0f, 1.0f);
+    vertices[1].position = D3DXVECTOR4(right, top, 0.0f, 1.0f);
+    vertices[2].position = D3DXVECTOR4(left, bottom, 0.0f, 1.0f);
+    vertices[3].position = D3DXVECTOR4(left, bottom, 0.0f, 1.0f);
+    vertices[4].position = D3DXVECTOR4(right, top, 0.0f, 1.0f);
+    vertices[5].position = D3DXVECTOR4(right, bottom, 0.0f, 1.0f);
+    for (idx = 0; idx < 6; idx++)
+    {
+        vertices[idx].diffuse = color;
+    }
+    return vertices + 6;
+}
+
+// The graph is a single draw, set up the way ScreenEffect::DrawSquare sets up its untextured quads. The numbers go
+// through the AsciiManager, which draws after the Supervisor.
+void PerfStats::DrawOverlay()
+{
+    VertexDiffuseXyzrwh *vertices;
+    PerfFrameStats *stats;
+    PerfFrameStats *worst;
+    D3DXVECTOR3 position;
+    char buffer[32];
+    f32 top;
+    f32 bottom;
+    f32 left;
+    i32 section;
+    i32 age;
+
+    stats = this->GetFrame(0);
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    vertices = AddPerfOverlayQuad(g_PerfOverlayVertices, PERF_OVERLAY_LEFT, PERF_OVERLAY_BOTTOM - PERF_OVERLAY_HEIGHT,
+                                  PERF_OVERLAY_LEFT + PERF_OVERLAY_FRAMES, PERF_OVERLAY_BOTTOM, 0x80000000);
+    top = PERF_OVERLAY_BOTTOM - 1000.0f / 60.0f * PERF_OVERLAY_PIXELS_PER_MS;
+    vertices = AddPerfOverlayQuad(vertices, PERF_OVERLAY_LEFT, top, PERF_OVERLAY_LEFT + PERF_OVERLAY_FRAMES, top + 1.0f,
+                                  0x80ffffff);
+    // Newest frame on the right, each one a stack of its calc, draw and present times.
+    for (age = 0; age < PERF_OVERLAY_FRAMES && this->GetFrame(age) != NULL; age++)
+    {
+        left = PERF_OVERLAY_LEFT + PERF_OVERLAY_FRAMES - 1 - age;
+        bottom = PERF_OVERLAY_BOTTOM;
+        for (section = 0; section < PerfSection_Count; section++)
+        {
+            top = bottom - this->GetFrame(age)->ms[section] * PERF_OVERLAY_PIXELS_PER_MS;
+            if (top < PERF_OVERLAY_BOTTOM - PERF_OVERLAY_HEIGHT)
+            {
+                top = PERF_OVERLAY_BOTTOM - PERF_OVERLAY_HEIGHT;
+            }
+            if (top < bottom)
+            {
+                vertices = AddPerfOverlayQuad(vertices, left, top, left + 1.0f, bottom, g_PerfSectionColors[section]);
+            }
+            bottom = top;
+        }
+    }
+
+    if (((g_Supervisor.cfg.opts >> GCOS_NO_COLOR_COMP) & 0x01) == 0)
+    {
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+    }
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+    if (((g_Supervisor.cfg.opts >> GCOS_TURN_OFF_DEPTH_TEST) & 0x01) == 0)
+    {
+        D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_ALWAYS);
+        D3D_SET_RENDER_STATE(D3DRS_ZWRITEENABLE, FALSE);
+    }
+    D3D_SET_RENDER_STATE(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+    D3D_SET_VERTEX_SHADER(D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
+    g_Supervisor.d3dDevice->DrawPrimitiveUP(D3DPT_TRIANGLELIST, (vertices - g_PerfOverlayVertices) / 3,
+                                            g_PerfOverlayVertices, sizeof(*g_PerfOverlayVertices));
+    g_AnmManager->SetCurrentVertexShader(0xff);
+    g_AnmManager->SetCurrentSprite(NULL);
+    g_AnmManager->SetCurrentTexture(NULL);
+    g_AnmManager->SetCurrentColorOp(0xff);
+    g_AnmManager->SetCurrentBlendMode(0xff);
+    g_AnmManager->SetCurrentZWriteDisable(0xff);
+    if (((g_Supervisor.cfg.opts >> GCOS_NO_COLOR_COMP) & 0x01) == 0)
+    {
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+    }
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+    D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
+
+    // The sidebar fits 14 characters a line.
+    worst = this->GetWorstFrame(PERF_STATS_WORST_SECONDS * 60);
+    position.x = 416.0f;
+    position.z = 0.0f;
+    position.y = 400.0f;
+    sprintf(buffer, "C%5.2f D%5.2f", stats->ms[PerfSection_Calc], stats->ms[PerfSection_Draw]);
+    g_AsciiManager.AddString(&position, buffer);
+    position.y = 416.0f;
+    sprintf(buffer, "P%5.2f W%5.2f", stats->ms[PerfSection_Present], this->GetFrameMs(worst));
+    g_AsciiManager.AddString(&position, buffer);
+    position.y = 432.0f;
+    sprintf(buffer, "B%3d E%3d I%3d", stats->bullets, stats->enemies, stats->items);
+    g_AsciiManager.AddString(&position, buffer);
+    position.y = 448.0f;
+    sprintf(buffer, "F%3d L%2d S%2d", stats->effects, stats->lasers, stats->playerBullets);
+    g_AsciiManager.AddString(&position, buffer);
+}
+}; // namespace th06
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Windows.h>
+#include <stdio.h>
+
+#include "ZunBool.hpp"
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
+// PERF_OVERLAY has GameWindow::Render and GameWindow::Present time their work through g_PerfStats, and adds the
+// -perfoverlay and -perfcsv switches to WinMain. None of them match the original binary with it.
+#if defined(PERF_OVERLAY) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "PERF_OVERLAY changes the main loop"
+#endif
+
+#ifdef PERF_OVERLAY
+#define PERF_STATS_BEGIN(section) g_PerfStats.Begin(section)
+#define PERF_STATS_END(section) g_PerfStats.End(section)
+#define PERF_STATS_END_FRAME() g_PerfStats.EndFrame()
+#else
+#define PERF_STATS_BEGIN(section)
+#define PERF_STATS_END(section)
+#define PERF_STATS_END_FRAME()
+#endif
+
+namespace th06
+{
+// Power of two, and more than PERF_STATS_WORST_SECONDS of frames at 60fps.
+#define PERF_STATS_HISTORY 256
+#define PERF_STATS_WORST_SECONDS 4
+
+enum PerfSection
+{
+    PerfSection_Calc,
+    PerfSection_Draw,
+    PerfSection_Present,
+    PerfSection_Count,
+};
+
+// What one presented frame cost. With frameskip several calc and draw passes go into a single frame.
+struct PerfFrameStats
+{
+    u32 frame;
+    f32 ms[PerfSection_Count];
+    i32 bullets;
+    i32 enemies;
+    i32 items;
+    i32 effects;
+    i32 lasers;
+    i32 playerBullets;
+};
+
+// Times the calc, draw and present passes of GameWindow::Render and keeps the last PERF_STATS_HISTORY frames along
+// with the live object counts. Supervisor::DrawFpsCounter shows them as an overlay, and any runner can have them
+// written out as CSV. When not enabled every call returns right away.
+struct PerfStats
+{
+    void Start(ZunBool showOverlay);
+    ZunResult OpenCsv(const char *path);
+    void CloseCsv();
+
+    void Begin(i32 section);
+    void End(i32 section);
+    // Samples the object counts and pushes the frame timed since the last call.
+    void EndFrame();
+    void PushFrame(PerfFrameStats *stats);
+
+    // age 0 is the newest frame; NULL past what has been recorded.
+    PerfFrameStats *GetFrame(i32 age);
+    f32 GetFrameMs(PerfFrameStats *stats);
+    PerfFrameStats *GetWorstFrame(i32 frames);
+
+    void DrawOverlay();
+
+    ZunBool isEnabled;
+    ZunBool isOverlayEnabled;
+    LONGLONG ticksPerSecond;
+    LONGLONG sectionBegin[PerfSection_Count];
+    LONGLONG sectionTicks[PerfSection_Count];
+    PerfFrameStats history[PERF_STATS_HISTORY];
+    u32 frameCount;
+    FILE *csvFile;
+};
+
+extern PerfStats g_PerfStats;
+}; // namespace th06
@@ -0,0 +1,964 @@
+#include "PipelinedD3dDevice.hpp"
+#include "ZunMemory.hpp"
+#include "utils.hpp"
+
+#include <float.h>
+#include <string.h>
+
+namespace th06
+{
+PipelinedD3dDevice *g_PipelinedD3dDevice;
+
+// Grows a ZunAlloc'd array to hold at least count + extra elements.
+static void *GrowPipelinedArray(void *array, i32 elemSize, i32 count, i32 extra, i32 *capacity)
+{
+    void *grown;
+
+    if (count + extra <= *capacity)
+    {
+        return array;
+    }
+    if (*capacity == 0)
+    {
+        *capacity = 256;
+    }
+    while (*capacity < count + extra)
+    {
+        *capacity *= 2;
+    }
+    grown = ZunAlloc(elemSize * *capacity, "pipelined draw");
+    if (array != NULL)
+    {
+        memcpy(grown, array, elemSize * count);
+        ZunFree(array);
+    }
+    return grown;
+}
+
+// Vertices consumed by a non-indexed draw, or indices by an indexed one, of primitiveCount primitives.
+static UINT PipelinedD3dVertexCount(D3DPRIMITIVETYPE primitiveType, UINT primitiveCount)
+{
+    switch (primitiveType)
+    {
+    case D3DPT_POINTLIST:
+        return primitiveCount;
+    case D3DPT_LINELIST:
+        return primitiveCount * 2;
+    case D3DPT_LINESTRIP:
+        return primitiveCount + 1;
+    case D3DPT_TRIANGLELIST:
+        return primitiveCount * 3;
+    default:
+        return primitiveCount + 2;
+    }
+}
+
+PipelinedD3dDevice::PipelinedD3dDevice(IDirect3DDevice8 *device)
+{
+    this->device = device;
+    this->refCount = 1;
+    memset(this->frames, 0, sizeof(this->frames));
+    this->recording = &this->frames[0];
+    this->submitting = NULL;
+    memset(&this->thisFrame, 0, sizeof(this->thisFrame));
+    memset(&this->lastFrame, 0, sizeof(this->lastFrame));
+    this->quitting = false;
+    this->fpuControl = _controlfp(0, 0);
+    this->startEvent = CreateEventA(NULL, 0, 0, NULL);
+    this->idleEvent = CreateEventA(NULL, 1, 1, NULL);
+    this->thread = CreateThread(NULL, 0, PipelinedD3dDevice::RenderThread, this, 0, NULL);
+}
+
+PipelinedD3dDevice::~PipelinedD3dDevice()
+{
+    i32 idx;
+
+    if (g_PipelinedD3dDevice == this)
+    {
+        g_PipelinedD3dDevice = NULL;
+    }
+    this->Sync();
+    this->quitting = true;
+    SetEvent(this->startEvent);
+    WaitForSingleObject(this->thread, INFINITE);
+    CloseHandle(this->thread);
+    CloseHandle(this->startEvent);
+    CloseHandle(this->idleEvent);
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(this->frames); idx++)
+    {
+        this->Recycle(&this->frames[idx]);
+        ZunFree(this->frames[idx].commands);
+        ZunFree(this->frames[idx].data);
+        ZunFree(this->frames[idx].objects);
+    }
+    this->device->Release();
+}
+
+DWORD __stdcall PipelinedD3dDevice::RenderThread(LPVOID lpThreadParameter)
+{
+    PipelinedD3dDevice *pipeline = (PipelinedD3dDevice *)lpThreadParameter;
+
+    for (;;)
+    {
+        WaitForSingleObject(pipeline->startEvent, INFINITE);
+        if (pipeline->quitting)
+        {
+            break;
+        }
+        // Direct3D and the game agree on the x87 precision; keep it that way on this side too.
+        _controlfp(pipeline->fpuControl, _MCW_PC);
+        pipeline->Replay(pipeline->submitting);
+        SetEvent(pipeline->idleEvent);
+    }
+    return 0;
+}
+
+// Hands the recorded calls to the render thread, once it is done with the previous frame.
+void PipelinedD3dDevice::Submit()
+{
+    if (this->recording->commandCount == 0)
+    {
+        return;
+    }
+    WaitForSingleObject(this->idleEvent, INFINITE);
+    if (this->submitting != NULL)
+    {
+        this->Recycle(this->submitting);
+    }
+    this->submitting = this->recording;
+    this->recording = this->recording == &this->frames[0] ? &this->frames[1] : &this->frames[0];
+    ResetEvent(this->idleEvent);
+    SetEvent(this->startEvent);
+}
+
+// Waits until every call made so far has reached the device.
+void PipelinedD3dDevice::Sync()
+{
+    this->Submit();
+    if (this->submitting == NULL)
+    {
+        return;
+    }
+    if (WaitForSingleObject(this->idleEvent, 0) != WAIT_OBJECT_0)
+    {
+        this->thisFrame.syncs++;
+        WaitForSingleObject(this->idleEvent, INFINITE);
+    }
+    this->Recycle(this->submitting);
+    this->submitting = NULL;
+}
+
+PipelinedD3dCommand *PipelinedD3dDevice::Record(u32 type, CONST void *data, i32 dataSize)
+{
+    PipelinedD3dFrame *frame = this->recording;
+    PipelinedD3dCommand *command;
+
+    frame->commands = (PipelinedD3dCommand *)GrowPipelinedArray(frame->commands, sizeof(PipelinedD3dCommand),
+                                                                frame->commandCount, 1, &frame->commandCapacity);
+    command = &frame->commands[frame->commandCount++];
+    command->type = type;
+    command->dataOffset = this->RecordData(data, dataSize);
+    command->object = NULL;
+    this->thisFrame.commands++;
+    return command;
+}
+
+// Copies size bytes into the recording frame and returns where they went.
+i32 PipelinedD3dDevice::RecordData(CONST void *data, i32 size)
+{
+    PipelinedD3dFrame *frame = this->recording;
+    i32 offset = frame->dataSize;
+    // Keep every payload 4 byte aligned, the matrices and vertices are read in place.
+    i32 alignedSize = (size + 3) & ~3;
+
+    if (size == 0)
+    {
+        return offset;
+    }
+    frame->data = (u8 *)GrowPipelinedArray(frame->data, 1, frame->dataSize, alignedSize, &frame->dataCapacity);
+    memcpy(frame->data + offset, data, size);
+    frame->dataSize += alignedSize;
+    this->thisFrame.dataBytes += alignedSize;
+    return offset;
+}
+
+// Keeps object alive until the frame holding command has been submitted.
+void PipelinedD3dDevice::Hold(PipelinedD3dCommand *command, IUnknown *object)
+{
+    PipelinedD3dFrame *frame = this->recording;
+
+    command->object = object;
+    if (object == NULL)
+    {
+        return;
+    }
+    object->AddRef();
+    frame->objects = (IUnknown **)GrowPipelinedArray(frame->objects, sizeof(IUnknown *), frame->objectCount, 1,
+                                                     &frame->objectCapacity);
+    frame->objects[frame->objectCount++] = object;
+}
+
+// Runs on the game thread, while the render thread is idle, so the references are dropped the way they were taken.
+void PipelinedD3dDevice::Recycle(PipelinedD3dFrame *frame)
+{
+    i32 idx;
+
+    for (idx = 0; idx < frame->objectCount; idx++)
+    {
+        frame->objects[idx]->Release();
+    }
+    frame->objectCount = 0;
+    frame->commandCount = 0;
+    frame->dataSize = 0;
+}
+
+void PipelinedD3dDevice::Replay(PipelinedD3dFrame *frame)
+{
+    PipelinedD3dCommand *command;
+    u8 *data;
+    i32 idx;
+
+    for (command = frame->commands, idx = 0; idx < frame->commandCount; idx++, command++)
+    {
+        data = frame->data + command->dataOffset;
+        switch (command->type)
+        {
+        case PipelinedD3dCommand_BeginScene:
+            this->device->BeginScene();
+            break;
+        case PipelinedD3dCommand_EndScene:
+            this->device->EndScene();
+            break;
+        case PipelinedD3dCommand_Clear:
+            this->device->Clear(command->args[0], command->args[0] != 0 ? (D3DRECT *)data : NULL, command->args[1],
+                                command->args[2], *(f32 *)&command->args[3], command->args[4]);
+            break;
+        case PipelinedD3dCommand_Transform:
+            this->device->SetTransform((D3DTRANSFORMSTATETYPE)command->args[0], (D3DMATRIX *)data);
+            break;
+        case PipelinedD3dCommand_Viewport:
+            this->device->SetViewport((D3DVIEWPORT8 *)data);
+            break;
+        case PipelinedD3dCommand_Material:
+            this->device->SetMaterial((D3DMATERIAL8 *)data);
+            break;
+        case PipelinedD3dCommand_RenderState:
+            this->device->SetRenderState((D3DRENDERSTATETYPE)command->args[0], command->args[1]);
+            break;
+        case PipelinedD3dCommand_TextureStageState:
+            this->device->SetTextureStageState(command->args[0], (D3DTEXTURESTAGESTATETYPE)command->args[1],
+                                               command->args[2]);
+            break;
+        case PipelinedD3dCommand_Texture:
+            this->device->SetTexture(command->args[0], (IDirect3DBaseTexture8 *)command->object);
+            break;
+        case PipelinedD3dCommand_VertexShader:
+            this->device->SetVertexShader(command->args[0]);
+            break;
+        case PipelinedD3dCommand_StreamSource:
+            this->device->SetStreamSource(command->args[0], (IDirect3DVertexBuffer8 *)command->object,
+                                          command->args[1]);
+            break;
+        case PipelinedD3dCommand_DrawPrimitive:
+            this->device->DrawPrimitive((D3DPRIMITIVETYPE)command->args[0], command->args[1], command->args[2]);
+            break;
+        case PipelinedD3dCommand_DrawIndexedPrimitive:
+            this->device->DrawIndexedPrimitive((D3DPRIMITIVETYPE)command->args[0], command->args[1],
+                                               command->args[2], command->args[3], command->args[4]);
+            break;
+        case PipelinedD3dCommand_DrawPrimitiveUP:
+            this->device->DrawPrimitiveUP((D3DPRIMITIVETYPE)command->args[0], command->args[1], data,
+                                          command->args[2]);
+            break;
+        case PipelinedD3dCommand_DrawIndexedPrimitiveUP:
+            this->device->DrawIndexedPrimitiveUP((D3DPRIMITIVETYPE)command->args[0], command->args[1],
+                                                 command->args[2], command->args[3], data + command->args[6],
+                                                 (D3DFORMAT)command->args[4], data, command->args[5]);
+            break;
+        }
+    }
+}
+
+STDMETHODIMP PipelinedD3dDevice::QueryInterface(REFIID riid, void **ppvObj)
+{
+    if (riid == IID_IUnknown || riid == IID_IDirect3DDevice8)
+    {
+        this->AddRef();
+        *ppvObj = this;
+        return S_OK;
+    }
+    *ppvObj = NULL;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) PipelinedD3dDevice::AddRef()
+{
+    return ++this->refCount;
+}
+
+STDMETHODIMP_(ULONG) PipelinedD3dDevice::Release()
+{
+    if (--this->refCount == 0)
+    {
+        delete this;
+        return 0;
+    }
+    return this->refCount;
+}
+
+STDMETHODIMP PipelinedD3dDevice::TestCooperativeLevel()
+{
+    this->Sync();
+    return this->device->TestCooperativeLevel();
+}
+
+STDMETHODIMP_(UINT) PipelinedD3dDevice::GetAvailableTextureMem()
+{
+    this->Sync();
+    return this->device->GetAvailableTextureMem();
+}
+
+STDMETHODIMP PipelinedD3dDevice::ResourceManagerDiscardBytes(DWORD Bytes)
+{
+    this->Sync();
+    return this->device->ResourceManagerDiscardBytes(Bytes);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetDirect3D(IDirect3D8 **ppD3D8)
+{
+    this->Sync();
+    return this->device->GetDirect3D(ppD3D8);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetDeviceCaps(D3DCAPS8 *pCaps)
+{
+    this->Sync();
+    return this->device->GetDeviceCaps(pCaps);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetDisplayMode(D3DDISPLAYMODE *pMode)
+{
+    this->Sync();
+    return this->device->GetDisplayMode(pMode);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetCreationParameters(D3DDEVICE_CREATION_PARAMETERS *pParameters)
+{
+    this->Sync();
+    return this->device->GetCreationParameters(pParameters);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetCursorProperties(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface8 *pCursorBitmap)
+{
+    this->Sync();
+    return this->device->SetCursorProperties(XHotSpot, YHotSpot, pCursorBitmap);
+}
+
+STDMETHODIMP_(void) PipelinedD3dDevice::SetCursorPosition(UINT XScreenSpace, UINT YScreenSpace, DWORD Flags)
+{
+    this->Sync();
+    this->device->SetCursorPosition(XScreenSpace, YScreenSpace, Flags);
+}
+
+STDMETHODIMP_(BOOL) PipelinedD3dDevice::ShowCursor(BOOL bShow)
+{
+    this->Sync();
+    return this->device->ShowCursor(bShow);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateAdditionalSwapChain(D3DPRESENT_PARAMETERS *pPresentationParameters,
+                                                           IDirect3DSwapChain8 **pSwapChain)
+{
+    this->Sync();
+    return this->device->CreateAdditionalSwapChain(pPresentationParameters, pSwapChain);
+}
+
+STDMETHODIMP PipelinedD3dDevice::Reset(D3DPRESENT_PARAMETERS *pPresentationParameters)
+{
+    this->Sync();
+    return this->device->Reset(pPresentationParameters);
+}
+
+STDMETHODIMP PipelinedD3dDevice::Present(CONST RECT *pSourceRect, CONST RECT *pDestRect, HWND hDestWindowOverride,
+                                         CONST RGNDATA *pDirtyRegion)
+{
+    this->Sync();
+    this->lastFrame = this->thisFrame;
+    memset(&this->thisFrame, 0, sizeof(this->thisFrame));
+    return this->device->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetBackBuffer(UINT BackBuffer, D3DBACKBUFFER_TYPE Type,
+                                               IDirect3DSurface8 **ppBackBuffer)
+{
+    this->Sync();
+    return this->device->GetBackBuffer(BackBuffer, Type, ppBackBuffer);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetRasterStatus(D3DRASTER_STATUS *pRasterStatus)
+{
+    this->Sync();
+    return this->device->GetRasterStatus(pRasterStatus);
+}
+
+STDMETHODIMP_(void) PipelinedD3dDevice::SetGammaRamp(DWORD Flags, CONST D3DGAMMARAMP *pRamp)
+{
+    this->Sync();
+    this->device->SetGammaRamp(Flags, pRamp);
+}
+
+STDMETHODIMP_(void) PipelinedD3dDevice::GetGammaRamp(D3DGAMMARAMP *pRamp)
+{
+    this->Sync();
+    this->device->GetGammaRamp(pRamp);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format,
+                                               D3DPOOL Pool, IDirect3DTexture8 **ppTexture)
+{
+    this->Sync();
+    return this->device->CreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateVolumeTexture(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage,
+                                                     D3DFORMAT Format, D3DPOOL Pool,
+                                                     IDirect3DVolumeTexture8 **ppVolumeTexture)
+{
+    this->Sync();
+    return this->device->CreateVolumeTexture(Width, Height, Depth, Levels, Usage, Format, Pool, ppVolumeTexture);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateCubeTexture(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format,
+                                                   D3DPOOL Pool, IDirect3DCubeTexture8 **ppCubeTexture)
+{
+    this->Sync();
+    return this->device->CreateCubeTexture(EdgeLength, Levels, Usage, Format, Pool, ppCubeTexture);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateVertexBuffer(UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool,
+                                                    IDirect3DVertexBuffer8 **ppVertexBuffer)
+{
+    this->Sync();
+    return this->device->CreateVertexBuffer(Length, Usage, FVF, Pool, ppVertexBuffer);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateIndexBuffer(UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool,
+                                                   IDirect3DIndexBuffer8 **ppIndexBuffer)
+{
+    this->Sync();
+    return this->device->CreateIndexBuffer(Length, Usage, Format, Pool, ppIndexBuffer);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format,
+                                                    D3DMULTISAMPLE_TYPE MultiSample, BOOL Lockable,
+                                                    IDirect3DSurface8 **ppSurface)
+{
+    this->Sync();
+    return this->device->CreateRenderTarget(Width, Height, Format, MultiSample, Lockable, ppSurface);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format,
+                                                           D3DMULTISAMPLE_TYPE MultiSample,
+                                                           IDirect3DSurface8 **ppSurface)
+{
+    this->Sync();
+    return this->device->CreateDepthStencilSurface(Width, Height, Format, MultiSample, ppSurface);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateImageSurface(UINT Width, UINT Height, D3DFORMAT Format,
+                                                    IDirect3DSurface8 **ppSurface)
+{
+    this->Sync();
+    return this->device->CreateImageSurface(Width, Height, Format, ppSurface);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CopyRects(IDirect3DSurface8 *pSourceSurface, CONST RECT *pSourceRectsArray,
+                                           UINT cRects, IDirect3DSurface8 *pDestinationSurface,
+                                           CONST POINT *pDestPointsArray)
+{
+    this->Sync();
+    return this->device->CopyRects(pSourceSurface, pSourceRectsArray, cRects, pDestinationSurface, pDestPointsArray);
+}
+
+STDMETHODIMP PipelinedD3dDevice::UpdateTexture(IDirect3DBaseTexture8 *pSourceTexture,
+                                               IDirect3DBaseTexture8 *pDestinationTexture)
+{
+    this->Sync();
+    return this->device->UpdateTexture(pSourceTexture, pDestinationTexture);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetFrontBuffer(IDirect3DSurface8 *pDestSurface)
+{
+    this->Sync();
+    return this->device->GetFrontBuffer(pDestSurface);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetRenderTarget(IDirect3DSurface8 *pRenderTarget, IDirect3DSurface8 *pNewZStencil)
+{
+    this->Sync();
+    return this->device->SetRenderTarget(pRenderTarget, pNewZStencil);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetRenderTarget(IDirect3DSurface8 **ppRenderTarget)
+{
+    this->Sync();
+    return this->device->GetRenderTarget(ppRenderTarget);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetDepthStencilSurface(IDirect3DSurface8 **ppZStencilSurface)
+{
+    this->Sync();
+    return this->device->GetDepthStencilSurface(ppZStencilSurface);
+}
+
+STDMETHODIMP PipelinedD3dDevice::BeginScene()
+{
+    this->Record(PipelinedD3dCommand_BeginScene, NULL, 0);
+    return D3D_OK;
+}
+
+// The frame is complete; let the render thread have it while the game moves on.
+STDMETHODIMP PipelinedD3dDevice::EndScene()
+{
+    this->Record(PipelinedD3dCommand_EndScene, NULL, 0);
+    this->Submit();
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::Clear(DWORD Count, CONST D3DRECT *pRects, DWORD Flags, D3DCOLOR Color, float Z,
+                                       DWORD Stencil)
+{
+    PipelinedD3dCommand *command;
+
+    if (pRects == NULL)
+    {
+        Count = 0;
+    }
+    command = this->Record(PipelinedD3dCommand_Clear, pRects, Count * sizeof(D3DRECT));
+    command->args[0] = Count;
+    command->args[1] = Flags;
+    command->args[2] = Color;
+    command->args[3] = *(DWORD *)&Z;
+    command->args[4] = Stencil;
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix)
+{
+    PipelinedD3dCommand *command = this->Record(PipelinedD3dCommand_Transform, pMatrix, sizeof(D3DMATRIX));
+
+    command->args[0] = State;
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetTransform(D3DTRANSFORMSTATETYPE State, D3DMATRIX *pMatrix)
+{
+    this->Sync();
+    return this->device->GetTransform(State, pMatrix);
+}
+
+STDMETHODIMP PipelinedD3dDevice::MultiplyTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix)
+{
+    this->Sync();
+    return this->device->MultiplyTransform(State, pMatrix);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetViewport(CONST D3DVIEWPORT8 *pViewport)
+{
+    this->Record(PipelinedD3dCommand_Viewport, pViewport, sizeof(D3DVIEWPORT8));
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetViewport(D3DVIEWPORT8 *pViewport)
+{
+    this->Sync();
+    return this->device->GetViewport(pViewport);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetMaterial(CONST D3DMATERIAL8 *pMaterial)
+{
+    this->Record(PipelinedD3dCommand_Material, pMaterial, sizeof(D3DMATERIAL8));
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetMaterial(D3DMATERIAL8 *pMaterial)
+{
+    this->Sync();
+    return this->device->GetMaterial(pMaterial);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetLight(DWORD Index, CONST D3DLIGHT8 *pLight)
+{
+    this->Sync();
+    return this->device->SetLight(Index, pLight);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetLight(DWORD Index, D3DLIGHT8 *pLight)
+{
+    this->Sync();
+    return this->device->GetLight(Index, pLight);
+}
+
+STDMETHODIMP PipelinedD3dDevice::LightEnable(DWORD Index, BOOL Enable)
+{
+    this->Sync();
+    return this->device->LightEnable(Index, Enable);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetLightEnable(DWORD Index, BOOL *pEnable)
+{
+    this->Sync();
+    return this->device->GetLightEnable(Index, pEnable);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetClipPlane(DWORD Index, CONST float *pPlane)
+{
+    this->Sync();
+    return this->device->SetClipPlane(Index, pPlane);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetClipPlane(DWORD Index, float *pPlane)
+{
+    this->Sync();
+    return this->device->GetClipPlane(Index, pPlane);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
+{
+    PipelinedD3dCommand *command = this->Record(PipelinedD3dCommand_RenderState, NULL, 0);
+
+    command->args[0] = State;
+    command->args[1] = Value;
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetRenderState(D3DRENDERSTATETYPE State, DWORD *pValue)
+{
+    this->Sync();
+    return this->device->GetRenderState(State, pValue);
+}
+
+STDMETHODIMP PipelinedD3dDevice::BeginStateBlock()
+{
+    this->Sync();
+    return this->device->BeginStateBlock();
+}
+
+STDMETHODIMP PipelinedD3dDevice::EndStateBlock(DWORD *pToken)
+{
+    this->Sync();
+    return this->device->EndStateBlock(pToken);
+}
+
+STDMETHODIMP PipelinedD3dDevice::ApplyStateBlock(DWORD Token)
+{
+    this->Sync();
+    return this->device->ApplyStateBlock(Token);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CaptureStateBlock(DWORD Token)
+{
+    this->Sync();
+    return this->device->CaptureStateBlock(Token);
+}
+
+STDMETHODIMP PipelinedD3dDevice::DeleteStateBlock(DWORD Token)
+{
+    this->Sync();
+    return this->device->DeleteStateBlock(Token);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateStateBlock(D3DSTATEBLOCKTYPE Type, DWORD *pToken)
+{
+    this->Sync();
+    return this->device->CreateStateBlock(Type, pToken);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetClipStatus(CONST D3DCLIPSTATUS8 *pClipStatus)
+{
+    this->Sync();
+    return this->device->SetClipStatus(pClipStatus);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetClipStatus(D3DCLIPSTATUS8 *pClipStatus)
+{
+    this->Sync();
+    return this->device->GetClipStatus(pClipStatus);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetTexture(DWORD Stage, IDirect3DBaseTexture8 **ppTexture)
+{
+    this->Sync();
+    return this->device->GetTexture(Stage, ppTexture);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetTexture(DWORD Stage, IDirect3DBaseTexture8 *pTexture)
+{
+    PipelinedD3dCommand *command = this->Record(PipelinedD3dCommand_Texture, NULL, 0);
+
+    command->args[0] = Stage;
+    this->Hold(command, pTexture);
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD *pValue)
+{
+    this->Sync();
+    return this->device->GetTextureStageState(Stage, Type, pValue);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+{
+    PipelinedD3dCommand *command = this->Record(PipelinedD3dCommand_TextureStageState, NULL, 0);
+
+    command->args[0] = Stage;
+    command->args[1] = Type;
+    command->args[2] = Value;
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::ValidateDevice(DWORD *pNumPasses)
+{
+    this->Sync();
+    return this->device->ValidateDevice(pNumPasses);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetInfo(DWORD DevInfoID, void *pDevInfoStruct, DWORD DevInfoStructSize)
+{
+    this->Sync();
+    return this->device->GetInfo(DevInfoID, pDevInfoStruct, DevInfoStructSize);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetPaletteEntries(UINT PaletteNumber, CONST PALETTEENTRY *pEntries)
+{
+    this->Sync();
+    return this->device->SetPaletteEntries(PaletteNumber, pEntries);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetPaletteEntries(UINT PaletteNumber, PALETTEENTRY *pEntries)
+{
+    this->Sync();
+    return this->device->GetPaletteEntries(PaletteNumber, pEntries);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetCurrentTexturePalette(UINT PaletteNumber)
+{
+    this->Sync();
+    return this->device->SetCurrentTexturePalette(PaletteNumber);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetCurrentTexturePalette(UINT *PaletteNumber)
+{
+    this->Sync();
+    return this->device->GetCurrentTexturePalette(PaletteNumber);
+}
+
+STDMETHODIMP PipelinedD3dDevice::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount)
+{
+    PipelinedD3dCommand *command = this->Record(PipelinedD3dCommand_DrawPrimitive, NULL, 0);
+
+    command->args[0] = PrimitiveType;
+    command->args[1] = StartVertex;
+    command->args[2] = PrimitiveCount;
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::DrawIndexedPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT minIndex, UINT NumVertices,
+                                                      UINT startIndex, UINT primCount)
+{
+    PipelinedD3dCommand *command = this->Record(PipelinedD3dCommand_DrawIndexedPrimitive, NULL, 0);
+
+    command->args[0] = PrimitiveType;
+    command->args[1] = minIndex;
+    command->args[2] = NumVertices;
+    command->args[3] = startIndex;
+    command->args[4] = primCount;
+    return D3D_OK;
+}
+
+// The vertices are copied now, which is what makes it safe for the game to go on moving its sprites while the frame
+// is being submitted.
+STDMETHODIMP PipelinedD3dDevice::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount,
+                                                 CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+    PipelinedD3dCommand *command =
+        this->Record(PipelinedD3dCommand_DrawPrimitiveUP, pVertexStreamZeroData,
+                     PipelinedD3dVertexCount(PrimitiveType, PrimitiveCount) * VertexStreamZeroStride);
+
+    command->args[0] = PrimitiveType;
+    command->args[1] = PrimitiveCount;
+    command->args[2] = VertexStreamZeroStride;
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::DrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex,
+                                                        UINT NumVertexIndices, UINT PrimitiveCount,
+                                                        CONST void *pIndexData, D3DFORMAT IndexDataFormat,
+                                                        CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+    PipelinedD3dCommand *command;
+    i32 indexCount;
+
+    // The indices are relative to the start of the vertex data, so everything up to the highest vertex is copied.
+    command = this->Record(PipelinedD3dCommand_DrawIndexedPrimitiveUP, pVertexStreamZeroData,
+                           (MinVertexIndex + NumVertexIndices) * VertexStreamZeroStride);
+    indexCount = PipelinedD3dVertexCount(PrimitiveType, PrimitiveCount);
+    command->args[0] = PrimitiveType;
+    command->args[1] = MinVertexIndex;
+    command->args[2] = NumVertexIndices;
+    command->args[3] = PrimitiveCount;
+    command->args[4] = IndexDataFormat;
+    command->args[5] = VertexStreamZeroStride;
+    command->args[6] =
+        this->RecordData(pIndexData, indexCount * (IndexDataFormat == D3DFMT_INDEX32 ? 4 : 2)) - command->dataOffset;
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::ProcessVertices(UINT SrcStartIndex, UINT DestIndex, UINT VertexCount,
+                                                 IDirect3DVertexBuffer8 *pDestBuffer, DWORD Flags)
+{
+    this->Sync();
+    return this->device->ProcessVertices(SrcStartIndex, DestIndex, VertexCount, pDestBuffer, Flags);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreateVertexShader(CONST DWORD *pDeclaration, CONST DWORD *pFunction, DWORD *pHandle,
+                                                    DWORD Usage)
+{
+    this->Sync();
+    return this->device->CreateVertexShader(pDeclaration, pFunction, pHandle, Usage);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetVertexShader(DWORD Handle)
+{
+    PipelinedD3dCommand *command = this->Record(PipelinedD3dCommand_VertexShader, NULL, 0);
+
+    command->args[0] = Handle;
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetVertexShader(DWORD *pHandle)
+{
+    this->Sync();
+    return this->device->GetVertexShader(pHandle);
+}
+
+STDMETHODIMP PipelinedD3dDevice::DeleteVertexShader(DWORD Handle)
+{
+    this->Sync();
+    return this->device->DeleteVertexShader(Handle);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetVertexShaderConstant(DWORD Register, CONST void *pConstantData, DWORD ConstantCount)
+{
+    this->Sync();
+    return this->device->SetVertexShaderConstant(Register, pConstantData, ConstantCount);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetVertexShaderConstant(DWORD Register, void *pConstantData, DWORD ConstantCount)
+{
+    this->Sync();
+    return this->device->GetVertexShaderConstant(Register, pConstantData, ConstantCount);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetVertexShaderDeclaration(DWORD Handle, void *pData, DWORD *pSizeOfData)
+{
+    this->Sync();
+    return this->device->GetVertexShaderDeclaration(Handle, pData, pSizeOfData);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetVertexShaderFunction(DWORD Handle, void *pData, DWORD *pSizeOfData)
+{
+    this->Sync();
+    return this->device->GetVertexShaderFunction(Handle, pData, pSizeOfData);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer8 *pStreamData, UINT Stride)
+{
+    PipelinedD3dCommand *command = this->Record(PipelinedD3dCommand_StreamSource, NULL, 0);
+
+    command->args[0] = StreamNumber;
+    command->args[1] = Stride;
+    this->Hold(command, pStreamData);
+    return D3D_OK;
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer8 **ppStreamData,
+                                                 UINT *pStride)
+{
+    this->Sync();
+    return this->device->GetStreamSource(StreamNumber, ppStreamData, pStride);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetIndices(IDirect3DIndexBuffer8 *pIndexData, UINT BaseVertexIndex)
+{
+    this->Sync();
+    return this->device->SetIndices(pIndexData, BaseVertexIndex);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetIndices(IDirect3DIndexBuffer8 **ppIndexData, UINT *pBaseVertexIndex)
+{
+    this->Sync();
+    return this->device->GetIndices(ppIndexData, pBaseVertexIndex);
+}
+
+STDMETHODIMP PipelinedD3dDevice::CreatePixelShader(CONST DWORD *pFunction, DWORD *pHandle)
+{
+    this->Sync();
+    return this->device->CreatePixelShader(pFunction, pHandle);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetPixelShader(DWORD Handle)
+{
+    this->Sync();
+    return this->device->SetPixelShader(Handle);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetPixelShader(DWORD *pHandle)
+{
+    this->Sync();
+    return this->device->GetPixelShader(pHandle);
+}
+
+STDMETHODIMP PipelinedD3dDevice::DeletePixelShader(DWORD Handle)
+{
+    this->Sync();
+    return this->device->DeletePixelShader(Handle);
+}
+
+STDMETHODIMP PipelinedD3dDevice::SetPixelShaderConstant(DWORD Register, CONST void *pConstantData, DWORD ConstantCount)
+{
+    this->Sync();
+    return this->device->SetPixelShaderConstant(Register, pConstantData, ConstantCount);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetPixelShaderConstant(DWORD Register, void *pConstantData, DWORD ConstantCount)
+{
+    this->Sync();
+    return this->device->GetPixelShaderConstant(Register, pConstantData, ConstantCount);
+}
+
+STDMETHODIMP PipelinedD3dDevice::GetPixelShaderFunction(DWORD Handle, void *pData, DWORD *pSizeOfData)
+{
+    this->Sync();
+    return this->device->GetPixelShaderFunction(Handle, pData, pSizeOfData);
+}
+
+STDMETHODIMP PipelinedD3dDevice::DrawRectPatch(UINT Handle, CONST float *pNumSegs,
+                                               CONST D3DRECTPATCH_INFO *pRectPatchInfo)
+{
+    this->Sync();
+    return this->device->DrawRectPatch(Handle, pNumSegs, pRectPatchInfo);
+}
+
+STDMETHODIMP PipelinedD3dDevice::DrawTriPatch(UINT Handle, CONST float *pNumSegs, CONST D3DTRIPATCH_INFO *pTriPatchInfo)
+{
+    this->Sync();
+    return this->device->DrawTriPatch(Handle, pNumSegs, pTriPatchInfo);
+}
+
+STDMETHODIMP PipelinedD3dDevice::DeletePatch(UINT Handle)
+{
+    this->Sync();
+    return this->device->DeletePatch(Handle);
+}
+}; // namespace th06
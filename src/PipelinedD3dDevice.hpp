@@ -0,0 +1,237 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d8.h>
+
+#include "ZunBool.hpp"
+#include "inttypes.hpp"
+
+namespace th06
+{
+enum PipelinedD3dCommandType
+{
+    PipelinedD3dCommand_BeginScene,
+    PipelinedD3dCommand_EndScene,
+    // args: rect count, flags, color, z, stencil; data: the rects.
+    PipelinedD3dCommand_Clear,
+    // args: transform state; data: the matrix.
+    PipelinedD3dCommand_Transform,
+    // data: the viewport.
+    PipelinedD3dCommand_Viewport,
+    // data: the material.
+    PipelinedD3dCommand_Material,
+    // args: state, value.
+    PipelinedD3dCommand_RenderState,
+    // args: stage, type, value.
+    PipelinedD3dCommand_TextureStageState,
+    // args: stage; object: the texture.
+    PipelinedD3dCommand_Texture,
+    // args: handle.
+    PipelinedD3dCommand_VertexShader,
+    // args: stream, stride; object: the vertex buffer.
+    PipelinedD3dCommand_StreamSource,
+    // args: primitive type, start vertex, primitive count.
+    PipelinedD3dCommand_DrawPrimitive,
+    // args: primitive type, min index, vertex count, start index, primitive count.
+    PipelinedD3dCommand_DrawIndexedPrimitive,
+    // args: primitive type, primitive count, stride; data: the vertices.
+    PipelinedD3dCommand_DrawPrimitiveUP,
+    // args: primitive type, min index, vertex count, primitive count, index format, stride, index data offset;
+    // data: the vertices from index 0 up.
+    PipelinedD3dCommand_DrawIndexedPrimitiveUP,
+};
+
+struct PipelinedD3dCommand
+{
+    u32 type;
+    DWORD args[7];
+    // Offset of the command's payload in its frame's data.
+    i32 dataOffset;
+    IUnknown *object;
+};
+
+// One frame's worth of recorded calls. Everything a command points at is copied into data or held by a reference,
+// so the game can change or free its own copy as soon as the call returns.
+struct PipelinedD3dFrame
+{
+    PipelinedD3dCommand *commands;
+    i32 commandCount;
+    i32 commandCapacity;
+    u8 *data;
+    i32 dataSize;
+    i32 dataCapacity;
+    IUnknown **objects;
+    i32 objectCount;
+    i32 objectCapacity;
+};
+
+struct PipelinedD3dFrameStats
+{
+    i32 commands;
+    i32 dataBytes;
+    // Calls that had to wait for the render thread to catch up before going to the device.
+    i32 syncs;
+};
+
+// Wraps a device so the draw chain records into a command buffer instead of calling Direct3D. EndScene hands the
+// recorded frame to a render thread and returns at once, so the calc chain of the next frame runs while this one is
+// being submitted. Any call the wrapper doesn't record, from resource creation and locks to Present and the Get*
+// calls, first waits for the render thread to go idle and then runs on the calling thread, so the device is never
+// used from two threads at once and sees the calls in the order the game made them.
+//
+// Recorded calls always return D3D_OK; their real result is dropped.
+struct PipelinedD3dDevice : public IDirect3DDevice8
+{
+    // Takes over the caller's reference to device.
+    PipelinedD3dDevice(IDirect3DDevice8 *device);
+    virtual ~PipelinedD3dDevice();
+
+    void Submit();
+    void Sync();
+
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObj);
+    STDMETHOD_(ULONG, AddRef)();
+    STDMETHOD_(ULONG, Release)();
+
+    STDMETHOD(TestCooperativeLevel)();
+    STDMETHOD_(UINT, GetAvailableTextureMem)();
+    STDMETHOD(ResourceManagerDiscardBytes)(DWORD Bytes);
+    STDMETHOD(GetDirect3D)(IDirect3D8 **ppD3D8);
+    STDMETHOD(GetDeviceCaps)(D3DCAPS8 *pCaps);
+    STDMETHOD(GetDisplayMode)(D3DDISPLAYMODE *pMode);
+    STDMETHOD(GetCreationParameters)(D3DDEVICE_CREATION_PARAMETERS *pParameters);
+    STDMETHOD(SetCursorProperties)(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface8 *pCursorBitmap);
+    STDMETHOD_(void, SetCursorPosition)(UINT XScreenSpace, UINT YScreenSpace, DWORD Flags);
+    STDMETHOD_(BOOL, ShowCursor)(BOOL bShow);
+    STDMETHOD(CreateAdditionalSwapChain)(D3DPRESENT_PARAMETERS *pPresentationParameters,
+                                         IDirect3DSwapChain8 **pSwapChain);
+    STDMETHOD(Reset)(D3DPRESENT_PARAMETERS *pPresentationParameters);
+    STDMETHOD(Present)(CONST RECT *pSourceRect, CONST RECT *pDestRect, HWND hDestWindowOverride,
+                       CONST RGNDATA *pDirtyRegion);
+    STDMETHOD(GetBackBuffer)(UINT BackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface8 **ppBackBuffer);
+    STDMETHOD(GetRasterStatus)(D3DRASTER_STATUS *pRasterStatus);
+    STDMETHOD_(void, SetGammaRamp)(DWORD Flags, CONST D3DGAMMARAMP *pRamp);
+    STDMETHOD_(void, GetGammaRamp)(D3DGAMMARAMP *pRamp);
+    STDMETHOD(CreateTexture)(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool,
+                             IDirect3DTexture8 **ppTexture);
+    STDMETHOD(CreateVolumeTexture)(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format,
+                                   D3DPOOL Pool, IDirect3DVolumeTexture8 **ppVolumeTexture);
+    STDMETHOD(CreateCubeTexture)(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool,
+                                 IDirect3DCubeTexture8 **ppCubeTexture);
+    STDMETHOD(CreateVertexBuffer)(UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool,
+                                  IDirect3DVertexBuffer8 **ppVertexBuffer);
+    STDMETHOD(CreateIndexBuffer)(UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool,
+                                 IDirect3DIndexBuffer8 **ppIndexBuffer);
+    STDMETHOD(CreateRenderTarget)(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample,
+                                  BOOL Lockable, IDirect3DSurface8 **ppSurface);
+    STDMETHOD(CreateDepthStencilSurface)(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample,
+                                         IDirect3DSurface8 **ppSurface);
+    STDMETHOD(CreateImageSurface)(UINT Width, UINT Height, D3DFORMAT Format, IDirect3DSurface8 **ppSurface);
+    STDMETHOD(CopyRects)(IDirect3DSurface8 *pSourceSurface, CONST RECT *pSourceRectsArray, UINT cRects,
+                         IDirect3DSurface8 *pDestinationSurface, CONST POINT *pDestPointsArray);
+    STDMETHOD(UpdateTexture)(IDirect3DBaseTexture8 *pSourceTexture, IDirect3DBaseTexture8 *pDestinationTexture);
+    STDMETHOD(GetFrontBuffer)(IDirect3DSurface8 *pDestSurface);
+    STDMETHOD(SetRenderTarget)(IDirect3DSurface8 *pRenderTarget, IDirect3DSurface8 *pNewZStencil);
+    STDMETHOD(GetRenderTarget)(IDirect3DSurface8 **ppRenderTarget);
+    STDMETHOD(GetDepthStencilSurface)(IDirect3DSurface8 **ppZStencilSurface);
+    STDMETHOD(BeginScene)();
+    STDMETHOD(EndScene)();
+    STDMETHOD(Clear)(DWORD Count, CONST D3DRECT *pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil);
+    STDMETHOD(SetTransform)(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix);
+    STDMETHOD(GetTransform)(D3DTRANSFORMSTATETYPE State, D3DMATRIX *pMatrix);
+    STDMETHOD(MultiplyTransform)(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix);
+    STDMETHOD(SetViewport)(CONST D3DVIEWPORT8 *pViewport);
+    STDMETHOD(GetViewport)(D3DVIEWPORT8 *pViewport);
+    STDMETHOD(SetMaterial)(CONST D3DMATERIAL8 *pMaterial);
+    STDMETHOD(GetMaterial)(D3DMATERIAL8 *pMaterial);
+    STDMETHOD(SetLight)(DWORD Index, CONST D3DLIGHT8 *pLight);
+    STDMETHOD(GetLight)(DWORD Index, D3DLIGHT8 *pLight);
+    STDMETHOD(LightEnable)(DWORD Index, BOOL Enable);
+    STDMETHOD(GetLightEnable)(DWORD Index, BOOL *pEnable);
+    STDMETHOD(SetClipPlane)(DWORD Index, CONST float *pPlane);
+    STDMETHOD(GetClipPlane)(DWORD Index, float *pPlane);
+    STDMETHOD(SetRenderState)(D3DRENDERSTATETYPE State, DWORD Value);
+    STDMETHOD(GetRenderState)(D3DRENDERSTATETYPE State, DWORD *pValue);
+    STDMETHOD(BeginStateBlock)();
+    STDMETHOD(EndStateBlock)(DWORD *pToken);
+    STDMETHOD(ApplyStateBlock)(DWORD Token);
+    STDMETHOD(CaptureStateBlock)(DWORD Token);
+    STDMETHOD(DeleteStateBlock)(DWORD Token);
+    STDMETHOD(CreateStateBlock)(D3DSTATEBLOCKTYPE Type, DWORD *pToken);
+    STDMETHOD(SetClipStatus)(CONST D3DCLIPSTATUS8 *pClipStatus);
+    STDMETHOD(GetClipStatus)(D3DCLIPSTATUS8 *pClipStatus);
+    STDMETHOD(GetTexture)(DWORD Stage, IDirect3DBaseTexture8 **ppTexture);
+    STDMETHOD(SetTexture)(DWORD Stage, IDirect3DBaseTexture8 *pTexture);
+    STDMETHOD(GetTextureStageState)(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD *pValue);
+    STDMETHOD(SetTextureStageState)(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value);
+    STDMETHOD(ValidateDevice)(DWORD *pNumPasses);
+    STDMETHOD(GetInfo)(DWORD DevInfoID, void *pDevInfoStruct, DWORD DevInfoStructSize);
+    STDMETHOD(SetPaletteEntries)(UINT PaletteNumber, CONST PALETTEENTRY *pEntries);
+    STDMETHOD(GetPaletteEntries)(UINT PaletteNumber, PALETTEENTRY *pEntries);
+    STDMETHOD(SetCurrentTexturePalette)(UINT PaletteNumber);
+    STDMETHOD(GetCurrentTexturePalette)(UINT *PaletteNumber);
+    STDMETHOD(DrawPrimitive)(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount);
+    STDMETHOD(DrawIndexedPrimitive)(D3DPRIMITIVETYPE PrimitiveType, UINT minIndex, UINT NumVertices,
+                                    UINT startIndex, UINT primCount);
+    STDMETHOD(DrawPrimitiveUP)(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void *pVertexStreamZeroData,
+                               UINT VertexStreamZeroStride);
+    STDMETHOD(DrawIndexedPrimitiveUP)(D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex, UINT NumVertexIndices,
+                                      UINT PrimitiveCount, CONST void *pIndexData, D3DFORMAT IndexDataFormat,
+                                      CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride);
+    STDMETHOD(ProcessVertices)(UINT SrcStartIndex, UINT DestIndex, UINT VertexCount,
+                               IDirect3DVertexBuffer8 *pDestBuffer, DWORD Flags);
+    STDMETHOD(CreateVertexShader)(CONST DWORD *pDeclaration, CONST DWORD *pFunction, DWORD *pHandle, DWORD Usage);
+    STDMETHOD(SetVertexShader)(DWORD Handle);
+    STDMETHOD(GetVertexShader)(DWORD *pHandle);
+    STDMETHOD(DeleteVertexShader)(DWORD Handle);
+    STDMETHOD(SetVertexShaderConstant)(DWORD Register, CONST void *pConstantData, DWORD ConstantCount);
+    STDMETHOD(GetVertexShaderConstant)(DWORD Register, void *pConstantData, DWORD ConstantCount);
+    STDMETHOD(GetVertexShaderDeclaration)(DWORD Handle, void *pData, DWORD *pSizeOfData);
+    STDMETHOD(GetVertexShaderFunction)(DWORD Handle, void *pData, DWORD *pSizeOfData);
+    STDMETHOD(SetStreamSource)(UINT StreamNumber, IDirect3DVertexBuffer8 *pStreamData, UINT Stride);
+    STDMETHOD(GetStreamSource)(UINT StreamNumber, IDirect3DVertexBuffer8 **ppStreamData, UINT *pStride);
+    STDMETHOD(SetIndices)(IDirect3DIndexBuffer8 *pIndexData, UINT BaseVertexIndex);
+    STDMETHOD(GetIndices)(IDirect3DIndexBuffer8 **ppIndexData, UINT *pBaseVertexIndex);
+    STDMETHOD(CreatePixelShader)(CONST DWORD *pFunction, DWORD *pHandle);
+    STDMETHOD(SetPixelShader)(DWORD Handle);
+    STDMETHOD(GetPixelShader)(DWORD *pHandle);
+    STDMETHOD(DeletePixelShader)(DWORD Handle);
+    STDMETHOD(SetPixelShaderConstant)(DWORD Register, CONST void *pConstantData, DWORD ConstantCount);
+    STDMETHOD(GetPixelShaderConstant)(DWORD Register, void *pConstantData, DWORD ConstantCount);
+    STDMETHOD(GetPixelShaderFunction)(DWORD Handle, void *pData, DWORD *pSizeOfData);
+    STDMETHOD(DrawRectPatch)(UINT Handle, CONST float *pNumSegs, CONST D3DRECTPATCH_INFO *pRectPatchInfo);
+    STDMETHOD(DrawTriPatch)(UINT Handle, CONST float *pNumSegs, CONST D3DTRIPATCH_INFO *pTriPatchInfo);
+    STDMETHOD(DeletePatch)(UINT Handle);
+
+    static DWORD __stdcall RenderThread(LPVOID lpThreadParameter);
+
+    PipelinedD3dCommand *Record(u32 type, CONST void *data, i32 dataSize);
+    i32 RecordData(CONST void *data, i32 size);
+    void Hold(PipelinedD3dCommand *command, IUnknown *object);
+    void Replay(PipelinedD3dFrame *frame);
+    void Recycle(PipelinedD3dFrame *frame);
+
+    IDirect3DDevice8 *device;
+    ULONG refCount;
+
+    // The frame the game is recording into, and the one the render thread is submitting, if any.
+    PipelinedD3dFrame frames[2];
+    PipelinedD3dFrame *recording;
+    PipelinedD3dFrame *submitting;
+
+    HANDLE thread;
+    HANDLE startEvent;
+    // Manual reset; set whenever the render thread has nothing to submit.
+    HANDLE idleEvent;
+    ZunBool quitting;
+    u32 fpuControl;
+
+    PipelinedD3dFrameStats thisFrame;
+    PipelinedD3dFrameStats lastFrame;
+};
+
+// The device the game draws through with PIPELINED_DRAW, NULL otherwise. Anything that writes into a texture without
+// going through the device, like text rendering's locks, has to Sync it first: the render thread may still be drawing
+// the last frame with the old contents.
+extern PipelinedD3dDevice *g_PipelinedD3dDevice;
+}; // namespace th06
@@ -0,0 +1,304 @@
+#include "PixelKernels.hpp"
+#include "utils.hpp"
+
+#include <emmintrin.h>
+
+namespace th06
+{
+namespace PixelKernels
+{
+static i32 g_PixelKernelLevel = -1;
+
+// Past this the SSE2 invert can no longer do its divisions exactly in single precision.
+#define PIXEL_KERNEL_MAX_SSE2_AREA 0x80000
+
+void SetLevel(i32 level)
+{
+    if (level >= PixelKernelLevel_Sse2 && (utils::GetCpuFeatures() & CPU_FEATURE_SSE2))
+    {
+        g_PixelKernelLevel = PixelKernelLevel_Sse2;
+    }
+    else
+    {
+        g_PixelKernelLevel = PixelKernelLevel_Scalar;
+    }
+}
+
+i32 GetLevel()
+{
+    if (g_PixelKernelLevel < 0)
+    {
+        SetLevel(PixelKernelLevel_Sse2);
+    }
+    return g_PixelKernelLevel;
+}
+
+// Keeps the pixel bits in keep and ors in the masked source shifted up into the alpha channel.
+static void MergeAlphaRow32(u32 *dst, u32 *src, i32 width, u32 keep, u32 srcMask, i32 shift)
+{
+    __m128i keepMask;
+    __m128i srcMaskVec;
+    __m128i shiftCount;
+    i32 x;
+
+    x = 0;
+    if (GetLevel() == PixelKernelLevel_Sse2)
+    {
+        keepMask = _mm_set1_epi32(keep);
+        srcMaskVec = _mm_set1_epi32(srcMask);
+        shiftCount = _mm_cvtsi32_si128(shift);
+        for (; x + 4 <= width; x += 4)
+        {
+            _mm_storeu_si128((__m128i *)&dst[x],
+                             _mm_or_si128(_mm_and_si128(_mm_loadu_si128((__m128i *)&dst[x]), keepMask),
+                                          _mm_sll_epi32(_mm_and_si128(_mm_loadu_si128((__m128i *)&src[x]), srcMaskVec),
+                                                        shiftCount)));
+        }
+    }
+    for (; x < width; x++)
+    {
+        dst[x] = (dst[x] & keep) | (src[x] & srcMask) << shift;
+    }
+}
+
+static void MergeAlphaRow16(u16 *dst, u16 *src, i32 width, u16 keep, u16 srcMask, i32 shift)
+{
+    __m128i keepMask;
+    __m128i srcMaskVec;
+    __m128i shiftCount;
+    i32 x;
+
+    x = 0;
+    if (GetLevel() == PixelKernelLevel_Sse2)
+    {
+        keepMask = _mm_set1_epi16(keep);
+        srcMaskVec = _mm_set1_epi16(srcMask);
+        shiftCount = _mm_cvtsi32_si128(shift);
+        for (; x + 8 <= width; x += 8)
+        {
+            _mm_storeu_si128((__m128i *)&dst[x],
+                             _mm_or_si128(_mm_and_si128(_mm_loadu_si128((__m128i *)&dst[x]), keepMask),
+                                          _mm_sll_epi16(_mm_and_si128(_mm_loadu_si128((__m128i *)&src[x]), srcMaskVec),
+                                                        shiftCount)));
+        }
+    }
+    for (; x < width; x++)
+    {
+        dst[x] = (dst[x] & keep) | (src[x] & srcMask) << shift;
+    }
+}
+
+bool MergeAlpha(D3DFORMAT format, u8 *dst, i32 dstPitch, u8 *src, i32 srcPitch, i32 width, i32 height)
+{
+    i32 y;
+
+    for (y = 0; y < height; y++, dst += dstPitch, src += srcPitch)
+    {
+        switch (format)
+        {
+        case D3DFMT_A8R8G8B8:
+            MergeAlphaRow32((u32 *)dst, (u32 *)src, width, 0x00ffffff, 0xff, 24);
+            break;
+        case D3DFMT_A1R5G5B5:
+            // The top bit of the five bit blue channel.
+            MergeAlphaRow16((u16 *)dst, (u16 *)src, width, 0x7fff, 0x10, 11);
+            break;
+        case D3DFMT_A4R4G4B4:
+            MergeAlphaRow16((u16 *)dst, (u16 *)src, width, 0x0fff, 0xf, 12);
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+// Pixel first + n sits at byte idx 2 * (first + n) of the region. The pixels that were opaque, the untouched background
+// of a text buffer, only depend on idx, so their gradient is stepped along instead of divided out.
+static void InvertAlpha1555Scalar(u16 *pixels, i32 first, i32 count, i32 doubleArea)
+{
+    i32 idx;
+    i32 end;
+    i32 step;
+    i32 remainder;
+    u32 red;
+    u32 green;
+    u32 blue;
+
+    idx = first * 2;
+    end = (first + count) * 2;
+    // step is idx * 31 / doubleArea.
+    step = idx * 31 / doubleArea;
+    remainder = idx * 31 % doubleArea;
+    for (; idx < end; idx += 2, pixels++)
+    {
+        if (*pixels >> 15)
+        {
+            *pixels = 0x7c00 - (step >> 1 << 10) | 0x3e0 - (step >> 1 << 5) | 0x1f - (step >> 2);
+        }
+        else
+        {
+            red = *pixels >> 10 & 0x1f;
+            green = *pixels >> 5 & 0x1f;
+            blue = *pixels & 0x1f;
+            red -= red * idx / doubleArea / 2;
+            green -= green * idx / doubleArea / 2;
+            blue -= blue * idx / doubleArea / 4;
+            *pixels = 0x8000 | red << 10 | green << 5 | blue;
+        }
+        for (remainder += 62; remainder >= doubleArea; remainder -= doubleArea)
+        {
+            step++;
+        }
+    }
+}
+
+// floor(channel * idx / doubleArea). Every product and quotient is an integer below 2^24, so they are exact as
+// floats, and the one ulp the reciprocal can be off by is corrected by comparing back against the dividend.
+static __m128i ScaleDownSse2(__m128i channel, __m128 idx, __m128 area, __m128 reciprocal)
+{
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 dividend;
+    __m128 quotient;
+
+    dividend = _mm_mul_ps(_mm_cvtepi32_ps(channel), idx);
+    quotient = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(dividend, reciprocal)));
+    quotient =
+        _mm_add_ps(quotient, _mm_and_ps(_mm_cmple_ps(_mm_mul_ps(_mm_add_ps(quotient, one), area), dividend), one));
+    quotient = _mm_sub_ps(quotient, _mm_and_ps(_mm_cmpgt_ps(_mm_mul_ps(quotient, area), dividend), one));
+    return _mm_cvttps_epi32(quotient);
+}
+
+// Four pixels widened to 32 bits. A pixel that was opaque works out the same as a transparent one with every channel
+// at 31, which is what the scalar code writes for it.
+static __m128i InvertAlpha1555Sse2Lanes(__m128i pixels, __m128 idx, __m128 area, __m128 reciprocal)
+{
+    __m128i alphaBit = _mm_set1_epi32(0x8000);
+    __m128i channelMask = _mm_set1_epi32(0x1f);
+    __m128i transparent;
+    __m128i red;
+    __m128i green;
+    __m128i blue;
+
+    transparent = _mm_cmpeq_epi32(_mm_and_si128(pixels, alphaBit), _mm_setzero_si128());
+    red = _mm_or_si128(_mm_and_si128(transparent, _mm_and_si128(_mm_srli_epi32(pixels, 10), channelMask)),
+                       _mm_andnot_si128(transparent, channelMask));
+    green = _mm_or_si128(_mm_and_si128(transparent, _mm_and_si128(_mm_srli_epi32(pixels, 5), channelMask)),
+                         _mm_andnot_si128(transparent, channelMask));
+    blue = _mm_or_si128(_mm_and_si128(transparent, _mm_and_si128(pixels, channelMask)),
+                        _mm_andnot_si128(transparent, channelMask));
+    red = _mm_sub_epi32(red, _mm_srli_epi32(ScaleDownSse2(red, idx, area, reciprocal), 1));
+    green = _mm_sub_epi32(green, _mm_srli_epi32(ScaleDownSse2(green, idx, area, reciprocal), 1));
+    blue = _mm_sub_epi32(blue, _mm_srli_epi32(ScaleDownSse2(blue, idx, area, reciprocal), 2));
+    return _mm_or_si128(_mm_or_si128(_mm_and_si128(transparent, alphaBit), _mm_slli_epi32(red, 10)),
+                        _mm_or_si128(_mm_slli_epi32(green, 5), blue));
+}
+
+// Narrows two vectors of 32 bit lanes holding 16 bit values to one vector, without the signed saturation of
+// _mm_packs_epi32 getting in the way of values with the top bit set.
+static __m128i PackLow16Sse2(__m128i lo, __m128i hi)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 16), _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16));
+}
+
+static void InvertAlpha1555(u16 *pixels, i32 doubleArea)
+{
+    __m128i src;
+    __m128 area;
+    __m128 reciprocal;
+    __m128 idx;
+    __m128 idxStep;
+    __m128 idxHalf;
+    i32 count;
+    i32 i;
+
+    count = (doubleArea + 1) / 2;
+    i = 0;
+    if (GetLevel() == PixelKernelLevel_Sse2 && doubleArea < PIXEL_KERNEL_MAX_SSE2_AREA)
+    {
+        area = _mm_set1_ps((f32)doubleArea);
+        reciprocal = _mm_set1_ps(1.0f / doubleArea);
+        idx = _mm_set_ps(6.0f, 4.0f, 2.0f, 0.0f);
+        idxHalf = _mm_set1_ps(8.0f);
+        idxStep = _mm_set1_ps(16.0f);
+        for (; i + 8 <= count; i += 8, idx = _mm_add_ps(idx, idxStep))
+        {
+            src = _mm_loadu_si128((__m128i *)&pixels[i]);
+            _mm_storeu_si128(
+                (__m128i *)&pixels[i],
+                PackLow16Sse2(
+                    InvertAlpha1555Sse2Lanes(_mm_unpacklo_epi16(src, _mm_setzero_si128()), idx, area, reciprocal),
+                    InvertAlpha1555Sse2Lanes(_mm_unpackhi_epi16(src, _mm_setzero_si128()), _mm_add_ps(idx, idxHalf),
+                                             area, reciprocal)));
+        }
+    }
+    if (i < count)
+    {
+        InvertAlpha1555Scalar(&pixels[i], i, count - i, doubleArea);
+    }
+}
+
+static void XorRow32(u32 *pixels, i32 count, u32 mask)
+{
+    __m128i maskVec;
+    i32 x;
+
+    x = 0;
+    if (GetLevel() == PixelKernelLevel_Sse2)
+    {
+        maskVec = _mm_set1_epi32(mask);
+        for (; x + 4 <= count; x += 4)
+        {
+            _mm_storeu_si128((__m128i *)&pixels[x], _mm_xor_si128(_mm_loadu_si128((__m128i *)&pixels[x]), maskVec));
+        }
+    }
+    for (; x < count; x++)
+    {
+        pixels[x] ^= mask;
+    }
+}
+
+static void XorRow16(u16 *pixels, i32 count, u16 mask)
+{
+    __m128i maskVec;
+    i32 x;
+
+    x = 0;
+    if (GetLevel() == PixelKernelLevel_Sse2)
+    {
+        maskVec = _mm_set1_epi16(mask);
+        for (; x + 8 <= count; x += 8)
+        {
+            _mm_storeu_si128((__m128i *)&pixels[x], _mm_xor_si128(_mm_loadu_si128((__m128i *)&pixels[x]), maskVec));
+        }
+    }
+    for (; x < count; x++)
+    {
+        pixels[x] ^= mask;
+    }
+}
+
+bool InvertAlpha(D3DFORMAT format, u8 *pixels, i32 doubleArea)
+{
+    if (doubleArea <= 0)
+    {
+        return format == D3DFMT_A8R8G8B8 || format == D3DFMT_A1R5G5B5 || format == D3DFMT_A4R4G4B4;
+    }
+    switch (format)
+    {
+    case D3DFMT_A8R8G8B8:
+        XorRow32((u32 *)pixels, doubleArea / 4, 0xff000000);
+        break;
+    case D3DFMT_A1R5G5B5:
+        InvertAlpha1555((u16 *)pixels, doubleArea);
+        break;
+    case D3DFMT_A4R4G4B4:
+        XorRow16((u16 *)pixels, doubleArea / 2, 0xf000);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+}; // namespace PixelKernels
+}; // namespace th06
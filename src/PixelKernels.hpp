@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d8.h>
+
+#include "inttypes.hpp"
+
+// PIXEL_KERNELS sends AnmManager::LoadTextureAlphaChannel and TextHelper::InvertAlpha through these instead of their
+// own loops, so both stop matching the original binary.
+#if defined(PIXEL_KERNELS) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "PIXEL_KERNELS changes LoadTextureAlphaChannel and InvertAlpha"
+#endif
+
+namespace th06
+{
+enum PixelKernelLevel
+{
+    PixelKernelLevel_Scalar,
+    PixelKernelLevel_Sse2,
+};
+
+// The per-pixel loops of alpha texture loading and text rendering. Every kernel has a scalar version and an SSE2 one that
+// gives bit for bit the same output; which one runs is picked from utils::GetCpuFeatures on first use.
+namespace PixelKernels
+{
+// Asking for more than the CPU has gives the best it does have.
+void SetLevel(i32 level);
+i32 GetLevel();
+
+// Copies the blue channel of src, a second image in the same format, into the alpha channel of dst. A8R8G8B8,
+// A1R5G5B5 and A4R4G4B4 only, the formats AnmManager::LoadTextureAlphaChannel accepts.
+bool MergeAlpha(D3DFORMAT format, u8 *dst, i32 dstPitch, u8 *src, i32 srcPitch, i32 width, i32 height);
+
+// TextHelper::InvertAlpha over a region doubleArea bytes long for A1R5G5B5, and the same doubleArea for the other
+// formats even though it means fewer pixels there.
+bool InvertAlpha(D3DFORMAT format, u8 *pixels, i32 doubleArea);
+}; // namespace PixelKernels
+}; // namespace th06
@@ -20,9 +20,16 @@
 #include "i18n.hpp"
 #include "utils.hpp"
 
+#ifdef BATCHED_BULLET_COLLISION
+#include <xmmintrin.h>
+#endif
+
 namespace th06
 {
 DIFFABLE_STATIC(Player, g_Player);
+#ifdef PLAYER_BULLET_GRID
+DIFFABLE_STATIC(PlayerBulletGrid, g_PlayerBulletGrid)
+#endif
 
 DIFFABLE_STATIC_ARRAY_ASSIGN(CharacterData, 4, g_CharData) = {
     /* ReimuA  */ {4.0, 2.0, 4.0, 2.0, Player::FireBulletReimuA, Player::FireBulletReimuA},
@@ -339,7 +346,107 @@ ChainCallbackResult Player::OnUpdate(Player *p)
     return CHAIN_CALLBACK_RESULT_CONTINUE;
 }
 
+#ifdef PLAYER_BULLET_GRID
+void PlayerBulletGrid::Clear()
+{
+    memset(this->cells, 0, sizeof(this->cells));
+    memset(this->unbounded, 0, sizeof(this->unbounded));
+    this->isBuilt = true;
+}
+
+static i32 GridCellCoord(f32 pos, i32 cellCount)
+{
+    if (pos < 0.0f)
+    {
+        return 0;
+    }
+    if (pos >= cellCount * PLAYER_BULLET_GRID_CELL_SIZE)
+    {
+        return cellCount - 1;
+    }
+    return (i32)(pos / PLAYER_BULLET_GRID_CELL_SIZE);
+}
+
+#pragma var_order(bulletTopLeft, bulletBottomRight, grownSize, x, y, x1, y1, x2, y2, bit)
+void PlayerBulletGrid::Insert(i32 bulletIdx, PlayerBullet *bullet)
+{
+    ZunVec3 bulletTopLeft;
+    ZunVec3 bulletBottomRight;
+    D3DXVECTOR3 grownSize;
+    i32 x, y, x1, y1, x2, y2;
+    u32 bit;
+
+    // BULLET_TYPE_2 bullets grow up to 48x48 when they hit an enemy, and can keep hitting the enemies updated
+    // after that one, so they are registered at their largest size.
+    grownSize = bullet->size;
+    if (bullet->bulletType == BULLET_TYPE_2)
+    {
+        if (grownSize.x < 48.0f)
+        {
+            grownSize.x = 48.0f;
+        }
+        if (grownSize.y < 48.0f)
+        {
+            grownSize.y = 48.0f;
+        }
+    }
+    ZunVec3::SetVecCorners(&bulletTopLeft, &bulletBottomRight, &bullet->position, &grownSize);
+
+    bit = 1 << (bulletIdx & 31);
+    if (bulletTopLeft.x != bulletTopLeft.x || bulletTopLeft.y != bulletTopLeft.y ||
+        bulletBottomRight.x != bulletBottomRight.x || bulletBottomRight.y != bulletBottomRight.y)
+    {
+        this->unbounded[bulletIdx >> 5] |= bit;
+        return;
+    }
+
+    x1 = GridCellCoord(bulletTopLeft.x, PLAYER_BULLET_GRID_WIDTH);
+    x2 = GridCellCoord(bulletBottomRight.x, PLAYER_BULLET_GRID_WIDTH);
+    y1 = GridCellCoord(bulletTopLeft.y, PLAYER_BULLET_GRID_HEIGHT);
+    y2 = GridCellCoord(bulletBottomRight.y, PLAYER_BULLET_GRID_HEIGHT);
+    for (y = y1; y <= y2; y++)
+    {
+        for (x = x1; x <= x2; x++)
+        {
+            this->cells[y][x][bulletIdx >> 5] |= bit;
+        }
+    }
+}
+
+#pragma var_order(x, y, x1, y1, x2, y2, word)
+void PlayerBulletGrid::Query(ZunVec3 *topLeft, ZunVec3 *bottomRight, u32 *candidates)
+{
+    i32 x, y, x1, y1, x2, y2;
+    i32 word;
+
+    if (topLeft->x != topLeft->x || topLeft->y != topLeft->y || bottomRight->x != bottomRight->x ||
+        bottomRight->y != bottomRight->y)
+    {
+        memset(candidates, 0xff, sizeof(this->unbounded));
+        return;
+    }
+
+    memcpy(candidates, this->unbounded, sizeof(this->unbounded));
+    x1 = GridCellCoord(topLeft->x, PLAYER_BULLET_GRID_WIDTH);
+    x2 = GridCellCoord(bottomRight->x, PLAYER_BULLET_GRID_WIDTH);
+    y1 = GridCellCoord(topLeft->y, PLAYER_BULLET_GRID_HEIGHT);
+    y2 = GridCellCoord(bottomRight->y, PLAYER_BULLET_GRID_HEIGHT);
+    for (y = y1; y <= y2; y++)
+    {
+        for (x = x1; x <= x2; x++)
+        {
+            for (word = 0; word < PLAYER_BULLET_GRID_WORDS; word++)
+            {
+                candidates[word] |= this->cells[y][x][word];
+            }
+        }
+    }
+}
+
+#pragma var_order(bullet, idx, enemyBottomRight, bulletBottomRight, enemyTopLeft, damage, bulletTopLeft, candidates)
+#else
 #pragma var_order(bullet, idx, enemyBottomRight, bulletBottomRight, enemyTopLeft, damage, bulletTopLeft)
+#endif
 i32 Player::CalcDamageToEnemy(D3DXVECTOR3 *enemyPos, D3DXVECTOR3 *enemyHitboxSize, ZunBool *hitWithLazerDuringBomb)
 {
     ZunVec3 bulletTopLeft;
@@ -347,6 +454,9 @@ i32 Player::CalcDamageToEnemy(D3DXVECTOR3 *enemyPos, D3DXVECTOR3 *enemyHitboxSiz
     ZunVec3 enemyTopLeft;
     i32 idx;
     PlayerBullet *bullet;
+#ifdef PLAYER_BULLET_GRID
+    u32 candidates[PLAYER_BULLET_GRID_WORDS];
+#endif
 
     ZunVec3 bulletBottomRight;
     ZunVec3 enemyBottomRight;
@@ -354,6 +464,16 @@ i32 Player::CalcDamageToEnemy(D3DXVECTOR3 *enemyPos, D3DXVECTOR3 *enemyHitboxSiz
     damage = 0;
 
     ZunVec3::SetVecCorners(&enemyTopLeft, &enemyBottomRight, enemyPos, enemyHitboxSize);
+#ifdef PLAYER_BULLET_GRID
+    if (g_PlayerBulletGrid.isBuilt)
+    {
+        g_PlayerBulletGrid.Query(&enemyTopLeft, &enemyBottomRight, candidates);
+    }
+    else
+    {
+        memset(candidates, 0xff, sizeof(candidates));
+    }
+#endif
     bullet = &this->bullets[0];
     if (hitWithLazerDuringBomb)
     {
@@ -361,6 +481,12 @@ i32 Player::CalcDamageToEnemy(D3DXVECTOR3 *enemyPos, D3DXVECTOR3 *enemyHitboxSiz
     }
     for (idx = 0; idx < ARRAY_SIZE_SIGNED(this->bullets); idx++, bullet++)
     {
+#ifdef PLAYER_BULLET_GRID
+        if ((candidates[idx >> 5] & (1 << (idx & 31))) == 0)
+        {
+            continue;
+        }
+#endif
         if (bullet->bulletState == PLAYER_BULLET_STATE_UNUSED ||
             bullet->bulletState != PLAYER_BULLET_STATE_FIRED && bullet->bulletType != BULLET_TYPE_2)
         {
@@ -483,6 +609,9 @@ void Player::UpdatePlayerBullets(Player *player)
             player->laserTimer[idx].Decrement(1);
         }
     }
+#ifdef PLAYER_BULLET_GRID
+    g_PlayerBulletGrid.Clear();
+#endif
     bullet = &player->bullets[0];
     for (idx = 0; idx < ARRAY_SIZE_SIGNED(player->bullets); idx++, bullet++)
     {
@@ -585,6 +714,13 @@ void Player::UpdatePlayerBullets(Player *player)
             bullet->bulletState = PLAYER_BULLET_STATE_UNUSED;
         }
         bullet->unk_140.Tick();
+#ifdef PLAYER_BULLET_GRID
+
+        if (bullet->bulletState != PLAYER_BULLET_STATE_UNUSED)
+        {
+            g_PlayerBulletGrid.Insert(idx, bullet);
+        }
+#endif
     }
 }
 
@@ -1071,6 +1207,9 @@ void Player::SpawnBullets(Player *p, u32 timer)
             curBullet->sprite.pos.y = curBullet->position.y;
             curBullet->sprite.pos.z = 0.495;
             curBullet->bulletState = PLAYER_BULLET_STATE_FIRED;
+#ifdef PLAYER_BULLET_GRID
+            g_PlayerBulletGrid.Insert(curBulletIdx, curBullet);
+#endif
         }
         if (bulletResult == FBR_STOP_SPAWNING)
         {
@@ -1292,6 +1431,187 @@ i32 Player::CalcKillBoxCollision(D3DXVECTOR3 *bulletCenter, D3DXVECTOR3 *bulletS
     }
 }
 
+#ifdef BATCHED_BULLET_COLLISION
+// Classifies every packed bullet against the bomb projectiles and the player's hitbox, four at a time when
+// SSE is available. This only computes the geometry: CheckGraze and CalcKillBoxCollision give the same answers
+// for the same boxes, the side effects are left to ResolveBatchedGraze/ResolveBatchedKillBoxCollision. D3D
+// keeps the x87 unit in single precision, so the SSE path rounds exactly like the scalar one.
+void Player::CalcBulletCollisionBatch(PlayerCollisionBatch *batch)
+{
+    f32 bombLeft[16];
+    f32 bombTop[16];
+    f32 bombRight[16];
+    f32 bombBottom[16];
+    i32 bombCount;
+    PlayerRect *bombProjectile;
+    i32 i;
+    i32 j;
+    f32 halfX, halfY;
+    f32 left, top, right, bottom;
+    u32 bit;
+
+    bombCount = 0;
+    bombProjectile = this->bombProjectiles;
+    for (i = 0; i < ARRAY_SIZE_SIGNED(this->bombProjectiles); i++, bombProjectile++)
+    {
+        if (bombProjectile->sizeX == 0.0f)
+        {
+            continue;
+        }
+        bombLeft[bombCount] = bombProjectile->posX - bombProjectile->sizeX / 2.0f;
+        bombTop[bombCount] = bombProjectile->posY - bombProjectile->sizeY / 2.0f;
+        bombRight[bombCount] = bombProjectile->sizeX / 2.0f + bombProjectile->posX;
+        bombBottom[bombCount] = bombProjectile->sizeY / 2.0f + bombProjectile->posY;
+        bombCount++;
+    }
+
+    for (i = 0; i < (batch->count + 31) / 32; i++)
+    {
+        batch->bombGrazeMask[i] = 0;
+        batch->grazeMask[i] = 0;
+        batch->bombHitMask[i] = 0;
+        batch->hitMask[i] = 0;
+    }
+
+    if (utils::GetCpuFeatures() & CPU_FEATURE_SSE)
+    {
+        __m128 vHalf = _mm_set1_ps(0.5f);
+        __m128 vGraze = _mm_set1_ps(20.0f);
+        __m128 vHitboxLeft = _mm_set1_ps(this->hitboxTopLeft.x);
+        __m128 vHitboxTop = _mm_set1_ps(this->hitboxTopLeft.y);
+        __m128 vHitboxRight = _mm_set1_ps(this->hitboxBottomRight.x);
+        __m128 vHitboxBottom = _mm_set1_ps(this->hitboxBottomRight.y);
+
+        for (i = 0; i < batch->count; i += 4)
+        {
+            __m128 vHalfX = _mm_mul_ps(_mm_loadu_ps(&batch->sizeX[i]), vHalf);
+            __m128 vHalfY = _mm_mul_ps(_mm_loadu_ps(&batch->sizeY[i]), vHalf);
+            __m128 vCenterX = _mm_loadu_ps(&batch->centerX[i]);
+            __m128 vCenterY = _mm_loadu_ps(&batch->centerY[i]);
+            __m128 vLeft = _mm_sub_ps(vCenterX, vHalfX);
+            __m128 vTop = _mm_sub_ps(vCenterY, vHalfY);
+            __m128 vRight = _mm_add_ps(vCenterX, vHalfX);
+            __m128 vBottom = _mm_add_ps(vCenterY, vHalfY);
+            __m128 vGrazeLeft = _mm_sub_ps(vLeft, vGraze);
+            __m128 vGrazeTop = _mm_sub_ps(vTop, vGraze);
+            __m128 vGrazeRight = _mm_add_ps(vRight, vGraze);
+            __m128 vGrazeBottom = _mm_add_ps(vBottom, vGraze);
+            // Lanes are set when the boxes do NOT overlap, written the same way as the scalar tests so that a
+            // NaN coordinate counts as a hit in both.
+            __m128 vMissBombGraze = _mm_cmpeq_ps(vHalf, vHalf);
+            __m128 vMissBombHit = vMissBombGraze;
+            __m128 vMissGraze;
+            __m128 vMissHit;
+            u32 validBits;
+
+            for (j = 0; j < bombCount; j++)
+            {
+                __m128 vBombLeft = _mm_set1_ps(bombLeft[j]);
+                __m128 vBombTop = _mm_set1_ps(bombTop[j]);
+                __m128 vBombRight = _mm_set1_ps(bombRight[j]);
+                __m128 vBombBottom = _mm_set1_ps(bombBottom[j]);
+
+                vMissBombGraze = _mm_and_ps(
+                    vMissBombGraze,
+                    _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(vBombLeft, vGrazeRight), _mm_cmplt_ps(vBombRight, vGrazeLeft)),
+                              _mm_or_ps(_mm_cmpgt_ps(vBombTop, vGrazeBottom), _mm_cmplt_ps(vBombBottom, vGrazeTop))));
+                vMissBombHit = _mm_and_ps(
+                    vMissBombHit, _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(vBombLeft, vRight), _mm_cmplt_ps(vBombRight, vLeft)),
+                                            _mm_or_ps(_mm_cmpgt_ps(vBombTop, vBottom), _mm_cmplt_ps(vBombBottom, vTop))));
+            }
+            vMissGraze =
+                _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(vHitboxLeft, vGrazeRight), _mm_cmplt_ps(vHitboxRight, vGrazeLeft)),
+                          _mm_or_ps(_mm_cmpgt_ps(vHitboxTop, vGrazeBottom), _mm_cmplt_ps(vHitboxBottom, vGrazeTop)));
+            vMissHit = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(vHitboxLeft, vRight), _mm_cmplt_ps(vHitboxRight, vLeft)),
+                                 _mm_or_ps(_mm_cmpgt_ps(vHitboxTop, vBottom), _mm_cmplt_ps(vHitboxBottom, vTop)));
+
+            validBits = batch->count - i >= 4 ? 0xf : ZUN_MASK(batch->count - i);
+            batch->bombGrazeMask[i >> 5] |= (~_mm_movemask_ps(vMissBombGraze) & validBits) << (i & 31);
+            batch->grazeMask[i >> 5] |= (~_mm_movemask_ps(vMissGraze) & validBits) << (i & 31);
+            batch->bombHitMask[i >> 5] |= (~_mm_movemask_ps(vMissBombHit) & validBits) << (i & 31);
+            batch->hitMask[i >> 5] |= (~_mm_movemask_ps(vMissHit) & validBits) << (i & 31);
+        }
+        return;
+    }
+
+    for (i = 0; i < batch->count; i++)
+    {
+        halfX = batch->sizeX[i] / 2.0f;
+        halfY = batch->sizeY[i] / 2.0f;
+        left = batch->centerX[i] - halfX;
+        top = batch->centerY[i] - halfY;
+        right = batch->centerX[i] + halfX;
+        bottom = batch->centerY[i] + halfY;
+        bit = 1 << (i & 31);
+
+        for (j = 0; j < bombCount; j++)
+        {
+            if (!(bombLeft[j] > right + 20.0f || bombRight[j] < left - 20.0f || bombTop[j] > bottom + 20.0f ||
+                  bombBottom[j] < top - 20.0f))
+            {
+                batch->bombGrazeMask[i >> 5] |= bit;
+            }
+            if (!(bombLeft[j] > right || bombRight[j] < left || bombTop[j] > bottom || bombBottom[j] < top))
+            {
+                batch->bombHitMask[i >> 5] |= bit;
+            }
+        }
+        if (!(this->hitboxTopLeft.x > right + 20.0f || this->hitboxBottomRight.x < left - 20.0f ||
+              this->hitboxTopLeft.y > bottom + 20.0f || this->hitboxBottomRight.y < top - 20.0f))
+        {
+            batch->grazeMask[i >> 5] |= bit;
+        }
+        if (!(this->hitboxTopLeft.x > right || this->hitboxBottomRight.x < left || this->hitboxTopLeft.y > bottom ||
+              this->hitboxBottomRight.y < top))
+        {
+            batch->hitMask[i >> 5] |= bit;
+        }
+    }
+}
+
+// Same result and side effects as CheckGraze for the box packed in `slot`.
+i32 Player::ResolveBatchedGraze(PlayerCollisionBatch *batch, i32 slot, D3DXVECTOR3 *center)
+{
+    if (PlayerCollisionBatch::IsSet(batch->bombGrazeMask, slot))
+    {
+        return 2;
+    }
+    if (this->playerState == PLAYER_STATE_DEAD || this->playerState == PLAYER_STATE_SPAWNING)
+    {
+        return 0;
+    }
+    if (!PlayerCollisionBatch::IsSet(batch->grazeMask, slot))
+    {
+        return 0;
+    }
+
+    this->ScoreGraze(center);
+    return 1;
+}
+
+// Same result and side effects as CalcKillBoxCollision for the box packed in `slot`.
+i32 Player::ResolveBatchedKillBoxCollision(PlayerCollisionBatch *batch, i32 slot)
+{
+    if (PlayerCollisionBatch::IsSet(batch->bombHitMask, slot))
+    {
+        return 2;
+    }
+    if (!PlayerCollisionBatch::IsSet(batch->hitMask, slot))
+    {
+        return 0;
+    }
+    else if (this->playerState != PLAYER_STATE_ALIVE)
+    {
+        return 1;
+    }
+    else
+    {
+        this->Die();
+        return 1;
+    }
+}
+#endif
+
 #pragma var_order(playerRelativeTopLeft, laserBottomRight, laserTopLeft, playerRelativeBottomRight)
 i32 Player::CalcLaserHitbox(D3DXVECTOR3 *laserCenter, D3DXVECTOR3 *laserSize, D3DXVECTOR3 *rotation, f32 angle,
                             i32 canGraze)
@@ -1349,6 +1669,101 @@ LASER_COLLISION:
     return 1;
 }
 
+#ifdef BATCHED_BULLET_COLLISION
+// Rotates the player's hitbox into the frame of every laser slot, like CalcLaserHitbox does for one laser.
+// Each step is a single float operation, so the SSE path gives the same results as the x87 one.
+void Player::CalcLaserPlayerBoxes(PlayerLaserBatch *batch)
+{
+    f32 relX, relY;
+    f32 rotatedX, rotatedY;
+    i32 i;
+
+    if (utils::GetCpuFeatures() & CPU_FEATURE_SSE)
+    {
+        __m128 vPlayerX = _mm_set1_ps(this->positionCenter.x);
+        __m128 vPlayerY = _mm_set1_ps(this->positionCenter.y);
+        __m128 vHitboxX = _mm_set1_ps(this->hitboxSize.x);
+        __m128 vHitboxY = _mm_set1_ps(this->hitboxSize.y);
+
+        for (i = 0; i < PLAYER_LASER_BATCH_MAX; i += 4)
+        {
+            __m128 vPosX = _mm_loadu_ps(&batch->posX[i]);
+            __m128 vPosY = _mm_loadu_ps(&batch->posY[i]);
+            __m128 vSine = _mm_loadu_ps(&batch->sine[i]);
+            __m128 vCosine = _mm_loadu_ps(&batch->cosine[i]);
+            __m128 vRelX = _mm_sub_ps(vPlayerX, vPosX);
+            __m128 vRelY = _mm_sub_ps(vPlayerY, vPosY);
+            __m128 vRotatedX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vCosine, vRelX), _mm_mul_ps(vSine, vRelY)), vPosX);
+            __m128 vRotatedY = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(vCosine, vRelY), _mm_mul_ps(vSine, vRelX)), vPosY);
+
+            _mm_storeu_ps(&batch->playerLeft[i], _mm_sub_ps(vRotatedX, vHitboxX));
+            _mm_storeu_ps(&batch->playerTop[i], _mm_sub_ps(vRotatedY, vHitboxY));
+            _mm_storeu_ps(&batch->playerRight[i], _mm_add_ps(vRotatedX, vHitboxX));
+            _mm_storeu_ps(&batch->playerBottom[i], _mm_add_ps(vRotatedY, vHitboxY));
+        }
+        return;
+    }
+
+    for (i = 0; i < PLAYER_LASER_BATCH_MAX; i++)
+    {
+        relX = this->positionCenter.x - batch->posX[i];
+        relY = this->positionCenter.y - batch->posY[i];
+        rotatedX = batch->cosine[i] * relX + batch->sine[i] * relY + batch->posX[i];
+        rotatedY = batch->cosine[i] * relY - batch->sine[i] * relX + batch->posY[i];
+        batch->playerLeft[i] = rotatedX - this->hitboxSize.x;
+        batch->playerTop[i] = rotatedY - this->hitboxSize.y;
+        batch->playerRight[i] = rotatedX + this->hitboxSize.x;
+        batch->playerBottom[i] = rotatedY + this->hitboxSize.y;
+    }
+}
+
+// Same result and side effects as CalcLaserHitbox, using the player box CalcLaserPlayerBoxes computed for
+// the laser in `slot`.
+i32 Player::CalcLaserHitboxBatched(PlayerLaserBatch *batch, i32 slot, D3DXVECTOR3 *laserCenter,
+                                   D3DXVECTOR3 *laserSize, i32 canGraze)
+{
+    D3DXVECTOR3 laserTopLeft;
+    D3DXVECTOR3 laserBottomRight;
+
+    laserTopLeft = *laserCenter - *laserSize / 2.0f;
+    laserBottomRight = *laserCenter + *laserSize / 2.0f;
+
+    if (!(batch->playerLeft[slot] > laserBottomRight.x || batch->playerRight[slot] < laserTopLeft.x ||
+          batch->playerTop[slot] > laserBottomRight.y || batch->playerBottom[slot] < laserTopLeft.y))
+    {
+        if (this->playerState != PLAYER_STATE_ALIVE)
+        {
+            return 0;
+        }
+
+        this->Die();
+        return 1;
+    }
+    if (canGraze == 0)
+    {
+        return 0;
+    }
+
+    laserTopLeft.x -= 48.0f;
+    laserTopLeft.y -= 48.0f;
+    laserBottomRight.x += 48.0f;
+    laserBottomRight.y += 48.0f;
+
+    if (batch->playerLeft[slot] > laserBottomRight.x || batch->playerRight[slot] < laserTopLeft.x ||
+        batch->playerTop[slot] > laserBottomRight.y || batch->playerBottom[slot] < laserTopLeft.y)
+    {
+        return 0;
+    }
+    if (this->playerState == PLAYER_STATE_DEAD || this->playerState == PLAYER_STATE_SPAWNING)
+    {
+        return 0;
+    }
+
+    this->ScoreGraze(&this->positionCenter);
+    return 2;
+}
+#endif
+
 #pragma var_order(itemBottomRight, itemTopLeft)
 i32 Player::CalcItemBoxCollision(D3DXVECTOR3 *itemCenter, D3DXVECTOR3 *itemSize)
 {
@@ -12,6 +12,12 @@
 #include "ZunResult.hpp"
 #include "inttypes.hpp"
 
+// PLAYER_BULLET_GRID buckets the live player bullets into a grid once per frame, so CalcDamageToEnemy only tests
+// the bullets near each enemy. Player::CalcDamageToEnemy no longer matches the original binary with it.
+#if defined(PLAYER_BULLET_GRID) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "PLAYER_BULLET_GRID rewrites Player::CalcDamageToEnemy"
+#endif
+
 namespace th06
 {
 struct Player;
@@ -166,6 +172,91 @@ struct CharacterPowerData
 };
 ZUN_ASSERT_SIZE(CharacterPowerData, 0xc);
 
+#ifdef BATCHED_BULLET_COLLISION
+#define PLAYER_COLLISION_BATCH_MAX 640
+
+// Packed bullet hitboxes for Player::CalcBulletCollisionBatch. Callers push every bullet that needs a
+// graze or kill box check this frame, classify them all at once, then resolve the side effects per slot in
+// their original order. Bit N of each mask refers to the slot returned by the Nth Push.
+struct PlayerCollisionBatch
+{
+    f32 centerX[PLAYER_COLLISION_BATCH_MAX];
+    f32 centerY[PLAYER_COLLISION_BATCH_MAX];
+    f32 sizeX[PLAYER_COLLISION_BATCH_MAX];
+    f32 sizeY[PLAYER_COLLISION_BATCH_MAX];
+    i32 count;
+
+    // A bomb projectile overlaps the bullet's graze box (CheckGraze returning 2).
+    u32 bombGrazeMask[PLAYER_COLLISION_BATCH_MAX / 32];
+    // The player's hitbox overlaps the bullet's graze box.
+    u32 grazeMask[PLAYER_COLLISION_BATCH_MAX / 32];
+    // A bomb projectile overlaps the bullet itself (CalcKillBoxCollision returning 2).
+    u32 bombHitMask[PLAYER_COLLISION_BATCH_MAX / 32];
+    // The player's hitbox overlaps the bullet itself.
+    u32 hitMask[PLAYER_COLLISION_BATCH_MAX / 32];
+
+    void Reset()
+    {
+        this->count = 0;
+    }
+
+    i32 Push(D3DXVECTOR3 *center, D3DXVECTOR3 *size)
+    {
+        this->centerX[this->count] = center->x;
+        this->centerY[this->count] = center->y;
+        this->sizeX[this->count] = size->x;
+        this->sizeY[this->count] = size->y;
+        return this->count++;
+    }
+
+    static ZunBool IsSet(u32 *mask, i32 slot)
+    {
+        return (mask[slot >> 5] >> (slot & 31)) & 1;
+    }
+};
+
+#define PLAYER_LASER_BATCH_MAX 64
+
+// Per-frame laser frames for Player::CalcLaserPlayerBoxes. The caller fills the position, sine and cosine of
+// each laser slot, the player's hitbox rotated into every one of those frames is then computed in one pass
+// and reused by every CalcLaserHitboxBatched call on that slot during the frame.
+struct PlayerLaserBatch
+{
+    f32 posX[PLAYER_LASER_BATCH_MAX];
+    f32 posY[PLAYER_LASER_BATCH_MAX];
+    f32 sine[PLAYER_LASER_BATCH_MAX];
+    f32 cosine[PLAYER_LASER_BATCH_MAX];
+
+    f32 playerLeft[PLAYER_LASER_BATCH_MAX];
+    f32 playerTop[PLAYER_LASER_BATCH_MAX];
+    f32 playerRight[PLAYER_LASER_BATCH_MAX];
+    f32 playerBottom[PLAYER_LASER_BATCH_MAX];
+};
+#endif
+
+#ifdef PLAYER_BULLET_GRID
+#define PLAYER_BULLET_GRID_CELL_SIZE 32.0f
+#define PLAYER_BULLET_GRID_WIDTH 12
+#define PLAYER_BULLET_GRID_HEIGHT 14
+#define PLAYER_BULLET_GRID_WORDS ((80 + 31) / 32)
+
+// Broadphase for CalcDamageToEnemy over the 384x448 play area, rebuilt every frame from the live player
+// bullets. Each cell holds a bitmask of the bullets whose hitbox touches it, boxes sticking out of the play
+// area are clamped to the edge cells. An enemy only runs the exact test against the bullets sharing one of
+// its cells, still in ascending index order.
+struct PlayerBulletGrid
+{
+    void Clear();
+    void Insert(i32 bulletIdx, PlayerBullet *bullet);
+    void Query(ZunVec3 *topLeft, ZunVec3 *bottomRight, u32 *candidates);
+
+    u32 cells[PLAYER_BULLET_GRID_HEIGHT][PLAYER_BULLET_GRID_WIDTH][PLAYER_BULLET_GRID_WORDS];
+    // Bullets with a NaN corner, which the exact test treats as touching everything.
+    u32 unbounded[PLAYER_BULLET_GRID_WORDS];
+    ZunBool isBuilt;
+};
+#endif
+
 struct Player
 {
     Player();
@@ -199,8 +290,18 @@ struct Player
     f32 AngleToPlayer(D3DXVECTOR3 *pos);
     i32 CheckGraze(D3DXVECTOR3 *center, D3DXVECTOR3 *size);
     i32 CalcKillBoxCollision(D3DXVECTOR3 *bulletCenter, D3DXVECTOR3 *bulletSize);
+#ifdef BATCHED_BULLET_COLLISION
+    void CalcBulletCollisionBatch(PlayerCollisionBatch *batch);
+    i32 ResolveBatchedGraze(PlayerCollisionBatch *batch, i32 slot, D3DXVECTOR3 *center);
+    i32 ResolveBatchedKillBoxCollision(PlayerCollisionBatch *batch, i32 slot);
+#endif
     i32 CalcLaserHitbox(D3DXVECTOR3 *laserCenter, D3DXVECTOR3 *laserSize, D3DXVECTOR3 *rotation, f32 angle,
                         i32 canGraze);
+#ifdef BATCHED_BULLET_COLLISION
+    void CalcLaserPlayerBoxes(PlayerLaserBatch *batch);
+    i32 CalcLaserHitboxBatched(PlayerLaserBatch *batch, i32 slot, D3DXVECTOR3 *laserCenter, D3DXVECTOR3 *laserSize,
+                               i32 canGraze);
+#endif
     i32 CalcDamageToEnemy(D3DXVECTOR3 *enemyPos, D3DXVECTOR3 *enemySize, i32 *unk);
     i32 CalcItemBoxCollision(D3DXVECTOR3 *center, D3DXVECTOR3 *size);
     void ScoreGraze(D3DXVECTOR3 *center);
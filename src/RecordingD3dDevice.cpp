@@ -0,0 +1,1259 @@
+#include "RecordingD3dDevice.hpp"
+#include "ZunMemory.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+namespace th06
+{
+RecordingD3dSurface::RecordingD3dSurface(RecordingD3dDevice *device, UINT width, UINT height, D3DFORMAT format,
+                                         IUnknown *container)
+{
+    this->device = device;
+    this->container = container;
+    this->refCount = 1;
+    this->format = format;
+    this->width = width;
+    this->height = height;
+    this->pitch = width * BytesPerPixel(format);
+    this->bits = (u8 *)ZunAlloc(this->pitch * height, "d3d recording");
+    memset(this->bits, 0, this->pitch * height);
+}
+
+RecordingD3dSurface::~RecordingD3dSurface()
+{
+    ZunFree(this->bits);
+}
+
+i32 RecordingD3dSurface::BytesPerPixel(D3DFORMAT format)
+{
+    switch (format)
+    {
+    case D3DFMT_R8G8B8:
+        return 3;
+    case D3DFMT_R5G6B5:
+    case D3DFMT_X1R5G5B5:
+    case D3DFMT_A1R5G5B5:
+    case D3DFMT_A4R4G4B4:
+    case D3DFMT_X4R4G4B4:
+        return 2;
+    case D3DFMT_A8:
+        return 1;
+    default:
+        return 4;
+    }
+}
+
+STDMETHODIMP RecordingD3dSurface::QueryInterface(REFIID riid, void **ppvObj)
+{
+    if (riid == IID_IUnknown || riid == IID_IDirect3DSurface8)
+    {
+        this->AddRef();
+        *ppvObj = this;
+        return S_OK;
+    }
+    *ppvObj = NULL;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) RecordingD3dSurface::AddRef()
+{
+    // Texture levels live and die with their texture.
+    if (this->container != NULL)
+    {
+        return this->container->AddRef();
+    }
+    return ++this->refCount;
+}
+
+STDMETHODIMP_(ULONG) RecordingD3dSurface::Release()
+{
+    ULONG refCount;
+
+    if (this->container != NULL)
+    {
+        return this->container->Release();
+    }
+    refCount = --this->refCount;
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
+
+STDMETHODIMP RecordingD3dSurface::GetDevice(IDirect3DDevice8 **ppDevice)
+{
+    this->device->AddRef();
+    *ppDevice = this->device;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dSurface::SetPrivateData(REFGUID refguid, CONST void *pData, DWORD SizeOfData, DWORD Flags)
+{
+    return E_NOTIMPL;
+}
+
+STDMETHODIMP RecordingD3dSurface::GetPrivateData(REFGUID refguid, void *pData, DWORD *pSizeOfData)
+{
+    return D3DERR_NOTFOUND;
+}
+
+STDMETHODIMP RecordingD3dSurface::FreePrivateData(REFGUID refguid)
+{
+    return D3DERR_NOTFOUND;
+}
+
+STDMETHODIMP RecordingD3dSurface::GetContainer(REFIID riid, void **ppContainer)
+{
+    if (this->container == NULL)
+    {
+        return E_NOINTERFACE;
+    }
+    this->container->AddRef();
+    *ppContainer = this->container;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dSurface::GetDesc(D3DSURFACE_DESC *pDesc)
+{
+    memset(pDesc, 0, sizeof(*pDesc));
+    pDesc->Format = this->format;
+    pDesc->Type = this->container != NULL ? D3DRTYPE_TEXTURE : D3DRTYPE_SURFACE;
+    pDesc->Pool = D3DPOOL_SYSTEMMEM;
+    pDesc->Size = this->pitch * this->height;
+    pDesc->Width = this->width;
+    pDesc->Height = this->height;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dSurface::LockRect(D3DLOCKED_RECT *pLockedRect, CONST RECT *pRect, DWORD Flags)
+{
+    pLockedRect->Pitch = this->pitch;
+    pLockedRect->pBits = this->bits;
+    if (pRect != NULL)
+    {
+        pLockedRect->pBits = this->bits + pRect->top * this->pitch + pRect->left * BytesPerPixel(this->format);
+    }
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dSurface::UnlockRect()
+{
+    return D3D_OK;
+}
+
+RecordingD3dTexture::RecordingD3dTexture(RecordingD3dDevice *device, UINT width, UINT height, D3DFORMAT format,
+                                         D3DPOOL pool)
+{
+    this->device = device;
+    this->refCount = 1;
+    this->pool = pool;
+    this->level = new RecordingD3dSurface(device, width, height, format, this);
+}
+
+RecordingD3dTexture::~RecordingD3dTexture()
+{
+    delete this->level;
+}
+
+STDMETHODIMP RecordingD3dTexture::QueryInterface(REFIID riid, void **ppvObj)
+{
+    if (riid == IID_IUnknown || riid == IID_IDirect3DResource8 || riid == IID_IDirect3DBaseTexture8 ||
+        riid == IID_IDirect3DTexture8)
+    {
+        this->AddRef();
+        *ppvObj = this;
+        return S_OK;
+    }
+    *ppvObj = NULL;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) RecordingD3dTexture::AddRef()
+{
+    return ++this->refCount;
+}
+
+STDMETHODIMP_(ULONG) RecordingD3dTexture::Release()
+{
+    ULONG refCount = --this->refCount;
+
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
+
+STDMETHODIMP RecordingD3dTexture::GetDevice(IDirect3DDevice8 **ppDevice)
+{
+    this->device->AddRef();
+    *ppDevice = this->device;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dTexture::SetPrivateData(REFGUID refguid, CONST void *pData, DWORD SizeOfData, DWORD Flags)
+{
+    return E_NOTIMPL;
+}
+
+STDMETHODIMP RecordingD3dTexture::GetPrivateData(REFGUID refguid, void *pData, DWORD *pSizeOfData)
+{
+    return D3DERR_NOTFOUND;
+}
+
+STDMETHODIMP RecordingD3dTexture::FreePrivateData(REFGUID refguid)
+{
+    return D3DERR_NOTFOUND;
+}
+
+STDMETHODIMP_(DWORD) RecordingD3dTexture::SetPriority(DWORD PriorityNew)
+{
+    return 0;
+}
+
+STDMETHODIMP_(DWORD) RecordingD3dTexture::GetPriority()
+{
+    return 0;
+}
+
+STDMETHODIMP_(void) RecordingD3dTexture::PreLoad()
+{
+}
+
+STDMETHODIMP_(D3DRESOURCETYPE) RecordingD3dTexture::GetType()
+{
+    return D3DRTYPE_TEXTURE;
+}
+
+STDMETHODIMP_(DWORD) RecordingD3dTexture::SetLOD(DWORD LODNew)
+{
+    return 0;
+}
+
+STDMETHODIMP_(DWORD) RecordingD3dTexture::GetLOD()
+{
+    return 0;
+}
+
+STDMETHODIMP_(DWORD) RecordingD3dTexture::GetLevelCount()
+{
+    return 1;
+}
+
+STDMETHODIMP RecordingD3dTexture::GetLevelDesc(UINT Level, D3DSURFACE_DESC *pDesc)
+{
+    if (Level != 0)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    this->level->GetDesc(pDesc);
+    pDesc->Pool = this->pool;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dTexture::GetSurfaceLevel(UINT Level, IDirect3DSurface8 **ppSurfaceLevel)
+{
+    if (Level != 0)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    this->AddRef();
+    *ppSurfaceLevel = this->level;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dTexture::LockRect(UINT Level, D3DLOCKED_RECT *pLockedRect, CONST RECT *pRect, DWORD Flags)
+{
+    if (Level != 0)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    return this->level->LockRect(pLockedRect, pRect, Flags);
+}
+
+STDMETHODIMP RecordingD3dTexture::UnlockRect(UINT Level)
+{
+    return Level != 0 ? D3DERR_INVALIDCALL : D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dTexture::AddDirtyRect(CONST RECT *pDirtyRect)
+{
+    return D3D_OK;
+}
+
+RecordingD3dVertexBuffer::RecordingD3dVertexBuffer(RecordingD3dDevice *device, UINT length, DWORD usage, DWORD fvf,
+                                                   D3DPOOL pool)
+{
+    this->device = device;
+    this->refCount = 1;
+    memset(&this->desc, 0, sizeof(this->desc));
+    this->desc.Format = D3DFMT_VERTEXDATA;
+    this->desc.Type = D3DRTYPE_VERTEXBUFFER;
+    this->desc.Usage = usage;
+    this->desc.Pool = pool;
+    this->desc.Size = length;
+    this->desc.FVF = fvf;
+    this->data = (u8 *)ZunAlloc(length, "d3d recording");
+    memset(this->data, 0, length);
+}
+
+RecordingD3dVertexBuffer::~RecordingD3dVertexBuffer()
+{
+    ZunFree(this->data);
+}
+
+STDMETHODIMP RecordingD3dVertexBuffer::QueryInterface(REFIID riid, void **ppvObj)
+{
+    if (riid == IID_IUnknown || riid == IID_IDirect3DResource8 || riid == IID_IDirect3DVertexBuffer8)
+    {
+        this->AddRef();
+        *ppvObj = this;
+        return S_OK;
+    }
+    *ppvObj = NULL;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) RecordingD3dVertexBuffer::AddRef()
+{
+    return ++this->refCount;
+}
+
+STDMETHODIMP_(ULONG) RecordingD3dVertexBuffer::Release()
+{
+    ULONG refCount = --this->refCount;
+
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
+
+STDMETHODIMP RecordingD3dVertexBuffer::GetDevice(IDirect3DDevice8 **ppDevice)
+{
+    this->device->AddRef();
+    *ppDevice = this->device;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dVertexBuffer::SetPrivateData(REFGUID refguid, CONST void *pData, DWORD SizeOfData,
+                                                      DWORD Flags)
+{
+    return E_NOTIMPL;
+}
+
+STDMETHODIMP RecordingD3dVertexBuffer::GetPrivateData(REFGUID refguid, void *pData, DWORD *pSizeOfData)
+{
+    return D3DERR_NOTFOUND;
+}
+
+STDMETHODIMP RecordingD3dVertexBuffer::FreePrivateData(REFGUID refguid)
+{
+    return D3DERR_NOTFOUND;
+}
+
+STDMETHODIMP_(DWORD) RecordingD3dVertexBuffer::SetPriority(DWORD PriorityNew)
+{
+    return 0;
+}
+
+STDMETHODIMP_(DWORD) RecordingD3dVertexBuffer::GetPriority()
+{
+    return 0;
+}
+
+STDMETHODIMP_(void) RecordingD3dVertexBuffer::PreLoad()
+{
+}
+
+STDMETHODIMP_(D3DRESOURCETYPE) RecordingD3dVertexBuffer::GetType()
+{
+    return D3DRTYPE_VERTEXBUFFER;
+}
+
+STDMETHODIMP RecordingD3dVertexBuffer::Lock(UINT OffsetToLock, UINT SizeToLock, BYTE **ppbData, DWORD Flags)
+{
+    if (OffsetToLock > this->desc.Size)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    *ppbData = this->data + OffsetToLock;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dVertexBuffer::Unlock()
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dVertexBuffer::GetDesc(D3DVERTEXBUFFER_DESC *pDesc)
+{
+    *pDesc = this->desc;
+    return D3D_OK;
+}
+
+RecordingD3dDevice::RecordingD3dDevice(UINT backBufferWidth, UINT backBufferHeight)
+{
+    i32 idx;
+
+    this->refCount = 1;
+    this->direct3d = NULL;
+    this->backBuffer = new RecordingD3dSurface(this, backBufferWidth, backBufferHeight, D3DFMT_X8R8G8B8, NULL);
+    this->renderTarget = this->backBuffer;
+    memset(this->renderStates, 0, sizeof(this->renderStates));
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(this->transforms); idx++)
+    {
+        memset(&this->transforms[idx], 0, sizeof(this->transforms[idx]));
+        this->transforms[idx].m[0][0] = 1.0f;
+        this->transforms[idx].m[1][1] = 1.0f;
+        this->transforms[idx].m[2][2] = 1.0f;
+        this->transforms[idx].m[3][3] = 1.0f;
+    }
+    this->viewport.X = 0;
+    this->viewport.Y = 0;
+    this->viewport.Width = backBufferWidth;
+    this->viewport.Height = backBufferHeight;
+    this->viewport.MinZ = 0.0f;
+    this->viewport.MaxZ = 1.0f;
+    memset(this->textures, 0, sizeof(this->textures));
+    memset(this->textureStageStates, 0, sizeof(this->textureStageStates));
+    this->vertexShader = 0;
+    this->streamSource = NULL;
+    this->streamStride = 0;
+    memset(&this->material, 0, sizeof(this->material));
+    this->logCount = 0;
+    memset(&this->thisFrame, 0, sizeof(this->thisFrame));
+    memset(&this->lastFrame, 0, sizeof(this->lastFrame));
+    memset(&this->total, 0, sizeof(this->total));
+    this->frameCount = 0;
+    this->statsFile = NULL;
+}
+
+RecordingD3dDevice::~RecordingD3dDevice()
+{
+    if (this->statsFile != NULL)
+    {
+        fclose(this->statsFile);
+    }
+    if (this->renderTarget != this->backBuffer)
+    {
+        this->renderTarget->Release();
+    }
+    this->backBuffer->Release();
+    if (this->direct3d != NULL)
+    {
+        this->direct3d->Release();
+    }
+}
+
+ZunResult RecordingD3dDevice::OpenStatsFile(const char *path)
+{
+    if (this->statsFile != NULL)
+    {
+        fclose(this->statsFile);
+    }
+    this->statsFile = fopen(path, "w");
+    if (this->statsFile == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    fprintf(this->statsFile, "frame,draw_calls,primitives,vertices,state_changes,texture_changes\n");
+    return ZUN_SUCCESS;
+}
+
+void RecordingD3dDevice::EndFrame()
+{
+    if (this->statsFile != NULL)
+    {
+        fprintf(this->statsFile, "%d,%d,%d,%d,%d,%d\n", this->frameCount, this->thisFrame.drawCalls,
+                this->thisFrame.primitives, this->thisFrame.vertices, this->thisFrame.stateChanges,
+                this->thisFrame.textureChanges);
+    }
+    this->total.drawCalls += this->thisFrame.drawCalls;
+    this->total.primitives += this->thisFrame.primitives;
+    this->total.vertices += this->thisFrame.vertices;
+    this->total.stateChanges += this->thisFrame.stateChanges;
+    this->total.textureChanges += this->thisFrame.textureChanges;
+    this->lastFrame = this->thisFrame;
+    memset(&this->thisFrame, 0, sizeof(this->thisFrame));
+    this->logCount = 0;
+    this->frameCount++;
+}
+
+void RecordingD3dDevice::Record(u32 type, u32 arg0, u32 arg1, u32 arg2)
+{
+    RecordedD3dCommand *command;
+
+    if (type != RecordedD3dCommand_Draw && type != RecordedD3dCommand_Clear)
+    {
+        this->thisFrame.stateChanges++;
+    }
+    if (this->logCount >= ARRAY_SIZE_SIGNED(this->log))
+    {
+        return;
+    }
+    command = &this->log[this->logCount++];
+    command->type = type;
+    command->args[0] = arg0;
+    command->args[1] = arg1;
+    command->args[2] = arg2;
+}
+
+void RecordingD3dDevice::RecordDraw(D3DPRIMITIVETYPE primitiveType, UINT primitiveCount, UINT vertexCount)
+{
+    this->thisFrame.drawCalls++;
+    this->thisFrame.primitives += primitiveCount;
+    this->thisFrame.vertices += vertexCount;
+    this->Record(RecordedD3dCommand_Draw, primitiveType, primitiveCount, vertexCount);
+}
+
+// Vertices consumed by a non-indexed draw of primitiveCount primitives.
+static UINT RecordingD3dVertexCount(D3DPRIMITIVETYPE primitiveType, UINT primitiveCount)
+{
+    switch (primitiveType)
+    {
+    case D3DPT_POINTLIST:
+        return primitiveCount;
+    case D3DPT_LINELIST:
+        return primitiveCount * 2;
+    case D3DPT_LINESTRIP:
+        return primitiveCount + 1;
+    case D3DPT_TRIANGLELIST:
+        return primitiveCount * 3;
+    default:
+        return primitiveCount + 2;
+    }
+}
+
+STDMETHODIMP RecordingD3dDevice::QueryInterface(REFIID riid, void **ppvObj)
+{
+    if (riid == IID_IUnknown || riid == IID_IDirect3DDevice8)
+    {
+        this->AddRef();
+        *ppvObj = this;
+        return S_OK;
+    }
+    *ppvObj = NULL;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) RecordingD3dDevice::AddRef()
+{
+    return ++this->refCount;
+}
+
+// The device is owned by whoever constructed it, so this never deletes.
+STDMETHODIMP_(ULONG) RecordingD3dDevice::Release()
+{
+    if (this->refCount > 1)
+    {
+        this->refCount--;
+    }
+    return this->refCount;
+}
+
+STDMETHODIMP RecordingD3dDevice::TestCooperativeLevel()
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP_(UINT) RecordingD3dDevice::GetAvailableTextureMem()
+{
+    return 64 * 1024 * 1024;
+}
+
+STDMETHODIMP RecordingD3dDevice::ResourceManagerDiscardBytes(DWORD Bytes)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetDirect3D(IDirect3D8 **ppD3D8)
+{
+    *ppD3D8 = this->direct3d;
+    if (this->direct3d == NULL)
+    {
+        return D3DERR_NOTAVAILABLE;
+    }
+    this->direct3d->AddRef();
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetDeviceCaps(D3DCAPS8 *pCaps)
+{
+    memset(pCaps, 0, sizeof(*pCaps));
+    pCaps->DeviceType = D3DDEVTYPE_HAL;
+    pCaps->PresentationIntervals = D3DPRESENT_INTERVAL_ONE | D3DPRESENT_INTERVAL_IMMEDIATE;
+    pCaps->TextureOpCaps = D3DTEXOPCAPS_SELECTARG1 | D3DTEXOPCAPS_SELECTARG2 | D3DTEXOPCAPS_MODULATE | D3DTEXOPCAPS_ADD;
+    pCaps->MaxTextureWidth = 2048;
+    pCaps->MaxTextureHeight = 2048;
+    pCaps->MaxTextureBlendStages = 8;
+    pCaps->MaxSimultaneousTextures = 8;
+    pCaps->MaxPrimitiveCount = 0xffff;
+    pCaps->MaxVertexIndex = 0xffff;
+    pCaps->MaxStreams = 1;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetDisplayMode(D3DDISPLAYMODE *pMode)
+{
+    pMode->Width = this->backBuffer->width;
+    pMode->Height = this->backBuffer->height;
+    pMode->RefreshRate = 60;
+    pMode->Format = this->backBuffer->format;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetCreationParameters(D3DDEVICE_CREATION_PARAMETERS *pParameters)
+{
+    memset(pParameters, 0, sizeof(*pParameters));
+    pParameters->DeviceType = D3DDEVTYPE_HAL;
+    pParameters->BehaviorFlags = D3DCREATE_SOFTWARE_VERTEXPROCESSING;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetCursorProperties(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface8 *pCursorBitmap)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP_(void) RecordingD3dDevice::SetCursorPosition(UINT XScreenSpace, UINT YScreenSpace, DWORD Flags)
+{
+}
+
+STDMETHODIMP_(BOOL) RecordingD3dDevice::ShowCursor(BOOL bShow)
+{
+    return FALSE;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateAdditionalSwapChain(D3DPRESENT_PARAMETERS *pPresentationParameters,
+                                                           IDirect3DSwapChain8 **pSwapChain)
+{
+    *pSwapChain = NULL;
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::Reset(D3DPRESENT_PARAMETERS *pPresentationParameters)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::Present(CONST RECT *pSourceRect, CONST RECT *pDestRect, HWND hDestWindowOverride,
+                                         CONST RGNDATA *pDirtyRegion)
+{
+    this->EndFrame();
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetBackBuffer(UINT BackBuffer, D3DBACKBUFFER_TYPE Type,
+                                               IDirect3DSurface8 **ppBackBuffer)
+{
+    this->backBuffer->AddRef();
+    *ppBackBuffer = this->backBuffer;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetRasterStatus(D3DRASTER_STATUS *pRasterStatus)
+{
+    pRasterStatus->InVBlank = TRUE;
+    pRasterStatus->ScanLine = 0;
+    return D3D_OK;
+}
+
+STDMETHODIMP_(void) RecordingD3dDevice::SetGammaRamp(DWORD Flags, CONST D3DGAMMARAMP *pRamp)
+{
+}
+
+STDMETHODIMP_(void) RecordingD3dDevice::GetGammaRamp(D3DGAMMARAMP *pRamp)
+{
+    memset(pRamp, 0, sizeof(*pRamp));
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format,
+                                               D3DPOOL Pool, IDirect3DTexture8 **ppTexture)
+{
+    *ppTexture = new RecordingD3dTexture(this, Width, Height, Format, Pool);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateVolumeTexture(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage,
+                                                     D3DFORMAT Format, D3DPOOL Pool,
+                                                     IDirect3DVolumeTexture8 **ppVolumeTexture)
+{
+    *ppVolumeTexture = NULL;
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateCubeTexture(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format,
+                                                   D3DPOOL Pool, IDirect3DCubeTexture8 **ppCubeTexture)
+{
+    *ppCubeTexture = NULL;
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateVertexBuffer(UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool,
+                                                    IDirect3DVertexBuffer8 **ppVertexBuffer)
+{
+    *ppVertexBuffer = new RecordingD3dVertexBuffer(this, Length, Usage, FVF, Pool);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateIndexBuffer(UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool,
+                                                   IDirect3DIndexBuffer8 **ppIndexBuffer)
+{
+    *ppIndexBuffer = NULL;
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format,
+                                                    D3DMULTISAMPLE_TYPE MultiSample, BOOL Lockable,
+                                                    IDirect3DSurface8 **ppSurface)
+{
+    *ppSurface = new RecordingD3dSurface(this, Width, Height, Format, NULL);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format,
+                                                           D3DMULTISAMPLE_TYPE MultiSample,
+                                                           IDirect3DSurface8 **ppSurface)
+{
+    *ppSurface = new RecordingD3dSurface(this, Width, Height, Format, NULL);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateImageSurface(UINT Width, UINT Height, D3DFORMAT Format,
+                                                    IDirect3DSurface8 **ppSurface)
+{
+    *ppSurface = new RecordingD3dSurface(this, Width, Height, Format, NULL);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::CopyRects(IDirect3DSurface8 *pSourceSurface, CONST RECT *pSourceRectsArray,
+                                           UINT cRects, IDirect3DSurface8 *pDestinationSurface,
+                                           CONST POINT *pDestPointsArray)
+{
+    RecordingD3dSurface *src = (RecordingD3dSurface *)pSourceSurface;
+    RecordingD3dSurface *dst = (RecordingD3dSurface *)pDestinationSurface;
+    RECT whole;
+    RECT rect;
+    POINT point;
+    i32 bytesPerPixel;
+    i32 row;
+    UINT idx;
+
+    if (src->format != dst->format)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    bytesPerPixel = RecordingD3dSurface::BytesPerPixel(src->format);
+    whole.left = 0;
+    whole.top = 0;
+    whole.right = src->width;
+    whole.bottom = src->height;
+    for (idx = 0; idx < (pSourceRectsArray != NULL ? cRects : 1); idx++)
+    {
+        rect = pSourceRectsArray != NULL ? pSourceRectsArray[idx] : whole;
+        point.x = pDestPointsArray != NULL ? pDestPointsArray[idx].x : rect.left;
+        point.y = pDestPointsArray != NULL ? pDestPointsArray[idx].y : rect.top;
+        if (rect.left < 0 || rect.top < 0 || rect.right > (LONG)src->width || rect.bottom > (LONG)src->height ||
+            point.x < 0 || point.y < 0 || point.x + rect.right - rect.left > (LONG)dst->width ||
+            point.y + rect.bottom - rect.top > (LONG)dst->height)
+        {
+            return D3DERR_INVALIDCALL;
+        }
+        for (row = 0; row < rect.bottom - rect.top; row++)
+        {
+            memcpy(dst->bits + (point.y + row) * dst->pitch + point.x * bytesPerPixel,
+                   src->bits + (rect.top + row) * src->pitch + rect.left * bytesPerPixel,
+                   (rect.right - rect.left) * bytesPerPixel);
+        }
+    }
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::UpdateTexture(IDirect3DBaseTexture8 *pSourceTexture,
+                                               IDirect3DBaseTexture8 *pDestinationTexture)
+{
+    RecordingD3dSurface *src = ((RecordingD3dTexture *)pSourceTexture)->level;
+    RecordingD3dSurface *dst = ((RecordingD3dTexture *)pDestinationTexture)->level;
+
+    if (src->format != dst->format || src->width != dst->width || src->height != dst->height)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    memcpy(dst->bits, src->bits, src->pitch * src->height);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetFrontBuffer(IDirect3DSurface8 *pDestSurface)
+{
+    return this->CopyRects(this->backBuffer, NULL, 0, pDestSurface, NULL);
+}
+
+STDMETHODIMP RecordingD3dDevice::SetRenderTarget(IDirect3DSurface8 *pRenderTarget, IDirect3DSurface8 *pNewZStencil)
+{
+    if (pRenderTarget == NULL)
+    {
+        return D3D_OK;
+    }
+    pRenderTarget->AddRef();
+    if (this->renderTarget != this->backBuffer)
+    {
+        this->renderTarget->Release();
+    }
+    this->renderTarget = (RecordingD3dSurface *)pRenderTarget;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetRenderTarget(IDirect3DSurface8 **ppRenderTarget)
+{
+    this->renderTarget->AddRef();
+    *ppRenderTarget = this->renderTarget;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetDepthStencilSurface(IDirect3DSurface8 **ppZStencilSurface)
+{
+    *ppZStencilSurface = NULL;
+    return D3DERR_NOTFOUND;
+}
+
+STDMETHODIMP RecordingD3dDevice::BeginScene()
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::EndScene()
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::Clear(DWORD Count, CONST D3DRECT *pRects, DWORD Flags, D3DCOLOR Color, float Z,
+                                       DWORD Stencil)
+{
+    this->Record(RecordedD3dCommand_Clear, Count, Flags, Color);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix)
+{
+    if ((u32)State >= ARRAY_SIZE(this->transforms))
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    this->transforms[State] = *pMatrix;
+    this->Record(RecordedD3dCommand_Transform, State, 0, 0);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetTransform(D3DTRANSFORMSTATETYPE State, D3DMATRIX *pMatrix)
+{
+    if ((u32)State >= ARRAY_SIZE(this->transforms))
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    *pMatrix = this->transforms[State];
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::MultiplyTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix)
+{
+    D3DMATRIX product;
+    i32 row;
+    i32 col;
+    i32 idx;
+
+    if ((u32)State >= ARRAY_SIZE(this->transforms))
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    for (row = 0; row < 4; row++)
+    {
+        for (col = 0; col < 4; col++)
+        {
+            product.m[row][col] = 0.0f;
+            for (idx = 0; idx < 4; idx++)
+            {
+                product.m[row][col] += pMatrix->m[row][idx] * this->transforms[State].m[idx][col];
+            }
+        }
+    }
+    return this->SetTransform(State, &product);
+}
+
+STDMETHODIMP RecordingD3dDevice::SetViewport(CONST D3DVIEWPORT8 *pViewport)
+{
+    this->viewport = *pViewport;
+    this->Record(RecordedD3dCommand_Viewport, pViewport->Width, pViewport->Height, 0);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetViewport(D3DVIEWPORT8 *pViewport)
+{
+    *pViewport = this->viewport;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetMaterial(CONST D3DMATERIAL8 *pMaterial)
+{
+    this->material = *pMaterial;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetMaterial(D3DMATERIAL8 *pMaterial)
+{
+    *pMaterial = this->material;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetLight(DWORD Index, CONST D3DLIGHT8 *pLight)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetLight(DWORD Index, D3DLIGHT8 *pLight)
+{
+    return D3DERR_INVALIDCALL;
+}
+
+STDMETHODIMP RecordingD3dDevice::LightEnable(DWORD Index, BOOL Enable)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetLightEnable(DWORD Index, BOOL *pEnable)
+{
+    *pEnable = FALSE;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetClipPlane(DWORD Index, CONST float *pPlane)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetClipPlane(DWORD Index, float *pPlane)
+{
+    memset(pPlane, 0, sizeof(float) * 4);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
+{
+    if ((u32)State < ARRAY_SIZE(this->renderStates))
+    {
+        this->renderStates[State] = Value;
+    }
+    this->Record(RecordedD3dCommand_RenderState, State, Value, 0);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetRenderState(D3DRENDERSTATETYPE State, DWORD *pValue)
+{
+    if ((u32)State >= ARRAY_SIZE(this->renderStates))
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    *pValue = this->renderStates[State];
+    return D3D_OK;
+}
+
+// The game never uses state blocks, so none of these need to do anything.
+STDMETHODIMP RecordingD3dDevice::BeginStateBlock()
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::EndStateBlock(DWORD *pToken)
+{
+    *pToken = 0;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::ApplyStateBlock(DWORD Token)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::CaptureStateBlock(DWORD Token)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::DeleteStateBlock(DWORD Token)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreateStateBlock(D3DSTATEBLOCKTYPE Type, DWORD *pToken)
+{
+    *pToken = 0;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetClipStatus(CONST D3DCLIPSTATUS8 *pClipStatus)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetClipStatus(D3DCLIPSTATUS8 *pClipStatus)
+{
+    memset(pClipStatus, 0, sizeof(*pClipStatus));
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetTexture(DWORD Stage, IDirect3DBaseTexture8 **ppTexture)
+{
+    if (Stage >= ARRAY_SIZE(this->textures))
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    *ppTexture = this->textures[Stage];
+    if (*ppTexture != NULL)
+    {
+        (*ppTexture)->AddRef();
+    }
+    return D3D_OK;
+}
+
+// Like the real runtime this does not hold a reference to bound textures; the game unbinds them before releasing.
+STDMETHODIMP RecordingD3dDevice::SetTexture(DWORD Stage, IDirect3DBaseTexture8 *pTexture)
+{
+    if (Stage >= ARRAY_SIZE(this->textures))
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    this->textures[Stage] = pTexture;
+    this->thisFrame.textureChanges++;
+    this->Record(RecordedD3dCommand_Texture, Stage, (u32)pTexture, 0);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD *pValue)
+{
+    if (Stage >= ARRAY_SIZE(this->textureStageStates) || (u32)Type >= ARRAY_SIZE(this->textureStageStates[0]))
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    *pValue = this->textureStageStates[Stage][Type];
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+{
+    if (Stage >= ARRAY_SIZE(this->textureStageStates) || (u32)Type >= ARRAY_SIZE(this->textureStageStates[0]))
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    this->textureStageStates[Stage][Type] = Value;
+    this->Record(RecordedD3dCommand_TextureStageState, Stage, Type, Value);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::ValidateDevice(DWORD *pNumPasses)
+{
+    *pNumPasses = 1;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetInfo(DWORD DevInfoID, void *pDevInfoStruct, DWORD DevInfoStructSize)
+{
+    return S_FALSE;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetPaletteEntries(UINT PaletteNumber, CONST PALETTEENTRY *pEntries)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetPaletteEntries(UINT PaletteNumber, PALETTEENTRY *pEntries)
+{
+    return D3DERR_INVALIDCALL;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetCurrentTexturePalette(UINT PaletteNumber)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetCurrentTexturePalette(UINT *PaletteNumber)
+{
+    *PaletteNumber = 0;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount)
+{
+    this->RecordDraw(PrimitiveType, PrimitiveCount, RecordingD3dVertexCount(PrimitiveType, PrimitiveCount));
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::DrawIndexedPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT minIndex, UINT NumVertices,
+                                                      UINT startIndex, UINT primCount)
+{
+    this->RecordDraw(PrimitiveType, primCount, NumVertices);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount,
+                                                 CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+    this->RecordDraw(PrimitiveType, PrimitiveCount, RecordingD3dVertexCount(PrimitiveType, PrimitiveCount));
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::DrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex,
+                                                        UINT NumVertexIndices, UINT PrimitiveCount,
+                                                        CONST void *pIndexData, D3DFORMAT IndexDataFormat,
+                                                        CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+    this->RecordDraw(PrimitiveType, PrimitiveCount, NumVertexIndices);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::ProcessVertices(UINT SrcStartIndex, UINT DestIndex, UINT VertexCount,
+                                                 IDirect3DVertexBuffer8 *pDestBuffer, DWORD Flags)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+
+// Only the fixed function pipeline is emulated; FVF codes are the only shader handles.
+STDMETHODIMP RecordingD3dDevice::CreateVertexShader(CONST DWORD *pDeclaration, CONST DWORD *pFunction, DWORD *pHandle,
+                                                    DWORD Usage)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetVertexShader(DWORD Handle)
+{
+    this->vertexShader = Handle;
+    this->Record(RecordedD3dCommand_VertexShader, Handle, 0, 0);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetVertexShader(DWORD *pHandle)
+{
+    *pHandle = this->vertexShader;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::DeleteVertexShader(DWORD Handle)
+{
+    return D3DERR_INVALIDCALL;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetVertexShaderConstant(DWORD Register, CONST void *pConstantData,
+                                                         DWORD ConstantCount)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetVertexShaderConstant(DWORD Register, void *pConstantData, DWORD ConstantCount)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetVertexShaderDeclaration(DWORD Handle, void *pData, DWORD *pSizeOfData)
+{
+    return D3DERR_INVALIDCALL;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetVertexShaderFunction(DWORD Handle, void *pData, DWORD *pSizeOfData)
+{
+    return D3DERR_INVALIDCALL;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer8 *pStreamData, UINT Stride)
+{
+    if (StreamNumber != 0)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    this->streamSource = pStreamData;
+    this->streamStride = Stride;
+    this->Record(RecordedD3dCommand_StreamSource, StreamNumber, (u32)pStreamData, Stride);
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer8 **ppStreamData,
+                                                 UINT *pStride)
+{
+    if (StreamNumber != 0)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    *ppStreamData = this->streamSource;
+    *pStride = this->streamStride;
+    if (this->streamSource != NULL)
+    {
+        this->streamSource->AddRef();
+    }
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetIndices(IDirect3DIndexBuffer8 *pIndexData, UINT BaseVertexIndex)
+{
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetIndices(IDirect3DIndexBuffer8 **ppIndexData, UINT *pBaseVertexIndex)
+{
+    *ppIndexData = NULL;
+    *pBaseVertexIndex = 0;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::CreatePixelShader(CONST DWORD *pFunction, DWORD *pHandle)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetPixelShader(DWORD Handle)
+{
+    return Handle == 0 ? D3D_OK : D3DERR_INVALIDCALL;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetPixelShader(DWORD *pHandle)
+{
+    *pHandle = 0;
+    return D3D_OK;
+}
+
+STDMETHODIMP RecordingD3dDevice::DeletePixelShader(DWORD Handle)
+{
+    return D3DERR_INVALIDCALL;
+}
+
+STDMETHODIMP RecordingD3dDevice::SetPixelShaderConstant(DWORD Register, CONST void *pConstantData, DWORD ConstantCount)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetPixelShaderConstant(DWORD Register, void *pConstantData, DWORD ConstantCount)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::GetPixelShaderFunction(DWORD Handle, void *pData, DWORD *pSizeOfData)
+{
+    return D3DERR_INVALIDCALL;
+}
+
+STDMETHODIMP RecordingD3dDevice::DrawRectPatch(UINT Handle, CONST float *pNumSegs,
+                                               CONST D3DRECTPATCH_INFO *pRectPatchInfo)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::DrawTriPatch(UINT Handle, CONST float *pNumSegs, CONST D3DTRIPATCH_INFO *pTriPatchInfo)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+
+STDMETHODIMP RecordingD3dDevice::DeletePatch(UINT Handle)
+{
+    return D3DERR_NOTAVAILABLE;
+}
+}; // namespace th06
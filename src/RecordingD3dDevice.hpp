@@ -0,0 +1,299 @@
+#pragma once
+
+#include <d3d8.h>
+#include <stdio.h>
+
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
+namespace th06
+{
+enum RecordedD3dCommandType
+{
+    RecordedD3dCommand_Clear,
+    // args: primitive type, primitive count, vertex count.
+    RecordedD3dCommand_Draw,
+    // args: state, value.
+    RecordedD3dCommand_RenderState,
+    // args: stage, type, value.
+    RecordedD3dCommand_TextureStageState,
+    // args: stage, texture.
+    RecordedD3dCommand_Texture,
+    RecordedD3dCommand_VertexShader,
+    // args: stream, vertex buffer, stride.
+    RecordedD3dCommand_StreamSource,
+    // args: transform state.
+    RecordedD3dCommand_Transform,
+    RecordedD3dCommand_Viewport,
+};
+
+struct RecordedD3dCommand
+{
+    u32 type;
+    u32 args[3];
+};
+
+struct RecordedD3dFrameStats
+{
+    i32 drawCalls;
+    i32 primitives;
+    i32 vertices;
+    // Every Set* call that changes pipeline state, texture and shader binds included.
+    i32 stateChanges;
+    i32 textureChanges;
+};
+
+#define RECORDING_D3D_LOG_SIZE 0x4000
+#define RECORDING_D3D_RENDER_STATES 256
+#define RECORDING_D3D_TRANSFORMS 512
+
+struct RecordingD3dDevice;
+
+// Plain system memory pixels; backs image surfaces, render targets and texture levels.
+struct RecordingD3dSurface : public IDirect3DSurface8
+{
+    RecordingD3dSurface(RecordingD3dDevice *device, UINT width, UINT height, D3DFORMAT format, IUnknown *container);
+    virtual ~RecordingD3dSurface();
+
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObj);
+    STDMETHOD_(ULONG, AddRef)();
+    STDMETHOD_(ULONG, Release)();
+
+    STDMETHOD(GetDevice)(IDirect3DDevice8 **ppDevice);
+    STDMETHOD(SetPrivateData)(REFGUID refguid, CONST void *pData, DWORD SizeOfData, DWORD Flags);
+    STDMETHOD(GetPrivateData)(REFGUID refguid, void *pData, DWORD *pSizeOfData);
+    STDMETHOD(FreePrivateData)(REFGUID refguid);
+    STDMETHOD(GetContainer)(REFIID riid, void **ppContainer);
+    STDMETHOD(GetDesc)(D3DSURFACE_DESC *pDesc);
+    STDMETHOD(LockRect)(D3DLOCKED_RECT *pLockedRect, CONST RECT *pRect, DWORD Flags);
+    STDMETHOD(UnlockRect)();
+
+    static i32 BytesPerPixel(D3DFORMAT format);
+
+    RecordingD3dDevice *device;
+    IUnknown *container;
+    ULONG refCount;
+    D3DFORMAT format;
+    UINT width;
+    UINT height;
+    i32 pitch;
+    u8 *bits;
+};
+
+// A single level texture, whatever level count was asked for.
+struct RecordingD3dTexture : public IDirect3DTexture8
+{
+    RecordingD3dTexture(RecordingD3dDevice *device, UINT width, UINT height, D3DFORMAT format, D3DPOOL pool);
+    virtual ~RecordingD3dTexture();
+
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObj);
+    STDMETHOD_(ULONG, AddRef)();
+    STDMETHOD_(ULONG, Release)();
+
+    STDMETHOD(GetDevice)(IDirect3DDevice8 **ppDevice);
+    STDMETHOD(SetPrivateData)(REFGUID refguid, CONST void *pData, DWORD SizeOfData, DWORD Flags);
+    STDMETHOD(GetPrivateData)(REFGUID refguid, void *pData, DWORD *pSizeOfData);
+    STDMETHOD(FreePrivateData)(REFGUID refguid);
+    STDMETHOD_(DWORD, SetPriority)(DWORD PriorityNew);
+    STDMETHOD_(DWORD, GetPriority)();
+    STDMETHOD_(void, PreLoad)();
+    STDMETHOD_(D3DRESOURCETYPE, GetType)();
+
+    STDMETHOD_(DWORD, SetLOD)(DWORD LODNew);
+    STDMETHOD_(DWORD, GetLOD)();
+    STDMETHOD_(DWORD, GetLevelCount)();
+
+    STDMETHOD(GetLevelDesc)(UINT Level, D3DSURFACE_DESC *pDesc);
+    STDMETHOD(GetSurfaceLevel)(UINT Level, IDirect3DSurface8 **ppSurfaceLevel);
+    STDMETHOD(LockRect)(UINT Level, D3DLOCKED_RECT *pLockedRect, CONST RECT *pRect, DWORD Flags);
+    STDMETHOD(UnlockRect)(UINT Level);
+    STDMETHOD(AddDirtyRect)(CONST RECT *pDirtyRect);
+
+    RecordingD3dDevice *device;
+    ULONG refCount;
+    D3DPOOL pool;
+    RecordingD3dSurface *level;
+};
+
+struct RecordingD3dVertexBuffer : public IDirect3DVertexBuffer8
+{
+    RecordingD3dVertexBuffer(RecordingD3dDevice *device, UINT length, DWORD usage, DWORD fvf, D3DPOOL pool);
+    virtual ~RecordingD3dVertexBuffer();
+
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObj);
+    STDMETHOD_(ULONG, AddRef)();
+    STDMETHOD_(ULONG, Release)();
+
+    STDMETHOD(GetDevice)(IDirect3DDevice8 **ppDevice);
+    STDMETHOD(SetPrivateData)(REFGUID refguid, CONST void *pData, DWORD SizeOfData, DWORD Flags);
+    STDMETHOD(GetPrivateData)(REFGUID refguid, void *pData, DWORD *pSizeOfData);
+    STDMETHOD(FreePrivateData)(REFGUID refguid);
+    STDMETHOD_(DWORD, SetPriority)(DWORD PriorityNew);
+    STDMETHOD_(DWORD, GetPriority)();
+    STDMETHOD_(void, PreLoad)();
+    STDMETHOD_(D3DRESOURCETYPE, GetType)();
+
+    STDMETHOD(Lock)(UINT OffsetToLock, UINT SizeToLock, BYTE **ppbData, DWORD Flags);
+    STDMETHOD(Unlock)();
+    STDMETHOD(GetDesc)(D3DVERTEXBUFFER_DESC *pDesc);
+
+    RecordingD3dDevice *device;
+    ULONG refCount;
+    D3DVERTEXBUFFER_DESC desc;
+    u8 *data;
+};
+
+// A Direct3D 8 device that draws nothing. It keeps enough state to answer the Get* calls the game makes, logs every
+// draw and state change of the current frame, and sums them up per frame on Present, so the draw chain can be
+// profiled and regression tested without a GPU.
+struct RecordingD3dDevice : public IDirect3DDevice8
+{
+    RecordingD3dDevice(UINT backBufferWidth, UINT backBufferHeight);
+    virtual ~RecordingD3dDevice();
+
+    // Writes one CSV line per presented frame to path.
+    ZunResult OpenStatsFile(const char *path);
+    void EndFrame();
+
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObj);
+    STDMETHOD_(ULONG, AddRef)();
+    STDMETHOD_(ULONG, Release)();
+
+    STDMETHOD(TestCooperativeLevel)();
+    STDMETHOD_(UINT, GetAvailableTextureMem)();
+    STDMETHOD(ResourceManagerDiscardBytes)(DWORD Bytes);
+    STDMETHOD(GetDirect3D)(IDirect3D8 **ppD3D8);
+    STDMETHOD(GetDeviceCaps)(D3DCAPS8 *pCaps);
+    STDMETHOD(GetDisplayMode)(D3DDISPLAYMODE *pMode);
+    STDMETHOD(GetCreationParameters)(D3DDEVICE_CREATION_PARAMETERS *pParameters);
+    STDMETHOD(SetCursorProperties)(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface8 *pCursorBitmap);
+    STDMETHOD_(void, SetCursorPosition)(UINT XScreenSpace, UINT YScreenSpace, DWORD Flags);
+    STDMETHOD_(BOOL, ShowCursor)(BOOL bShow);
+    STDMETHOD(CreateAdditionalSwapChain)(D3DPRESENT_PARAMETERS *pPresentationParameters,
+                                         IDirect3DSwapChain8 **pSwapChain);
+    STDMETHOD(Reset)(D3DPRESENT_PARAMETERS *pPresentationParameters);
+    STDMETHOD(Present)(CONST RECT *pSourceRect, CONST RECT *pDestRect, HWND hDestWindowOverride,
+                       CONST RGNDATA *pDirtyRegion);
+    STDMETHOD(GetBackBuffer)(UINT BackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface8 **ppBackBuffer);
+    STDMETHOD(GetRasterStatus)(D3DRASTER_STATUS *pRasterStatus);
+    STDMETHOD_(void, SetGammaRamp)(DWORD Flags, CONST D3DGAMMARAMP *pRamp);
+    STDMETHOD_(void, GetGammaRamp)(D3DGAMMARAMP *pRamp);
+    STDMETHOD(CreateTexture)(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool,
+                             IDirect3DTexture8 **ppTexture);
+    STDMETHOD(CreateVolumeTexture)(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format,
+                                   D3DPOOL Pool, IDirect3DVolumeTexture8 **ppVolumeTexture);
+    STDMETHOD(CreateCubeTexture)(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool,
+                                 IDirect3DCubeTexture8 **ppCubeTexture);
+    STDMETHOD(CreateVertexBuffer)(UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool,
+                                  IDirect3DVertexBuffer8 **ppVertexBuffer);
+    STDMETHOD(CreateIndexBuffer)(UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool,
+                                 IDirect3DIndexBuffer8 **ppIndexBuffer);
+    STDMETHOD(CreateRenderTarget)(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample,
+                                  BOOL Lockable, IDirect3DSurface8 **ppSurface);
+    STDMETHOD(CreateDepthStencilSurface)(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample,
+                                         IDirect3DSurface8 **ppSurface);
+    STDMETHOD(CreateImageSurface)(UINT Width, UINT Height, D3DFORMAT Format, IDirect3DSurface8 **ppSurface);
+    STDMETHOD(CopyRects)(IDirect3DSurface8 *pSourceSurface, CONST RECT *pSourceRectsArray, UINT cRects,
+                         IDirect3DSurface8 *pDestinationSurface, CONST POINT *pDestPointsArray);
+    STDMETHOD(UpdateTexture)(IDirect3DBaseTexture8 *pSourceTexture, IDirect3DBaseTexture8 *pDestinationTexture);
+    STDMETHOD(GetFrontBuffer)(IDirect3DSurface8 *pDestSurface);
+    STDMETHOD(SetRenderTarget)(IDirect3DSurface8 *pRenderTarget, IDirect3DSurface8 *pNewZStencil);
+    STDMETHOD(GetRenderTarget)(IDirect3DSurface8 **ppRenderTarget);
+    STDMETHOD(GetDepthStencilSurface)(IDirect3DSurface8 **ppZStencilSurface);
+    STDMETHOD(BeginScene)();
+    STDMETHOD(EndScene)();
+    STDMETHOD(Clear)(DWORD Count, CONST D3DRECT *pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil);
+    STDMETHOD(SetTransform)(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix);
+    STDMETHOD(GetTransform)(D3DTRANSFORMSTATETYPE State, D3DMATRIX *pMatrix);
+    STDMETHOD(MultiplyTransform)(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix);
+    STDMETHOD(SetViewport)(CONST D3DVIEWPORT8 *pViewport);
+    STDMETHOD(GetViewport)(D3DVIEWPORT8 *pViewport);
+    STDMETHOD(SetMaterial)(CONST D3DMATERIAL8 *pMaterial);
+    STDMETHOD(GetMaterial)(D3DMATERIAL8 *pMaterial);
+    STDMETHOD(SetLight)(DWORD Index, CONST D3DLIGHT8 *pLight);
+    STDMETHOD(GetLight)(DWORD Index, D3DLIGHT8 *pLight);
+    STDMETHOD(LightEnable)(DWORD Index, BOOL Enable);
+    STDMETHOD(GetLightEnable)(DWORD Index, BOOL *pEnable);
+    STDMETHOD(SetClipPlane)(DWORD Index, CONST float *pPlane);
+    STDMETHOD(GetClipPlane)(DWORD Index, float *pPlane);
+    STDMETHOD(SetRenderState)(D3DRENDERSTATETYPE State, DWORD Value);
+    STDMETHOD(GetRenderState)(D3DRENDERSTATETYPE State, DWORD *pValue);
+    STDMETHOD(BeginStateBlock)();
+    STDMETHOD(EndStateBlock)(DWORD *pToken);
+    STDMETHOD(ApplyStateBlock)(DWORD Token);
+    STDMETHOD(CaptureStateBlock)(DWORD Token);
+    STDMETHOD(DeleteStateBlock)(DWORD Token);
+    STDMETHOD(CreateStateBlock)(D3DSTATEBLOCKTYPE Type, DWORD *pToken);
+    STDMETHOD(SetClipStatus)(CONST D3DCLIPSTATUS8 *pClipStatus);
+    STDMETHOD(GetClipStatus)(D3DCLIPSTATUS8 *pClipStatus);
+    STDMETHOD(GetTexture)(DWORD Stage, IDirect3DBaseTexture8 **ppTexture);
+    STDMETHOD(SetTexture)(DWORD Stage, IDirect3DBaseTexture8 *pTexture);
+    STDMETHOD(GetTextureStageState)(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD *pValue);
+    STDMETHOD(SetTextureStageState)(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value);
+    STDMETHOD(ValidateDevice)(DWORD *pNumPasses);
+    STDMETHOD(GetInfo)(DWORD DevInfoID, void *pDevInfoStruct, DWORD DevInfoStructSize);
+    STDMETHOD(SetPaletteEntries)(UINT PaletteNumber, CONST PALETTEENTRY *pEntries);
+    STDMETHOD(GetPaletteEntries)(UINT PaletteNumber, PALETTEENTRY *pEntries);
+    STDMETHOD(SetCurrentTexturePalette)(UINT PaletteNumber);
+    STDMETHOD(GetCurrentTexturePalette)(UINT *PaletteNumber);
+    STDMETHOD(DrawPrimitive)(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount);
+    STDMETHOD(DrawIndexedPrimitive)(D3DPRIMITIVETYPE PrimitiveType, UINT minIndex, UINT NumVertices,
+                                    UINT startIndex, UINT primCount);
+    STDMETHOD(DrawPrimitiveUP)(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void *pVertexStreamZeroData,
+                               UINT VertexStreamZeroStride);
+    STDMETHOD(DrawIndexedPrimitiveUP)(D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex, UINT NumVertexIndices,
+                                      UINT PrimitiveCount, CONST void *pIndexData, D3DFORMAT IndexDataFormat,
+                                      CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride);
+    STDMETHOD(ProcessVertices)(UINT SrcStartIndex, UINT DestIndex, UINT VertexCount,
+                               IDirect3DVertexBuffer8 *pDestBuffer, DWORD Flags);
+    STDMETHOD(CreateVertexShader)(CONST DWORD *pDeclaration, CONST DWORD *pFunction, DWORD *pHandle, DWORD Usage);
+    STDMETHOD(SetVertexShader)(DWORD Handle);
+    STDMETHOD(GetVertexShader)(DWORD *pHandle);
+    STDMETHOD(DeleteVertexShader)(DWORD Handle);
+    STDMETHOD(SetVertexShaderConstant)(DWORD Register, CONST void *pConstantData, DWORD ConstantCount);
+    STDMETHOD(GetVertexShaderConstant)(DWORD Register, void *pConstantData, DWORD ConstantCount);
+    STDMETHOD(GetVertexShaderDeclaration)(DWORD Handle, void *pData, DWORD *pSizeOfData);
+    STDMETHOD(GetVertexShaderFunction)(DWORD Handle, void *pData, DWORD *pSizeOfData);
+    STDMETHOD(SetStreamSource)(UINT StreamNumber, IDirect3DVertexBuffer8 *pStreamData, UINT Stride);
+    STDMETHOD(GetStreamSource)(UINT StreamNumber, IDirect3DVertexBuffer8 **ppStreamData, UINT *pStride);
+    STDMETHOD(SetIndices)(IDirect3DIndexBuffer8 *pIndexData, UINT BaseVertexIndex);
+    STDMETHOD(GetIndices)(IDirect3DIndexBuffer8 **ppIndexData, UINT *pBaseVertexIndex);
+    STDMETHOD(CreatePixelShader)(CONST DWORD *pFunction, DWORD *pHandle);
+    STDMETHOD(SetPixelShader)(DWORD Handle);
+    STDMETHOD(GetPixelShader)(DWORD *pHandle);
+    STDMETHOD(DeletePixelShader)(DWORD Handle);
+    STDMETHOD(SetPixelShaderConstant)(DWORD Register, CONST void *pConstantData, DWORD ConstantCount);
+    STDMETHOD(GetPixelShaderConstant)(DWORD Register, void *pConstantData, DWORD ConstantCount);
+    STDMETHOD(GetPixelShaderFunction)(DWORD Handle, void *pData, DWORD *pSizeOfData);
+    STDMETHOD(DrawRectPatch)(UINT Handle, CONST float *pNumSegs, CONST D3DRECTPATCH_INFO *pRectPatchInfo);
+    STDMETHOD(DrawTriPatch)(UINT Handle, CONST float *pNumSegs, CONST D3DTRIPATCH_INFO *pTriPatchInfo);
+    STDMETHOD(DeletePatch)(UINT Handle);
+
+    void Record(u32 type, u32 arg0, u32 arg1, u32 arg2);
+    void RecordDraw(D3DPRIMITIVETYPE primitiveType, UINT primitiveCount, UINT vertexCount);
+
+    ULONG refCount;
+    // What GetDirect3D hands out, so D3DX can check texture formats. NULL when there is no real Direct3D around.
+    IDirect3D8 *direct3d;
+    RecordingD3dSurface *backBuffer;
+    RecordingD3dSurface *renderTarget;
+    DWORD renderStates[RECORDING_D3D_RENDER_STATES];
+    D3DMATRIX transforms[RECORDING_D3D_TRANSFORMS];
+    D3DVIEWPORT8 viewport;
+    IDirect3DBaseTexture8 *textures[8];
+    DWORD textureStageStates[8][32];
+    DWORD vertexShader;
+    IDirect3DVertexBuffer8 *streamSource;
+    UINT streamStride;
+    D3DMATERIAL8 material;
+
+    // The current frame's commands; once the log is full only the stats keep counting.
+    RecordedD3dCommand log[RECORDING_D3D_LOG_SIZE];
+    i32 logCount;
+    RecordedD3dFrameStats thisFrame;
+    RecordedD3dFrameStats lastFrame;
+    RecordedD3dFrameStats total;
+    i32 frameCount;
+    FILE *statsFile;
+};
+}; // namespace th06
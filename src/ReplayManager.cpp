@@ -245,7 +245,7 @@ ZunResult ReplayManager::AddedCallback(ReplayManager *mgr)
         utils::DebugPrint2("error : replay.cpp");
     }
     mgr->replayData->stageReplayData[g_GameManager.currentStage - 1] =
-        (StageReplayData *)ZunAlloc(sizeof(StageReplayData));
+        (StageReplayData *)ZunAlloc(sizeof(StageReplayData), "replay");
     stageReplayData = mgr->replayData->stageReplayData[g_GameManager.currentStage - 1];
     stageReplayData->bombsRemaining = g_GameManager.bombsRemaining;
     stageReplayData->livesRemaining = g_GameManager.livesRemaining;
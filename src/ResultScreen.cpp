@@ -1,6 +1,7 @@
 #include "ResultScreen.hpp"
 #include "AnmManager.hpp"
 #include "AsciiManager.hpp"
+#include "AssetTrace.hpp"
 #include "BulletManager.hpp"
 #include "Chain.hpp"
 #include "ChainPriorities.hpp"
@@ -58,7 +59,7 @@ ScoreDat *ResultScreen::OpenScore(char *path)
     if (scoreData == NULL)
     {
     FAILED_TO_READ:
-        scoreData = (ScoreDat *)ZunAlloc(sizeof(ScoreDat));
+        scoreData = (ScoreDat *)ZunAlloc(sizeof(ScoreDat), "score");
         scoreData->dataOffset = sizeof(ScoreDat);
         scoreData->fileLen = sizeof(ScoreDat);
     }
@@ -66,7 +67,7 @@ ScoreDat *ResultScreen::OpenScore(char *path)
     {
         if (g_LastFileSize < sizeof(ScoreDat))
         {
-            free(scoreData);
+            ZunFree(scoreData);
             goto FAILED_TO_READ;
         }
 
@@ -94,7 +95,7 @@ ScoreDat *ResultScreen::OpenScore(char *path)
         }
         if (scoreData->csum != checksum)
         {
-            free(scoreData);
+            ZunFree(scoreData);
             goto FAILED_TO_READ;
         }
         fileLen = scoreData->fileLen;
@@ -110,11 +111,11 @@ ScoreDat *ResultScreen::OpenScore(char *path)
         }
         if (fileLen <= 0)
         {
-            free(scoreData);
+            ZunFree(scoreData);
             goto FAILED_TO_READ;
         };
     }
-    scoreData->scores = (ScoreListNode *)ZunAlloc(sizeof(ScoreListNode));
+    scoreData->scores = (ScoreListNode *)ZunAlloc(sizeof(ScoreListNode), "score");
     scoreData->scores->next = NULL;
     scoreData->scores->data = NULL;
     scoreData->scores->prev = NULL;
@@ -199,7 +200,7 @@ i32 ResultScreen::LinkScore(ScoreListNode *prevNode, Hscr *newScore)
     }
     nextNode = prevNode->next;
 
-    prevNode->next = (ScoreListNode *)ZunAlloc(sizeof(ScoreListNode));
+    prevNode->next = (ScoreListNode *)ZunAlloc(sizeof(ScoreListNode), "score");
     prevNode->next->prev = prevNode;
     prevNode = prevNode->next;
     prevNode->data = newScore;
@@ -214,7 +215,7 @@ void ResultScreen::FreeAllScores(ScoreListNode *scores)
     while (scores != NULL)
     {
         next = scores->next;
-        free(scores);
+        ZunFree(scores);
         scores = next;
     }
 }
@@ -365,8 +366,8 @@ void ResultScreen::ReleaseScoreDat(ScoreDat *scoreDat)
     ScoreListNode *scores;
     ResultScreen::FreeAllScores(scoreDat->scores);
     scores = scoreDat->scores;
-    free(scores);
-    free(scoreDat);
+    ZunFree(scores);
+    ZunFree(scoreDat);
 }
 
 #pragma function("memcpy")
@@ -394,7 +395,7 @@ void ResultScreen::WriteScore(ResultScreen *resultScreen)
 
     sizeOfFile = 0;
 
-    fileBuffer = (u8 *)ZunAlloc(SCORE_DAT_FILE_BUFFER_SIZE);
+    fileBuffer = (u8 *)ZunAlloc(SCORE_DAT_FILE_BUFFER_SIZE, "score");
 
     memcpy(fileBuffer + sizeOfFile, resultScreen->scoreDat, sizeof(ScoreDat));
 
@@ -518,7 +519,7 @@ void ResultScreen::WriteScore(ResultScreen *resultScreen)
         remainingSize--;
     }
     FileSystem::WriteDataToFile("score.dat", fileBuffer, sizeOfFile);
-    free(fileBuffer);
+    ZunFree(fileBuffer);
 }
 #pragma intrinsic("memcpy")
 
@@ -871,7 +872,7 @@ i32 ResultScreen::HandleReplaySaveKeyboard()
                 {
                     this->replays[idx] = *replayLoaded;
                 }
-                free(replayLoaded);
+                ZunFree(replayLoaded);
             }
         }
 
@@ -1322,6 +1323,7 @@ ZunResult ResultScreen::RegisterChain(i32 unk)
 
     i32 unused[16];
     ResultScreen *resultScreen;
+    ASSET_TRACE_ENTER_SCENE(ASSET_SCENE_RESULT);
     resultScreen = new ResultScreen();
 
     utils::DebugPrint(TH_DBG_RESULTSCREEN_COUNAT, g_GameManager.counat);
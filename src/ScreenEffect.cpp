@@ -1,6 +1,7 @@
 #include "ScreenEffect.hpp"
 #include "AnmManager.hpp"
 #include "ChainPriorities.hpp"
+#include "D3dStateCache.hpp"
 #include "GameWindow.hpp"
 #include "Rng.hpp"
 #include "Supervisor.hpp"
@@ -14,11 +15,17 @@ void ScreenEffect::Clear(D3DCOLOR color)
     if (g_Supervisor.d3dDevice->Present(NULL, NULL, NULL, NULL) < 0)
     {
         g_Supervisor.d3dDevice->Reset(&g_Supervisor.presentParameters);
+#ifdef D3D_STATE_CACHE
+        g_D3dStateCache.Invalidate();
+#endif
     }
     g_Supervisor.d3dDevice->Clear(0, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, color, 1.0, 0);
     if (g_Supervisor.d3dDevice->Present(NULL, NULL, NULL, NULL) < 0)
     {
         g_Supervisor.d3dDevice->Reset(&g_Supervisor.presentParameters);
+#ifdef D3D_STATE_CACHE
+        g_D3dStateCache.Invalidate();
+#endif
     }
     return;
 }
@@ -71,19 +78,19 @@ void ScreenEffect::DrawSquare(ZunRect *rect, D3DCOLOR rectColor)
 
     if (((g_Supervisor.cfg.opts >> GCOS_NO_COLOR_COMP) & 0x01) == 0)
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
     }
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
     if (((g_Supervisor.cfg.opts >> GCOS_TURN_OFF_DEPTH_TEST) & 0x01) == 0)
     {
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_ALWAYS);
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+        D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_ALWAYS);
+        D3D_SET_RENDER_STATE(D3DRS_ZWRITEENABLE, FALSE);
     }
 
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
-    g_Supervisor.d3dDevice->SetVertexShader(D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
+    D3D_SET_RENDER_STATE(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+    D3D_SET_VERTEX_SHADER(D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
     g_Supervisor.d3dDevice->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, vertices, sizeof(*vertices));
     g_AnmManager->SetCurrentVertexShader(0xff);
     g_AnmManager->SetCurrentSprite(NULL);
@@ -94,12 +101,12 @@ void ScreenEffect::DrawSquare(ZunRect *rect, D3DCOLOR rectColor)
 
     if (((g_Supervisor.cfg.opts >> GCOS_NO_COLOR_COMP) & 0x01) == 0)
     {
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
-        g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+        D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
     }
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-    g_Supervisor.d3dDevice->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+    D3D_SET_TEXTURE_STAGE_STATE(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+    D3D_SET_RENDER_STATE(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
 }
 
 ChainCallbackResult ScreenEffect::CalcFadeOut(ScreenEffect *effect)
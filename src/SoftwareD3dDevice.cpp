@@ -0,0 +1,1300 @@
+#include "SoftwareD3dDevice.hpp"
+#include "ZunMath.hpp"
+#include "ZunMemory.hpp"
+#include "utils.hpp"
+
+#include <emmintrin.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+namespace th06
+{
+SoftwareD3dDevice *g_SoftwareD3dDevice;
+
+enum SoftwareAttribute
+{
+    SoftwareAttribute_Z,
+    SoftwareAttribute_Rhw,
+    SoftwareAttribute_U,
+    SoftwareAttribute_V,
+    SoftwareAttribute_Color,
+    SoftwareAttribute_Fog = SoftwareAttribute_Color + 4,
+    SoftwareAttribute_Count,
+};
+
+#define SOFTWARE_VERTEX_FLOATS (sizeof(SoftwareVertex) / sizeof(f32))
+
+// Grows a ZunAlloc'd array to hold at least count + 1 elements.
+static void *GrowSoftwareArray(void *array, i32 elemSize, i32 count, i32 *capacity)
+{
+    void *grown;
+
+    if (count < *capacity)
+    {
+        return array;
+    }
+    *capacity = *capacity == 0 ? 256 : *capacity * 2;
+    grown = ZunAlloc(elemSize * *capacity, "software d3d");
+    if (array != NULL)
+    {
+        memcpy(grown, array, elemSize * count);
+        ZunFree(array);
+    }
+    return grown;
+}
+
+// Fills count pixels, or depth values as their bits, with value. Clears and flat spans are most of what the GUI draws.
+static void FillSoftwareSpan(u32 *dst, i32 count, u32 value, ZunBool useSse2)
+{
+    __m128i fill;
+    i32 idx;
+
+    idx = 0;
+    if (useSse2)
+    {
+        fill = _mm_set1_epi32(value);
+        for (; idx + 4 <= count; idx += 4)
+        {
+            _mm_storeu_si128((__m128i *)(dst + idx), fill);
+        }
+    }
+    for (; idx < count; idx++)
+    {
+        dst[idx] = value;
+    }
+}
+
+SoftwareD3dDevice::SoftwareD3dDevice(UINT backBufferWidth, UINT backBufferHeight, i32 threadCount)
+    : RecordingD3dDevice(backBufferWidth, backBufferHeight)
+{
+    SYSTEM_INFO systemInfo;
+    SoftwareRasterWorker *worker;
+    i32 idx;
+
+    // Direct3D's defaults for the states the rasterizer reads.
+    this->renderStates[D3DRS_ZENABLE] = TRUE;
+    this->renderStates[D3DRS_ZWRITEENABLE] = TRUE;
+    this->renderStates[D3DRS_ZFUNC] = D3DCMP_LESSEQUAL;
+    this->renderStates[D3DRS_SHADEMODE] = D3DSHADE_GOURAUD;
+    this->renderStates[D3DRS_SRCBLEND] = D3DBLEND_ONE;
+    this->renderStates[D3DRS_DESTBLEND] = D3DBLEND_ZERO;
+    this->renderStates[D3DRS_ALPHAFUNC] = D3DCMP_ALWAYS;
+    this->renderStates[D3DRS_TEXTUREFACTOR] = 0xffffffff;
+    this->renderStates[D3DRS_FOGEND] = 0x3f800000;
+    this->textureStageStates[0][D3DTSS_COLOROP] = D3DTOP_MODULATE;
+    this->textureStageStates[0][D3DTSS_COLORARG1] = D3DTA_TEXTURE;
+    this->textureStageStates[0][D3DTSS_COLORARG2] = D3DTA_CURRENT;
+    this->textureStageStates[0][D3DTSS_ALPHAOP] = D3DTOP_SELECTARG1;
+    this->textureStageStates[0][D3DTSS_ALPHAARG1] = D3DTA_TEXTURE;
+    this->textureStageStates[0][D3DTSS_ALPHAARG2] = D3DTA_CURRENT;
+    this->textureStageStates[0][D3DTSS_MAGFILTER] = D3DTEXF_POINT;
+    this->textureStageStates[0][D3DTSS_MINFILTER] = D3DTEXF_POINT;
+
+    this->commands = NULL;
+    this->commandCount = 0;
+    this->commandCapacity = 0;
+    this->states = NULL;
+    this->stateCount = 0;
+    this->stateCapacity = 0;
+    this->stateDirty = true;
+    this->fetched = NULL;
+    this->fetchedCount = 0;
+    this->fetchedCapacity = 0;
+    this->depthBuffer = (f32 *)ZunAlloc(backBufferWidth * backBufferHeight * sizeof(f32), "software d3d");
+    for (idx = 0; idx < (i32)(backBufferWidth * backBufferHeight); idx++)
+    {
+        this->depthBuffer[idx] = 1.0f;
+    }
+    this->depthActive = true;
+    this->tilesX = 0;
+    this->tilesY = 0;
+    this->frameDump = NULL;
+    this->frameDumpFormat = SoftwareFrameDump_Rgb;
+    this->frameDumpRow = (u8 *)ZunAlloc(backBufferWidth * 3, "software d3d");
+    this->fpuControl = _controlfp(0, 0);
+    this->useSse2 = (utils::GetCpuFeatures() & CPU_FEATURE_SSE2) != 0;
+
+    if (threadCount <= 0)
+    {
+        GetSystemInfo(&systemInfo);
+        threadCount = systemInfo.dwNumberOfProcessors;
+    }
+    // The calling thread rasterizes too.
+    this->workerCount = threadCount - 1;
+    if (this->workerCount > SOFTWARE_D3D_MAX_WORKERS)
+    {
+        this->workerCount = SOFTWARE_D3D_MAX_WORKERS;
+    }
+    if (this->workerCount < 0)
+    {
+        this->workerCount = 0;
+    }
+    this->quitting = false;
+    this->nextTile = 0;
+    this->busyWorkers = 0;
+    this->doneEvent = CreateEventA(NULL, 0, 0, NULL);
+    for (worker = this->workers, idx = 0; idx < this->workerCount; idx++, worker++)
+    {
+        worker->device = this;
+        worker->startEvent = CreateEventA(NULL, 0, 0, NULL);
+        worker->thread = CreateThread(NULL, 0, SoftwareD3dDevice::WorkerThread, worker, 0, NULL);
+    }
+}
+
+SoftwareD3dDevice::~SoftwareD3dDevice()
+{
+    SoftwareRasterWorker *worker;
+    i32 idx;
+
+    this->quitting = true;
+    for (worker = this->workers, idx = 0; idx < this->workerCount; idx++, worker++)
+    {
+        SetEvent(worker->startEvent);
+        WaitForSingleObject(worker->thread, INFINITE);
+        CloseHandle(worker->thread);
+        CloseHandle(worker->startEvent);
+    }
+    CloseHandle(this->doneEvent);
+    if (this->frameDump != NULL)
+    {
+        fclose(this->frameDump);
+    }
+    ZunFree(this->frameDumpRow);
+    ZunFree(this->depthBuffer);
+    ZunFree(this->fetched);
+    ZunFree(this->states);
+    ZunFree(this->commands);
+}
+
+ZunResult SoftwareD3dDevice::OpenFrameDump(const char *path, SoftwareFrameDumpFormat format)
+{
+    if (this->frameDump != NULL)
+    {
+        fclose(this->frameDump);
+    }
+    this->frameDump = fopen(path, "wb");
+    if (this->frameDump == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    this->frameDumpFormat = format;
+    if (format == SoftwareFrameDump_Y4m)
+    {
+        fprintf(this->frameDump, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444\n", this->backBuffer->width,
+                this->backBuffer->height);
+    }
+    return ZUN_SUCCESS;
+}
+
+DWORD __stdcall SoftwareD3dDevice::WorkerThread(LPVOID lpThreadParameter)
+{
+    SoftwareRasterWorker *worker = (SoftwareRasterWorker *)lpThreadParameter;
+    SoftwareD3dDevice *device = worker->device;
+
+    for (;;)
+    {
+        WaitForSingleObject(worker->startEvent, INFINITE);
+        if (device->quitting)
+        {
+            break;
+        }
+        // Rasterize at the precision the game thread runs at, so every tile comes out the same whichever thread
+        // picked it up.
+        _controlfp(device->fpuControl, _MCW_PC);
+        device->RasterizeTiles();
+        if (InterlockedDecrement(&device->busyWorkers) == 0)
+        {
+            SetEvent(device->doneEvent);
+        }
+    }
+    return 0;
+}
+
+void SoftwareD3dDevice::Flush()
+{
+    i32 idx;
+
+    if (this->commandCount == 0)
+    {
+        return;
+    }
+    if (RecordingD3dSurface::BytesPerPixel(this->renderTarget->format) == 4)
+    {
+        this->depthActive = this->renderTarget == this->backBuffer;
+        this->tilesX = (this->renderTarget->width + SOFTWARE_D3D_TILE_SIZE - 1) / SOFTWARE_D3D_TILE_SIZE;
+        this->tilesY = (this->renderTarget->height + SOFTWARE_D3D_TILE_SIZE - 1) / SOFTWARE_D3D_TILE_SIZE;
+        this->fpuControl = _controlfp(0, 0);
+        this->nextTile = 0;
+        this->busyWorkers = this->workerCount;
+        for (idx = 0; idx < this->workerCount; idx++)
+        {
+            SetEvent(this->workers[idx].startEvent);
+        }
+        this->RasterizeTiles();
+        if (this->workerCount != 0)
+        {
+            WaitForSingleObject(this->doneEvent, INFINITE);
+        }
+    }
+    this->commandCount = 0;
+    this->stateCount = 0;
+    this->stateDirty = true;
+}
+
+void SoftwareD3dDevice::RasterizeTiles()
+{
+    LONG tileIdx;
+
+    while ((tileIdx = InterlockedIncrement(&this->nextTile) - 1) < this->tilesX * this->tilesY)
+    {
+        this->RasterizeTile(tileIdx);
+    }
+}
+
+void SoftwareD3dDevice::RasterizeTile(i32 tileIdx)
+{
+    SoftwareRasterCommand *command;
+    i32 left = (tileIdx % this->tilesX) * SOFTWARE_D3D_TILE_SIZE;
+    i32 top = (tileIdx / this->tilesX) * SOFTWARE_D3D_TILE_SIZE;
+    i32 right = ZUN_MIN(left + SOFTWARE_D3D_TILE_SIZE, (i32)this->renderTarget->width);
+    i32 bottom = ZUN_MIN(top + SOFTWARE_D3D_TILE_SIZE, (i32)this->renderTarget->height);
+    i32 idx;
+
+    for (command = this->commands, idx = 0; idx < this->commandCount; idx++, command++)
+    {
+        if (command->right <= left || command->left >= right || command->bottom <= top || command->top >= bottom)
+        {
+            continue;
+        }
+        if (command->type == SoftwareRasterCommand_Clear)
+        {
+            this->ClearTile(command, ZUN_MAX(left, command->left), ZUN_MAX(top, command->top),
+                            ZUN_MIN(right, command->right), ZUN_MIN(bottom, command->bottom));
+        }
+        else
+        {
+            this->RasterizeTriangle(command, ZUN_MAX(left, command->left), ZUN_MAX(top, command->top),
+                                    ZUN_MIN(right, command->right), ZUN_MIN(bottom, command->bottom));
+        }
+    }
+}
+
+void SoftwareD3dDevice::ClearTile(SoftwareRasterCommand *command, i32 left, i32 top, i32 right, i32 bottom)
+{
+    RecordingD3dSurface *target = this->renderTarget;
+    i32 y;
+
+    for (y = top; y < bottom; y++)
+    {
+        if (command->clearFlags & D3DCLEAR_TARGET)
+        {
+            FillSoftwareSpan((u32 *)(target->bits + y * target->pitch) + left, right - left, command->clearColor,
+                             this->useSse2);
+        }
+        if ((command->clearFlags & D3DCLEAR_ZBUFFER) && this->depthActive)
+        {
+            FillSoftwareSpan((u32 *)(this->depthBuffer + y * target->width + left), right - left,
+                             *(u32 *)&command->clearZ, this->useSse2);
+        }
+    }
+}
+
+static ZunBool SoftwareCompare(u8 func, f32 value, f32 reference)
+{
+    switch (func)
+    {
+    case D3DCMP_NEVER:
+        return false;
+    case D3DCMP_LESS:
+        return value < reference;
+    case D3DCMP_EQUAL:
+        return value == reference;
+    case D3DCMP_LESSEQUAL:
+        return value <= reference;
+    case D3DCMP_GREATER:
+        return value > reference;
+    case D3DCMP_NOTEQUAL:
+        return value != reference;
+    case D3DCMP_GREATEREQUAL:
+        return value >= reference;
+    default:
+        return true;
+    }
+}
+
+// Reads one texel as a D3DCOLOR, wrapping out of range coordinates. D3DX rounds every texture the game loads up to
+// power of two sizes, so wrapping is a mask.
+static u32 SoftwareFetchTexel(RecordingD3dSurface *texture, i32 x, i32 y)
+{
+    u8 *row;
+    u32 texel;
+
+    x &= texture->width - 1;
+    y &= texture->height - 1;
+    row = texture->bits + y * texture->pitch;
+    switch (texture->format)
+    {
+    case D3DFMT_A8R8G8B8:
+        return ((u32 *)row)[x];
+    case D3DFMT_X8R8G8B8:
+        return ((u32 *)row)[x] | 0xff000000;
+    case D3DFMT_A4R4G4B4:
+        texel = ((u16 *)row)[x];
+        return (texel >> 12) * 0x11 << 24 | ((texel >> 8) & 0xf) * 0x11 << 16 | ((texel >> 4) & 0xf) * 0x11 << 8 |
+               (texel & 0xf) * 0x11;
+    case D3DFMT_A1R5G5B5:
+        texel = ((u16 *)row)[x];
+        return (texel & 0x8000 ? 0xff000000 : 0) | (texel & 0x7c00) << 9 | (texel & 0x3e0) << 6 | (texel & 0x1f) << 3;
+    case D3DFMT_X1R5G5B5:
+        texel = ((u16 *)row)[x];
+        return 0xff000000 | (texel & 0x7c00) << 9 | (texel & 0x3e0) << 6 | (texel & 0x1f) << 3;
+    case D3DFMT_R5G6B5:
+        texel = ((u16 *)row)[x];
+        return 0xff000000 | (texel & 0xf800) << 8 | (texel & 0x7e0) << 5 | (texel & 0x1f) << 3;
+    default:
+        return 0xff000000;
+    }
+}
+
+static void SoftwareSample(SoftwareRasterState *state, f32 u, f32 v, i32 *out)
+{
+    RecordingD3dSurface *texture = state->texture;
+    u32 texels[4];
+    i32 weights[4];
+    i32 fracX;
+    i32 fracY;
+    i32 x;
+    i32 y;
+    i32 channel;
+    i32 idx;
+
+    if (!state->linearFilter)
+    {
+        texels[0] = SoftwareFetchTexel(texture, (i32)floorf(u * texture->width), (i32)floorf(v * texture->height));
+        for (channel = 0; channel < 4; channel++)
+        {
+            out[channel] = (texels[0] >> (channel * 8)) & 0xff;
+        }
+        return;
+    }
+    u = u * texture->width - 0.5f;
+    v = v * texture->height - 0.5f;
+    x = (i32)floorf(u);
+    y = (i32)floorf(v);
+    fracX = (i32)((u - x) * 256.0f);
+    fracY = (i32)((v - y) * 256.0f);
+    texels[0] = SoftwareFetchTexel(texture, x, y);
+    texels[1] = SoftwareFetchTexel(texture, x + 1, y);
+    texels[2] = SoftwareFetchTexel(texture, x, y + 1);
+    texels[3] = SoftwareFetchTexel(texture, x + 1, y + 1);
+    weights[0] = (256 - fracX) * (256 - fracY);
+    weights[1] = fracX * (256 - fracY);
+    weights[2] = (256 - fracX) * fracY;
+    weights[3] = fracX * fracY;
+    for (channel = 0; channel < 4; channel++)
+    {
+        out[channel] = 0;
+        for (idx = 0; idx < 4; idx++)
+        {
+            out[channel] += ((texels[idx] >> (channel * 8)) & 0xff) * weights[idx];
+        }
+        out[channel] >>= 16;
+    }
+}
+
+static i32 *SoftwareSelectArg(u8 arg, i32 *diffuse, i32 *texel, i32 *factor)
+{
+    switch (arg & D3DTA_SELECTMASK)
+    {
+    case D3DTA_TEXTURE:
+        return texel;
+    case D3DTA_TFACTOR:
+        return factor;
+    default:
+        return diffuse;
+    }
+}
+
+static i32 SoftwareCombine(u8 op, i32 arg1, i32 arg2, i32 current)
+{
+    i32 result;
+
+    switch (op)
+    {
+    case D3DTOP_DISABLE:
+        return current;
+    case D3DTOP_SELECTARG2:
+        return arg2;
+    case D3DTOP_MODULATE:
+        return arg1 * arg2 / 255;
+    case D3DTOP_MODULATE2X:
+        result = arg1 * arg2 * 2 / 255;
+        break;
+    case D3DTOP_MODULATE4X:
+        result = arg1 * arg2 * 4 / 255;
+        break;
+    case D3DTOP_ADD:
+        result = arg1 + arg2;
+        break;
+    case D3DTOP_ADDSIGNED:
+        result = arg1 + arg2 - 128;
+        break;
+    case D3DTOP_SUBTRACT:
+        result = arg1 - arg2;
+        break;
+    default:
+        return arg1;
+    }
+    return result < 0 ? 0 : (result > 255 ? 255 : result);
+}
+
+static i32 SoftwareBlendFactor(u8 blend, i32 channel, i32 *src, i32 *dst)
+{
+    switch (blend)
+    {
+    case D3DBLEND_ZERO:
+        return 0;
+    case D3DBLEND_SRCCOLOR:
+        return src[channel];
+    case D3DBLEND_INVSRCCOLOR:
+        return 255 - src[channel];
+    case D3DBLEND_SRCALPHA:
+        return src[3];
+    case D3DBLEND_INVSRCALPHA:
+        return 255 - src[3];
+    case D3DBLEND_DESTALPHA:
+        return dst[3];
+    case D3DBLEND_INVDESTALPHA:
+        return 255 - dst[3];
+    case D3DBLEND_DESTCOLOR:
+        return dst[channel];
+    case D3DBLEND_INVDESTCOLOR:
+        return 255 - dst[channel];
+    default:
+        return 255;
+    }
+}
+
+static ZunBool SoftwareInside(f32 *edges, i32 *includeEdge)
+{
+    return (edges[0] > 0.0f || (edges[0] == 0.0f && includeEdge[0])) &&
+           (edges[1] > 0.0f || (edges[1] == 0.0f && includeEdge[1])) &&
+           (edges[2] > 0.0f || (edges[2] == 0.0f && includeEdge[2]));
+}
+
+static void SoftwareEdgesAt(f32 *a, f32 *rowEdges, i32 x, f32 *edges)
+{
+    edges[0] = a[0] * x + rowEdges[0];
+    edges[1] = a[1] * x + rowEdges[1];
+    edges[2] = a[2] * x + rowEdges[2];
+}
+
+void SoftwareD3dDevice::RasterizeTriangle(SoftwareRasterCommand *command, i32 left, i32 top, i32 right, i32 bottom)
+{
+    SoftwareRasterState *state = &this->states[command->stateIdx];
+    RecordingD3dSurface *target = this->renderTarget;
+    SoftwareVertex *vertices[3];
+    f32 area;
+    f32 a[3];
+    f32 b[3];
+    f32 c[3];
+    i32 includeEdge[3];
+    f32 attrs[3][SoftwareAttribute_Count];
+    f32 attrDx[SoftwareAttribute_Count];
+    f32 attrDy[SoftwareAttribute_Count];
+    f32 attrBase[SoftwareAttribute_Count];
+    f32 rowEdges[3];
+    f32 edges[3];
+    f32 span[SoftwareAttribute_Count];
+    i32 spanStart;
+    i32 spanEnd;
+    f32 bound;
+    i32 x;
+    i32 y;
+    i32 idx;
+    u32 *pixel;
+    f32 *depth;
+    f32 w;
+    f32 z;
+    i32 diffuse[4];
+    i32 texel[4];
+    i32 factor[4];
+    i32 color[4];
+    i32 dst[4];
+    i32 blended[4];
+    i32 fogColor[4];
+    i32 *colorArg1;
+    i32 *colorArg2;
+    i32 *alphaArg1;
+    i32 *alphaArg2;
+    ZunBool solid;
+    u32 solidColor;
+    i32 channel;
+    f32 tmp;
+
+    vertices[0] = &command->vertices[0];
+    vertices[1] = &command->vertices[1];
+    vertices[2] = &command->vertices[2];
+    area = (vertices[1]->x - vertices[0]->x) * (vertices[2]->y - vertices[0]->y) -
+           (vertices[2]->x - vertices[0]->x) * (vertices[1]->y - vertices[0]->y);
+    if (area == 0.0f)
+    {
+        return;
+    }
+    // Culling is always off in the game, so either winding has to come out facing us.
+    if (area < 0.0f)
+    {
+        vertices[1] = &command->vertices[2];
+        vertices[2] = &command->vertices[1];
+        area = -area;
+    }
+    for (idx = 0; idx < 3; idx++)
+    {
+        SoftwareVertex *from = vertices[(idx + 1) % 3];
+        SoftwareVertex *to = vertices[(idx + 2) % 3];
+
+        a[idx] = from->y - to->y;
+        b[idx] = to->x - from->x;
+        c[idx] = from->x * to->y - to->x * from->y;
+        // Top-left rule: pixels exactly on a left or top edge belong to this triangle.
+        includeEdge[idx] = a[idx] > 0.0f || (a[idx] == 0.0f && b[idx] > 0.0f);
+
+        attrs[idx][SoftwareAttribute_Z] = vertices[idx]->z;
+        attrs[idx][SoftwareAttribute_Rhw] = vertices[idx]->rhw;
+        attrs[idx][SoftwareAttribute_U] = vertices[idx]->u * vertices[idx]->rhw;
+        attrs[idx][SoftwareAttribute_V] = vertices[idx]->v * vertices[idx]->rhw;
+        for (channel = 0; channel < 4; channel++)
+        {
+            attrs[idx][SoftwareAttribute_Color + channel] =
+                (state->flatShade ? command->vertices[0].color[channel] : vertices[idx]->color[channel]) *
+                vertices[idx]->rhw;
+        }
+        attrs[idx][SoftwareAttribute_Fog] = vertices[idx]->fog * vertices[idx]->rhw;
+    }
+    for (idx = 0; idx < SoftwareAttribute_Count; idx++)
+    {
+        attrDx[idx] = (a[0] * attrs[0][idx] + a[1] * attrs[1][idx] + a[2] * attrs[2][idx]) / area;
+        attrDy[idx] = (b[0] * attrs[0][idx] + b[1] * attrs[1][idx] + b[2] * attrs[2][idx]) / area;
+        attrBase[idx] = (c[0] * attrs[0][idx] + c[1] * attrs[1][idx] + c[2] * attrs[2][idx]) / area;
+    }
+
+    for (channel = 0; channel < 4; channel++)
+    {
+        factor[channel] = (state->textureFactor >> (channel * 8)) & 0xff;
+        fogColor[channel] = (state->fogColor >> (channel * 8)) & 0xff;
+        texel[channel] = channel == 3 ? 255 : 0;
+    }
+    colorArg1 = SoftwareSelectArg(state->colorArg1, diffuse, texel, factor);
+    colorArg2 = SoftwareSelectArg(state->colorArg2, diffuse, texel, factor);
+    alphaArg1 = SoftwareSelectArg(state->alphaArg1, diffuse, texel, factor);
+    alphaArg2 = SoftwareSelectArg(state->alphaArg2, diffuse, texel, factor);
+
+    // Untextured, unblended, unfogged and undepthed triangles of one color are plain span fills, like the GUI's
+    // backgrounds.
+    solid = false;
+    solidColor = 0;
+    if (!state->zEnable && !state->fogEnable && !state->alphaTestEnable &&
+        (!state->blendEnable || (state->srcBlend == D3DBLEND_ONE && state->destBlend == D3DBLEND_ZERO)) &&
+        (state->colorOp == D3DTOP_SELECTARG1 || state->colorOp == D3DTOP_DISABLE) &&
+        (state->alphaOp == D3DTOP_SELECTARG1 || state->alphaOp == D3DTOP_DISABLE) &&
+        (state->colorArg1 & D3DTA_SELECTMASK) != D3DTA_TEXTURE &&
+        (state->alphaArg1 & D3DTA_SELECTMASK) != D3DTA_TEXTURE &&
+        (state->flatShade ||
+         memcmp(command->vertices[0].color, command->vertices[1].color, sizeof(command->vertices[0].color)) == 0 &&
+             memcmp(command->vertices[0].color, command->vertices[2].color, sizeof(command->vertices[0].color)) == 0))
+    {
+        solid = true;
+        for (channel = 0; channel < 4; channel++)
+        {
+            diffuse[channel] = (i32)command->vertices[0].color[channel];
+        }
+        for (channel = 0; channel < 4; channel++)
+        {
+            color[channel] = channel < 3 ? colorArg1[channel] : alphaArg1[channel];
+            if (channel < 3 ? state->colorOp == D3DTOP_DISABLE : state->alphaOp == D3DTOP_DISABLE)
+            {
+                color[channel] = diffuse[channel];
+            }
+            solidColor |= color[channel] << (channel * 8);
+        }
+    }
+
+    for (y = top; y < bottom; y++)
+    {
+        rowEdges[0] = b[0] * y + c[0];
+        rowEdges[1] = b[1] * y + c[1];
+        rowEdges[2] = b[2] * y + c[2];
+
+        // Solve each edge for where it crosses this row, then nudge the ends onto the exact edge test so shared
+        // edges between neighbouring triangles neither overlap nor leave gaps.
+        spanStart = left;
+        spanEnd = right - 1;
+        for (idx = 0; idx < 3; idx++)
+        {
+            if (a[idx] == 0.0f)
+            {
+                if (rowEdges[idx] < 0.0f || (rowEdges[idx] == 0.0f && !includeEdge[idx]))
+                {
+                    spanEnd = spanStart - 1;
+                }
+                continue;
+            }
+            bound = -rowEdges[idx] / a[idx];
+            if (a[idx] > 0.0f)
+            {
+                if (bound > spanStart)
+                {
+                    spanStart = bound > right ? right : (i32)ceilf(bound);
+                }
+            }
+            else if (bound < spanEnd)
+            {
+                spanEnd = bound < left ? left - 1 : (i32)floorf(bound);
+            }
+        }
+        if (spanStart > spanEnd)
+        {
+            continue;
+        }
+        for (;;)
+        {
+            SoftwareEdgesAt(a, rowEdges, spanStart, edges);
+            if (spanStart > spanEnd || SoftwareInside(edges, includeEdge))
+            {
+                break;
+            }
+            spanStart++;
+        }
+        while (spanStart > left)
+        {
+            SoftwareEdgesAt(a, rowEdges, spanStart - 1, edges);
+            if (!SoftwareInside(edges, includeEdge))
+            {
+                break;
+            }
+            spanStart--;
+        }
+        for (;;)
+        {
+            SoftwareEdgesAt(a, rowEdges, spanEnd, edges);
+            if (spanEnd < spanStart || SoftwareInside(edges, includeEdge))
+            {
+                break;
+            }
+            spanEnd--;
+        }
+        while (spanEnd < right - 1)
+        {
+            SoftwareEdgesAt(a, rowEdges, spanEnd + 1, edges);
+            if (!SoftwareInside(edges, includeEdge))
+            {
+                break;
+            }
+            spanEnd++;
+        }
+        if (spanStart > spanEnd)
+        {
+            continue;
+        }
+
+        pixel = (u32 *)(target->bits + y * target->pitch) + spanStart;
+        if (solid)
+        {
+            FillSoftwareSpan(pixel, spanEnd - spanStart + 1, solidColor, this->useSse2);
+            continue;
+        }
+
+        depth = this->depthBuffer + y * target->width + spanStart;
+        for (idx = 0; idx < SoftwareAttribute_Count; idx++)
+        {
+            span[idx] = attrBase[idx] + attrDy[idx] * y + attrDx[idx] * spanStart;
+        }
+        for (x = spanStart; x <= spanEnd; x++, pixel++, depth++)
+        {
+            z = span[SoftwareAttribute_Z];
+            if (state->zEnable && !SoftwareCompare(state->zFunc, z, *depth))
+            {
+                goto next_pixel;
+            }
+            w = 1.0f / span[SoftwareAttribute_Rhw];
+            for (channel = 0; channel < 4; channel++)
+            {
+                tmp = span[SoftwareAttribute_Color + channel] * w;
+                diffuse[channel] = tmp <= 0.0f ? 0 : (tmp >= 255.0f ? 255 : (i32)tmp);
+            }
+            if (state->texture != NULL)
+            {
+                SoftwareSample(state, span[SoftwareAttribute_U] * w, span[SoftwareAttribute_V] * w, texel);
+            }
+            for (channel = 0; channel < 3; channel++)
+            {
+                color[channel] =
+                    SoftwareCombine(state->colorOp, colorArg1[channel], colorArg2[channel], diffuse[channel]);
+            }
+            color[3] = SoftwareCombine(state->alphaOp, alphaArg1[3], alphaArg2[3], diffuse[3]);
+            if (state->alphaTestEnable && !SoftwareCompare(state->alphaFunc, (f32)color[3], (f32)state->alphaRef))
+            {
+                goto next_pixel;
+            }
+            if (state->fogEnable)
+            {
+                tmp = span[SoftwareAttribute_Fog] * w;
+                tmp = tmp <= 0.0f ? 0.0f : (tmp >= 1.0f ? 1.0f : tmp);
+                for (channel = 0; channel < 3; channel++)
+                {
+                    color[channel] = (i32)(fogColor[channel] + (color[channel] - fogColor[channel]) * tmp);
+                }
+            }
+            if (state->blendEnable)
+            {
+                for (channel = 0; channel < 4; channel++)
+                {
+                    dst[channel] = (*pixel >> (channel * 8)) & 0xff;
+                }
+                for (channel = 0; channel < 4; channel++)
+                {
+                    blended[channel] = (color[channel] * SoftwareBlendFactor(state->srcBlend, channel, color, dst) +
+                                        dst[channel] * SoftwareBlendFactor(state->destBlend, channel, color, dst)) /
+                                       255;
+                }
+                for (channel = 0; channel < 4; channel++)
+                {
+                    color[channel] = blended[channel] > 255 ? 255 : blended[channel];
+                }
+            }
+            *pixel = color[0] | color[1] << 8 | color[2] << 16 | color[3] << 24;
+            if (state->zEnable && state->zWriteEnable)
+            {
+                *depth = z;
+            }
+        next_pixel:
+            for (idx = 0; idx < SoftwareAttribute_Count; idx++)
+            {
+                span[idx] += attrDx[idx];
+            }
+        }
+    }
+}
+
+void SoftwareD3dDevice::SnapshotState()
+{
+    SoftwareRasterState *state;
+    DWORD *stage = this->textureStageStates[0];
+
+    this->states = (SoftwareRasterState *)GrowSoftwareArray(this->states, sizeof(SoftwareRasterState),
+                                                             this->stateCount, &this->stateCapacity);
+    state = &this->states[this->stateCount++];
+    state->texture = this->textures[0] != NULL ? ((RecordingD3dTexture *)this->textures[0])->level : NULL;
+    state->textureFactor = this->renderStates[D3DRS_TEXTUREFACTOR];
+    state->fogColor = this->renderStates[D3DRS_FOGCOLOR];
+    state->colorOp = (u8)stage[D3DTSS_COLOROP];
+    state->colorArg1 = (u8)stage[D3DTSS_COLORARG1];
+    state->colorArg2 = (u8)stage[D3DTSS_COLORARG2];
+    state->alphaOp = (u8)stage[D3DTSS_ALPHAOP];
+    state->alphaArg1 = (u8)stage[D3DTSS_ALPHAARG1];
+    state->alphaArg2 = (u8)stage[D3DTSS_ALPHAARG2];
+    state->linearFilter = stage[D3DTSS_MAGFILTER] == D3DTEXF_LINEAR;
+    state->flatShade = this->renderStates[D3DRS_SHADEMODE] == D3DSHADE_FLAT;
+    state->blendEnable = this->renderStates[D3DRS_ALPHABLENDENABLE] != 0;
+    state->srcBlend = (u8)this->renderStates[D3DRS_SRCBLEND];
+    state->destBlend = (u8)this->renderStates[D3DRS_DESTBLEND];
+    state->alphaTestEnable = this->renderStates[D3DRS_ALPHATESTENABLE] != 0;
+    state->alphaFunc = (u8)this->renderStates[D3DRS_ALPHAFUNC];
+    state->alphaRef = (u8)this->renderStates[D3DRS_ALPHAREF];
+    state->zEnable = this->renderStates[D3DRS_ZENABLE] != 0 && this->renderTarget == this->backBuffer;
+    state->zWriteEnable = this->renderStates[D3DRS_ZWRITEENABLE] != 0;
+    state->zFunc = (u8)this->renderStates[D3DRS_ZFUNC];
+    state->fogEnable = this->renderStates[D3DRS_FOGENABLE] != 0;
+    state->clipLeft = ZUN_MAX((i32)this->viewport.X, 0);
+    state->clipTop = ZUN_MAX((i32)this->viewport.Y, 0);
+    state->clipRight = ZUN_MIN((i32)(this->viewport.X + this->viewport.Width), (i32)this->renderTarget->width);
+    state->clipBottom = ZUN_MIN((i32)(this->viewport.Y + this->viewport.Height), (i32)this->renderTarget->height);
+    this->stateDirty = false;
+}
+
+SoftwareRasterCommand *SoftwareD3dDevice::AllocCommand()
+{
+    this->commands = (SoftwareRasterCommand *)GrowSoftwareArray(this->commands, sizeof(SoftwareRasterCommand),
+                                                                 this->commandCount, &this->commandCapacity);
+    return &this->commands[this->commandCount++];
+}
+
+void SoftwareD3dDevice::FetchVertices(CONST u8 *src, UINT stride, i32 count)
+{
+    DWORD fvf = this->vertexShader;
+    D3DMATRIX worldView;
+    D3DMATRIX transform;
+    D3DMATRIX *lhs;
+    D3DMATRIX *rhs;
+    SoftwareVertex *vertex;
+    CONST f32 *position;
+    D3DCOLOR diffuse;
+    i32 offset;
+    f32 fogStart = *(f32 *)&this->renderStates[D3DRS_FOGSTART];
+    f32 fogEnd = *(f32 *)&this->renderStates[D3DRS_FOGEND];
+    ZunBool linearFog = this->renderStates[D3DRS_FOGTABLEMODE] == D3DFOG_LINEAR ||
+                        this->renderStates[D3DRS_FOGVERTEXMODE] == D3DFOG_LINEAR;
+    f32 eyeDepth;
+    i32 row;
+    i32 col;
+    i32 idx;
+
+    if (count > this->fetchedCapacity)
+    {
+        ZunFree(this->fetched);
+        this->fetchedCapacity = ZUN_MAX(count, 256);
+        this->fetched = (SoftwareVertex *)ZunAlloc(this->fetchedCapacity * sizeof(SoftwareVertex), "software d3d");
+    }
+    this->fetchedCount = count;
+
+    if ((fvf & D3DFVF_POSITION_MASK) != D3DFVF_XYZRHW)
+    {
+        lhs = &this->transforms[D3DTS_WORLD];
+        rhs = &this->transforms[D3DTS_VIEW];
+        for (row = 0; row < 4; row++)
+        {
+            for (col = 0; col < 4; col++)
+            {
+                worldView.m[row][col] = lhs->m[row][0] * rhs->m[0][col] + lhs->m[row][1] * rhs->m[1][col] +
+                                        lhs->m[row][2] * rhs->m[2][col] + lhs->m[row][3] * rhs->m[3][col];
+            }
+        }
+        rhs = &this->transforms[D3DTS_PROJECTION];
+        for (row = 0; row < 4; row++)
+        {
+            for (col = 0; col < 4; col++)
+            {
+                transform.m[row][col] = worldView.m[row][0] * rhs->m[0][col] + worldView.m[row][1] * rhs->m[1][col] +
+                                        worldView.m[row][2] * rhs->m[2][col] + worldView.m[row][3] * rhs->m[3][col];
+            }
+        }
+    }
+
+    for (vertex = this->fetched, idx = 0; idx < count; idx++, vertex++, src += stride)
+    {
+        position = (CONST f32 *)src;
+        if ((fvf & D3DFVF_POSITION_MASK) == D3DFVF_XYZRHW)
+        {
+            vertex->x = position[0];
+            vertex->y = position[1];
+            vertex->z = position[2];
+            vertex->rhw = position[3];
+            eyeDepth = vertex->rhw != 0.0f ? 1.0f / vertex->rhw : 0.0f;
+            offset = 16;
+        }
+        else
+        {
+            // Clip space for now, with w parked in rhw until ProjectVertex.
+            vertex->x = position[0] * transform.m[0][0] + position[1] * transform.m[1][0] +
+                        position[2] * transform.m[2][0] + transform.m[3][0];
+            vertex->y = position[0] * transform.m[0][1] + position[1] * transform.m[1][1] +
+                        position[2] * transform.m[2][1] + transform.m[3][1];
+            vertex->z = position[0] * transform.m[0][2] + position[1] * transform.m[1][2] +
+                        position[2] * transform.m[2][2] + transform.m[3][2];
+            vertex->rhw = position[0] * transform.m[0][3] + position[1] * transform.m[1][3] +
+                          position[2] * transform.m[2][3] + transform.m[3][3];
+            eyeDepth = position[0] * worldView.m[0][2] + position[1] * worldView.m[1][2] +
+                       position[2] * worldView.m[2][2] + worldView.m[3][2];
+            offset = 12;
+        }
+        if (fvf & D3DFVF_NORMAL)
+        {
+            offset += 12;
+        }
+        diffuse = 0xffffffff;
+        if (fvf & D3DFVF_DIFFUSE)
+        {
+            diffuse = *(CONST D3DCOLOR *)(src + offset);
+            offset += 4;
+        }
+        if (fvf & D3DFVF_SPECULAR)
+        {
+            offset += 4;
+        }
+        vertex->u = 0.0f;
+        vertex->v = 0.0f;
+        if ((fvf & D3DFVF_TEXCOUNT_MASK) != 0)
+        {
+            vertex->u = ((CONST f32 *)(src + offset))[0];
+            vertex->v = ((CONST f32 *)(src + offset))[1];
+        }
+        vertex->color[0] = (f32)(diffuse & 0xff);
+        vertex->color[1] = (f32)((diffuse >> 8) & 0xff);
+        vertex->color[2] = (f32)((diffuse >> 16) & 0xff);
+        vertex->color[3] = (f32)(diffuse >> 24);
+        vertex->fog = 1.0f;
+        if (linearFog)
+        {
+            if (fogEnd != fogStart)
+            {
+                vertex->fog = (fogEnd - eyeDepth) / (fogEnd - fogStart);
+            }
+            else
+            {
+                vertex->fog = eyeDepth < fogEnd ? 1.0f : 0.0f;
+            }
+        }
+    }
+}
+
+void SoftwareD3dDevice::AssembleTriangles(D3DPRIMITIVETYPE primitiveType, UINT primitiveCount, CONST void *indices,
+                                          D3DFORMAT indexFormat)
+{
+    ZunBool pretransformed = (this->vertexShader & D3DFVF_POSITION_MASK) == D3DFVF_XYZRHW;
+    i32 corners[3];
+    i32 idx;
+    i32 corner;
+    UINT primitive;
+
+    for (primitive = 0; primitive < primitiveCount; primitive++)
+    {
+        switch (primitiveType)
+        {
+        case D3DPT_TRIANGLELIST:
+            corners[0] = primitive * 3;
+            corners[1] = primitive * 3 + 1;
+            corners[2] = primitive * 3 + 2;
+            break;
+        case D3DPT_TRIANGLESTRIP:
+            corners[0] = primitive;
+            corners[1] = primitive + 1;
+            corners[2] = primitive + 2;
+            break;
+        case D3DPT_TRIANGLEFAN:
+            corners[0] = 0;
+            corners[1] = primitive + 1;
+            corners[2] = primitive + 2;
+            break;
+        default:
+            // Points and lines are never drawn by the game.
+            return;
+        }
+        for (idx = 0; idx < 3; idx++)
+        {
+            corner = corners[idx];
+            if (indices != NULL)
+            {
+                corner =
+                    indexFormat == D3DFMT_INDEX32 ? ((CONST u32 *)indices)[corner] : ((CONST u16 *)indices)[corner];
+            }
+            if (corner < 0 || corner >= this->fetchedCount)
+            {
+                return;
+            }
+            corners[idx] = corner;
+        }
+        if (pretransformed)
+        {
+            this->QueueTriangle(&this->fetched[corners[0]], &this->fetched[corners[1]], &this->fetched[corners[2]]);
+        }
+        else
+        {
+            this->ClipAndQueueTriangle(&this->fetched[corners[0]], &this->fetched[corners[1]],
+                                       &this->fetched[corners[2]]);
+        }
+    }
+}
+
+// Clips against the near plane, z >= 0 in clip space, which is all that is needed to keep w positive; everything
+// else is left to the rasterizer's bounds.
+void SoftwareD3dDevice::ClipAndQueueTriangle(SoftwareVertex *v0, SoftwareVertex *v1, SoftwareVertex *v2)
+{
+    SoftwareVertex *in[3];
+    SoftwareVertex out[4];
+    i32 outCount;
+    i32 idx;
+    i32 field;
+    SoftwareVertex *cur;
+    SoftwareVertex *next;
+    f32 t;
+
+    in[0] = v0;
+    in[1] = v1;
+    in[2] = v2;
+    outCount = 0;
+    for (idx = 0; idx < 3; idx++)
+    {
+        cur = in[idx];
+        next = in[(idx + 1) % 3];
+        if (cur->z >= 0.0f)
+        {
+            out[outCount++] = *cur;
+        }
+        if ((cur->z >= 0.0f) != (next->z >= 0.0f))
+        {
+            t = cur->z / (cur->z - next->z);
+            for (field = 0; field < (i32)SOFTWARE_VERTEX_FLOATS; field++)
+            {
+                ((f32 *)&out[outCount])[field] =
+                    ((f32 *)cur)[field] + (((f32 *)next)[field] - ((f32 *)cur)[field]) * t;
+            }
+            out[outCount].z = 0.0f;
+            outCount++;
+        }
+    }
+    if (outCount < 3)
+    {
+        return;
+    }
+    for (idx = 0; idx < outCount; idx++)
+    {
+        this->ProjectVertex(&out[idx]);
+    }
+    for (idx = 2; idx < outCount; idx++)
+    {
+        this->QueueTriangle(&out[0], &out[idx - 1], &out[idx]);
+    }
+}
+
+void SoftwareD3dDevice::ProjectVertex(SoftwareVertex *vertex)
+{
+    f32 rhw;
+
+    if (vertex->rhw <= 0.0f)
+    {
+        vertex->rhw = FLT_EPSILON;
+    }
+    rhw = 1.0f / vertex->rhw;
+    vertex->x = this->viewport.X + (1.0f + vertex->x * rhw) * this->viewport.Width * 0.5f;
+    vertex->y = this->viewport.Y + (1.0f - vertex->y * rhw) * this->viewport.Height * 0.5f;
+    vertex->z = this->viewport.MinZ + vertex->z * rhw * (this->viewport.MaxZ - this->viewport.MinZ);
+    vertex->rhw = rhw;
+}
+
+void SoftwareD3dDevice::QueueTriangle(SoftwareVertex *v0, SoftwareVertex *v1, SoftwareVertex *v2)
+{
+    SoftwareRasterCommand *command;
+    SoftwareRasterState *state;
+    f32 minX;
+    f32 minY;
+    f32 maxX;
+    f32 maxY;
+
+    if (this->stateDirty)
+    {
+        this->SnapshotState();
+    }
+    state = &this->states[this->stateCount - 1];
+    minX = ZUN_MIN(v0->x, ZUN_MIN(v1->x, v2->x));
+    minY = ZUN_MIN(v0->y, ZUN_MIN(v1->y, v2->y));
+    maxX = ZUN_MAX(v0->x, ZUN_MAX(v1->x, v2->x));
+    maxY = ZUN_MAX(v0->y, ZUN_MAX(v1->y, v2->y));
+    if (maxX < state->clipLeft || minX >= state->clipRight || maxY < state->clipTop || minY >= state->clipBottom)
+    {
+        return;
+    }
+
+    command = this->AllocCommand();
+    command->type = SoftwareRasterCommand_Triangle;
+    command->stateIdx = this->stateCount - 1;
+    command->left = ZUN_MAX((i32)floorf(minX), state->clipLeft);
+    command->top = ZUN_MAX((i32)floorf(minY), state->clipTop);
+    command->right = ZUN_MIN((i32)ceilf(maxX) + 1, state->clipRight);
+    command->bottom = ZUN_MIN((i32)ceilf(maxY) + 1, state->clipBottom);
+    command->vertices[0] = *v0;
+    command->vertices[1] = *v1;
+    command->vertices[2] = *v2;
+}
+
+void SoftwareD3dDevice::WriteFrame()
+{
+    RecordingD3dSurface *frame = this->backBuffer;
+    u32 *pixels;
+    u8 *out;
+    i32 plane;
+    i32 r;
+    i32 g;
+    i32 b;
+    i32 x;
+    i32 y;
+
+    if (this->frameDump == NULL)
+    {
+        return;
+    }
+    if (this->frameDumpFormat == SoftwareFrameDump_Rgb)
+    {
+        for (y = 0; y < (i32)frame->height; y++)
+        {
+            pixels = (u32 *)(frame->bits + y * frame->pitch);
+            for (out = this->frameDumpRow, x = 0; x < (i32)frame->width; x++, pixels++)
+            {
+                *out++ = (u8)(*pixels >> 16);
+                *out++ = (u8)(*pixels >> 8);
+                *out++ = (u8)*pixels;
+            }
+            fwrite(this->frameDumpRow, 3, frame->width, this->frameDump);
+        }
+        return;
+    }
+
+    fprintf(this->frameDump, "FRAME\n");
+    for (plane = 0; plane < 3; plane++)
+    {
+        for (y = 0; y < (i32)frame->height; y++)
+        {
+            pixels = (u32 *)(frame->bits + y * frame->pitch);
+            for (out = this->frameDumpRow, x = 0; x < (i32)frame->width; x++, pixels++)
+            {
+                r = (*pixels >> 16) & 0xff;
+                g = (*pixels >> 8) & 0xff;
+                b = *pixels & 0xff;
+                switch (plane)
+                {
+                case 0:
+                    *out++ = (u8)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                    break;
+                case 1:
+                    *out++ = (u8)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                    break;
+                default:
+                    *out++ = (u8)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+                    break;
+                }
+            }
+            fwrite(this->frameDumpRow, 1, frame->width, this->frameDump);
+        }
+    }
+}
+
+STDMETHODIMP SoftwareD3dDevice::Present(CONST RECT *pSourceRect, CONST RECT *pDestRect, HWND hDestWindowOverride,
+                                        CONST RGNDATA *pDirtyRegion)
+{
+    this->Flush();
+    this->WriteFrame();
+    return RecordingD3dDevice::Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
+}
+
+STDMETHODIMP SoftwareD3dDevice::CopyRects(IDirect3DSurface8 *pSourceSurface, CONST RECT *pSourceRectsArray,
+                                          UINT cRects, IDirect3DSurface8 *pDestinationSurface,
+                                          CONST POINT *pDestPointsArray)
+{
+    this->Flush();
+    return RecordingD3dDevice::CopyRects(pSourceSurface, pSourceRectsArray, cRects, pDestinationSurface,
+                                         pDestPointsArray);
+}
+
+STDMETHODIMP SoftwareD3dDevice::UpdateTexture(IDirect3DBaseTexture8 *pSourceTexture,
+                                              IDirect3DBaseTexture8 *pDestinationTexture)
+{
+    this->Flush();
+    return RecordingD3dDevice::UpdateTexture(pSourceTexture, pDestinationTexture);
+}
+
+STDMETHODIMP SoftwareD3dDevice::SetRenderTarget(IDirect3DSurface8 *pRenderTarget, IDirect3DSurface8 *pNewZStencil)
+{
+    this->Flush();
+    this->stateDirty = true;
+    return RecordingD3dDevice::SetRenderTarget(pRenderTarget, pNewZStencil);
+}
+
+// Rasterize at the end of the scene, like a GPU would start on it, so a device driven from a render thread does its
+// work there rather than in Present.
+STDMETHODIMP SoftwareD3dDevice::EndScene()
+{
+    RecordingD3dDevice::EndScene();
+    this->Flush();
+    return D3D_OK;
+}
+
+STDMETHODIMP SoftwareD3dDevice::Clear(DWORD Count, CONST D3DRECT *pRects, DWORD Flags, D3DCOLOR Color, float Z,
+                                      DWORD Stencil)
+{
+    SoftwareRasterCommand *command;
+    i32 viewportRight = ZUN_MIN((i32)(this->viewport.X + this->viewport.Width), (i32)this->renderTarget->width);
+    i32 viewportBottom = ZUN_MIN((i32)(this->viewport.Y + this->viewport.Height), (i32)this->renderTarget->height);
+    DWORD idx;
+
+    RecordingD3dDevice::Clear(Count, pRects, Flags, Color, Z, Stencil);
+    for (idx = 0; idx < (Count != 0 ? Count : 1); idx++)
+    {
+        command = this->AllocCommand();
+        command->type = SoftwareRasterCommand_Clear;
+        command->stateIdx = 0;
+        command->left = (i32)this->viewport.X;
+        command->top = (i32)this->viewport.Y;
+        command->right = viewportRight;
+        command->bottom = viewportBottom;
+        if (Count != 0)
+        {
+            command->left = ZUN_MAX(command->left, pRects[idx].x1);
+            command->top = ZUN_MAX(command->top, pRects[idx].y1);
+            command->right = ZUN_MIN(command->right, pRects[idx].x2);
+            command->bottom = ZUN_MIN(command->bottom, pRects[idx].y2);
+        }
+        command->clearFlags = Flags;
+        command->clearColor = Color;
+        command->clearZ = Z;
+    }
+    return D3D_OK;
+}
+
+STDMETHODIMP SoftwareD3dDevice::SetViewport(CONST D3DVIEWPORT8 *pViewport)
+{
+    this->stateDirty = true;
+    return RecordingD3dDevice::SetViewport(pViewport);
+}
+
+STDMETHODIMP SoftwareD3dDevice::SetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
+{
+    this->stateDirty = true;
+    return RecordingD3dDevice::SetRenderState(State, Value);
+}
+
+STDMETHODIMP SoftwareD3dDevice::SetTexture(DWORD Stage, IDirect3DBaseTexture8 *pTexture)
+{
+    this->stateDirty = true;
+    return RecordingD3dDevice::SetTexture(Stage, pTexture);
+}
+
+STDMETHODIMP SoftwareD3dDevice::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+{
+    this->stateDirty = true;
+    return RecordingD3dDevice::SetTextureStageState(Stage, Type, Value);
+}
+
+STDMETHODIMP SoftwareD3dDevice::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount)
+{
+    RecordingD3dVertexBuffer *vertexBuffer = (RecordingD3dVertexBuffer *)this->streamSource;
+    i32 vertexCount;
+
+    RecordingD3dDevice::DrawPrimitive(PrimitiveType, StartVertex, PrimitiveCount);
+    if (vertexBuffer == NULL)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    vertexCount = PrimitiveType == D3DPT_TRIANGLELIST ? PrimitiveCount * 3 : PrimitiveCount + 2;
+    if ((StartVertex + vertexCount) * this->streamStride > vertexBuffer->desc.Size)
+    {
+        return D3DERR_INVALIDCALL;
+    }
+    this->FetchVertices(vertexBuffer->data + StartVertex * this->streamStride, this->streamStride, vertexCount);
+    this->AssembleTriangles(PrimitiveType, PrimitiveCount, NULL, D3DFMT_INDEX16);
+    return D3D_OK;
+}
+
+STDMETHODIMP SoftwareD3dDevice::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount,
+                                                CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+    RecordingD3dDevice::DrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
+    this->FetchVertices((CONST u8 *)pVertexStreamZeroData, VertexStreamZeroStride,
+                        PrimitiveType == D3DPT_TRIANGLELIST ? PrimitiveCount * 3 : PrimitiveCount + 2);
+    this->AssembleTriangles(PrimitiveType, PrimitiveCount, NULL, D3DFMT_INDEX16);
+    return D3D_OK;
+}
+
+STDMETHODIMP SoftwareD3dDevice::DrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex,
+                                                       UINT NumVertexIndices, UINT PrimitiveCount,
+                                                       CONST void *pIndexData, D3DFORMAT IndexDataFormat,
+                                                       CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+    RecordingD3dDevice::DrawIndexedPrimitiveUP(PrimitiveType, MinVertexIndex, NumVertexIndices, PrimitiveCount,
+                                               pIndexData, IndexDataFormat, pVertexStreamZeroData,
+                                               VertexStreamZeroStride);
+    // Indices are relative to the start of the buffer, so fetch from vertex 0 up to the highest one used.
+    this->FetchVertices((CONST u8 *)pVertexStreamZeroData, VertexStreamZeroStride, MinVertexIndex + NumVertexIndices);
+    this->AssembleTriangles(PrimitiveType, PrimitiveCount, pIndexData, IndexDataFormat);
+    return D3D_OK;
+}
+}; // namespace th06
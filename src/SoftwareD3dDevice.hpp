@@ -0,0 +1,187 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "RecordingD3dDevice.hpp"
+#include "ZunBool.hpp"
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
+// SOFTWARE_RENDERER adds the -swrender switch, which has WinMain swap the Direct3D device for a SoftwareD3dDevice.
+// WinMain no longer matches the original binary with it.
+#if defined(SOFTWARE_RENDERER) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "SOFTWARE_RENDERER changes WinMain"
+#endif
+
+namespace th06
+{
+#define SOFTWARE_D3D_TILE_SIZE 64
+#define SOFTWARE_D3D_MAX_WORKERS 8
+
+enum SoftwareFrameDumpFormat
+{
+    // Packed 24 bit RGB, frames back to back.
+    SoftwareFrameDump_Rgb,
+    // YUV4MPEG2, 4:4:4, BT.601 limited range. Any video tool reads it.
+    SoftwareFrameDump_Y4m,
+};
+
+// A vertex after transform: screen position, 1/w, and the attributes the rasterizer interpolates.
+struct SoftwareVertex
+{
+    f32 x;
+    f32 y;
+    f32 z;
+    f32 rhw;
+    f32 u;
+    f32 v;
+    // 0 to 255, in B G R A order like a D3DCOLOR in memory.
+    f32 color[4];
+    // 1 for no fog, 0 for the full fog color.
+    f32 fog;
+};
+
+// Everything about the pipeline one triangle needs; snapshotted whenever the game changes state between draws.
+struct SoftwareRasterState
+{
+    RecordingD3dSurface *texture;
+    D3DCOLOR textureFactor;
+    D3DCOLOR fogColor;
+    u8 colorOp;
+    u8 colorArg1;
+    u8 colorArg2;
+    u8 alphaOp;
+    u8 alphaArg1;
+    u8 alphaArg2;
+    u8 linearFilter;
+    u8 flatShade;
+    u8 blendEnable;
+    u8 srcBlend;
+    u8 destBlend;
+    u8 alphaTestEnable;
+    u8 alphaFunc;
+    u8 alphaRef;
+    u8 zEnable;
+    u8 zWriteEnable;
+    u8 zFunc;
+    u8 fogEnable;
+    i32 clipLeft;
+    i32 clipTop;
+    i32 clipRight;
+    i32 clipBottom;
+};
+
+enum SoftwareRasterCommandType
+{
+    SoftwareRasterCommand_Clear,
+    SoftwareRasterCommand_Triangle,
+};
+
+struct SoftwareRasterCommand
+{
+    i32 type;
+    i32 stateIdx;
+    // Screen bounds, exclusive on the right and bottom; the clear rectangle for clears.
+    i32 left;
+    i32 top;
+    i32 right;
+    i32 bottom;
+    DWORD clearFlags;
+    D3DCOLOR clearColor;
+    f32 clearZ;
+    SoftwareVertex vertices[3];
+};
+
+struct SoftwareD3dDevice;
+
+struct SoftwareRasterWorker
+{
+    SoftwareD3dDevice *device;
+    HANDLE thread;
+    HANDLE startEvent;
+};
+
+// Renders what the game draws on the CPU. Draws are transformed and clipped as they come in and queued; the queue is
+// rasterized when the frame is presented or read back, with the render target split into tiles that a pool of
+// worker threads claims one at a time, so each thread owns its pixels and no locking is needed.
+//
+// Only what the game uses is covered: pretransformed and fixed function XYZ vertices with diffuse and one texture,
+// stage 0 color and alpha ops, alpha test, alpha blending, depth test and linear table fog.
+struct SoftwareD3dDevice : public RecordingD3dDevice
+{
+    // threadCount 0 uses one thread per processor.
+    SoftwareD3dDevice(UINT backBufferWidth, UINT backBufferHeight, i32 threadCount);
+    virtual ~SoftwareD3dDevice();
+
+    ZunResult OpenFrameDump(const char *path, SoftwareFrameDumpFormat format);
+    void Flush();
+
+    STDMETHOD(Present)(CONST RECT *pSourceRect, CONST RECT *pDestRect, HWND hDestWindowOverride,
+                       CONST RGNDATA *pDirtyRegion);
+    STDMETHOD(CopyRects)(IDirect3DSurface8 *pSourceSurface, CONST RECT *pSourceRectsArray, UINT cRects,
+                         IDirect3DSurface8 *pDestinationSurface, CONST POINT *pDestPointsArray);
+    STDMETHOD(UpdateTexture)(IDirect3DBaseTexture8 *pSourceTexture, IDirect3DBaseTexture8 *pDestinationTexture);
+    STDMETHOD(SetRenderTarget)(IDirect3DSurface8 *pRenderTarget, IDirect3DSurface8 *pNewZStencil);
+    STDMETHOD(EndScene)();
+    STDMETHOD(Clear)(DWORD Count, CONST D3DRECT *pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil);
+    STDMETHOD(SetViewport)(CONST D3DVIEWPORT8 *pViewport);
+    STDMETHOD(SetRenderState)(D3DRENDERSTATETYPE State, DWORD Value);
+    STDMETHOD(SetTexture)(DWORD Stage, IDirect3DBaseTexture8 *pTexture);
+    STDMETHOD(SetTextureStageState)(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value);
+    STDMETHOD(DrawPrimitive)(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount);
+    STDMETHOD(DrawPrimitiveUP)(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void *pVertexStreamZeroData,
+                               UINT VertexStreamZeroStride);
+    STDMETHOD(DrawIndexedPrimitiveUP)(D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex, UINT NumVertexIndices,
+                                      UINT PrimitiveCount, CONST void *pIndexData, D3DFORMAT IndexDataFormat,
+                                      CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride);
+
+    static DWORD __stdcall WorkerThread(LPVOID lpThreadParameter);
+
+    void FetchVertices(CONST u8 *src, UINT stride, i32 count);
+    void AssembleTriangles(D3DPRIMITIVETYPE primitiveType, UINT primitiveCount, CONST void *indices,
+                           D3DFORMAT indexFormat);
+    void ClipAndQueueTriangle(SoftwareVertex *v0, SoftwareVertex *v1, SoftwareVertex *v2);
+    void ProjectVertex(SoftwareVertex *vertex);
+    void QueueTriangle(SoftwareVertex *v0, SoftwareVertex *v1, SoftwareVertex *v2);
+    SoftwareRasterCommand *AllocCommand();
+    void SnapshotState();
+    void RasterizeTiles();
+    void RasterizeTile(i32 tileIdx);
+    void ClearTile(SoftwareRasterCommand *command, i32 left, i32 top, i32 right, i32 bottom);
+    void RasterizeTriangle(SoftwareRasterCommand *command, i32 left, i32 top, i32 right, i32 bottom);
+    void WriteFrame();
+
+    SoftwareRasterWorker workers[SOFTWARE_D3D_MAX_WORKERS];
+    i32 workerCount;
+    HANDLE doneEvent;
+    volatile LONG nextTile;
+    volatile LONG busyWorkers;
+    ZunBool quitting;
+    u32 fpuControl;
+    ZunBool useSse2;
+
+    SoftwareRasterCommand *commands;
+    i32 commandCount;
+    i32 commandCapacity;
+    SoftwareRasterState *states;
+    i32 stateCount;
+    i32 stateCapacity;
+    ZunBool stateDirty;
+    SoftwareVertex *fetched;
+    i32 fetchedCount;
+    i32 fetchedCapacity;
+
+    // Sized to the back buffer; depth testing is off while rendering to any other target.
+    f32 *depthBuffer;
+    ZunBool depthActive;
+    i32 tilesX;
+    i32 tilesY;
+
+    FILE *frameDump;
+    SoftwareFrameDumpFormat frameDumpFormat;
+    u8 *frameDumpRow;
+};
+
+// The device -swrender draws with, NULL otherwise.
+extern SoftwareD3dDevice *g_SoftwareD3dDevice;
+}; // namespace th06
@@ -0,0 +1,631 @@
+#include "SoundMixer.hpp"
+#include "SoundPlayer.hpp"
+#include "ZunMemory.hpp"
+#include "utils.hpp"
+
+#include <emmintrin.h>
+#include <math.h>
+#include <string.h>
+
+namespace th06
+{
+SoundMixer g_SoundMixer;
+SoundMixerNullSink g_SoundMixerNullSink;
+SoundMixerWavSink g_SoundMixerWavSink;
+SoundMixerDSoundSink g_SoundMixerDSoundSink;
+
+#define SOUND_MIXER_WAV_HEADER_BYTES 44
+
+// Adds src scaled by gain into dst, saturating. Both paths round the product the same way, towards negative
+// infinity, so they agree on every sample.
+static void MixInto(i16 *dst, i16 *src, i32 count, i16 gain, ZunBool useSse2)
+{
+    __m128i gainVec;
+    __m128i low;
+    __m128i high;
+    __m128i scaled;
+    i32 idx;
+    i32 value;
+
+    idx = 0;
+    if (useSse2)
+    {
+        gainVec = _mm_set1_epi16(gain);
+        for (; idx + 8 <= count; idx += 8)
+        {
+            scaled = _mm_loadu_si128((__m128i *)(src + idx));
+            if (gain != SOUND_MIXER_UNITY_GAIN)
+            {
+                low = _mm_mullo_epi16(scaled, gainVec);
+                high = _mm_mulhi_epi16(scaled, gainVec);
+                scaled = _mm_packs_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(low, high), 15),
+                                         _mm_srai_epi32(_mm_unpackhi_epi16(low, high), 15));
+            }
+            _mm_storeu_si128((__m128i *)(dst + idx),
+                             _mm_adds_epi16(_mm_loadu_si128((__m128i *)(dst + idx)), scaled));
+        }
+    }
+    for (; idx < count; idx++)
+    {
+        value = src[idx];
+        if (gain != SOUND_MIXER_UNITY_GAIN)
+        {
+            value = (value * gain) >> 15;
+        }
+        value += dst[idx];
+        if (value > 0x7fff)
+        {
+            value = 0x7fff;
+        }
+        else if (value < -0x8000)
+        {
+            value = -0x8000;
+        }
+        dst[idx] = value;
+    }
+}
+
+ZunBool SoundMixerNullSink::IsRealtime()
+{
+    return false;
+}
+
+i32 SoundMixerNullSink::GetFreeBlocks()
+{
+    return 1;
+}
+
+ZunResult SoundMixerNullSink::WriteBlock(i16 *samples)
+{
+    this->blocksWritten++;
+    return ZUN_SUCCESS;
+}
+
+void SoundMixerNullSink::Close()
+{
+}
+
+SoundMixerWavSink::SoundMixerWavSink()
+{
+    this->file = NULL;
+    this->dataBytes = 0;
+}
+
+static void WriteWavHeader(FILE *file, u32 dataBytes)
+{
+    u32 fields[11];
+
+    fields[0] = mmioFOURCC('R', 'I', 'F', 'F');
+    fields[1] = SOUND_MIXER_WAV_HEADER_BYTES - 8 + dataBytes;
+    fields[2] = mmioFOURCC('W', 'A', 'V', 'E');
+    fields[3] = mmioFOURCC('f', 'm', 't', ' ');
+    fields[4] = 16;
+    fields[5] = WAVE_FORMAT_PCM | (SOUND_MIXER_CHANNELS << 16);
+    fields[6] = SOUND_MIXER_SAMPLE_RATE;
+    fields[7] = SOUND_MIXER_SAMPLE_RATE * SOUND_MIXER_CHANNELS * 2;
+    fields[8] = SOUND_MIXER_CHANNELS * 2 | (16 << 16);
+    fields[9] = mmioFOURCC('d', 'a', 't', 'a');
+    fields[10] = dataBytes;
+    fseek(file, 0, SEEK_SET);
+    fwrite(fields, sizeof(fields), 1, file);
+}
+
+ZunResult SoundMixerWavSink::Open(const char *path)
+{
+    this->Close();
+    this->file = fopen(path, "wb");
+    if (this->file == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    this->dataBytes = 0;
+    WriteWavHeader(this->file, 0);
+    return ZUN_SUCCESS;
+}
+
+ZunBool SoundMixerWavSink::IsRealtime()
+{
+    return false;
+}
+
+i32 SoundMixerWavSink::GetFreeBlocks()
+{
+    return 1;
+}
+
+ZunResult SoundMixerWavSink::WriteBlock(i16 *samples)
+{
+    if (this->file == NULL || fwrite(samples, SOUND_MIXER_BLOCK_BYTES, 1, this->file) != 1)
+    {
+        return ZUN_ERROR;
+    }
+    this->dataBytes += SOUND_MIXER_BLOCK_BYTES;
+    return ZUN_SUCCESS;
+}
+
+void SoundMixerWavSink::Close()
+{
+    if (this->file != NULL)
+    {
+        WriteWavHeader(this->file, this->dataBytes);
+        fclose(this->file);
+        this->file = NULL;
+    }
+}
+
+SoundMixerDSoundSink::SoundMixerDSoundSink()
+{
+    this->buffer = NULL;
+    this->underruns = 0;
+}
+
+ZunResult SoundMixerDSoundSink::Open(LPDIRECTSOUND dsound)
+{
+    DSBUFFERDESC bufDesc;
+    WAVEFORMATEX wavFormat;
+    LPVOID audioBuffer1Start;
+    DWORD audioBuffer1Len;
+    LPVOID audioBuffer2Start;
+    DWORD audioBuffer2Len;
+
+    this->Close();
+    memset(&wavFormat, 0, sizeof(wavFormat));
+    wavFormat.wFormatTag = WAVE_FORMAT_PCM;
+    wavFormat.nChannels = SOUND_MIXER_CHANNELS;
+    wavFormat.nSamplesPerSec = SOUND_MIXER_SAMPLE_RATE;
+    wavFormat.nBlockAlign = SOUND_MIXER_CHANNELS * 2;
+    wavFormat.nAvgBytesPerSec = SOUND_MIXER_SAMPLE_RATE * wavFormat.nBlockAlign;
+    wavFormat.wBitsPerSample = 16;
+    memset(&bufDesc, 0, sizeof(bufDesc));
+    bufDesc.dwSize = sizeof(bufDesc);
+    bufDesc.dwFlags = DSBCAPS_GETCURRENTPOSITION2 | DSBCAPS_GLOBALFOCUS | DSBCAPS_LOCSOFTWARE;
+    bufDesc.dwBufferBytes = SOUND_MIXER_DSOUND_BLOCKS * SOUND_MIXER_BLOCK_BYTES;
+    bufDesc.lpwfxFormat = &wavFormat;
+    if (FAILED(dsound->CreateSoundBuffer(&bufDesc, &this->buffer, NULL)))
+    {
+        this->buffer = NULL;
+        return ZUN_ERROR;
+    }
+    if (FAILED(this->buffer->Lock(0, bufDesc.dwBufferBytes, &audioBuffer1Start, &audioBuffer1Len, &audioBuffer2Start,
+                                  &audioBuffer2Len, 0)))
+    {
+        this->Close();
+        return ZUN_ERROR;
+    }
+    memset(audioBuffer1Start, 0, audioBuffer1Len);
+    this->buffer->Unlock(audioBuffer1Start, audioBuffer1Len, audioBuffer2Start, audioBuffer2Len);
+
+    // The cursor starts in block 0, which stays silent; everything after it is free.
+    this->writeBlock = 1;
+    this->lastPlayBlock = 0;
+    this->queuedBlocks = 0;
+    this->underruns = 0;
+    if (FAILED(this->buffer->Play(0, 0, DSBPLAY_LOOPING)))
+    {
+        this->Close();
+        return ZUN_ERROR;
+    }
+    return ZUN_SUCCESS;
+}
+
+ZunBool SoundMixerDSoundSink::IsRealtime()
+{
+    return true;
+}
+
+i32 SoundMixerDSoundSink::GetFreeBlocks()
+{
+    DWORD playCursor;
+    i32 playBlock;
+
+    if (this->buffer == NULL || FAILED(this->buffer->GetCurrentPosition(&playCursor, NULL)))
+    {
+        return 0;
+    }
+    playBlock = playCursor / SOUND_MIXER_BLOCK_BYTES;
+    this->queuedBlocks -= (playBlock - this->lastPlayBlock + SOUND_MIXER_DSOUND_BLOCKS) % SOUND_MIXER_DSOUND_BLOCKS;
+    this->lastPlayBlock = playBlock;
+    if (this->queuedBlocks < 0)
+    {
+        // The cursor is playing blocks we never wrote. Pick up just after it rather than behind it.
+        this->underruns++;
+        this->queuedBlocks = 0;
+        this->writeBlock = (playBlock + 1) % SOUND_MIXER_DSOUND_BLOCKS;
+    }
+    return SOUND_MIXER_DSOUND_BLOCKS - 1 - this->queuedBlocks;
+}
+
+ZunResult SoundMixerDSoundSink::WriteBlock(i16 *samples)
+{
+    LPVOID audioBuffer1Start;
+    DWORD audioBuffer1Len;
+    LPVOID audioBuffer2Start;
+    DWORD audioBuffer2Len;
+
+    if (FAILED(this->buffer->Lock(this->writeBlock * SOUND_MIXER_BLOCK_BYTES, SOUND_MIXER_BLOCK_BYTES,
+                                  &audioBuffer1Start, &audioBuffer1Len, &audioBuffer2Start, &audioBuffer2Len, 0)))
+    {
+        return ZUN_ERROR;
+    }
+    memcpy(audioBuffer1Start, samples, audioBuffer1Len);
+    this->buffer->Unlock(audioBuffer1Start, audioBuffer1Len, audioBuffer2Start, audioBuffer2Len);
+    this->writeBlock = (this->writeBlock + 1) % SOUND_MIXER_DSOUND_BLOCKS;
+    this->queuedBlocks++;
+    return ZUN_SUCCESS;
+}
+
+void SoundMixerDSoundSink::Close()
+{
+    if (this->buffer != NULL)
+    {
+        this->buffer->Stop();
+        this->buffer->Release();
+        this->buffer = NULL;
+    }
+}
+
+SoundMixer::SoundMixer()
+{
+    memset(this, 0, sizeof(SoundMixer));
+    this->streamGain = SOUND_MIXER_UNITY_GAIN;
+    InitializeCriticalSection(&this->lock);
+}
+
+ZunResult SoundMixer::Start(SoundMixerSink *sink)
+{
+    LARGE_INTEGER frequency;
+
+    this->Stop();
+    QueryPerformanceFrequency(&frequency);
+    this->ticksPerSecond = frequency.QuadPart;
+    this->useSse2 = (utils::GetCpuFeatures() & CPU_FEATURE_SSE2) != 0;
+    this->sink = sink;
+    this->queuedSounds = 0;
+    this->pendingFrames = 0;
+    this->blocksMixed = 0;
+    this->mixTicks = 0;
+    memset(this->voices, 0, sizeof(this->voices));
+    this->SetStream(NULL, NULL);
+    this->isEnabled = true;
+    if (sink->IsRealtime())
+    {
+        this->stopEvent = CreateEventA(NULL, 0, 0, NULL);
+        this->thread = CreateThread(NULL, 0, SoundMixer::MixerThread, this, 0, NULL);
+        if (this->thread == NULL)
+        {
+            CloseHandle(this->stopEvent);
+            this->stopEvent = NULL;
+            this->sink = NULL;
+            this->isEnabled = false;
+            return ZUN_ERROR;
+        }
+    }
+    return ZUN_SUCCESS;
+}
+
+void SoundMixer::Stop()
+{
+    if (!this->isEnabled)
+    {
+        return;
+    }
+    if (this->thread != NULL)
+    {
+        SetEvent(this->stopEvent);
+        WaitForSingleObject(this->thread, INFINITE);
+        CloseHandle(this->thread);
+        CloseHandle(this->stopEvent);
+        this->thread = NULL;
+        this->stopEvent = NULL;
+    }
+    this->sink->Close();
+    this->sink = NULL;
+    this->isEnabled = false;
+    this->SetStream(NULL, NULL);
+    this->ReleaseSamples();
+}
+
+DWORD __stdcall SoundMixer::MixerThread(LPVOID arg)
+{
+    SoundMixer *mixer;
+
+    mixer = (SoundMixer *)arg;
+    while (WaitForSingleObject(mixer->stopEvent, SOUND_MIXER_THREAD_INTERVAL_MS) == WAIT_TIMEOUT)
+    {
+        mixer->Pump();
+    }
+    return 0;
+}
+
+// Channel channel of frame frame, as a 16 bit sample.
+static i32 ReadPcm(WAVEFORMATEX *format, u8 *data, i32 frame, i32 channel)
+{
+    i32 idx;
+
+    idx = frame * format->nChannels + (format->nChannels > 1 ? channel : 0);
+    if (format->wBitsPerSample == 8)
+    {
+        return (data[idx] - 128) << 8;
+    }
+    return ((i16 *)data)[idx];
+}
+
+static void ReleaseSample(SoundMixerSample *sample)
+{
+    if (sample->asset != NULL)
+    {
+        g_PcmAssetCache.Release(sample->asset);
+    }
+    else
+    {
+        ZunFree(sample->frames);
+    }
+    sample->frames = NULL;
+    sample->frameCount = 0;
+    sample->asset = NULL;
+}
+
+ZunResult SoundMixer::LoadSample(i32 idx, WAVEFORMATEX *format, u8 *data, u32 dataSize)
+{
+    SoundMixerSample *sample;
+    i32 srcFrames;
+    i32 frame;
+    i32 channel;
+    LONGLONG position;
+    i32 srcFrame;
+    i32 frac;
+    i32 left;
+    i32 right;
+
+    if (idx < 0 || idx >= SOUND_MIXER_MAX_SAMPLES || format->wFormatTag != WAVE_FORMAT_PCM ||
+        (format->wBitsPerSample != 8 && format->wBitsPerSample != 16) || format->nChannels < 1 ||
+        format->nChannels > 2 || format->nSamplesPerSec == 0)
+    {
+        return ZUN_ERROR;
+    }
+    srcFrames = dataSize / (format->nChannels * (format->wBitsPerSample / 8));
+
+    EnterCriticalSection(&this->lock);
+    sample = &this->samples[idx];
+    ReleaseSample(sample);
+    sample->frameCount = (LONGLONG)srcFrames * SOUND_MIXER_SAMPLE_RATE / format->nSamplesPerSec;
+    sample->frames = (i16 *)ZunAlloc(sample->frameCount * SOUND_MIXER_CHANNELS * sizeof(i16), "mixer");
+    if (sample->frames == NULL)
+    {
+        sample->frameCount = 0;
+        LeaveCriticalSection(&this->lock);
+        return ZUN_ERROR;
+    }
+
+    // Linear interpolation, in 16.16 fixed point. At SOUND_MIXER_SAMPLE_RATE the fraction is always 0 and the
+    // samples come through unchanged.
+    for (frame = 0; frame < sample->frameCount; frame++)
+    {
+        position = ((LONGLONG)frame * format->nSamplesPerSec << 16) / SOUND_MIXER_SAMPLE_RATE;
+        srcFrame = (i32)(position >> 16);
+        frac = (i32)(position & 0xffff);
+        for (channel = 0; channel < SOUND_MIXER_CHANNELS; channel++)
+        {
+            left = ReadPcm(format, data, srcFrame, channel);
+            right = srcFrame + 1 < srcFrames ? ReadPcm(format, data, srcFrame + 1, channel) : left;
+            sample->frames[frame * SOUND_MIXER_CHANNELS + channel] = left + ((right - left) * frac >> 16);
+        }
+    }
+    LeaveCriticalSection(&this->lock);
+    return ZUN_SUCCESS;
+}
+
+ZunResult SoundMixer::LoadSample(i32 idx, PcmAsset *asset)
+{
+    SoundMixerSample *sample;
+
+    if (asset->format.wFormatTag != WAVE_FORMAT_PCM || asset->format.wBitsPerSample != 16 ||
+        asset->format.nChannels != SOUND_MIXER_CHANNELS || asset->format.nSamplesPerSec != SOUND_MIXER_SAMPLE_RATE ||
+        ((UINT_PTR)asset->pcm & 1) != 0)
+    {
+        return this->LoadSample(idx, &asset->format, asset->pcm, asset->pcmSize);
+    }
+    if (idx < 0 || idx >= SOUND_MIXER_MAX_SAMPLES)
+    {
+        return ZUN_ERROR;
+    }
+
+    g_PcmAssetCache.AddRef(asset);
+    EnterCriticalSection(&this->lock);
+    sample = &this->samples[idx];
+    ReleaseSample(sample);
+    sample->frames = (i16 *)asset->pcm;
+    sample->frameCount = asset->pcmSize / (SOUND_MIXER_CHANNELS * sizeof(i16));
+    sample->asset = asset;
+    LeaveCriticalSection(&this->lock);
+    return ZUN_SUCCESS;
+}
+
+void SoundMixer::ReleaseSamples()
+{
+    i32 idx;
+
+    EnterCriticalSection(&this->lock);
+    for (idx = 0; idx < SOUND_MIXER_MAX_VOICES; idx++)
+    {
+        this->voices[idx].isPlaying = false;
+    }
+    for (idx = 0; idx < SOUND_MIXER_MAX_SAMPLES; idx++)
+    {
+        ReleaseSample(&this->samples[idx]);
+    }
+    LeaveCriticalSection(&this->lock);
+}
+
+i16 SoundMixer::VolumeToGain(i32 volume)
+{
+    if (volume >= 0)
+    {
+        return SOUND_MIXER_UNITY_GAIN;
+    }
+    return (i16)(SOUND_MIXER_UNITY_GAIN * powf(10.0f, volume / 2000.0f) + 0.5f);
+}
+
+void SoundMixer::Play(i32 voice, i32 sample, i16 gain)
+{
+    SoundMixerVoice *playing;
+
+    if (voice < 0 || voice >= SOUND_MIXER_MAX_VOICES || sample < 0 || sample >= SOUND_MIXER_MAX_SAMPLES ||
+        this->samples[sample].frames == NULL)
+    {
+        return;
+    }
+    playing = &this->voices[voice];
+    playing->sample = sample;
+    playing->position = 0;
+    playing->gain = gain;
+    playing->isPlaying = true;
+}
+
+void SoundMixer::Queue(i32 soundIdx)
+{
+    if (soundIdx >= 0 && soundIdx < SOUND_MIXER_MAX_VOICES)
+    {
+        this->queuedSounds |= 1 << soundIdx;
+    }
+}
+
+void SoundMixer::PlayQueued()
+{
+    i32 idx;
+
+    if (this->queuedSounds == 0)
+    {
+        return;
+    }
+    EnterCriticalSection(&this->lock);
+    for (idx = 0; idx < SOUND_MIXER_MAX_VOICES; idx++)
+    {
+        if (this->queuedSounds & (1 << idx))
+        {
+            this->Play(idx, g_SoundBufferIdxVol[idx].bufferIdx, VolumeToGain(g_SoundBufferIdxVol[idx].volume));
+        }
+    }
+    this->queuedSounds = 0;
+    LeaveCriticalSection(&this->lock);
+}
+
+void SoundMixer::SetStream(SoundMixerStreamCallback callback, void *arg)
+{
+    EnterCriticalSection(&this->lock);
+    this->streamCallback = callback;
+    this->streamArg = arg;
+    this->streamGain = SOUND_MIXER_UNITY_GAIN;
+    this->streamFadeProgress = 0;
+    this->streamFadeTotal = 0;
+    LeaveCriticalSection(&this->lock);
+}
+
+void SoundMixer::FadeOutStream(i32 frames)
+{
+    this->streamFadeProgress = frames;
+    this->streamFadeTotal = frames;
+}
+
+// Once per game frame, the curve CStreamingSound::UpdateFadeOut follows: linear in decibels down to -50dB, then off.
+void SoundMixer::UpdateFadeOut()
+{
+    if (this->streamFadeTotal <= 0)
+    {
+        return;
+    }
+    this->streamFadeProgress--;
+    if (this->streamFadeProgress <= 0)
+    {
+        this->SetStream(NULL, NULL);
+        return;
+    }
+    this->streamGain = VolumeToGain(this->streamFadeProgress * 5000 / this->streamFadeTotal - 5000);
+}
+
+void SoundMixer::AdvanceFrame()
+{
+    if (!this->isEnabled || this->sink->IsRealtime())
+    {
+        return;
+    }
+    EnterCriticalSection(&this->lock);
+    this->pendingFrames += SOUND_MIXER_FRAMES_PER_GAME_FRAME;
+    while (this->pendingFrames >= SOUND_MIXER_BLOCK_FRAMES)
+    {
+        this->MixBlock(this->block);
+        this->sink->WriteBlock(this->block);
+        this->pendingFrames -= SOUND_MIXER_BLOCK_FRAMES;
+    }
+    LeaveCriticalSection(&this->lock);
+}
+
+void SoundMixer::Pump()
+{
+    EnterCriticalSection(&this->lock);
+    while (this->sink->GetFreeBlocks() > 0)
+    {
+        this->MixBlock(this->block);
+        if (this->sink->WriteBlock(this->block) != ZUN_SUCCESS)
+        {
+            break;
+        }
+    }
+    LeaveCriticalSection(&this->lock);
+}
+
+void SoundMixer::MixBlock(i16 *out)
+{
+    LARGE_INTEGER begin;
+    LARGE_INTEGER end;
+    i32 idx;
+    SoundMixerVoice *voice;
+    i32 count;
+    i32 written;
+
+    QueryPerformanceCounter(&begin);
+    memset(out, 0, SOUND_MIXER_BLOCK_BYTES);
+    if (this->streamCallback != NULL)
+    {
+        written = this->streamCallback(this->streamArg, this->streamBlock, SOUND_MIXER_BLOCK_FRAMES);
+        if (written < SOUND_MIXER_BLOCK_FRAMES)
+        {
+            written = written < 0 ? 0 : written;
+            this->streamCallback = NULL;
+        }
+        MixInto(out, this->streamBlock, written * SOUND_MIXER_CHANNELS, this->streamGain, this->useSse2);
+    }
+    for (idx = 0; idx < SOUND_MIXER_MAX_VOICES; idx++)
+    {
+        voice = &this->voices[idx];
+        if (!voice->isPlaying)
+        {
+            continue;
+        }
+        count = this->samples[voice->sample].frameCount - voice->position;
+        if (count > SOUND_MIXER_BLOCK_FRAMES)
+        {
+            count = SOUND_MIXER_BLOCK_FRAMES;
+        }
+        MixInto(out, this->samples[voice->sample].frames + voice->position * SOUND_MIXER_CHANNELS,
+                count * SOUND_MIXER_CHANNELS, voice->gain, this->useSse2);
+        voice->position += count;
+        if (voice->position >= this->samples[voice->sample].frameCount)
+        {
+            voice->isPlaying = false;
+        }
+    }
+    QueryPerformanceCounter(&end);
+    this->mixTicks += end.QuadPart - begin.QuadPart;
+    this->blocksMixed++;
+}
+
+f32 SoundMixer::GetMixUsPerBlock()
+{
+    if (this->blocksMixed == 0 || this->ticksPerSecond == 0)
+    {
+        return 0.0f;
+    }
+    return (f32)((f64)this->mixTicks * 1000000.0 / this->ticksPerSecond / this->blocksMixed);
+}
+}; // namespace th06
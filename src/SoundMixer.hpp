@@ -0,0 +1,181 @@
+#pragma once
+
+#include <Windows.h>
+#include <dsound.h>
+#include <stdio.h>
+
+#include "PcmAsset.hpp"
+#include "ZunBool.hpp"
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
+// SOUND_MIXER adds the -swmixer, -audiowav and -audionull switches, which have SoundPlayer play everything through
+// g_SoundMixer. WinMain and most of SoundPlayer no longer match the original binary with it.
+#if defined(SOUND_MIXER) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "SOUND_MIXER changes WinMain and SoundPlayer"
+#endif
+
+namespace th06
+{
+#define SOUND_MIXER_SAMPLE_RATE 44100
+#define SOUND_MIXER_CHANNELS 2
+#define SOUND_MIXER_FRAMES_PER_GAME_FRAME (SOUND_MIXER_SAMPLE_RATE / 60)
+// About 12ms. Blocks are what the mixer hands to its sink, and the granularity of voice starts.
+#define SOUND_MIXER_BLOCK_FRAMES 512
+#define SOUND_MIXER_BLOCK_SAMPLES (SOUND_MIXER_BLOCK_FRAMES * SOUND_MIXER_CHANNELS)
+#define SOUND_MIXER_BLOCK_BYTES (SOUND_MIXER_BLOCK_SAMPLES * 2)
+// g_SFXList and g_SoundBufferIdxVol, with room to spare.
+#define SOUND_MIXER_MAX_SAMPLES 32
+#define SOUND_MIXER_MAX_VOICES 32
+// A Q15 gain of 1.0 that leaves samples untouched rather than scaling them by 32767 / 32768.
+#define SOUND_MIXER_UNITY_GAIN 0x7fff
+#define SOUND_MIXER_DSOUND_BLOCKS 6
+#define SOUND_MIXER_THREAD_INTERVAL_MS 4
+
+// A sound as interleaved 16 bit stereo at SOUND_MIXER_SAMPLE_RATE, whatever its file had. A file already in that
+// format is played from the asset's own buffer; anything else is converted at load into one of the mixer's.
+struct SoundMixerSample
+{
+    i16 *frames;
+    i32 frameCount;
+    // Whose buffer frames points into, or NULL if the mixer allocated it.
+    PcmAsset *asset;
+};
+
+// One per SoundIdx, as with the DirectSound duplicate buffers: playing a sound again restarts it.
+struct SoundMixerVoice
+{
+    i32 sample;
+    i32 position;
+    i16 gain;
+    ZunBool isPlaying;
+};
+
+// Writes up to frameCount stereo frames of the background music and returns how many it wrote. Anything short of
+// frameCount ends the stream. Runs with the mixer locked, on whichever thread mixes.
+typedef i32 (*SoundMixerStreamCallback)(void *arg, i16 *frames, i32 frameCount);
+
+// Where mixed blocks go. A realtime sink is fed by the mixer thread as fast as it plays; the others get the audio
+// for each game frame as SoundPlayer::PlaySounds runs, so what they receive doesn't depend on how fast the game
+// runs.
+struct SoundMixerSink
+{
+    virtual ~SoundMixerSink()
+    {
+    }
+    virtual ZunBool IsRealtime() = 0;
+    // How many blocks can be written now without overwriting any that haven't played yet.
+    virtual i32 GetFreeBlocks() = 0;
+    virtual ZunResult WriteBlock(i16 *samples) = 0;
+    virtual void Close() = 0;
+};
+
+struct SoundMixerNullSink : SoundMixerSink
+{
+    ZunBool IsRealtime();
+    i32 GetFreeBlocks();
+    ZunResult WriteBlock(i16 *samples);
+    void Close();
+
+    u32 blocksWritten;
+};
+
+struct SoundMixerWavSink : SoundMixerSink
+{
+    SoundMixerWavSink();
+
+    ZunResult Open(const char *path);
+    ZunBool IsRealtime();
+    i32 GetFreeBlocks();
+    ZunResult WriteBlock(i16 *samples);
+    // Fills in the sizes the header was written without.
+    void Close();
+
+    FILE *file;
+    u32 dataBytes;
+};
+
+// A looping secondary buffer of SOUND_MIXER_DSOUND_BLOCKS blocks, written just behind the play cursor.
+struct SoundMixerDSoundSink : SoundMixerSink
+{
+    SoundMixerDSoundSink();
+
+    ZunResult Open(LPDIRECTSOUND dsound);
+    ZunBool IsRealtime();
+    i32 GetFreeBlocks();
+    ZunResult WriteBlock(i16 *samples);
+    void Close();
+
+    LPDIRECTSOUNDBUFFER buffer;
+    i32 writeBlock;
+    i32 lastPlayBlock;
+    // Written and not yet reached by the play cursor, not counting the block it's in.
+    i32 queuedBlocks;
+    // Times the play cursor caught up with the writes.
+    u32 underruns;
+};
+
+// Mixes the sound effects and the background music in software into fixed size blocks, in place of a DirectSound
+// buffer per sound. The voice count depends on nothing but SOUND_MIXER_MAX_VOICES, and a headless sink lets the
+// whole audio path run without a sound device.
+struct SoundMixer
+{
+    SoundMixer();
+
+    ZunResult Start(SoundMixerSink *sink);
+    void Stop();
+
+    ZunResult LoadSample(i32 idx, WAVEFORMATEX *format, u8 *data, u32 dataSize);
+    ZunResult LoadSample(i32 idx, PcmAsset *asset);
+    void ReleaseSamples();
+
+    // volume is in hundredths of a decibel, as DirectSound and g_SoundBufferIdxVol have it.
+    static i16 VolumeToGain(i32 volume);
+    void Play(i32 voice, i32 sample, i16 gain);
+    // Plays every SoundIdx queued since the last call, each with its g_SoundBufferIdxVol sample and volume.
+    void Queue(i32 soundIdx);
+    void PlayQueued();
+
+    void SetStream(SoundMixerStreamCallback callback, void *arg);
+    void FadeOutStream(i32 frames);
+    void UpdateFadeOut();
+
+    // Produces a game frame of audio for a sink that isn't realtime.
+    void AdvanceFrame();
+    void Pump();
+    void MixBlock(i16 *out);
+    f32 GetMixUsPerBlock();
+
+    static DWORD __stdcall MixerThread(LPVOID arg);
+
+    ZunBool isEnabled;
+    ZunBool useSse2;
+    SoundMixerSink *sink;
+    SoundMixerSample samples[SOUND_MIXER_MAX_SAMPLES];
+    SoundMixerVoice voices[SOUND_MIXER_MAX_VOICES];
+    u32 queuedSounds;
+
+    SoundMixerStreamCallback streamCallback;
+    void *streamArg;
+    i16 streamGain;
+    i32 streamFadeProgress;
+    i32 streamFadeTotal;
+
+    i32 pendingFrames;
+    CRITICAL_SECTION lock;
+    HANDLE thread;
+    HANDLE stopEvent;
+
+    u32 blocksMixed;
+    LONGLONG mixTicks;
+    LONGLONG ticksPerSecond;
+
+    i16 block[SOUND_MIXER_BLOCK_SAMPLES];
+    i16 streamBlock[SOUND_MIXER_BLOCK_SAMPLES];
+};
+
+extern SoundMixer g_SoundMixer;
+extern SoundMixerNullSink g_SoundMixerNullSink;
+extern SoundMixerWavSink g_SoundMixerWavSink;
+extern SoundMixerDSoundSink g_SoundMixerDSoundSink;
+}; // namespace th06
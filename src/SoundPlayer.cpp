@@ -1,7 +1,10 @@
 #include "SoundPlayer.hpp"
 
+#include "AssetTrace.hpp"
+#include "BgmStream.hpp"
 #include "FileSystem.hpp"
 #include "Supervisor.hpp"
+#include "ZunMemory.hpp"
 #include "i18n.hpp"
 #include "utils.hpp"
 
@@ -32,6 +35,130 @@ DIFFABLE_STATIC_ARRAY_ASSIGN(char *, 26, g_SFXList) = {
 };
 DIFFABLE_STATIC(SoundPlayer, g_SoundPlayer)
 
+// The file each sound buffer was loaded from, held only while InitSoundBuffers runs, so that sounds loaded together
+// can find the ones with the same samples. What plays afterwards is DirectSound's copy or g_SoundMixer's reference.
+static PcmAsset *g_SoundAssets[0x80];
+
+static void ReleaseSoundAssets()
+{
+    i32 idx;
+
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_SoundAssets); idx++)
+    {
+        g_PcmAssetCache.Release(g_SoundAssets[idx]);
+        g_SoundAssets[idx] = NULL;
+    }
+}
+
+#if defined(SOUND_MIXER) || defined(BGM_READ_AHEAD)
+// Like BackgroundMusicPlayerThread, always loops, going back to the .pos loop start at the end of the file.
+static i32 ReadLoopedBgm(void *arg, i16 *frames, i32 frameCount)
+{
+    CWaveFile *file;
+    DWORD bytesWanted;
+    DWORD bytesRead;
+    DWORD totalRead;
+    ZunBool justReset;
+
+    file = (CWaveFile *)arg;
+    bytesWanted = frameCount * BACKGROUND_MUSIC_WAV_BLOCK_ALIGN;
+    totalRead = 0;
+    justReset = false;
+    while (totalRead < bytesWanted)
+    {
+        if (FAILED(file->Read((BYTE *)frames + totalRead, bytesWanted - totalRead, &bytesRead)))
+        {
+            break;
+        }
+        totalRead += bytesRead;
+        if (totalRead < bytesWanted)
+        {
+            // Nothing between the loop points, so there's nothing to loop.
+            if ((bytesRead == 0 && justReset) || FAILED(file->ResetFile(true)))
+            {
+                break;
+            }
+            justReset = true;
+        }
+        else
+        {
+            justReset = false;
+        }
+    }
+    return totalRead / BACKGROUND_MUSIC_WAV_BLOCK_ALIGN;
+}
+#endif
+
+#ifdef BGM_READ_AHEAD
+static void StopBgmReadAhead(CStreamingSound *music)
+{
+    music->m_pReadAhead = NULL;
+    g_BgmStream.Stop();
+}
+
+// Hands the rest of the file, from wherever FillBufferWithSound left it, to g_BgmStream's producer thread. Files in
+// any other format than the ring's keep streaming straight from the file.
+static ZunResult StartBgmReadAhead(CStreamingSound *music)
+{
+    WAVEFORMATEX *format;
+
+    format = music->m_pWaveFile->m_pwfx;
+    if (format->wFormatTag != WAVE_FORMAT_PCM || format->nChannels != SOUND_MIXER_CHANNELS ||
+        format->wBitsPerSample != BACKGROUND_MUSIC_WAV_BITS_PER_SAMPLE)
+    {
+        return ZUN_SUCCESS;
+    }
+    if (g_BgmStream.Start(ReadLoopedBgm, music->m_pWaveFile, true) != ZUN_SUCCESS)
+    {
+        return ZUN_ERROR;
+    }
+    music->m_pReadAhead = &g_BgmStream;
+    return ZUN_SUCCESS;
+}
+
+#endif
+
+#ifdef SOUND_MIXER
+// The background music when g_SoundMixer plays it in place of a CStreamingSound. Only read by g_BgmStream.
+static CWaveFile *g_MixerBgmFile;
+
+static void StopMixerBgm()
+{
+    g_SoundMixer.SetStream(NULL, NULL);
+    g_BgmStream.Stop();
+    if (g_MixerBgmFile != NULL)
+    {
+        delete g_MixerBgmFile;
+        g_MixerBgmFile = NULL;
+    }
+}
+
+static ZunResult LoadMixerBgm(char *path)
+{
+    WAVEFORMATEX *format;
+
+    StopMixerBgm();
+    g_MixerBgmFile = new CWaveFile();
+    if (FAILED(g_MixerBgmFile->Open(path, NULL, WAVEFILE_READ)) || g_MixerBgmFile->GetSize() == 0)
+    {
+        utils::DebugPrint2("error : wav file load error %s\n", path);
+        StopMixerBgm();
+        return ZUN_ERROR;
+    }
+    // The mixer streams the file as it is, so it has to already be in the mixer's format.
+    format = g_MixerBgmFile->m_pwfx;
+    if (format->wFormatTag != WAVE_FORMAT_PCM || format->nChannels != SOUND_MIXER_CHANNELS ||
+        format->wBitsPerSample != BACKGROUND_MUSIC_WAV_BITS_PER_SAMPLE ||
+        format->nSamplesPerSec != SOUND_MIXER_SAMPLE_RATE)
+    {
+        utils::DebugPrint2("error : wav file format not supported by the mixer %s\n", path);
+        StopMixerBgm();
+        return ZUN_ERROR;
+    }
+    return ZUN_SUCCESS;
+}
+#endif
+
 SoundPlayer::SoundPlayer()
 {
     memset(this, 0, sizeof(SoundPlayer));
@@ -102,6 +229,13 @@ ZunResult SoundPlayer::Release(void)
 {
     i32 i;
 
+#ifdef SOUND_MIXER
+    if (g_SoundMixer.isEnabled)
+    {
+        StopMixerBgm();
+        g_SoundMixer.Stop();
+    }
+#endif
     if (this->manager == NULL)
     {
         return ZUN_SUCCESS;
@@ -143,6 +277,12 @@ ZunResult SoundPlayer::Release(void)
 
 void SoundPlayer::StopBGM()
 {
+#ifdef SOUND_MIXER
+    if (g_SoundMixer.isEnabled)
+    {
+        StopMixerBgm();
+    }
+#endif
     if (this->backgroundMusic != NULL)
     {
         this->backgroundMusic->Stop();
@@ -156,6 +296,9 @@ void SoundPlayer::StopBGM()
             CloseHandle(this->backgroundMusicUpdateEvent);
             this->backgroundMusicThreadHandle = NULL;
         }
+#ifdef BGM_READ_AHEAD
+        StopBgmReadAhead(this->backgroundMusic);
+#endif
         if (this->backgroundMusic != NULL)
         {
             delete this->backgroundMusic;
@@ -182,6 +325,12 @@ ZunResult SoundPlayer::LoadWav(char *path)
     DWORD curTime2;
     u32 waitTime2;
 
+#ifdef SOUND_MIXER
+    if (g_SoundMixer.isEnabled && g_Supervisor.cfg.playSounds)
+    {
+        return LoadMixerBgm(path);
+    }
+#endif
     if (this->manager == NULL)
     {
         return ZUN_ERROR;
@@ -251,7 +400,11 @@ ZunResult SoundPlayer::LoadPos(char *path)
     i32 loopEnd;
     i32 loopStart;
 
+#ifdef SOUND_MIXER
+    if (this->manager == NULL && !g_SoundMixer.isEnabled)
+#else
     if (this->manager == NULL)
+#endif
     {
         return ZUN_ERROR;
     }
@@ -259,7 +412,19 @@ ZunResult SoundPlayer::LoadPos(char *path)
     {
         return ZUN_ERROR;
     }
+#ifdef SOUND_MIXER
+    if (g_SoundMixer.isEnabled)
+    {
+        bgmFile = g_MixerBgmFile;
+    }
+    else
+    {
+        bgmFile = this->backgroundMusic != NULL ? this->backgroundMusic->m_pWaveFile : NULL;
+    }
+    if (bgmFile == NULL)
+#else
     if (this->backgroundMusic == NULL)
+#endif
     {
         return ZUN_ERROR;
     }
@@ -269,18 +434,37 @@ ZunResult SoundPlayer::LoadPos(char *path)
     {
         return ZUN_ERROR;
     }
+#ifndef SOUND_MIXER
     bgmFile = this->backgroundMusic->m_pWaveFile;
+#endif
     loopEnd = *(i32 *)(fileData + 4) * 4;
     loopStart = *(i32 *)(fileData) * 4;
     bgmFile->m_loopStartPoint = loopStart;
     bgmFile->m_loopEndPoint = loopEnd;
-    free(fileData);
+    ZunFree(fileData);
     return ZUN_SUCCESS;
 }
 
 ZunResult SoundPlayer::InitSoundBuffers()
 {
     i32 idx;
+#ifdef SOUND_MIXER
+    if (g_SoundMixer.isEnabled)
+    {
+        // No duplicate buffers: the mixer plays each SoundIdx straight from its sample.
+        for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_SFXList); idx++)
+        {
+            if (this->LoadSound(idx, g_SFXList[idx]) != ZUN_SUCCESS)
+            {
+                g_GameErrorContext.Log(TH_ERR_SOUNDPLAYER_FAILED_TO_LOAD_SOUND_FILE, g_SFXList[idx]);
+                ReleaseSoundAssets();
+                return ZUN_ERROR;
+            }
+        }
+        ReleaseSoundAssets();
+        return ZUN_SUCCESS;
+    }
+#endif
     if (this->manager == NULL)
     {
         return ZUN_ERROR;
@@ -300,9 +484,11 @@ ZunResult SoundPlayer::InitSoundBuffers()
             if (this->LoadSound(idx, g_SFXList[idx]) != ZUN_SUCCESS)
             {
                 g_GameErrorContext.Log(TH_ERR_SOUNDPLAYER_FAILED_TO_LOAD_SOUND_FILE, g_SFXList[idx]);
+                ReleaseSoundAssets();
                 return ZUN_ERROR;
             }
         }
+        ReleaseSoundAssets();
         for (idx = 0; idx < ARRAY_SIZE(g_SoundBufferIdxVol); idx++)
         {
             this->dsoundHdl->DuplicateSoundBuffer(this->soundBuffers[g_SoundBufferIdxVol[idx].bufferIdx],
@@ -345,8 +531,15 @@ ZunResult SoundPlayer::LoadSound(i32 idx, char *path)
     WAVEFORMATEX wavData;
     i32 formatSize;
     DSBUFFERDESC dsBuffer;
+    PcmAsset *asset;
+    i32 otherIdx;
+    ASSET_TRACE_SCOPE(AssetTraceKind_Sound, path);
 
+#ifdef SOUND_MIXER
+    if (this->manager == NULL && !g_SoundMixer.isEnabled)
+#else
     if (this->manager == NULL)
+#endif
     {
         return ZUN_SUCCESS;
     }
@@ -355,69 +548,102 @@ ZunResult SoundPlayer::LoadSound(i32 idx, char *path)
         this->soundBuffers[idx]->Release();
         this->soundBuffers[idx] = NULL;
     }
-    soundFileData = (u8 *)FileSystem::OpenPath(path, 0);
-    sFDCursor = soundFileData;
-    if (sFDCursor == NULL)
-    {
-        return ZUN_ERROR;
-    }
-    if (strncmp((char *)sFDCursor, "RIFF", 4))
+    g_PcmAssetCache.Release(g_SoundAssets[idx]);
+    g_SoundAssets[idx] = NULL;
+
+    asset = g_PcmAssetCache.FindPath(path);
+    if (asset == NULL)
     {
-        g_GameErrorContext.Log(TH_ERR_NOT_A_WAV_FILE, path);
-        free(soundFileData);
-        return ZUN_ERROR;
-    }
-    sFDCursor += 4;
+        soundFileData = (u8 *)FileSystem::OpenPath(path, 0);
+        sFDCursor = soundFileData;
+        if (sFDCursor == NULL)
+        {
+            return ZUN_ERROR;
+        }
+        if (strncmp((char *)sFDCursor, "RIFF", 4))
+        {
+            g_GameErrorContext.Log(TH_ERR_NOT_A_WAV_FILE, path);
+            ZunFree(soundFileData);
+            return ZUN_ERROR;
+        }
+        sFDCursor += 4;
 
-    fileSize = *(i32 *)sFDCursor;
-    sFDCursor += 4;
+        fileSize = *(i32 *)sFDCursor;
+        sFDCursor += 4;
 
-    if (strncmp((char *)sFDCursor, "WAVE", 4))
-    {
-        g_GameErrorContext.Log(TH_ERR_NOT_A_WAV_FILE, path);
-        free(soundFileData);
-        return ZUN_ERROR;
+        if (strncmp((char *)sFDCursor, "WAVE", 4))
+        {
+            g_GameErrorContext.Log(TH_ERR_NOT_A_WAV_FILE, path);
+            ZunFree(soundFileData);
+            return ZUN_ERROR;
+        }
+        sFDCursor += 4;
+        wavDataPtr = GetWavFormatData(sFDCursor, "fmt ", &formatSize, fileSize - 12);
+        if (wavDataPtr == NULL)
+        {
+            g_GameErrorContext.Log(TH_ERR_NOT_A_WAV_FILE, path);
+            ZunFree(soundFileData);
+            return ZUN_ERROR;
+        }
+        wavData = *wavDataPtr;
+
+        wavDataPtr = GetWavFormatData(sFDCursor, "data", &formatSize, fileSize - 12);
+        if (wavDataPtr == NULL)
+        {
+            g_GameErrorContext.Log(TH_ERR_NOT_A_WAV_FILE, path);
+            ZunFree(soundFileData);
+            return ZUN_ERROR;
+        }
+        // The samples stay where they are in soundFileData, which the asset owns from here on.
+        asset = g_PcmAssetCache.Adopt(path, soundFileData, &wavData, (u8 *)wavDataPtr, formatSize);
+        if (asset == NULL)
+        {
+            ZunFree(soundFileData);
+            return ZUN_ERROR;
+        }
     }
-    sFDCursor += 4;
-    wavDataPtr = GetWavFormatData(sFDCursor, "fmt ", &formatSize, fileSize - 12);
-    if (wavDataPtr == NULL)
+    g_SoundAssets[idx] = asset;
+
+#ifdef SOUND_MIXER
+    if (g_SoundMixer.isEnabled)
     {
-        g_GameErrorContext.Log(TH_ERR_NOT_A_WAV_FILE, path);
-        free(soundFileData);
-        return ZUN_ERROR;
+        return g_SoundMixer.LoadSample(idx, asset);
     }
-    wavData = *wavDataPtr;
+#endif
 
-    wavDataPtr = GetWavFormatData(sFDCursor, "data", &formatSize, fileSize - 12);
-    if (wavDataPtr == NULL)
+    // Sounds with the same samples play from the same memory.
+    for (otherIdx = 0; otherIdx < ARRAY_SIZE_SIGNED(g_SoundAssets); otherIdx++)
     {
-        g_GameErrorContext.Log(TH_ERR_NOT_A_WAV_FILE, path);
-        free(soundFileData);
-        return ZUN_ERROR;
+        if (otherIdx != idx && g_SoundAssets[otherIdx] == asset && this->soundBuffers[otherIdx] != NULL)
+        {
+            if (FAILED(this->dsoundHdl->DuplicateSoundBuffer(this->soundBuffers[otherIdx], &this->soundBuffers[idx])))
+            {
+                return ZUN_ERROR;
+            }
+            return ZUN_SUCCESS;
+        }
     }
+
     memset(&dsBuffer, 0, sizeof(dsBuffer));
     dsBuffer.dwSize = sizeof(dsBuffer);
     dsBuffer.dwFlags = DSBCAPS_GLOBALFOCUS | DSBCAPS_CTRLVOLUME | DSBCAPS_LOCSOFTWARE;
-    dsBuffer.dwBufferBytes = formatSize;
-    dsBuffer.lpwfxFormat = &wavData;
+    dsBuffer.dwBufferBytes = asset->pcmSize;
+    dsBuffer.lpwfxFormat = &asset->format;
     if (FAILED(this->dsoundHdl->CreateSoundBuffer(&dsBuffer, &this->soundBuffers[idx], NULL)))
     {
-        free(soundFileData);
         return ZUN_ERROR;
     }
-    if (FAILED(soundBuffers[idx]->Lock(0, formatSize, (LPVOID *)&audioPtr1, (LPDWORD)&audioSize1, (LPVOID *)&audioPtr2,
-                                       (LPDWORD)&audioSize2, NULL)))
+    if (FAILED(soundBuffers[idx]->Lock(0, asset->pcmSize, (LPVOID *)&audioPtr1, (LPDWORD)&audioSize1,
+                                       (LPVOID *)&audioPtr2, (LPDWORD)&audioSize2, NULL)))
     {
-        free(soundFileData);
         return ZUN_ERROR;
     }
-    memcpy(audioPtr1, wavDataPtr, audioSize1);
+    memcpy(audioPtr1, asset->pcm, audioSize1);
     if (audioSize2 != 0)
     {
-        memcpy(audioPtr2, (i8 *)wavDataPtr + audioSize1, audioSize2);
+        memcpy(audioPtr2, asset->pcm + audioSize1, audioSize2);
     }
     soundBuffers[idx]->Unlock((LPVOID *)audioPtr1, audioSize1, (LPVOID *)audioPtr2, audioSize2);
-    free(soundFileData);
     return ZUN_SUCCESS;
 }
 
@@ -428,10 +654,32 @@ ZunResult SoundPlayer::PlayBGM(BOOL isLooping)
     HRESULT res;
 
     utils::DebugPrint2("play BGM\n");
+#ifdef SOUND_MIXER
+    if (g_SoundMixer.isEnabled)
+    {
+        g_SoundMixer.SetStream(NULL, NULL);
+        g_BgmStream.Stop();
+        if (g_MixerBgmFile == NULL || FAILED(g_MixerBgmFile->ResetFile(false)))
+        {
+            return ZUN_ERROR;
+        }
+        // The headless sinks mix on the game thread, so the ring can be topped up there too.
+        if (g_BgmStream.Start(ReadLoopedBgm, g_MixerBgmFile, g_SoundMixer.sink->IsRealtime()) != ZUN_SUCCESS)
+        {
+            return ZUN_ERROR;
+        }
+        g_SoundMixer.SetStream(BgmStream::Read, &g_BgmStream);
+        this->isLooping = isLooping;
+        return ZUN_SUCCESS;
+    }
+#endif
     if (this->backgroundMusic == NULL)
     {
         return ZUN_ERROR;
     }
+#ifdef BGM_READ_AHEAD
+    StopBgmReadAhead(this->backgroundMusic);
+#endif
     res = this->backgroundMusic->Reset();
     if (FAILED(res))
     {
@@ -444,6 +692,12 @@ ZunResult SoundPlayer::PlayBGM(BOOL isLooping)
     {
         return ZUN_ERROR;
     }
+#ifdef BGM_READ_AHEAD
+    if (StartBgmReadAhead(this->backgroundMusic) != ZUN_SUCCESS)
+    {
+        return ZUN_ERROR;
+    }
+#endif
     res = this->backgroundMusic->Play(0, DSBPLAY_LOOPING);
     if (FAILED(res))
     {
@@ -460,6 +714,18 @@ void SoundPlayer::PlaySounds()
     i32 idx;
     i32 sndBufIdx;
 
+#ifdef SOUND_MIXER
+    if (g_SoundMixer.isEnabled)
+    {
+        if (g_Supervisor.cfg.playSounds)
+        {
+            g_SoundMixer.PlayQueued();
+        }
+        g_SoundMixer.queuedSounds = 0;
+        g_SoundMixer.AdvanceFrame();
+        return;
+    }
+#endif
     if (this->manager == NULL)
     {
         return;
@@ -494,6 +760,14 @@ void SoundPlayer::PlaySoundByIdx(SoundIdx idx, i32 unused)
     i32 i;
 
     SFXToPlay = g_SoundBufferIdxVol[idx].unk;
+#ifdef SOUND_MIXER
+    if (g_SoundMixer.isEnabled)
+    {
+        // Every sound asked for in a frame plays, not just the first three.
+        g_SoundMixer.Queue(idx);
+        return;
+    }
+#endif
     for (i = 0; i < 3; i++)
     {
         if (this->soundBuffersToPlay[i] < 0)
@@ -2,6 +2,7 @@
 
 #include <Windows.h>
 
+#include "SoundMixer.hpp"
 #include "ZunResult.hpp"
 #include "diffbuild.hpp"
 #include "inttypes.hpp"
@@ -73,7 +74,15 @@ struct SoundPlayer
     {
         CStreamingSound *bgm;
 
+#ifdef SOUND_MIXER
+        if (g_SoundMixer.isEnabled)
+        {
+            g_SoundMixer.FadeOutStream(seconds * 60);
+        }
+        else if (this->backgroundMusic != NULL)
+#else
         if (this->backgroundMusic != NULL)
+#endif
         {
             bgm = this->backgroundMusic;
             bgm->m_dwIsFadingOut = 1;
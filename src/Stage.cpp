@@ -3,6 +3,7 @@
 #include "AnmManager.hpp"
 #include "Chain.hpp"
 #include "ChainPriorities.hpp"
+#include "D3dStateCache.hpp"
 #include "FileSystem.hpp"
 #include "GameManager.hpp"
 #include "Gui.hpp"
@@ -99,9 +100,9 @@ ChainCallbackResult Stage::OnUpdate(Stage *stage)
                 stage->skyFog.farPlane = ((f32 *)curInsn->args)[2];
                 if (stage->skyFogInterpDuration == 0)
                 {
-                    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGCOLOR, stage->skyFog.color);
-                    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGSTART, *(u32 *)&stage->skyFog.nearPlane);
-                    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGEND, *(u32 *)&stage->skyFog.farPlane);
+                    D3D_SET_RENDER_STATE(D3DRS_FOGCOLOR, stage->skyFog.color);
+                    D3D_SET_RENDER_STATE(D3DRS_FOGSTART, *(u32 *)&stage->skyFog.nearPlane);
+                    D3D_SET_RENDER_STATE(D3DRS_FOGEND, *(u32 *)&stage->skyFog.farPlane);
                 }
                 stage->instructionIndex++;
                 stage->skyFogInterpFinal = stage->skyFog;
@@ -195,9 +196,9 @@ ChainCallbackResult Stage::OnUpdate(Stage *stage)
             stage->skyFog.farPlane =
                 (stage->skyFogInterpFinal.farPlane - stage->skyFogInterpInitial.farPlane) * skyFogInterpRatio +
                 stage->skyFogInterpInitial.farPlane;
-            g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGCOLOR, stage->skyFog.color);
-            g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGSTART, *(u32 *)&stage->skyFog.nearPlane);
-            g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGEND, *(u32 *)&stage->skyFog.farPlane);
+            D3D_SET_RENDER_STATE(D3DRS_FOGCOLOR, stage->skyFog.color);
+            D3D_SET_RENDER_STATE(D3DRS_FOGSTART, *(u32 *)&stage->skyFog.nearPlane);
+            D3D_SET_RENDER_STATE(D3DRS_FOGEND, *(u32 *)&stage->skyFog.farPlane);
             if ((ZunBool)(stage->skyFogInterpTimer.current >= stage->skyFogInterpDuration))
             {
                 stage->skyFogInterpDuration = 0;
@@ -226,10 +227,10 @@ ChainCallbackResult Stage::OnDrawHighPrio(Stage *stage)
     if (stage->skyFogNeedsSetup)
     {
         stage->skyFogNeedsSetup = 0;
-        g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGCOLOR, stage->skyFog.color);
+        D3D_SET_RENDER_STATE(D3DRS_FOGCOLOR, stage->skyFog.color);
     }
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGSTART, *(u32 *)&stage->skyFog.nearPlane);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGEND, *(u32 *)&stage->skyFog.farPlane);
+    D3D_SET_RENDER_STATE(D3DRS_FOGSTART, *(u32 *)&stage->skyFog.nearPlane);
+    D3D_SET_RENDER_STATE(D3DRS_FOGEND, *(u32 *)&stage->skyFog.farPlane);
     if (stage->spellcardState <= RUNNING)
     {
         if (!g_Gui.IsStageFinished())
@@ -278,9 +279,9 @@ ChainCallbackResult Stage::OnDrawLowPrio(Stage *stage)
     GameManager::SetupCameraStageBackground(0);
     g_Supervisor.d3dDevice->SetViewport(&g_Supervisor.viewport);
     val = 1000.0f;
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGSTART, *(u32 *)&val);
+    D3D_SET_RENDER_STATE(D3DRS_FOGSTART, *(u32 *)&val);
     val = 2000.0f;
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGEND, *(u32 *)&val);
+    D3D_SET_RENDER_STATE(D3DRS_FOGEND, *(u32 *)&val);
     return CHAIN_CALLBACK_RESULT_CONTINUE;
 }
 
@@ -326,9 +327,9 @@ ZunResult Stage::AddedCallback(Stage *stage)
     facingDirTimer->InitializeForPopup();
     stage->unpauseFlag = 0;
 
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGCOLOR, stage->skyFog.color);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGSTART, *(DWORD *)&stage->skyFog.nearPlane);
-    g_Supervisor.d3dDevice->SetRenderState(D3DRS_FOGEND, *(DWORD *)&stage->skyFog.farPlane);
+    D3D_SET_RENDER_STATE(D3DRS_FOGCOLOR, stage->skyFog.color);
+    D3D_SET_RENDER_STATE(D3DRS_FOGSTART, *(DWORD *)&stage->skyFog.nearPlane);
+    D3D_SET_RENDER_STATE(D3DRS_FOGEND, *(DWORD *)&stage->skyFog.farPlane);
     return ZUN_SUCCESS;
 }
 
@@ -377,13 +378,21 @@ ZunResult Stage::DeletedCallback(Stage *s)
     if (s->quadVms != NULL)
     {
         void *quadVms = s->quadVms;
+#ifdef ZUN_ARENAS
+        ZunFree(quadVms, ZUN_ARENA_STAGE);
+#else
         free(quadVms);
+#endif
         s->quadVms = NULL;
     }
     if (s->stdData != NULL)
     {
         void *stdData = s->stdData;
+#ifdef ZUN_ARENAS
+        ZunFree(stdData, ZUN_ARENA_STAGE);
+#else
         free(stdData);
+#endif
         s->stdData = NULL;
     }
     return ZUN_SUCCESS;
@@ -408,7 +417,11 @@ ZunResult Stage::LoadStageData(char *anmpath, char *stdpath)
     {
         return ZUN_ERROR;
     }
+#ifdef ZUN_ARENAS
+    this->stdData = (RawStageHeader *)FileSystem::OpenPath(stdpath, false, ZUN_ARENA_STAGE);
+#else
     this->stdData = (RawStageHeader *)FileSystem::OpenPath(stdpath, false);
+#endif
     if (this->stdData == NULL)
     {
         g_GameErrorContext.Log(TH_ERR_STAGE_DATA_CORRUPTED);
@@ -423,7 +436,11 @@ ZunResult Stage::LoadStageData(char *anmpath, char *stdpath)
     {
         this->objects[idx] = (RawStageObject *)((i32)this->objects[idx] + (i32)this->stdData);
     }
+#ifdef ZUN_ARENAS
+    this->quadVms = (AnmVm *)ZunAlloc(this->quadCount * sizeof(AnmVm), ZUN_ARENA_STAGE);
+#else
     this->quadVms = (AnmVm *)ZunAlloc(this->quadCount * sizeof(AnmVm));
+#endif
     for (idx = 0, vmIdx = 0; idx < this->objectsCount; idx++)
     {
         curObj = this->objects[idx];
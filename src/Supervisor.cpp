@@ -1,20 +1,26 @@
 #include "Supervisor.hpp"
 #include "AnmManager.hpp"
 #include "AsciiManager.hpp"
+#include "AssetPreload.hpp"
+#include "AssetTrace.hpp"
 #include "Chain.hpp"
 #include "ChainPriorities.hpp"
+#include "D3dStateCache.hpp"
 #include "Ending.hpp"
 #include "FileSystem.hpp"
+#include "FixedStep.hpp"
 #include "GameErrorContext.hpp"
 #include "GameManager.hpp"
 #include "GameWindow.hpp"
 #include "MainMenu.hpp"
 #include "MusicRoom.hpp"
+#include "PerfStats.hpp"
 #include "ReplayManager.hpp"
 #include "ResultScreen.hpp"
 #include "Rng.hpp"
 #include "SoundPlayer.hpp"
 #include "TextHelper.hpp"
+#include "ZunMemory.hpp"
 #include "i18n.hpp"
 #include "inttypes.hpp"
 #include "utils.hpp"
@@ -39,6 +45,9 @@ ChainCallbackResult Supervisor::OnUpdate(Supervisor *s)
     {
         g_SoundPlayer.backgroundMusic->UpdateFadeOut();
     }
+#ifdef SOUND_MIXER
+    g_SoundMixer.UpdateFadeOut();
+#endif
     g_LastFrameInput = g_CurFrameInput;
     g_CurFrameInput = Controller::GetInput();
     g_IsEigthFrameOfHeldInput = 0;
@@ -314,11 +323,21 @@ ZunResult Supervisor::AddedCallback(Supervisor *s)
     g_AnmManager->LoadSurface(0, "data/title/th06logo.jpg");
     g_AnmManager->CopySurfaceToBackBuffer(0, 0, 0, 0, 0);
     if (g_Supervisor.d3dDevice->Present(0, 0, 0, 0) < 0)
+    {
         g_Supervisor.d3dDevice->Reset(&g_Supervisor.presentParameters);
+#ifdef D3D_STATE_CACHE
+        g_D3dStateCache.Invalidate();
+#endif
+    }
 
     g_AnmManager->CopySurfaceToBackBuffer(0, 0, 0, 0, 0);
     if (g_Supervisor.d3dDevice->Present(0, 0, 0, 0) < 0)
+    {
         g_Supervisor.d3dDevice->Reset(&g_Supervisor.presentParameters);
+#ifdef D3D_STATE_CACHE
+        g_D3dStateCache.Invalidate();
+#endif
+    }
 
     g_AnmManager->ReleaseSurface(0);
 
@@ -512,7 +531,18 @@ void Supervisor::DrawFpsCounter()
     static char g_FpsCounterBuffer[256];
 
     curTime = timeGetTime();
+#ifdef FIXED_STEP
+    if (g_FixedStep.isEnabled)
+    {
+        g_NumFramesSinceLastTime += g_FixedStep.lastSteps;
+    }
+    else
+    {
+        g_NumFramesSinceLastTime = g_NumFramesSinceLastTime + 1 + (u32)g_Supervisor.cfg.frameskipConfig;
+    }
+#else
     g_NumFramesSinceLastTime = g_NumFramesSinceLastTime + 1 + (u32)g_Supervisor.cfg.frameskipConfig;
+#endif
     if (500 <= curTime - g_LastTime)
     {
         elapsed = (curTime - g_LastTime) / 1000.f;
@@ -541,6 +571,12 @@ void Supervisor::DrawFpsCounter()
         fpsCounterPos.y = 464.0;
         fpsCounterPos.z = 0.0;
         g_AsciiManager.AddString(&fpsCounterPos, g_FpsCounterBuffer);
+#ifdef PERF_OVERLAY
+        if (g_PerfStats.isOverlayEnabled)
+        {
+            g_PerfStats.DrawOverlay();
+        }
+#endif
     }
     return;
 }
@@ -568,6 +604,8 @@ void Supervisor::ReleasePbg3(i32 pbg3FileIdx)
     {
         return;
     }
+    // The read ahead thread could be in the middle of this archive.
+    ASSET_PRELOAD_STOP();
 
     // Double free! Release is called internally by the Pbg3Archive destructor,
     // and as such should not be called directly. By calling it directly here,
@@ -587,6 +625,7 @@ i32 Supervisor::LoadPbg3(i32 pbg3FileIdx, char *filename)
 {
     if (this->pbg3Archives[pbg3FileIdx] == NULL || strcmp(filename, this->pbg3ArchiveNames[pbg3FileIdx]) != 0)
     {
+        ASSET_TRACE_ARCHIVE_SCOPE(filename, pbg3FileIdx);
         this->ReleasePbg3(pbg3FileIdx);
         this->pbg3Archives[pbg3FileIdx] = new Pbg3Archive();
         utils::DebugPrint("%s open ...\n", filename);
@@ -689,7 +728,7 @@ ZunResult Supervisor::LoadConfig(char *path)
             g_GameErrorContext.Log(TH_ERR_CONFIG_CORRUPTED);
         }
         g_ControllerMapping = g_Supervisor.cfg.controllerMapping;
-        free(data);
+        ZunFree(data);
     }
     if (((this->cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) != 0)
     {
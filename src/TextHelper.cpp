@@ -2,6 +2,19 @@
 #include "GameWindow.hpp"
 #include "Supervisor.hpp"
 #include "i18n.hpp"
+#ifdef PIPELINED_DRAW
+#include "PipelinedD3dDevice.hpp"
+#endif
+#ifdef PIXEL_KERNELS
+#include "PixelKernels.hpp"
+#endif
+#ifdef TEXT_GLYPH_ATLAS
+#include "ZunMath.hpp"
+#include "ZunMemory.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+#endif
 
 namespace th06
 {
@@ -155,6 +168,12 @@ FormatInfo *TextHelper::GetFormatInfo(D3DFORMAT format)
     return &g_FormatInfoArray[local_8];
 }
 
+#ifdef PIXEL_KERNELS
+bool TextHelper::InvertAlpha(i32 x, i32 y, i32 spriteWidth, i32 fontHeight)
+{
+    return PixelKernels::InvertAlpha(this->format, &this->buffer[y * spriteWidth * 2], spriteWidth * fontHeight * 2);
+}
+#else
 struct A1R5G5B5
 {
     u16 blue : 5;
@@ -212,6 +231,7 @@ bool TextHelper::InvertAlpha(i32 x, i32 y, i32 spriteWidth, i32 fontHeight)
     }
     return true;
 }
+#endif
 
 #pragma function(memcpy)
 #pragma var_order(dstBuf, dstWidthBytes, rectToLock, curHeight, srcWidthBytes, outSurfaceDesc, srcBuf, lockedRect,     \
@@ -263,6 +283,102 @@ bool TextHelper::CopyTextToSurface(IDirect3DSurface8 *outSurface)
 }
 
 #pragma function(strlen)
+#ifdef TEXT_GLYPH_ATLAS
+void TextHelper::RenderTextWithGdi(TextHelper *target, i32 xPos, i32 spriteWidth, i32 fontHeight, ZunColor textColor,
+                                   ZunColor shadowColor, char *string)
+{
+    HGDIOBJ h;
+    HFONT font;
+    HDC hdc;
+
+    font = CreateFontA(fontHeight * 2, 0, 0, 0, FW_BOLD, false, false, false, SHIFTJIS_CHARSET, OUT_DEFAULT_PRECIS,
+                       CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, FF_ROMAN | FIXED_PITCH, TH_FONT_NAME);
+    memset(target->buffer, 0, target->imageSizeInBytes);
+    hdc = target->hdc;
+    h = SelectObject(hdc, font);
+    target->InvertAlpha(0, 0, spriteWidth * 2, fontHeight * 2 + 6);
+    SetBkMode(hdc, TRANSPARENT);
+
+    if (shadowColor != COLOR_WHITE)
+    {
+        // Render shadow.
+        SetTextColor(hdc, shadowColor);
+        TextOutA(hdc, xPos * 2 + 3, 2, string, strlen(string));
+    }
+    // Render main text.
+    SetTextColor(hdc, textColor);
+    TextOutA(hdc, xPos * 2, 0, string, strlen(string));
+
+    SelectObject(hdc, h);
+    target->InvertAlpha(0, 0, spriteWidth * 2, fontHeight * 2 + 6);
+    DeleteObject(font);
+}
+
+bool TextHelper::ComposeText(TextHelper *target, i32 xPos, i32 spriteWidth, i32 fontHeight, ZunColor textColor,
+                             ZunColor shadowColor, char *string)
+{
+    i32 idx;
+
+    if (target->format != D3DFMT_A1R5G5B5 && target->format != D3DFMT_A8R8G8B8)
+    {
+        return false;
+    }
+    if (!g_TextGlyphCache.Init())
+    {
+        return false;
+    }
+    memset(target->buffer, 0, target->imageSizeInBytes);
+    // What the first InvertAlpha turns a cleared A1R5G5B5 region into: opaque black.
+    if (target->format == D3DFMT_A1R5G5B5)
+    {
+        for (idx = 0; idx < spriteWidth * 2 * (fontHeight * 2 + 6); idx++)
+        {
+            ((u16 *)target->buffer)[idx] = 0x8000;
+        }
+    }
+    else
+    {
+        target->InvertAlpha(0, 0, spriteWidth * 2, fontHeight * 2 + 6);
+    }
+    if (shadowColor != COLOR_WHITE &&
+        !g_TextGlyphCache.ComposeString(target, xPos * 2 + 3, 2, fontHeight, shadowColor, string))
+    {
+        return false;
+    }
+    if (!g_TextGlyphCache.ComposeString(target, xPos * 2, 0, fontHeight, textColor, string))
+    {
+        return false;
+    }
+    target->InvertAlpha(0, 0, spriteWidth * 2, fontHeight * 2 + 6);
+    return true;
+}
+
+// Kept from one string to the next, along with the glyph cache, so a call costs no GDI object churn.
+static TextHelper g_TextComposeHelper;
+
+#pragma var_order(textSurfaceDesc, srcRect, destRect, destSurface)
+void TextHelper::RenderTextToTexture(i32 xPos, i32 yPos, i32 spriteWidth, i32 spriteHeight, i32 fontHeight,
+                                     i32 fontWidth, ZunColor textColor, ZunColor shadowColor, char *string,
+                                     IDirect3DTexture8 *outTexture)
+{
+    LPDIRECT3DSURFACE8 destSurface;
+    RECT destRect;
+    RECT srcRect;
+    D3DSURFACE_DESC textSurfaceDesc;
+
+    if (g_TextComposeHelper.hdc == NULL)
+    {
+        g_TextBufferSurface->GetDesc(&textSurfaceDesc);
+        g_TextComposeHelper.AllocateBufferWithFallback(textSurfaceDesc.Width, textSurfaceDesc.Height,
+                                                       textSurfaceDesc.Format);
+    }
+    if (!TextHelper::ComposeText(&g_TextComposeHelper, xPos, spriteWidth, fontHeight, textColor, shadowColor, string))
+    {
+        TextHelper::RenderTextWithGdi(&g_TextComposeHelper, xPos, spriteWidth, fontHeight, textColor, shadowColor,
+                                      string);
+    }
+    g_TextComposeHelper.CopyTextToSurface(g_TextBufferSurface);
+#else
 #pragma var_order(hdc, font, textSurfaceDesc, h, textHelper, hdc, srcRect, destRect, destSurface)
 void TextHelper::RenderTextToTexture(i32 xPos, i32 yPos, i32 spriteWidth, i32 spriteHeight, i32 fontHeight,
                                      i32 fontWidth, ZunColor textColor, ZunColor shadowColor, char *string,
@@ -301,6 +417,7 @@ void TextHelper::RenderTextToTexture(i32 xPos, i32 yPos, i32 spriteWidth, i32 sp
     textHelper.CopyTextToSurface(g_TextBufferSurface);
     SelectObject(hdc, h);
     DeleteObject(font);
+#endif
     destRect.left = 0;
     destRect.top = yPos;
     destRect.right = spriteWidth;
@@ -309,6 +426,12 @@ void TextHelper::RenderTextToTexture(i32 xPos, i32 yPos, i32 spriteWidth, i32 sp
     srcRect.top = 0;
     srcRect.right = spriteWidth * 2 - 2;
     srcRect.bottom = fontHeight * 2 - 2;
+#ifdef PIPELINED_DRAW
+    if (g_PipelinedD3dDevice != NULL)
+    {
+        g_PipelinedD3dDevice->Sync();
+    }
+#endif
     outTexture->GetSurfaceLevel(0, &destSurface);
     D3DXLoadSurfaceFromSurface(destSurface, NULL, &destRect, g_TextBufferSurface, NULL, &srcRect, 4, 0);
     if (destSurface != NULL)
@@ -326,6 +449,325 @@ void th06::TextHelper::ReleaseTextBuffer()
         g_TextBufferSurface->Release();
         g_TextBufferSurface = NULL;
     }
+#ifdef TEXT_GLYPH_ATLAS
+    g_TextComposeHelper.ReleaseBuffer();
+    g_TextGlyphCache.Release();
+#endif
     return;
 }
+
+#ifdef TEXT_GLYPH_ATLAS
+TextGlyphCache g_TextGlyphCache;
+
+// Room around the pen position for the bold overhang and antialiasing.
+#define TEXT_GLYPH_PAD 4
+
+TextGlyphCache::TextGlyphCache()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+TextGlyphCache::~TextGlyphCache()
+{
+    this->Release();
+}
+
+bool TextGlyphCache::Init()
+{
+    BITMAPINFO bitmapInfo;
+
+    if (this->hdc != NULL)
+    {
+        return true;
+    }
+    memset(&bitmapInfo, 0, sizeof(bitmapInfo));
+    bitmapInfo.bmiHeader.biSize = sizeof(bitmapInfo.bmiHeader);
+    bitmapInfo.bmiHeader.biWidth = TEXT_GLYPH_SCRATCH_WIDTH;
+    bitmapInfo.bmiHeader.biHeight = -TEXT_GLYPH_SCRATCH_HEIGHT;
+    bitmapInfo.bmiHeader.biPlanes = 1;
+    bitmapInfo.bmiHeader.biBitCount = 32;
+    bitmapInfo.bmiHeader.biCompression = BI_RGB;
+    this->scratchBitmap = CreateDIBSection(NULL, &bitmapInfo, DIB_RGB_COLORS, (void **)&this->scratch, NULL, 0);
+    if (this->scratchBitmap == NULL)
+    {
+        return false;
+    }
+    this->atlas = (u8 *)ZunAlloc(TEXT_GLYPH_ATLAS_WIDTH * TEXT_GLYPH_ATLAS_HEIGHT, "text atlas");
+    this->hdc = CreateCompatibleDC(NULL);
+    this->originalBitmap = SelectObject(this->hdc, this->scratchBitmap);
+    SetBkMode(this->hdc, TRANSPARENT);
+    SetTextColor(this->hdc, RGB(0xff, 0xff, 0xff));
+    this->Flush();
+    return true;
+}
+
+void TextGlyphCache::Release()
+{
+    i32 idx;
+
+    if (this->hdc == NULL)
+    {
+        return;
+    }
+    SelectObject(this->hdc, this->originalBitmap);
+    DeleteDC(this->hdc);
+    DeleteObject(this->scratchBitmap);
+    for (idx = 0; idx < this->fontCount; idx++)
+    {
+        DeleteObject(this->fonts[idx].font);
+    }
+    ZunFree(this->atlas);
+    memset(this, 0, sizeof(*this));
+}
+
+void TextGlyphCache::Flush()
+{
+    memset(this->glyphs, 0, sizeof(this->glyphs));
+    this->glyphCount = 0;
+    this->shelfX = 0;
+    this->shelfY = 0;
+    this->shelfHeight = 0;
+}
+
+// The same font RenderTextWithGdi creates, made once per size.
+HFONT TextGlyphCache::GetFont(i32 fontHeight)
+{
+    HFONT font;
+    i32 idx;
+
+    for (idx = 0; idx < this->fontCount; idx++)
+    {
+        if (this->fonts[idx].fontHeight == fontHeight)
+        {
+            return this->fonts[idx].font;
+        }
+    }
+    if (this->fontCount >= ARRAY_SIZE_SIGNED(this->fonts))
+    {
+        return NULL;
+    }
+    font = CreateFontA(fontHeight * 2, 0, 0, 0, FW_BOLD, false, false, false, SHIFTJIS_CHARSET, OUT_DEFAULT_PRECIS,
+                       CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, FF_ROMAN | FIXED_PITCH, TH_FONT_NAME);
+    if (font == NULL)
+    {
+        return NULL;
+    }
+    this->fonts[this->fontCount].fontHeight = fontHeight;
+    this->fonts[this->fontCount].font = font;
+    this->fontCount++;
+    return font;
+}
+
+static u32 HashTextGlyphKey(u32 key)
+{
+    return (key * 2654435761u >> 16) & (TEXT_GLYPH_CACHE_SIZE - 1);
+}
+
+TextGlyph *TextGlyphCache::GetGlyph(i32 fontHeight, char *character, i32 length)
+{
+    TextGlyph *glyph;
+    HFONT font;
+    SIZE extent;
+    i32 cellWidth;
+    i32 cellHeight;
+    u32 *row;
+    u32 pixel;
+    i32 x;
+    i32 y;
+    i32 left;
+    i32 top;
+    i32 right;
+    i32 bottom;
+    u8 coverage;
+    u32 key;
+    u32 slot;
+
+    key = fontHeight << 16 | (u8)character[0];
+    if (length == 2)
+    {
+        key = fontHeight << 16 | (u8)character[0] << 8 | (u8)character[1];
+    }
+    for (slot = HashTextGlyphKey(key); this->glyphs[slot].key != 0; slot = (slot + 1) & (TEXT_GLYPH_CACHE_SIZE - 1))
+    {
+        if (this->glyphs[slot].key == key)
+        {
+            this->hits++;
+            return &this->glyphs[slot];
+        }
+    }
+
+    this->misses++;
+    font = this->GetFont(fontHeight);
+    if (font == NULL)
+    {
+        return NULL;
+    }
+    SelectObject(this->hdc, font);
+    GetTextExtentPoint32A(this->hdc, character, length, &extent);
+    cellWidth = extent.cx + TEXT_GLYPH_PAD * 2;
+    cellHeight = extent.cy + TEXT_GLYPH_PAD;
+    if (cellWidth > TEXT_GLYPH_SCRATCH_WIDTH || cellHeight > TEXT_GLYPH_SCRATCH_HEIGHT)
+    {
+        return NULL;
+    }
+
+    // GDI clears the top byte of every pixel it writes, which tells the pixels it touched at zero coverage apart from
+    // the ones it never touched.
+    for (y = 0; y < cellHeight; y++)
+    {
+        row = &this->scratch[y * TEXT_GLYPH_SCRATCH_WIDTH];
+        for (x = 0; x < cellWidth; x++)
+        {
+            row[x] = 0xff000000;
+        }
+    }
+    TextOutA(this->hdc, TEXT_GLYPH_PAD, 0, character, length);
+    GdiFlush();
+
+    left = cellWidth;
+    top = cellHeight;
+    right = 0;
+    bottom = 0;
+    for (y = 0; y < cellHeight; y++)
+    {
+        row = &this->scratch[y * TEXT_GLYPH_SCRATCH_WIDTH];
+        for (x = 0; x < cellWidth; x++)
+        {
+            if ((row[x] >> 24) == 0)
+            {
+                left = ZUN_MIN(left, x);
+                top = ZUN_MIN(top, y);
+                right = ZUN_MAX(right, x + 1);
+                bottom = ZUN_MAX(bottom, y + 1);
+            }
+        }
+    }
+    if (right <= left)
+    {
+        left = right = top = bottom = 0;
+    }
+
+    // Make room before picking a slot, since dropping everything empties the table too.
+    if (this->shelfX + (right - left) > TEXT_GLYPH_ATLAS_WIDTH)
+    {
+        this->shelfX = 0;
+        this->shelfY += this->shelfHeight;
+        this->shelfHeight = 0;
+    }
+    if (this->shelfY + (bottom - top) > TEXT_GLYPH_ATLAS_HEIGHT ||
+        this->glyphCount >= TEXT_GLYPH_CACHE_SIZE * 3 / 4)
+    {
+        this->Flush();
+    }
+    for (slot = HashTextGlyphKey(key); this->glyphs[slot].key != 0; slot = (slot + 1) & (TEXT_GLYPH_CACHE_SIZE - 1))
+    {
+    }
+
+    glyph = &this->glyphs[slot];
+    glyph->key = key;
+    glyph->advance = extent.cx;
+    glyph->offsetX = left - TEXT_GLYPH_PAD;
+    glyph->offsetY = top;
+    glyph->width = right - left;
+    glyph->height = bottom - top;
+    glyph->atlasX = this->shelfX;
+    glyph->atlasY = this->shelfY;
+    for (y = 0; y < glyph->height; y++)
+    {
+        row = &this->scratch[(top + y) * TEXT_GLYPH_SCRATCH_WIDTH + left];
+        for (x = 0; x < glyph->width; x++)
+        {
+            pixel = row[x];
+            coverage = 0;
+            if ((pixel >> 24) == 0)
+            {
+                coverage = ZUN_MAX((pixel >> 8) & 0xff, 1);
+            }
+            this->atlas[(glyph->atlasY + y) * TEXT_GLYPH_ATLAS_WIDTH + glyph->atlasX + x] = coverage;
+        }
+    }
+    this->shelfX += glyph->width;
+    this->shelfHeight = ZUN_MAX(this->shelfHeight, glyph->height);
+    this->glyphCount++;
+    return glyph;
+}
+
+// Blends like GDI's grayscale antialiasing into a pixel, clearing alpha as GDI does.
+static u32 BlendGlyphChannel(u32 dst, u32 src, u32 coverage)
+{
+    return dst + ((i32)(src - dst) * (i32)coverage) / 255;
+}
+
+bool TextGlyphCache::ComposeString(TextHelper *target, i32 x, i32 y, i32 fontHeight, ZunColor color, char *string)
+{
+    TextGlyph *glyph;
+    u8 *src;
+    u8 *dstRow;
+    u16 *dst16;
+    u32 *dst32;
+    u32 pixel;
+    i32 length;
+    i32 penX;
+    i32 glyphX;
+    i32 glyphY;
+    i32 dstX;
+    i32 dstY;
+    u32 red;
+    u32 green;
+    u32 blue;
+    u32 coverage;
+
+    // ZunColor goes to SetTextColor as is, so it is a COLORREF here.
+    red = color & 0xff;
+    green = color >> 8 & 0xff;
+    blue = color >> 16 & 0xff;
+    for (penX = x; *string != '\0'; string += length)
+    {
+        length = IsDBCSLeadByteEx(932, (BYTE)*string) && string[1] != '\0' ? 2 : 1;
+        glyph = this->GetGlyph(fontHeight, string, length);
+        if (glyph == NULL)
+        {
+            return false;
+        }
+        for (glyphY = 0; glyphY < glyph->height; glyphY++)
+        {
+            dstY = y + glyph->offsetY + glyphY;
+            if (dstY < 0 || dstY >= target->height)
+            {
+                continue;
+            }
+            src = &this->atlas[(glyph->atlasY + glyphY) * TEXT_GLYPH_ATLAS_WIDTH + glyph->atlasX];
+            dstRow = &target->buffer[dstY * target->imageWidthInBytes];
+            for (glyphX = 0; glyphX < glyph->width; glyphX++)
+            {
+                dstX = penX + glyph->offsetX + glyphX;
+                coverage = src[glyphX];
+                if (coverage == 0 || dstX < 0 || dstX >= target->width)
+                {
+                    continue;
+                }
+                if (target->format == D3DFMT_A1R5G5B5)
+                {
+                    dst16 = (u16 *)dstRow + dstX;
+                    pixel = *dst16;
+                    pixel = (BlendGlyphChannel((pixel >> 7 & 0xf8) | (pixel >> 12 & 7), red, coverage) >> 3) << 10 |
+                            (BlendGlyphChannel((pixel >> 2 & 0xf8) | (pixel >> 7 & 7), green, coverage) >> 3) << 5 |
+                            BlendGlyphChannel((pixel << 3 & 0xf8) | (pixel >> 2 & 7), blue, coverage) >> 3;
+                    *dst16 = pixel;
+                }
+                else
+                {
+                    dst32 = (u32 *)dstRow + dstX;
+                    pixel = *dst32;
+                    *dst32 = BlendGlyphChannel(pixel >> 16 & 0xff, red, coverage) << 16 |
+                             BlendGlyphChannel(pixel >> 8 & 0xff, green, coverage) << 8 |
+                             BlendGlyphChannel(pixel & 0xff, blue, coverage);
+                }
+            }
+        }
+        penX += glyph->advance;
+    }
+    return true;
+}
+#endif
 }; // namespace th06
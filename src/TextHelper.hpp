@@ -5,6 +5,12 @@
 
 #include <d3d8.h>
 
+// TEXT_GLYPH_ATLAS builds strings from a cache of GDI-rasterized glyphs instead of drawing each one through GDI.
+// RenderTextToTexture stops matching the original binary, and the antialiased edges come out a little different.
+#if defined(TEXT_GLYPH_ATLAS) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "TEXT_GLYPH_ATLAS changes RenderTextToTexture"
+#endif
+
 namespace th06
 {
 struct FormatInfo
@@ -23,6 +29,15 @@ struct TextHelper
     static void RenderTextToTexture(i32 xPos, i32 yPos, i32 spriteWidth, i32 spriteHeight, i32 fontHeight,
                                     i32 fontWidth, ZunColor textColor, ZunColor shadowColor, char *string,
                                     IDirect3DTexture8 *outTexture);
+#ifdef TEXT_GLYPH_ATLAS
+    // Both leave target holding the string at twice its final size, ready for CopyTextToSurface. ComposeText builds
+    // it from g_TextGlyphCache and fails for formats it cannot blend into; RenderTextWithGdi is the original path,
+    // creating the font and drawing the whole string through GDI.
+    static bool ComposeText(TextHelper *target, i32 xPos, i32 spriteWidth, i32 fontHeight, ZunColor textColor,
+                            ZunColor shadowColor, char *string);
+    static void RenderTextWithGdi(TextHelper *target, i32 xPos, i32 spriteWidth, i32 fontHeight, ZunColor textColor,
+                                  ZunColor shadowColor, char *string);
+#endif
 
     TextHelper();
     ~TextHelper();
@@ -43,4 +58,68 @@ struct TextHelper
     HGDIOBJ gdiObj2;
     u8 *buffer;
 };
+
+#ifdef TEXT_GLYPH_ATLAS
+#define TEXT_GLYPH_CACHE_SIZE 2048
+#define TEXT_GLYPH_MAX_FONTS 8
+#define TEXT_GLYPH_ATLAS_WIDTH 1024
+#define TEXT_GLYPH_ATLAS_HEIGHT 1024
+#define TEXT_GLYPH_SCRATCH_WIDTH 256
+#define TEXT_GLYPH_SCRATCH_HEIGHT 128
+
+struct TextGlyph
+{
+    // Font height in the high word, the one or two Shift-JIS bytes in the low one. 0 for a free slot.
+    u32 key;
+    i16 advance;
+    // Where the covered pixels start relative to the pen position.
+    i16 offsetX;
+    i16 offsetY;
+    i16 width;
+    i16 height;
+    i16 atlasX;
+    i16 atlasY;
+};
+
+struct TextGlyphFont
+{
+    i32 fontHeight;
+    HFONT font;
+};
+
+// Every glyph the text renderer has drawn, rasterized once by GDI in white on black and kept as coverage in a shared
+// atlas: 0 where GDI left the pixel alone, otherwise how much of the text color it blended in. Strings are then put
+// together by blending those into the text buffer, shadow pass first, the way TextOutA draws them. When the atlas or
+// the table fills up everything is dropped and rebuilt on demand.
+struct TextGlyphCache
+{
+    TextGlyphCache();
+    ~TextGlyphCache();
+
+    bool Init();
+    void Release();
+    void Flush();
+
+    HFONT GetFont(i32 fontHeight);
+    TextGlyph *GetGlyph(i32 fontHeight, char *character, i32 length);
+    bool ComposeString(TextHelper *target, i32 x, i32 y, i32 fontHeight, ZunColor color, char *string);
+
+    HDC hdc;
+    HBITMAP scratchBitmap;
+    HGDIOBJ originalBitmap;
+    u32 *scratch;
+    TextGlyphFont fonts[TEXT_GLYPH_MAX_FONTS];
+    i32 fontCount;
+    TextGlyph glyphs[TEXT_GLYPH_CACHE_SIZE];
+    i32 glyphCount;
+    u8 *atlas;
+    i32 shelfX;
+    i32 shelfY;
+    i32 shelfHeight;
+    i32 hits;
+    i32 misses;
+};
+
+extern TextGlyphCache g_TextGlyphCache;
+#endif
 }; // namespace th06
@@ -49,6 +49,7 @@ struct ZunVec3
 ZUN_ASSERT_SIZE(ZunVec3, 0xC);
 
 #define ZUN_MIN(x, y) ((x) > (y) ? (y) : (x))
+#define ZUN_MAX(x, y) ((x) < (y) ? (y) : (x))
 #define ZUN_PI ((f32)(3.14159265358979323846))
 #define ZUN_2PI ((f32)(ZUN_PI * 2.0f))
 
@@ -0,0 +1,368 @@
+#include "ZunMemory.hpp"
+#include "AssetTrace.hpp"
+#include "utils.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace th06
+{
+ZunMemoryTracker g_ZunMemoryTracker;
+ZunArena g_ZunArenas[ZUN_ARENA_COUNT];
+
+static char *g_ZunArenaNames[ZUN_ARENA_COUNT] = {"global", "scene", "stage"};
+static char *g_ZunArenaTags[ZUN_ARENA_COUNT] = {"global arena", "scene arena", "stage arena"};
+
+static u32 HashZunMemoryPtr(void *ptr)
+{
+    return ((u32)((size_t)ptr >> 3) * 0x9e3779b1) & (ZUN_MEMORY_MAX_RECORDS - 1);
+}
+
+i32 ZunMemoryTracker::FindTag(const char *tag)
+{
+    i32 idx;
+
+    for (idx = 0; idx < this->numTags; idx++)
+    {
+        if (strncmp(this->tags[idx].name, tag, ZUN_MEMORY_TAG_LENGTH - 1) == 0)
+        {
+            return idx;
+        }
+    }
+    // Past the last tag, everything new shares it.
+    if (this->numTags == ZUN_MEMORY_MAX_TAGS)
+    {
+        return ZUN_MEMORY_MAX_TAGS - 1;
+    }
+    strncpy(this->tags[idx].name, this->numTags == ZUN_MEMORY_MAX_TAGS - 1 ? "other" : tag,
+            ZUN_MEMORY_TAG_LENGTH - 1);
+    this->numTags++;
+    return idx;
+}
+
+ZunMemoryRecord *ZunMemoryTracker::FindRecord(void *ptr)
+{
+    u32 idx;
+
+    for (idx = HashZunMemoryPtr(ptr); this->records[idx].ptr != NULL; idx = (idx + 1) & (ZUN_MEMORY_MAX_RECORDS - 1))
+    {
+        if (this->records[idx].ptr == ptr)
+        {
+            return &this->records[idx];
+        }
+    }
+    return NULL;
+}
+
+void *ZunMemoryTracker::Alloc(u32 size, const char *tag)
+{
+    ZunMemoryRecord *record;
+    ZunMemoryTag *memoryTag;
+    void *ptr;
+    u32 idx;
+
+    ptr = malloc(size);
+    if (ptr == NULL)
+    {
+        return NULL;
+    }
+    // The game thread makes the first allocation long before any other thread exists.
+    if (!this->isInitialized)
+    {
+        InitializeCriticalSection(&this->lock);
+        this->isInitialized = true;
+    }
+
+    EnterCriticalSection(&this->lock);
+    // Kept three quarters full at most, so a probe ends quickly.
+    if (this->numRecords >= ZUN_MEMORY_MAX_RECORDS / 4 * 3)
+    {
+        this->numUntracked++;
+        LeaveCriticalSection(&this->lock);
+        return ptr;
+    }
+    for (idx = HashZunMemoryPtr(ptr); this->records[idx].ptr != NULL; idx = (idx + 1) & (ZUN_MEMORY_MAX_RECORDS - 1))
+    {
+    }
+    record = &this->records[idx];
+    record->ptr = ptr;
+    record->size = size;
+    record->tag = this->FindTag(tag);
+    record->scene = this->scene;
+    this->numRecords++;
+
+    memoryTag = &this->tags[record->tag];
+    memoryTag->liveBytes += size;
+    memoryTag->numLive++;
+    memoryTag->numAllocs++;
+    if (memoryTag->liveBytes > memoryTag->peakBytes)
+    {
+        memoryTag->peakBytes = memoryTag->liveBytes;
+    }
+    this->liveBytes += size;
+    if (this->liveBytes > this->peakBytes)
+    {
+        this->peakBytes = this->liveBytes;
+    }
+    LeaveCriticalSection(&this->lock);
+    return ptr;
+}
+
+void ZunMemoryTracker::Free(void *ptr)
+{
+    ZunMemoryRecord *record;
+    ZunMemoryTag *memoryTag;
+    u32 hole;
+    u32 idx;
+    u32 home;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+    if (this->isInitialized)
+    {
+        EnterCriticalSection(&this->lock);
+        record = this->FindRecord(ptr);
+        if (record == NULL)
+        {
+            this->numUnknownFrees++;
+        }
+        else
+        {
+            memoryTag = &this->tags[record->tag];
+            memoryTag->liveBytes -= record->size;
+            memoryTag->numLive--;
+            this->liveBytes -= record->size;
+            this->numRecords--;
+
+            // Pull back whatever probed past the hole, so lookups never stop short at it.
+            hole = record - this->records;
+            record->ptr = NULL;
+            for (idx = (hole + 1) & (ZUN_MEMORY_MAX_RECORDS - 1); this->records[idx].ptr != NULL;
+                 idx = (idx + 1) & (ZUN_MEMORY_MAX_RECORDS - 1))
+            {
+                home = HashZunMemoryPtr(this->records[idx].ptr);
+                if (hole <= idx ? (hole < home && home <= idx) : (hole < home || home <= idx))
+                {
+                    continue;
+                }
+                this->records[hole] = this->records[idx];
+                this->records[idx].ptr = NULL;
+                hole = idx;
+            }
+        }
+        LeaveCriticalSection(&this->lock);
+    }
+    free(ptr);
+}
+
+const char *ZunMemoryTracker::GetFileTag(const char *path)
+{
+    const char *extension;
+
+    extension = strrchr(path, '.');
+    return extension != NULL ? extension : "file";
+}
+
+void ZunMemoryTracker::EnterScene(i32 scene)
+{
+    char title[64];
+
+    sprintf(title, "%s -> %s", AssetTrace::GetSceneName(this->scene), AssetTrace::GetSceneName(scene));
+    this->WriteReport(ZUN_MEMORY_LOG, title);
+    this->scene = scene;
+}
+
+ZunResult ZunMemoryTracker::WriteReport(const char *path, const char *title)
+{
+    static u32 leftBytes[ASSET_SCENE_COUNT][ZUN_MEMORY_MAX_TAGS];
+    static u32 leftCount[ASSET_SCENE_COUNT];
+    FILE *file;
+    ZunMemoryRecord *record;
+    ZunMemoryTag *memoryTag;
+    i32 idx;
+    i32 tagIdx;
+    i32 scene;
+
+    file = fopen(path, "a");
+    if (file == NULL)
+    {
+        return ZUN_ERROR;
+    }
+    if (!this->isInitialized)
+    {
+        InitializeCriticalSection(&this->lock);
+        this->isInitialized = true;
+    }
+    EnterCriticalSection(&this->lock);
+
+    fprintf(file, "== %s: %u bytes live in %d allocations, peak %u\n", title, this->liveBytes, this->numRecords,
+            this->peakBytes);
+    fprintf(file, "%-16s %10s %10s %6s %6s\n", "tag", "live", "peak", "count", "new");
+    for (tagIdx = 0; tagIdx < this->numTags; tagIdx++)
+    {
+        memoryTag = &this->tags[tagIdx];
+        if (memoryTag->numLive != 0 || memoryTag->numAllocs != 0)
+        {
+            fprintf(file, "%-16s %10u %10u %6u %6u\n", memoryTag->name, memoryTag->liveBytes, memoryTag->peakBytes,
+                    memoryTag->numLive, memoryTag->numAllocs);
+        }
+        memoryTag->numAllocs = 0;
+    }
+
+    // Boot loads what the game keeps for good, and the scene being left may still be tearing down.
+    memset(leftBytes, 0, sizeof(leftBytes));
+    memset(leftCount, 0, sizeof(leftCount));
+    for (idx = 0; idx < ZUN_MEMORY_MAX_RECORDS; idx++)
+    {
+        record = &this->records[idx];
+        if (record->ptr != NULL && record->scene != ASSET_SCENE_BOOT && record->scene != this->scene)
+        {
+            leftBytes[record->scene][record->tag] += record->size;
+            leftCount[record->scene]++;
+        }
+    }
+    for (scene = 0; scene < ASSET_SCENE_COUNT; scene++)
+    {
+        if (leftCount[scene] == 0)
+        {
+            continue;
+        }
+        fprintf(file, "still live from %s: %u allocations,", AssetTrace::GetSceneName(scene), leftCount[scene]);
+        for (tagIdx = 0; tagIdx < this->numTags; tagIdx++)
+        {
+            if (leftBytes[scene][tagIdx] != 0)
+            {
+                fprintf(file, " %s %u", this->tags[tagIdx].name, leftBytes[scene][tagIdx]);
+            }
+        }
+        fprintf(file, "\n");
+    }
+    if (this->numUntracked != 0 || this->numUnknownFrees != 0)
+    {
+        fprintf(file, "%u allocations not recorded, %u frees of unknown pointers\n", this->numUntracked,
+                this->numUnknownFrees);
+    }
+
+    LeaveCriticalSection(&this->lock);
+    fclose(file);
+    return ZUN_SUCCESS;
+}
+
+static ZunArenaBlock *NewArenaBlock(ZunArena *arena, u32 size)
+{
+    ZunArenaBlock *block;
+    const char *tag;
+
+    tag = arena >= g_ZunArenas && arena < g_ZunArenas + ZUN_ARENA_COUNT ? g_ZunArenaTags[arena - g_ZunArenas] : "arena";
+    block = (ZunArenaBlock *)ZunAlloc(sizeof(ZunArenaBlock) + ZUN_ARENA_ALIGN + size, tag);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    block->next = NULL;
+    block->data = (u8 *)(block + 1);
+    block->data += (ZUN_ARENA_ALIGN - (size_t)block->data % ZUN_ARENA_ALIGN) % ZUN_ARENA_ALIGN;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+void *ZunArena::Alloc(u32 size)
+{
+    ZunArenaBlock *block;
+    void *ptr;
+
+    size = (size + ZUN_ARENA_ALIGN - 1) & ~(ZUN_ARENA_ALIGN - 1);
+    for (block = this->blocks; block != NULL; block = block->next)
+    {
+        if (block->size - block->used >= size)
+        {
+            break;
+        }
+    }
+    if (block == NULL)
+    {
+        block = NewArenaBlock(this, size > ZUN_ARENA_BLOCK_SIZE ? size : ZUN_ARENA_BLOCK_SIZE);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        block->next = this->blocks;
+        this->blocks = block;
+        this->reservedBytes += block->size;
+    }
+
+    ptr = block->data + block->used;
+    block->used += size;
+    this->usedBytes += size;
+    this->numAllocs++;
+    if (this->usedBytes > this->peakBytes)
+    {
+        this->peakBytes = this->usedBytes;
+    }
+    return ptr;
+}
+
+ZunBool ZunArena::Owns(void *ptr)
+{
+    ZunArenaBlock *block;
+
+    for (block = this->blocks; block != NULL; block = block->next)
+    {
+        if ((u8 *)ptr >= block->data && (u8 *)ptr < block->data + block->size)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ZunArena::Reset()
+{
+    ZunArenaBlock *block;
+
+    for (block = this->blocks; block != NULL; block = block->next)
+    {
+        block->used = 0;
+    }
+    this->usedBytes = 0;
+    this->numAllocs = 0;
+    this->numResets++;
+}
+
+void ZunArena::Release()
+{
+    ZunArenaBlock *block;
+    ZunArenaBlock *next;
+
+    for (block = this->blocks; block != NULL; block = next)
+    {
+        next = block->next;
+        ZunFree(block);
+    }
+    this->blocks = NULL;
+    this->usedBytes = 0;
+    this->reservedBytes = 0;
+}
+
+char *ZunArenaName(ZunArenaIdx arena)
+{
+    return g_ZunArenaNames[arena];
+}
+
+void ZunArenaPrintStats()
+{
+    ZunArena *arena;
+    i32 idx;
+
+    for (idx = 0; idx < ZUN_ARENA_COUNT; idx++)
+    {
+        arena = &g_ZunArenas[idx];
+        utils::DebugPrint2("arena : %s, %d bytes in %d allocs, peak %d, %d reserved, reset %d times\n",
+                           g_ZunArenaNames[idx], arena->usedBytes, arena->numAllocs, arena->peakBytes,
+                           arena->reservedBytes, arena->numResets);
+    }
+}
+}; // namespace th06
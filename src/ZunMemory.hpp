@@ -1,20 +1,177 @@
 #pragma once
 
+#include <Windows.h>
 #include <stdlib.h>
 
+#include "ZunBool.hpp"
+#include "ZunResult.hpp"
+#include "inttypes.hpp"
+
 // In later games, ZUN uses a class we're calling "ZunMemory" to track allocated data for debugging
 // purposes. Although this struct's full form does not seem to be present in EoSD, quirks in the
 // codegen do reveal the existence of some early version of this system.
 
+// ZUN_MEMORY_TRACKING sends every ZunAlloc and ZunFree through g_ZunMemoryTracker, and writes what's live to
+// ZUN_MEMORY_LOG whenever the scene changes.
+#if defined(ZUN_MEMORY_TRACKING) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "ZUN_MEMORY_TRACKING changes every allocation the game makes"
+#endif
+
+// ZUN_ARENAS loads stage scripts, data and anm files into g_ZunArenas, and resets them between stages. The loaders and
+// the functions releasing their files stop matching the original binary.
+#if defined(ZUN_ARENAS) && (defined(BINARYMATCHBUILD) || defined(DIFFBUILD) || defined(DLLBUILD))
+#error "ZUN_ARENAS changes where the stage loaders put their files"
+#endif
+
 namespace th06
 {
-inline void *ZunAlloc(i32 size)
+#define ZUN_MEMORY_LOG "memtrack.log"
+#define ZUN_MEMORY_MAX_TAGS 0x40
+#define ZUN_MEMORY_TAG_LENGTH 16
+// Allocations live at once. A power of two, since it's the size of the hash table.
+#define ZUN_MEMORY_MAX_RECORDS 0x4000
+
+struct ZunMemoryTag
+{
+    char name[ZUN_MEMORY_TAG_LENGTH];
+    u32 liveBytes;
+    u32 peakBytes;
+    u32 numLive;
+    u32 numAllocs;
+};
+
+struct ZunMemoryRecord
+{
+    void *ptr;
+    u32 size;
+    u8 tag;
+    u8 scene;
+};
+
+// Every live allocation, with the tag its call site gave it and the AssetScene it was made in, and for each tag the
+// bytes live and the most there have ever been. Any thread may allocate through it. Zeroed is ready to use, so
+// allocations made before main count too.
+struct ZunMemoryTracker
+{
+    void *Alloc(u32 size, const char *tag);
+    void Free(void *ptr);
+
+    // Appends a report on the scene being left to ZUN_MEMORY_LOG, then counts allocations against scene.
+    void EnterScene(i32 scene);
+    // Every tag that has anything live or was used since the last report, then what older scenes still have live,
+    // which in a long session is where leaks show up.
+    ZunResult WriteReport(const char *path, const char *title);
+
+    i32 FindTag(const char *tag);
+    ZunMemoryRecord *FindRecord(void *ptr);
+    // The tag for a file's buffer: its extension, so textures, scripts and sounds add up apart.
+    static const char *GetFileTag(const char *path);
+
+    ZunBool isInitialized;
+    CRITICAL_SECTION lock;
+    ZunMemoryTag tags[ZUN_MEMORY_MAX_TAGS];
+    i32 numTags;
+    // Open addressing on the pointer.
+    ZunMemoryRecord records[ZUN_MEMORY_MAX_RECORDS];
+    i32 numRecords;
+    i32 scene;
+    u32 liveBytes;
+    u32 peakBytes;
+    // Allocated with no room left to record them, and freed without ever having been recorded.
+    u32 numUntracked;
+    u32 numUnknownFrees;
+};
+
+extern ZunMemoryTracker g_ZunMemoryTracker;
+
+enum ZunArenaIdx
+{
+    // Lives until the game exits.
+    ZUN_ARENA_GLOBAL,
+    // A play session, from starting a game to leaving it: what the game keeps loaded from one stage to the next.
+    ZUN_ARENA_SCENE,
+    // One stage, or one try at it: script and data files, and the stage's own anm files.
+    ZUN_ARENA_STAGE,
+    ZUN_ARENA_COUNT,
+};
+
+// Big enough that a stage's files fit in the first block.
+#define ZUN_ARENA_BLOCK_SIZE 0x80000
+#define ZUN_ARENA_ALIGN 16
+
+struct ZunArenaBlock
 {
+    ZunArenaBlock *next;
+    // After the header, lined up to ZUN_ARENA_ALIGN, which malloc alone doesn't promise.
+    u8 *data;
+    u32 size;
+    u32 used;
+};
+
+// Hands out memory from big blocks, and takes it all back at once when Reset, rather than a free at a time. What
+// goes in an arena is freed with ZunFree(ptr, arena), which leaves it be.
+struct ZunArena
+{
+    void *Alloc(u32 size);
+    ZunBool Owns(void *ptr);
+    // Forgets everything allocated, but keeps the blocks for the next round. A pointer from before the reset is then
+    // still inside one of them, so a late ZunFree(ptr, arena) still leaves it be rather than handing it to free.
+    void Reset();
+    // Gives the blocks back to the heap. Nothing may still point into them.
+    void Release();
+
+    // Newest first. Allocations come out of the first one with room.
+    ZunArenaBlock *blocks;
+
+    u32 usedBytes;
+    u32 peakBytes;
+    u32 reservedBytes;
+    u32 numAllocs;
+    u32 numResets;
+};
+
+extern ZunArena g_ZunArenas[ZUN_ARENA_COUNT];
+
+char *ZunArenaName(ZunArenaIdx arena);
+// Prints what each arena holds, and the most it has held.
+void ZunArenaPrintStats();
+
+// tag says what the memory is for in ZUN_MEMORY_TRACKING's reports. Only the first ZUN_MEMORY_TAG_LENGTH - 1
+// characters count.
+inline void *ZunAlloc(i32 size, const char *tag)
+{
+#ifdef ZUN_MEMORY_TRACKING
+    return g_ZunMemoryTracker.Alloc(size, tag);
+#else
     return malloc(size);
+#endif
+}
+
+inline void *ZunAlloc(i32 size)
+{
+    return ZunAlloc(size, "untagged");
 }
 
 inline void ZunFree(void *ptr)
 {
+#ifdef ZUN_MEMORY_TRACKING
+    g_ZunMemoryTracker.Free(ptr);
+#else
     free(ptr);
+#endif
+}
+
+inline void *ZunAlloc(i32 size, ZunArenaIdx arena)
+{
+    return g_ZunArenas[arena].Alloc(size);
+}
+
+// Frees ptr, unless it came out of arena, which gets it back when it's reset.
+inline void ZunFree(void *ptr, ZunArenaIdx arena)
+{
+    if (!g_ZunArenas[arena].Owns(ptr))
+    {
+        ZunFree(ptr);
+    }
 }
 }; // namespace th06
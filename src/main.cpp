@@ -4,15 +4,25 @@
 
 #include <D3DX8.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "AnmManager.hpp"
+#include "AssetPreload.hpp"
+#include "AssetTrace.hpp"
 #include "Chain.hpp"
+#include "ChainProfiler.hpp"
 #include "FileSystem.hpp"
+#include "FixedStep.hpp"
 #include "GameErrorContext.hpp"
 #include "GameWindow.hpp"
+#include "MidiTimeline.hpp"
+#include "PerfStats.hpp"
+#include "SoftwareD3dDevice.hpp"
+#include "SoundMixer.hpp"
 #include "SoundPlayer.hpp"
 #include "Stage.hpp"
 #include "Supervisor.hpp"
+#include "ZunMemory.hpp"
 #include "ZunResult.hpp"
 #include "i18n.hpp"
 #include "utils.hpp"
@@ -64,13 +74,55 @@ restart:
         g_GameErrorContext.Flush();
         return 1;
     }
+#ifdef SOFTWARE_RENDERER
+    // Before anything creates textures, as they belong to the device that draws with them.
+    if (strstr(lpCmdLine, "-swrender") != NULL)
+    {
+        GameWindow::InitSoftwareRendering();
+    }
+#endif
 
     g_SoundPlayer.InitializeDSound(g_GameWindow.window);
+#ifdef MIDI_TIMELINE
+    g_MidiTimeline.isEnabled = strstr(lpCmdLine, "-miditimeline") != NULL;
+#endif
+#ifdef SOUND_MIXER
+    // Before RegisterChain, which loads the sound effects the mixer needs to have.
+    if (strstr(lpCmdLine, "-audiowav") != NULL)
+    {
+        if (g_SoundMixerWavSink.Open("audio.wav") == ZUN_SUCCESS)
+        {
+            g_SoundMixer.Start(&g_SoundMixerWavSink);
+        }
+    }
+    else if (strstr(lpCmdLine, "-audionull") != NULL)
+    {
+        g_SoundMixer.Start(&g_SoundMixerNullSink);
+    }
+    else if (strstr(lpCmdLine, "-swmixer") != NULL && g_SoundPlayer.dsoundHdl != NULL)
+    {
+        if (g_SoundMixerDSoundSink.Open(g_SoundPlayer.dsoundHdl) == ZUN_SUCCESS)
+        {
+            g_SoundMixer.Start(&g_SoundMixerDSoundSink);
+        }
+    }
+#endif
     Controller::GetJoystickCaps();
     Controller::ResetKeyboard();
 
     g_AnmManager = new AnmManager();
 
+#ifdef ASSET_TRACE
+    // Before RegisterChain, which opens the archives and loads the first files.
+    if (strstr(lpCmdLine, "-assettrace") != NULL && !g_AssetTrace.isEnabled)
+    {
+        g_AssetTrace.Start();
+    }
+    if (strstr(lpCmdLine, "-preload") != NULL)
+    {
+        g_AssetPreload.isEnabled = g_AssetPreload.LoadManifest("preload.txt") == ZUN_SUCCESS;
+    }
+#endif
     if (Supervisor::RegisterChain() != ZUN_SUCCESS)
     {
         goto stop;
@@ -82,6 +134,29 @@ restart:
 
     g_GameWindow.curFrame = 0;
 
+#ifdef CHAIN_PROFILER
+    if (strstr(lpCmdLine, "-chaintrace") != NULL)
+    {
+        g_ChainProfiler.Start();
+    }
+#endif
+#ifdef PERF_OVERLAY
+    if (strstr(lpCmdLine, "-perfoverlay") != NULL || strstr(lpCmdLine, "-perfcsv") != NULL)
+    {
+        g_PerfStats.Start(strstr(lpCmdLine, "-perfoverlay") != NULL);
+    }
+    if (strstr(lpCmdLine, "-perfcsv") != NULL)
+    {
+        g_PerfStats.OpenCsv("perfstats.csv");
+    }
+#endif
+#ifdef FIXED_STEP
+    if (strstr(lpCmdLine, "-fixedstep") != NULL)
+    {
+        g_FixedStep.Start();
+    }
+#endif
+
     while (!g_GameWindow.isAppClosing)
     {
         if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
@@ -115,11 +190,40 @@ restart:
     }
 
 stop:
+#ifdef CHAIN_PROFILER
+    if (g_ChainProfiler.isEnabled)
+    {
+        g_ChainProfiler.Stop();
+        g_ChainProfiler.ExportChromeTrace("chaintrace.json");
+    }
+#endif
+#ifdef ASSET_TRACE
+    if (g_AssetTrace.isEnabled)
+    {
+        g_AssetTrace.WriteCsv("assettrace.csv");
+    }
+    g_AssetPreload.Stop();
+#endif
+#ifdef ZUN_ARENAS
+    ZunArenaPrintStats();
+#endif
+#ifdef PERF_OVERLAY
+    g_PerfStats.CloseCsv();
+#endif
     g_Chain.Release();
     g_SoundPlayer.Release();
 
     delete g_AnmManager;
     g_AnmManager = NULL;
+#ifdef SOFTWARE_RENDERER
+    // Unlike a real device, the software one doesn't free itself on its last Release.
+    if (g_SoftwareD3dDevice != NULL)
+    {
+        g_Supervisor.d3dDevice = NULL;
+        delete g_SoftwareD3dDevice;
+        g_SoftwareD3dDevice = NULL;
+    }
+#endif
     if (g_Supervisor.d3dDevice != NULL)
     {
         g_Supervisor.d3dDevice->Release();
@@ -156,5 +260,8 @@ stop:
 
     ShowCursor(TRUE);
     g_GameErrorContext.Flush();
+#ifdef ZUN_MEMORY_TRACKING
+    g_ZunMemoryTracker.WriteReport(ZUN_MEMORY_LOG, "exit");
+#endif
     return 0;
 }
@@ -1,6 +1,7 @@
 #include <stddef.h>
 
 #include "pbg3/Pbg3Archive.hpp"
+#include "ZunMemory.hpp"
 
 namespace th06
 {
@@ -148,13 +149,13 @@ u8 *Pbg3Archive::ReadEntryRaw(u32 *outSize, u32 *outChecksum, i32 entryIdx)
         size = this->entries[entryIdx + 1].dataOffset - this->entries[entryIdx].dataOffset;
     }
 
-    u8 *data = (u8 *)malloc(size);
+    u8 *data = (u8 *)ZunAlloc(size, "pbg3 raw");
     if (data == NULL)
         return NULL;
 
     if (this->parser->ReadByteAlignedData(data, size) == FALSE)
     {
-        free(data);
+        ZunFree(data);
         return NULL;
     }
 
@@ -244,13 +245,21 @@ i32 Pbg3Archive::Load(char *path)
         DEC_NEXT_BIT();                                                                                                \
     }
 
+#ifdef ZUN_ARENAS
+u8 *Pbg3Archive::ReadDecompressEntry(u32 entryIdx, char *filename, u8 *dest)
+#else
 u8 *Pbg3Archive::ReadDecompressEntry(u32 entryIdx, char *filename)
+#endif
 {
     if (entryIdx >= this->numOfEntries || this->parser == NULL)
         return NULL;
 
     u32 size = this->GetEntrySize(entryIdx);
-    u8 *out = (u8 *)malloc(size);
+#ifdef ZUN_ARENAS
+    u8 *out = dest != NULL ? dest : (u8 *)ZunAlloc(size, ZunMemoryTracker::GetFileTag(filename));
+#else
+    u8 *out = (u8 *)ZunAlloc(size, ZunMemoryTracker::GetFileTag(filename));
+#endif
     if (out == NULL)
         return NULL;
 
@@ -261,9 +270,13 @@ u8 *Pbg3Archive::ReadDecompressEntry(u32 entryIdx, char *filename)
 
     if (rawData == NULL)
     {
+#ifdef ZUN_ARENAS
+        if (out != NULL && dest == NULL)
+#else
         if (out != NULL)
+#endif
         {
-            free(out);
+            ZunFree(out);
             out = NULL;
         }
         return NULL;
@@ -325,13 +338,17 @@ u8 *Pbg3Archive::ReadDecompressEntry(u32 entryIdx, char *filename)
         DEC_READ_FLAG_BIT();
     }
 
-    free(rawData);
+    ZunFree(rawData);
 
     if (this->entries[entryIdx].checksum != checksum)
     {
+#ifdef ZUN_ARENAS
+        if (out != NULL && dest == NULL)
+#else
         if (out != NULL)
+#endif
         {
-            free(out);
+            ZunFree(out);
             out = NULL;
         }
         return NULL;
@@ -30,7 +30,13 @@ class Pbg3Archive
     i32 FindEntry(char *path);
     u32 GetEntrySize(u32 entryIdx);
     u8 *ReadEntryRaw(u32 *outSize, u32 *outChecksum, i32 entryIdx);
+#ifdef ZUN_ARENAS
+    // With dest, which must hold GetEntrySize(entryIdx) bytes, the entry is decoded there instead of into a new
+    // buffer. dest stays the caller's even if decoding fails.
+    u8 *ReadDecompressEntry(u32 entryIdx, char *filename, u8 *dest = NULL);
+#else
     u8 *ReadDecompressEntry(u32 entryIdx, char *filename);
+#endif
 
   private:
     Pbg3Parser *parser;
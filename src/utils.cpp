@@ -5,6 +5,7 @@
 
 #include <windows.h>
 
+#include "ZunBool.hpp"
 #include "ZunMath.hpp"
 #include "i18n.hpp"
 #include "utils.hpp"
@@ -78,6 +79,64 @@ void Rotate(D3DXVECTOR3 *outVector, D3DXVECTOR3 *point, f32 angle)
     outVector->y = cosOut * point->y - sinOut * point->x;
 }
 
+// Queried once and cached, SIMD paths check this before picking their kernel so the game still runs on the
+// plain Pentiums it was built for.
+u32 GetCpuFeatures()
+{
+    static u32 cpuFeatures = 0;
+    static ZunBool isQueried = false;
+    u32 hasCpuid;
+    u32 edxFeatures;
+
+    if (isQueried)
+    {
+        return cpuFeatures;
+    }
+    isQueried = true;
+
+    // CPUID is only available if the ID bit of EFLAGS can be toggled.
+    __asm {
+        pushfd
+        pop eax
+        mov ecx, eax
+        xor eax, 0x200000
+        push eax
+        popfd
+        pushfd
+        pop eax
+        push ecx
+        popfd
+        xor eax, ecx
+        and eax, 0x200000
+        mov hasCpuid, eax
+    }
+    if (hasCpuid == 0)
+    {
+        return cpuFeatures;
+    }
+
+    __asm {
+        push ebx
+        mov eax, 1
+        cpuid
+        mov edxFeatures, edx
+        pop ebx
+    }
+    if (edxFeatures & ZUN_BIT(23))
+    {
+        cpuFeatures |= CPU_FEATURE_MMX;
+    }
+    if (edxFeatures & ZUN_BIT(25))
+    {
+        cpuFeatures |= CPU_FEATURE_SSE;
+    }
+    if (edxFeatures & ZUN_BIT(26))
+    {
+        cpuFeatures |= CPU_FEATURE_SSE2;
+    }
+    return cpuFeatures;
+}
+
 void DebugPrint2(const char *fmt, ...)
 {
 #ifdef DEBUG
@@ -12,6 +12,10 @@
 #define ZUN_RANGE(a, count) (ZUN_MASK((a) + (count)) & ~ZUN_MASK(a))
 #define ZUN_CLEAR_BITS(a, keep_mask) (a & ~keep_mask)
 
+#define CPU_FEATURE_MMX ZUN_BIT(0)
+#define CPU_FEATURE_SSE ZUN_BIT(1)
+#define CPU_FEATURE_SSE2 ZUN_BIT(2)
+
 #define IS_PRESSED(key) (g_CurFrameInput & (key))
 #define WAS_PRESSED(key) (((g_CurFrameInput & (key)) != 0) && (g_CurFrameInput & (key)) != (g_LastFrameInput & (key)))
 #define WAS_PRESSED_WEIRD(key)                                                                                         \
@@ -27,5 +31,7 @@ void DebugPrint2(const char *fmt, ...);
 
 f32 AddNormalizeAngle(f32 a, f32 b);
 void Rotate(D3DXVECTOR3 *outVector, D3DXVECTOR3 *point, f32 angle);
+
+u32 GetCpuFeatures();
 }; // namespace utils
 }; // namespace th06
@@ -480,6 +480,9 @@ CStreamingSound::CStreamingSound(LPDIRECTSOUNDBUFFER pDSBuffer, DWORD dwDSBuffer
     m_dwNotifySize = dwNotifySize;
     m_dwNextWriteOffset = 0;
     m_bFillNextNotificationWithSilence = FALSE;
+#ifdef BGM_READ_AHEAD
+    m_pReadAhead = NULL;
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -544,7 +547,11 @@ HRESULT CStreamingSound::HandleWaveStreamNotification(BOOL bLoopedPlay)
     if (bRestored)
     {
         // The buffer was restored, so we need to fill it with new data
+#ifdef BGM_READ_AHEAD
+        if (FAILED(hr = m_pReadAhead != NULL ? FillBufferFromReadAhead() : FillBufferWithSound(m_apDSBuffer[0], FALSE)))
+#else
         if (FAILED(hr = FillBufferWithSound(m_apDSBuffer[0], FALSE)))
+#endif
         {
             utils::DebugPrint2("error : FillBufferWithSound in HandleWaveStreamNotification\n");
             return DXTRACE_ERR(TEXT("FillBufferWithSound"), hr);
@@ -570,7 +577,11 @@ HRESULT CStreamingSound::HandleWaveStreamNotification(BOOL bLoopedPlay)
     if (!m_bFillNextNotificationWithSilence)
     {
         // Fill the DirectSound buffer with wav data
+#ifdef BGM_READ_AHEAD
+        if (FAILED(hr = ReadStreamData((BYTE *)pDSLockedBuffer, dwDSLockedBufferSize, &dwBytesWrittenToBuffer)))
+#else
         if (FAILED(hr = m_pWaveFile->Read((BYTE *)pDSLockedBuffer, dwDSLockedBufferSize, &dwBytesWrittenToBuffer)))
+#endif
         {
             utils::DebugPrint2("error : m_pWaveFile->Read in HandleWaveStreamNotification\n");
             return DXTRACE_ERR(TEXT("Read"), hr);
@@ -661,6 +672,51 @@ HRESULT CStreamingSound::HandleWaveStreamNotification(BOOL bLoopedPlay)
     return S_OK;
 }
 
+#ifdef BGM_READ_AHEAD
+//-----------------------------------------------------------------------------
+// Name: CStreamingSound::ReadStreamData()
+// Desc: Reads wave data from the read ahead ring when there is one, and from
+//       the wave file otherwise. The ring never comes up short while its
+//       source loops; frames its producer has yet to write are silence.
+//-----------------------------------------------------------------------------
+HRESULT CStreamingSound::ReadStreamData(BYTE *pbBuffer, DWORD dwSizeToRead, DWORD *pdwSizeRead)
+{
+    DWORD dwFrameSize;
+
+    if (m_pReadAhead == NULL)
+        return m_pWaveFile->Read(pbBuffer, dwSizeToRead, pdwSizeRead);
+
+    dwFrameSize = SOUND_MIXER_CHANNELS * sizeof(i16);
+    *pdwSizeRead = BgmStream::Read(m_pReadAhead, (i16 *)pbBuffer, dwSizeToRead / dwFrameSize) * dwFrameSize;
+    return S_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Name: CStreamingSound::FillBufferFromReadAhead()
+// Desc: FillBufferWithSound for a restored buffer while the read ahead runs.
+//       Rewinding the wave file under the producer thread isn't an option,
+//       so the music carries on from the ring instead of starting over.
+//-----------------------------------------------------------------------------
+HRESULT CStreamingSound::FillBufferFromReadAhead()
+{
+    HRESULT hr;
+    VOID *pDSLockedBuffer = NULL;
+    DWORD dwDSLockedBufferSize = 0;
+    DWORD dwDataRead = 0;
+
+    if (FAILED(hr = m_apDSBuffer[0]->Lock(0, m_dwDSBufferSize, &pDSLockedBuffer, &dwDSLockedBufferSize, NULL, NULL,
+                                          0L)))
+        return DXTRACE_ERR(TEXT("Lock"), hr);
+
+    ReadStreamData((BYTE *)pDSLockedBuffer, dwDSLockedBufferSize, &dwDataRead);
+    if (dwDataRead < dwDSLockedBufferSize)
+        FillMemory((BYTE *)pDSLockedBuffer + dwDataRead, dwDSLockedBufferSize - dwDataRead, 0);
+
+    m_apDSBuffer[0]->Unlock(pDSLockedBuffer, dwDSLockedBufferSize, NULL, 0);
+    return S_OK;
+}
+
+#endif
 //-----------------------------------------------------------------------------
 // Name: CStreamingSound::Reset()
 // Desc: Resets the sound so it will begin playing at the beginning
@@ -13,6 +13,9 @@
 #include <mmreg.h>
 #include <mmsystem.h>
 #include <windows.h>
+#ifdef BGM_READ_AHEAD
+#include "BgmStream.hpp"
+#endif
 
 namespace th06
 {
@@ -124,6 +127,11 @@ class CStreamingSound : public CSound
     DWORD m_dwNotifySize;
     DWORD m_dwNextWriteOffset;
     BOOL m_bFillNextNotificationWithSilence;
+#ifdef BGM_READ_AHEAD
+
+    HRESULT ReadStreamData(BYTE *pbBuffer, DWORD dwSizeToRead, DWORD *pdwSizeRead);
+    HRESULT FillBufferFromReadAhead();
+#endif
 
   public:
     CStreamingSound(LPDIRECTSOUNDBUFFER pDSBuffer, DWORD dwDSBufferSize, CWaveFile *pWaveFile, DWORD dwNotifySize);
@@ -132,6 +140,11 @@ class CStreamingSound : public CSound
     HRESULT UpdateFadeOut();
     HRESULT HandleWaveStreamNotification(BOOL bLoopedPlay);
     HRESULT Reset();
+#ifdef BGM_READ_AHEAD
+
+    // When set, the wave data comes out of this ring instead of m_pWaveFile, which only its producer thread reads.
+    BgmStream *m_pReadAhead;
+#endif
 };
 
 //-----------------------------------------------------------------------------
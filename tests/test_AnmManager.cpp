@@ -0,0 +1,507 @@
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "AnmManager.hpp"
+#include "D3dStateCache.hpp"
+#include "FileSystem.hpp"
+#include "GameWindow.hpp"
+#include "RecordingD3dDevice.hpp"
+#include "Rng.hpp"
+#include "Supervisor.hpp"
+#include "pbg3/Pbg3Archive.hpp"
+#include "utils.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+namespace th06
+{
+// Where Draw leaves the quad it submitted, for each vertex path.
+extern VertexTex1Xyzrwh g_PrimitivesToDrawVertexBuf[4];
+extern VertexTex1DiffuseXyzrwh g_PrimitivesToDrawNoVertexBuf[4];
+}; // namespace th06
+
+#define ANM_TEST_FILE_SIZE 0x200
+#define ANM_TEST_SPRITE_TABLE 0x60
+#define ANM_TEST_SCRIPT_START 0x90
+#define ANM_TEST_VM_COUNT 512
+#define ANM_TEST_FRAME_COUNT 600
+
+static u32 g_AnmTestFile[ANM_TEST_FILE_SIZE / sizeof(u32)];
+static u32 g_AnmTestCursor;
+static u32 g_AnmTestLoopOffset;
+static u32 g_AnmTestJumpOffset;
+static u32 g_AnmTestLastOffset;
+static AnmManager *g_AnmTestManager;
+static AnmVm g_AnmTestVms[ANM_TEST_VM_COUNT];
+static AnmVm g_AnmTestRawVms[ANM_TEST_VM_COUNT];
+#ifdef BATCHED_SPRITES
+static AnmSpriteBatch g_AnmTestBatch;
+static VertexTex1DiffuseXyzrwh g_AnmTestQuads[ANM_TEST_VM_COUNT * 4];
+static RecordingD3dDevice *g_AnmTestDevice;
+static IDirect3DDevice8 *g_AnmTestSavedDevice;
+#endif
+
+static AnmRawEntry *AnmTestEntry()
+{
+    return (AnmRawEntry *)g_AnmTestFile;
+}
+
+static AnmRawInstr *AnmTestInstrAt(u32 offset)
+{
+    return (AnmRawInstr *)((u8 *)g_AnmTestFile + offset);
+}
+
+static u32 FloatArg(f32 value)
+{
+    return *(u32 *)&value;
+}
+
+static u32 WriteAnmInstr(i16 time, u8 opcode, i32 argCount, u32 arg0, u32 arg1, u32 arg2, u32 arg3)
+{
+    AnmRawInstr *instr = AnmTestInstrAt(g_AnmTestCursor);
+    u32 offset = g_AnmTestCursor;
+
+    instr->time = time;
+    instr->opcode = opcode;
+    instr->argsCount = argCount * sizeof(u32);
+    instr->args[0] = arg0;
+    instr->args[1] = arg1;
+    instr->args[2] = arg2;
+    instr->args[3] = arg3;
+    g_AnmTestCursor += (u8 *)&instr->args[argCount] - (u8 *)instr;
+    return offset;
+}
+
+// Two sprites and two scripts laid out the way the shipped files are: header, sprite and script offset tables,
+// sprites, scripts, then the texture name. Script 0 loops over a sprite change, a rotation, a fade, a position
+// interpolation and a scale speed, which is what most effect and bullet scripts do; script 1 picks a random sprite
+// and exits.
+static void BuildAnmTestFile()
+{
+    AnmRawEntry *anm = AnmTestEntry();
+    AnmRawSprite *sprite;
+    i32 idx;
+
+    memset(g_AnmTestFile, 0, sizeof(g_AnmTestFile));
+    anm->numSprites = 2;
+    anm->numScripts = 2;
+    anm->width = 256;
+    anm->height = 256;
+    for (idx = 0; idx < anm->numSprites; idx++)
+    {
+        anm->spriteOffsets[idx] = ANM_TEST_SPRITE_TABLE + idx * sizeof(AnmRawSprite);
+        sprite = (AnmRawSprite *)((u8 *)g_AnmTestFile + anm->spriteOffsets[idx]);
+        sprite->id = idx;
+        sprite->offset = D3DXVECTOR2(idx * 32.0f, 0.0f);
+        sprite->size = D3DXVECTOR2(32.0f, 32.0f);
+    }
+
+    g_AnmTestCursor = ANM_TEST_SCRIPT_START;
+    anm->spriteOffsets[2] = 0;
+    anm->spriteOffsets[3] = g_AnmTestCursor;
+    WriteAnmInstr(0, AnmOpcode_SetActiveSprite, 1, 0, 0, 0, 0);
+    WriteAnmInstr(0, AnmOpcode_SetAngleVel, 3, 0, 0, FloatArg(0.05f), 0);
+    WriteAnmInstr(0, AnmOpcode_Fade, 2, 0x40ffffff, 30, 0, 0);
+    WriteAnmInstr(0, AnmOpcode_PosTimeDecel, 4, FloatArg(100.0f), FloatArg(50.0f), 0, 20);
+    g_AnmTestLoopOffset = WriteAnmInstr(10, AnmOpcode_SetActiveSprite, 1, 1, 0, 0, 0);
+    WriteAnmInstr(20, AnmOpcode_SetScaleSpeed, 2, FloatArg(0.01f), FloatArg(0.01f), 0, 0);
+    WriteAnmInstr(40, AnmOpcode_SetScale, 2, FloatArg(1.0f), FloatArg(1.0f), 0, 0);
+    g_AnmTestLoopOffset -= anm->spriteOffsets[3];
+    g_AnmTestJumpOffset = WriteAnmInstr(45, AnmOpcode_Jump, 2, g_AnmTestLoopOffset, 10, 0, 0);
+
+    anm->spriteOffsets[4] = 1;
+    anm->spriteOffsets[5] = g_AnmTestCursor;
+    WriteAnmInstr(0, AnmOpcode_SetRandomSprite, 2, 0, 2, 0, 0);
+    WriteAnmInstr(5, AnmOpcode_UVScrollX, 1, FloatArg(0.1f), 0, 0, 0);
+    WriteAnmInstr(30, AnmOpcode_SetBlendAdditive, 0, 0, 0, 0, 0);
+    g_AnmTestLastOffset = WriteAnmInstr(60, AnmOpcode_ExitHide, 0, 0, 0, 0, 0);
+
+    anm->nameOffset = g_AnmTestCursor;
+    strcpy((char *)g_AnmTestFile + anm->nameOffset, "@test");
+}
+
+static void SetUpAnmTest(ZunBool predecode)
+{
+    AnmRawEntry *anm;
+    u32 *scriptOffset;
+    i32 idx;
+
+    g_Supervisor.framerateMultiplier = 1.0f;
+    g_Supervisor.effectiveFramerateMultiplier = 1.0f;
+    g_Rng.Initialize(0x1234);
+    if (g_AnmTestManager == NULL)
+    {
+        g_AnmTestManager = new AnmManager();
+    }
+    BuildAnmTestFile();
+#ifdef PREDECODED_ANM
+    if (predecode)
+    {
+        munit_assert_int(AnmManager::PredecodeScripts(AnmTestEntry(), sizeof(g_AnmTestFile), 0), ==, ZUN_SUCCESS);
+    }
+#endif
+
+    anm = AnmTestEntry();
+    for (idx = 0; idx < anm->numSprites; idx++)
+    {
+        g_AnmTestManager->sprites[idx].sourceFileIndex = 0;
+        g_AnmTestManager->sprites[idx].textureWidth = 256.0f;
+        g_AnmTestManager->sprites[idx].textureHeight = 256.0f;
+    }
+    for (idx = 0, scriptOffset = anm->spriteOffsets + anm->numSprites; idx < anm->numScripts;
+         idx++, scriptOffset += 2)
+    {
+        g_AnmTestManager->scripts[scriptOffset[0]] = AnmTestInstrAt(scriptOffset[1]);
+        g_AnmTestManager->spriteIndices[scriptOffset[0]] = 0;
+    }
+    memset(g_AnmTestVms, 0, sizeof(g_AnmTestVms));
+    for (idx = 0; idx < ANM_TEST_VM_COUNT; idx++)
+    {
+        g_AnmTestManager->SetAndExecuteScriptIdx(&g_AnmTestVms[idx], idx % anm->numScripts);
+    }
+}
+
+static void RunAnmFrames(i32 frameCount)
+{
+    i32 frame;
+    i32 idx;
+
+    for (frame = 0; frame < frameCount; frame++)
+    {
+        for (idx = 0; idx < ANM_TEST_VM_COUNT; idx++)
+        {
+            g_AnmTestManager->ExecuteScript(&g_AnmTestVms[idx]);
+        }
+    }
+}
+
+// Scripts are only predecoded with PREDECODED_ANM.
+#ifdef PREDECODED_ANM
+static MunitResult test_anm_predecoded_matches_raw(const MunitParameter params[], void *user_data)
+{
+    SetUpAnmTest(false);
+    RunAnmFrames(ANM_TEST_FRAME_COUNT / 10);
+    memcpy(g_AnmTestRawVms, g_AnmTestVms, sizeof(g_AnmTestRawVms));
+
+    SetUpAnmTest(true);
+    munit_assert_int(AnmTestInstrAt(g_AnmTestJumpOffset)->opcode, ==, AnmOpcode_JumpResolved);
+    RunAnmFrames(ANM_TEST_FRAME_COUNT / 10);
+
+    munit_assert_memory_equal(sizeof(g_AnmTestRawVms), g_AnmTestVms, g_AnmTestRawVms);
+    munit_assert_int(g_AnmTestVms[0].activeSpriteIndex, ==, 1);
+    munit_assert_null(g_AnmTestVms[1].currentInstruction);
+    return MUNIT_OK;
+}
+
+static MunitResult test_anm_rejects_malformed(const MunitParameter params[], void *user_data)
+{
+    AnmRawEntry *anm = AnmTestEntry();
+
+    BuildAnmTestFile();
+    AnmTestInstrAt(g_AnmTestJumpOffset)->args[0] = ANM_TEST_FILE_SIZE;
+    munit_assert_int(AnmManager::PredecodeScripts(anm, sizeof(g_AnmTestFile), 0), ==, ZUN_ERROR);
+
+    // Into the middle of an instruction.
+    BuildAnmTestFile();
+    AnmTestInstrAt(g_AnmTestJumpOffset)->args[0] = 2;
+    munit_assert_int(AnmManager::PredecodeScripts(anm, sizeof(g_AnmTestFile), 0), ==, ZUN_ERROR);
+
+    BuildAnmTestFile();
+    AnmTestInstrAt(anm->spriteOffsets[3])->args[0] = ARRAY_SIZE(g_AnmTestManager->sprites);
+    munit_assert_int(AnmManager::PredecodeScripts(anm, sizeof(g_AnmTestFile), 0), ==, ZUN_ERROR);
+
+    // The last instruction running into the texture name.
+    BuildAnmTestFile();
+    AnmTestInstrAt(g_AnmTestLastOffset)->argsCount = 8;
+    munit_assert_int(AnmManager::PredecodeScripts(anm, sizeof(g_AnmTestFile), 0), ==, ZUN_ERROR);
+
+    BuildAnmTestFile();
+    anm->numScripts = -1;
+    munit_assert_int(AnmManager::PredecodeScripts(anm, sizeof(g_AnmTestFile), 0), ==, ZUN_ERROR);
+
+    // A script running on into the next one only leaves the jumps of the one it runs into relative.
+    BuildAnmTestFile();
+    AnmTestInstrAt(g_AnmTestJumpOffset)->opcode = AnmOpcode_Nop;
+    AnmTestInstrAt(g_AnmTestJumpOffset - 12)->opcode = AnmOpcode_Jump;
+    AnmTestInstrAt(g_AnmTestJumpOffset - 12)->args[0] = g_AnmTestLoopOffset;
+    AnmTestInstrAt(anm->spriteOffsets[5] + 12)->opcode = AnmOpcode_Jump;
+    AnmTestInstrAt(anm->spriteOffsets[5] + 12)->args[0] = 0;
+    munit_assert_int(AnmManager::PredecodeScripts(anm, sizeof(g_AnmTestFile), 0), ==, ZUN_SUCCESS);
+    munit_assert_int(AnmTestInstrAt(g_AnmTestJumpOffset - 12)->opcode, ==, AnmOpcode_JumpResolved);
+    munit_assert_int(AnmTestInstrAt(anm->spriteOffsets[5] + 12)->opcode, ==, AnmOpcode_Jump);
+
+    // A broken script doesn't stop the others from being resolved.
+    BuildAnmTestFile();
+    AnmTestInstrAt(g_AnmTestLastOffset)->argsCount = 8;
+    munit_assert_int(AnmManager::PredecodeScripts(anm, sizeof(g_AnmTestFile), 0), ==, ZUN_ERROR);
+    munit_assert_int(AnmTestInstrAt(g_AnmTestJumpOffset)->opcode, ==, AnmOpcode_JumpResolved);
+    return MUNIT_OK;
+}
+
+static MunitResult test_anm_predecode_shipped(const MunitParameter params[], void *user_data)
+{
+    static Pbg3Archive *archives[0x10];
+    Pbg3Archive archive;
+    char path[32];
+    AnmRawEntry *anm;
+    i32 stage;
+
+    if (archive.Load("resources/KOUMAKYO_ST.dat") == 0)
+    {
+        return MUNIT_SKIP;
+    }
+    archives[0] = &archive;
+    g_Pbg3Archives = archives;
+
+    for (stage = 1; stage <= 7; stage++)
+    {
+        sprintf(path, "data/stg%dbg.anm", stage);
+        anm = (AnmRawEntry *)FileSystem::OpenPath(path, 0);
+        munit_assert_not_null(anm);
+        munit_assert_int(AnmManager::PredecodeScripts(anm, g_LastFileSize, ANM_OFFSET_STAGEBG), ==, ZUN_SUCCESS);
+        free(anm);
+    }
+
+    g_Pbg3Archives = NULL;
+    return MUNIT_OK;
+}
+#endif
+
+// Sprites are only batched with BATCHED_SPRITES.
+#ifdef BATCHED_SPRITES
+// A frame's worth of VMs with two sprites on two textures. Positions, scales, rotations, anchors and colors come from
+// the test scripts plus the RNG, so the half pixel rounding gets exercised.
+static void SetUpAnmBatchTest()
+{
+    AnmVm *vm;
+    i32 idx;
+
+    SetUpAnmTest(false);
+    RunAnmFrames(ANM_TEST_FRAME_COUNT / 20);
+    for (idx = 0; idx < 2; idx++)
+    {
+        g_AnmTestManager->sprites[idx].sourceFileIndex = idx;
+        g_AnmTestManager->sprites[idx].widthPx = 32.0f - idx * 16.0f;
+        g_AnmTestManager->sprites[idx].heightPx = 32.0f;
+        g_AnmTestManager->sprites[idx].uvStart.x = idx * 0.125f;
+        g_AnmTestManager->sprites[idx].uvStart.y = 0.0f;
+        g_AnmTestManager->sprites[idx].uvEnd.x = idx * 0.125f + 0.125f;
+        g_AnmTestManager->sprites[idx].uvEnd.y = 0.125f;
+        g_AnmTestManager->textures[idx] = (IDirect3DTexture8 *)&g_AnmTestManager->sprites[idx];
+    }
+    for (vm = g_AnmTestVms, idx = 0; idx < ANM_TEST_VM_COUNT; idx++, vm++)
+    {
+        vm->flags.isVisible = 1;
+        vm->pos = D3DXVECTOR3(g_Rng.GetRandomF32InRange(640.0f), g_Rng.GetRandomF32InRange(480.0f), 0.1f);
+        vm->flags.anchor = idx % 4;
+        vm->color = idx % 16 == 0 ? 0 : vm->color;
+        vm->rotation.z = idx % 3 == 0 ? 0.0f : vm->rotation.z;
+    }
+    g_AnmTestManager->currentSprite = NULL;
+    g_AnmTestManager->BeginSpriteBatch(&g_AnmTestBatch);
+}
+
+static void TearDownAnmBatchTest()
+{
+    g_AnmTestManager->textures[0] = NULL;
+    g_AnmTestManager->textures[1] = NULL;
+}
+
+static i32 CountAnmBatchQuads()
+{
+    i32 quadCount;
+    i32 idx;
+
+    for (quadCount = 0, idx = 0; idx < g_AnmTestBatch.runCount; idx++)
+    {
+        quadCount += g_AnmTestBatch.runs[idx].quadCount;
+    }
+    return quadCount;
+}
+
+// Copies out the quad Draw just submitted, with the diffuse color the vertex buffer path gets from the texture factor.
+static void CopyDrawnAnmQuad(AnmVm *vm, VertexTex1DiffuseXyzrwh *quad)
+{
+    i32 idx;
+
+    for (idx = 0; idx < 4; idx++)
+    {
+        if (((g_Supervisor.cfg.opts >> GCOS_DONT_USE_VERTEX_BUF) & 1) == 0)
+        {
+            quad[idx].position = g_PrimitivesToDrawVertexBuf[idx].position;
+            quad[idx].diffuse = vm->color;
+            quad[idx].textureUV = g_PrimitivesToDrawVertexBuf[idx].textureUV;
+        }
+        else
+        {
+            quad[idx] = g_PrimitivesToDrawNoVertexBuf[idx];
+        }
+    }
+}
+
+// The batch and Draw, in both vertex paths. Draw goes to a recording device, and what it leaves in the primitive
+// buffers is what the device was given.
+static MunitResult test_anm_sprite_batch_matches_draw(const MunitParameter params[], void *user_data)
+{
+    u32 savedOpts = g_Supervisor.cfg.opts;
+    u32 savedControl;
+    AnmLoadedSprite *batchedSprite;
+    i32 quadCount;
+    i32 pass;
+    i32 idx;
+
+    SetUpAnmBatchTest();
+    if (g_AnmTestDevice == NULL)
+    {
+        g_AnmTestDevice = new RecordingD3dDevice(GAME_WINDOW_WIDTH, GAME_WINDOW_HEIGHT);
+    }
+    g_AnmTestSavedDevice = g_Supervisor.d3dDevice;
+    g_Supervisor.d3dDevice = g_AnmTestDevice;
+    g_D3dStateCache.Invalidate();
+    // Direct3D drops the FPU to single precision when it creates the device.
+    savedControl = _controlfp(0, 0);
+    _controlfp(_PC_24, _MCW_PC);
+    for (pass = 0; pass < 2; pass++)
+    {
+        g_Supervisor.cfg.opts = (savedOpts & ~(1 << GCOS_DONT_USE_VERTEX_BUF)) | (pass << GCOS_DONT_USE_VERTEX_BUF);
+
+        g_AnmTestManager->currentSprite = NULL;
+        g_AnmTestManager->BeginSpriteBatch(&g_AnmTestBatch);
+        for (idx = 0; idx < ANM_TEST_VM_COUNT; idx++)
+        {
+            g_AnmTestManager->BatchSprite(&g_AnmTestBatch, &g_AnmTestVms[idx]);
+        }
+        batchedSprite = g_AnmTestManager->currentSprite;
+
+        g_AnmTestManager->currentSprite = NULL;
+        g_AnmTestManager->SetCurrentVertexShader(0xff);
+        quadCount = 0;
+        for (idx = 0; idx < ANM_TEST_VM_COUNT; idx++)
+        {
+            if (g_AnmTestManager->Draw(&g_AnmTestVms[idx]) == ZUN_SUCCESS)
+            {
+                CopyDrawnAnmQuad(&g_AnmTestVms[idx], &g_AnmTestQuads[quadCount * 4]);
+                quadCount++;
+            }
+        }
+
+        munit_assert_int(g_AnmTestBatch.quadCount, ==, quadCount);
+        munit_assert_memory_equal(quadCount * 4 * sizeof(VertexTex1DiffuseXyzrwh), g_AnmTestBatch.vertices,
+                                  g_AnmTestQuads);
+        munit_assert_ptr_equal(batchedSprite, g_AnmTestManager->currentSprite);
+        munit_assert_int(g_AnmTestBatch.runCount, >, 1);
+        munit_assert_int(g_AnmTestBatch.runCount, <, quadCount);
+        munit_assert_int(CountAnmBatchQuads(), ==, quadCount);
+    }
+    _controlfp(savedControl, _MCW_PC);
+
+    g_Supervisor.cfg.opts = savedOpts;
+    g_AnmTestManager->SetCurrentTexture(NULL);
+    g_D3dStateCache.SetTexture(0, NULL);
+    g_Supervisor.d3dDevice = g_AnmTestSavedDevice;
+    g_D3dStateCache.Invalidate();
+    TearDownAnmBatchTest();
+    return MUNIT_OK;
+}
+
+// Two layers: the first must come out untouched by the second's sort, the second grouped by state and otherwise in
+// submission order, with each quad still next to its own vertices.
+static MunitResult test_anm_sprite_batch_layer_sort(const MunitParameter params[], void *user_data)
+{
+    i32 firstLayerQuads;
+    i32 unsortedRuns;
+    i32 idx;
+    AnmVm *prev;
+    AnmVm *cur;
+
+    SetUpAnmBatchTest();
+    for (idx = 0; idx < ANM_TEST_VM_COUNT / 4; idx++)
+    {
+        g_AnmTestManager->BatchSprite(&g_AnmTestBatch, &g_AnmTestVms[idx]);
+    }
+    g_AnmTestManager->EndSpriteBatchLayer(&g_AnmTestBatch);
+    firstLayerQuads = g_AnmTestBatch.quadCount;
+    memcpy(g_AnmTestQuads, g_AnmTestBatch.vertices, firstLayerQuads * 4 * sizeof(VertexTex1DiffuseXyzrwh));
+    munit_assert_int(g_AnmTestBatch.layerStart, ==, firstLayerQuads);
+
+    for (; idx < ANM_TEST_VM_COUNT; idx++)
+    {
+        g_AnmTestManager->BatchSprite(&g_AnmTestBatch, &g_AnmTestVms[idx]);
+    }
+    unsortedRuns = g_AnmTestBatch.runCount;
+    g_AnmTestManager->EndSpriteBatchLayer(&g_AnmTestBatch);
+
+    munit_assert_int(g_AnmTestBatch.runCount, <, unsortedRuns);
+    munit_assert_int(CountAnmBatchQuads(), ==, g_AnmTestBatch.quadCount);
+    munit_assert_memory_equal(firstLayerQuads * 4 * sizeof(VertexTex1DiffuseXyzrwh), g_AnmTestBatch.vertices,
+                              g_AnmTestQuads);
+    for (idx = firstLayerQuads; idx < g_AnmTestBatch.quadCount; idx++)
+    {
+        cur = g_AnmTestBatch.quadVms[idx];
+        munit_assert_uint32(g_AnmTestBatch.vertices[idx * 4].diffuse, ==, cur->color);
+        if (idx == firstLayerQuads)
+        {
+            continue;
+        }
+        prev = g_AnmTestBatch.quadVms[idx - 1];
+        munit_assert_int(prev->sprite->sourceFileIndex, <=, cur->sprite->sourceFileIndex);
+        if (prev->sprite->sourceFileIndex == cur->sprite->sourceFileIndex && prev->flags.flags == cur->flags.flags &&
+            prev->color == cur->color)
+        {
+            munit_assert_ptr(prev, <, cur);
+        }
+    }
+
+    TearDownAnmBatchTest();
+    return MUNIT_OK;
+}
+#endif
+
+static MunitResult RunAnmBenchmark(ZunBool predecode)
+{
+    clock_t start;
+    f64 seconds;
+
+    SetUpAnmTest(predecode);
+    start = clock();
+    RunAnmFrames(ANM_TEST_FRAME_COUNT);
+    seconds = (f64)(clock() - start) / CLOCKS_PER_SEC;
+    if (seconds > 0.0)
+    {
+        munit_logf(MUNIT_LOG_INFO, "%.0f VM updates per second, %d bytes per VM",
+                   (f64)ANM_TEST_VM_COUNT * ANM_TEST_FRAME_COUNT / seconds, (i32)sizeof(AnmVm));
+    }
+    return MUNIT_OK;
+}
+
+// Run with --log-visible info to see the VM updates per second each benchmark reaches.
+static MunitResult bench_anm_raw(const MunitParameter params[], void *user_data)
+{
+    return RunAnmBenchmark(false);
+}
+
+#ifdef PREDECODED_ANM
+static MunitResult bench_anm_predecoded(const MunitParameter params[], void *user_data)
+{
+    return RunAnmBenchmark(true);
+}
+#endif
+
+static MunitTest anmmanager_test_suite_tests[] = {
+#ifdef PREDECODED_ANM
+    {"/predecoded_matches_raw", test_anm_predecoded_matches_raw, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/rejects_malformed", test_anm_rejects_malformed, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/predecode_shipped", test_anm_predecode_shipped, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+#ifdef BATCHED_SPRITES
+    {"/sprite_batch_matches_draw", test_anm_sprite_batch_matches_draw, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/sprite_batch_layer_sort", test_anm_sprite_batch_layer_sort, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {"/bench_raw", bench_anm_raw, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#ifdef PREDECODED_ANM
+    {"/bench_predecoded", bench_anm_predecoded, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
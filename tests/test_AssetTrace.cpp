@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AssetPreload.hpp"
+#include "AssetTrace.hpp"
+#include "FileSystem.hpp"
+#include "pbg3/Pbg3Archive.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define ASSET_TEST_FILE "assettrace_test.bin"
+#define ASSET_TEST_MANIFEST "assettrace_test_preload.txt"
+#define ASSET_TEST_CSV "assettrace_test.csv"
+
+static void WriteAssetTestManifest(const char *text)
+{
+    munit_assert_int(FileSystem::WriteDataToFile(ASSET_TEST_MANIFEST, (void *)text, strlen(text)), ==, 0);
+}
+
+// OpenPath only records and hands over preloaded files with ASSET_TRACE.
+#ifdef ASSET_TRACE
+static MunitResult test_asset_trace_record(const MunitParameter params[], void *user_data)
+{
+    char contents[100];
+    char line[128];
+    FILE *file;
+    u8 *data;
+
+    memset(contents, 'x', sizeof(contents));
+    munit_assert_int(FileSystem::WriteDataToFile(ASSET_TEST_FILE, contents, sizeof(contents)), ==, 0);
+
+    g_AssetTrace.Start();
+    g_AssetTrace.EnterScene(ASSET_SCENE_STAGE2);
+    {
+        AssetTraceScope traceScope(AssetTraceKind_Anm, "stg2enm.anm");
+
+        data = FileSystem::OpenPath(ASSET_TEST_FILE, 1);
+        munit_assert_not_null(data);
+        free(data);
+        data = FileSystem::OpenPath(ASSET_TEST_FILE, 1);
+        free(data);
+    }
+
+    // The loader comes after the files it opened, with all of their bytes.
+    munit_assert_int32(g_AssetTrace.numEvents, ==, 3);
+    munit_assert_uint8(g_AssetTrace.events[0].kind, ==, AssetTraceKind_File);
+    munit_assert_uint8(g_AssetTrace.events[0].scene, ==, ASSET_SCENE_STAGE2);
+    munit_assert_int8(g_AssetTrace.events[0].archive, ==, -1);
+    munit_assert_uint32(g_AssetTrace.events[0].bytes, ==, sizeof(contents));
+    munit_assert_string_equal(g_AssetTrace.events[0].path, ASSET_TEST_FILE);
+    munit_assert_uint8(g_AssetTrace.events[2].kind, ==, AssetTraceKind_Anm);
+    munit_assert_uint32(g_AssetTrace.events[2].bytes, ==, sizeof(contents) * 2);
+    munit_assert_string_equal(g_AssetTrace.events[2].path, "stg2enm.anm");
+
+    munit_assert_int32(g_AssetTrace.WriteCsv(ASSET_TEST_CSV), ==, ZUN_SUCCESS);
+    file = fopen(ASSET_TEST_CSV, "r");
+    munit_assert_not_null(file);
+    munit_assert_not_null(fgets(line, sizeof(line), file));
+    munit_assert_string_equal(line, "scene,kind,path,archive,bytes,us,preloaded\n");
+    munit_assert_not_null(fgets(line, sizeof(line), file));
+    munit_assert_memory_equal(36, line, "stage2,file,assettrace_test.bin,-1,1");
+    fclose(file);
+
+    g_AssetTrace.Stop();
+    g_AssetTrace.EnterScene(ASSET_SCENE_BOOT);
+    remove(ASSET_TEST_FILE);
+    remove(ASSET_TEST_CSV);
+    return MUNIT_OK;
+}
+#endif
+
+static MunitResult test_asset_trace_manifest(const MunitParameter params[], void *user_data)
+{
+    WriteAssetTestManifest("# made by hand\r\n"
+                           "[title]\r\n"
+                           "data/title01.anm\r\n"
+                           "data/title02.anm  \r\n"
+                           "\r\n"
+                           "[nowhere]\r\n"
+                           "data/lost.anm\r\n"
+                           "[stage1]\r\n"
+                           "data/ecldata1.ecl");
+    munit_assert_int32(g_AssetPreload.LoadManifest(ASSET_TEST_MANIFEST), ==, ZUN_SUCCESS);
+
+    munit_assert_int32(g_AssetPreload.numPaths, ==, 3);
+    munit_assert_int32(g_AssetPreload.sceneNumPaths[ASSET_SCENE_TITLE], ==, 2);
+    munit_assert_string_equal(g_AssetPreload.paths[g_AssetPreload.sceneFirstPath[ASSET_SCENE_TITLE]],
+                              "data/title01.anm");
+    munit_assert_string_equal(g_AssetPreload.paths[g_AssetPreload.sceneFirstPath[ASSET_SCENE_TITLE] + 1],
+                              "data/title02.anm");
+    munit_assert_int32(g_AssetPreload.sceneNumPaths[ASSET_SCENE_STAGE1], ==, 1);
+    munit_assert_string_equal(g_AssetPreload.paths[g_AssetPreload.sceneFirstPath[ASSET_SCENE_STAGE1]],
+                              "data/ecldata1.ecl");
+    munit_assert_int32(g_AssetPreload.sceneNumPaths[ASSET_SCENE_STAGE2], ==, 0);
+
+    g_AssetPreload.ReleaseManifest();
+    remove(ASSET_TEST_MANIFEST);
+    return MUNIT_OK;
+}
+
+#ifdef ASSET_TRACE
+// The thread reads the scene's files out of the archive, and OpenPath hands over its buffer rather than decoding again.
+static MunitResult test_asset_trace_preload(const MunitParameter params[], void *user_data)
+{
+    Pbg3Archive archive;
+    Pbg3Archive *archives[0x10];
+    i32 entryIdx;
+    u8 *expected;
+    u8 *data;
+
+    munit_assert_int(archive.Load("resources/KOUMAKYO_IN.dat"), !=, 0);
+    memset(archives, 0, sizeof(archives));
+    archives[2] = &archive;
+    g_Pbg3Archives = archives;
+
+    WriteAssetTestManifest("[title]\ndata/th06logo.jpg\ndata/text.anm\n");
+    munit_assert_int32(g_AssetPreload.LoadManifest(ASSET_TEST_MANIFEST), ==, ZUN_SUCCESS);
+    g_AssetPreload.isEnabled = true;
+    g_AssetTrace.Start();
+    g_AssetTrace.EnterScene(ASSET_SCENE_TITLE);
+    munit_assert_not_null(g_AssetPreload.thread);
+    WaitForSingleObject(g_AssetPreload.thread, INFINITE);
+    munit_assert_int32(g_AssetPreload.entries[0].state, ==, ASSET_PRELOAD_READY);
+
+    data = FileSystem::OpenPath("data/th06logo.jpg", 0);
+    munit_assert_not_null(data);
+    munit_assert_null(g_AssetPreload.entries[0].data);
+    munit_assert_uint32(g_AssetPreload.hits, ==, 1);
+    entryIdx = archive.FindEntry("th06logo.jpg");
+    expected = archive.ReadDecompressEntry(entryIdx, "th06logo.jpg");
+    munit_assert_uint32(g_LastFileSize, ==, archive.GetEntrySize(entryIdx));
+    munit_assert_memory_equal(g_LastFileSize, data, expected);
+    munit_assert_int32(g_AssetTrace.numEvents, ==, 1);
+    munit_assert_uint8(g_AssetTrace.events[0].wasPreloaded, ==, true);
+    munit_assert_int8(g_AssetTrace.events[0].archive, ==, 2);
+    free(data);
+    free(expected);
+
+    // Opened a second time, it's read as usual.
+    data = FileSystem::OpenPath("data/th06logo.jpg", 0);
+    munit_assert_not_null(data);
+    munit_assert_uint8(g_AssetTrace.events[1].wasPreloaded, ==, false);
+    munit_assert_uint32(g_AssetPreload.hits, ==, 1);
+    free(data);
+
+    // text.anm was never asked for, and goes when the scene does.
+    g_AssetTrace.EnterScene(ASSET_SCENE_MUSICROOM);
+    munit_assert_int32(g_AssetPreload.numEntries, ==, 0);
+
+    g_AssetTrace.Stop();
+    g_AssetPreload.isEnabled = false;
+    g_AssetPreload.ReleaseManifest();
+    g_AssetTrace.EnterScene(ASSET_SCENE_BOOT);
+    g_Pbg3Archives = NULL;
+    remove(ASSET_TEST_MANIFEST);
+    return MUNIT_OK;
+}
+#endif
+
+static MunitTest assettrace_test_suite_tests[] = {
+#ifdef ASSET_TRACE
+    {"/record", test_asset_trace_record, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {"/manifest", test_asset_trace_manifest, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#ifdef ASSET_TRACE
+    {"/preload", test_asset_trace_preload, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -0,0 +1,154 @@
+#include <string.h>
+
+#include "BgmStream.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define BGM_TEST_READ_FRAMES 777
+
+static BgmStream g_BgmTestStream;
+static i16 g_BgmTestFrames[BGM_TEST_READ_FRAMES * SOUND_MIXER_CHANNELS];
+static u32 g_BgmTestSourceFrame;
+static u32 g_BgmTestSourceEnd;
+static ZunBool g_BgmTestSourceBlocks;
+static HANDLE g_BgmTestSourceEvent;
+
+// Counts frames up from 0, with the right channel the negative of the left, until g_BgmTestSourceEnd.
+static i32 BgmTestSource(void *arg, i16 *frames, i32 frameCount)
+{
+    i32 idx;
+
+    if (g_BgmTestSourceBlocks)
+    {
+        WaitForSingleObject(g_BgmTestSourceEvent, INFINITE);
+    }
+    for (idx = 0; idx < frameCount && g_BgmTestSourceFrame < g_BgmTestSourceEnd; idx++, g_BgmTestSourceFrame++)
+    {
+        frames[idx * 2] = g_BgmTestSourceFrame & 0x7fff;
+        frames[idx * 2 + 1] = -(i16)(g_BgmTestSourceFrame & 0x7fff);
+    }
+    return idx;
+}
+
+static void StartBgmTest(u32 endFrame, ZunBool isThreaded)
+{
+    g_BgmTestSourceFrame = 0;
+    g_BgmTestSourceEnd = endFrame;
+    g_BgmTestSourceBlocks = false;
+    munit_assert_int32(g_BgmTestStream.Start(BgmTestSource, NULL, isThreaded), ==, ZUN_SUCCESS);
+}
+
+static void AssertBgmTestFrames(i16 *frames, i32 count, u32 firstFrame)
+{
+    i32 idx;
+
+    for (idx = 0; idx < count; idx++)
+    {
+        munit_assert_int16(frames[idx * 2], ==, (firstFrame + idx) & 0x7fff);
+        munit_assert_int16(frames[idx * 2 + 1], ==, -(i16)((firstFrame + idx) & 0x7fff));
+    }
+}
+
+static MunitResult test_bgm_stream_wrap(const MunitParameter params[], void *user_data)
+{
+    u32 frame;
+
+    // Reads that don't divide the ring land across its end, several times over.
+    StartBgmTest(0xffffffff, false);
+    munit_assert_int32(g_BgmTestStream.GetFillFrames(), ==, BGM_STREAM_RING_FRAMES);
+    for (frame = 0; frame < BGM_STREAM_RING_FRAMES * 5; frame += BGM_TEST_READ_FRAMES)
+    {
+        munit_assert_int32(BgmStream::Read(&g_BgmTestStream, g_BgmTestFrames, BGM_TEST_READ_FRAMES), ==,
+                           BGM_TEST_READ_FRAMES);
+        AssertBgmTestFrames(g_BgmTestFrames, BGM_TEST_READ_FRAMES, frame);
+    }
+    munit_assert_uint32(g_BgmTestStream.underruns, ==, 0);
+    g_BgmTestStream.Stop();
+    return MUNIT_OK;
+}
+
+static MunitResult test_bgm_stream_end(const MunitParameter params[], void *user_data)
+{
+    i32 read;
+
+    // The end of the source is the end of the stream, not an underrun.
+    StartBgmTest(BGM_TEST_READ_FRAMES + 100, false);
+    munit_assert_int32(BgmStream::Read(&g_BgmTestStream, g_BgmTestFrames, BGM_TEST_READ_FRAMES), ==,
+                       BGM_TEST_READ_FRAMES);
+    read = BgmStream::Read(&g_BgmTestStream, g_BgmTestFrames, BGM_TEST_READ_FRAMES);
+    munit_assert_int32(read, ==, 100);
+    AssertBgmTestFrames(g_BgmTestFrames, read, BGM_TEST_READ_FRAMES);
+    munit_assert_int32(BgmStream::Read(&g_BgmTestStream, g_BgmTestFrames, BGM_TEST_READ_FRAMES), ==, 0);
+    munit_assert_uint32(g_BgmTestStream.underruns, ==, 0);
+    g_BgmTestStream.Stop();
+    return MUNIT_OK;
+}
+
+static MunitResult test_bgm_stream_underrun(const MunitParameter params[], void *user_data)
+{
+    i32 idx;
+    u32 frame;
+
+    // A source stuck in a read is a disk that's fallen behind: the read ahead plays out, then silence.
+    g_BgmTestSourceEvent = CreateEventA(NULL, 1, 0, NULL);
+    StartBgmTest(0xffffffff, true);
+    g_BgmTestSourceBlocks = true;
+    for (frame = 0; frame + BGM_TEST_READ_FRAMES <= BGM_STREAM_RING_FRAMES; frame += BGM_TEST_READ_FRAMES)
+    {
+        BgmStream::Read(&g_BgmTestStream, g_BgmTestFrames, BGM_TEST_READ_FRAMES);
+        AssertBgmTestFrames(g_BgmTestFrames, BGM_TEST_READ_FRAMES, frame);
+    }
+    munit_assert_uint32(g_BgmTestStream.underruns, ==, 0);
+
+    munit_assert_int32(BgmStream::Read(&g_BgmTestStream, g_BgmTestFrames, BGM_TEST_READ_FRAMES), ==,
+                       BGM_TEST_READ_FRAMES);
+    AssertBgmTestFrames(g_BgmTestFrames, BGM_STREAM_RING_FRAMES - frame, frame);
+    for (idx = (BGM_STREAM_RING_FRAMES - frame) * 2; idx < BGM_TEST_READ_FRAMES * 2; idx++)
+    {
+        munit_assert_int16(g_BgmTestFrames[idx], ==, 0);
+    }
+    munit_assert_uint32(g_BgmTestStream.underruns, ==, 1);
+    munit_assert_uint32(g_BgmTestStream.underrunFrames, ==, BGM_TEST_READ_FRAMES - (BGM_STREAM_RING_FRAMES - frame));
+    munit_assert_int32(g_BgmTestStream.minFillFrames, ==, BGM_STREAM_RING_FRAMES - frame);
+
+    SetEvent(g_BgmTestSourceEvent);
+    g_BgmTestStream.Stop();
+    CloseHandle(g_BgmTestSourceEvent);
+    return MUNIT_OK;
+}
+
+// The producer thread against a consumer that only waits once the ring is dry: whatever isn't an underrun has to be
+// the source's frames, in order.
+static MunitResult test_bgm_stream_threaded(const MunitParameter params[], void *user_data)
+{
+    u32 underrunFrames;
+    u32 frame;
+    i32 fromRing;
+
+    StartBgmTest(0xffffffff, true);
+    frame = 0;
+    while (frame < BGM_STREAM_RING_FRAMES * 8)
+    {
+        underrunFrames = g_BgmTestStream.underrunFrames;
+        BgmStream::Read(&g_BgmTestStream, g_BgmTestFrames, BGM_TEST_READ_FRAMES);
+        fromRing = BGM_TEST_READ_FRAMES - (g_BgmTestStream.underrunFrames - underrunFrames);
+        AssertBgmTestFrames(g_BgmTestFrames, fromRing, frame);
+        frame += fromRing;
+        if (fromRing == 0)
+        {
+            Sleep(1);
+        }
+    }
+    munit_logf(MUNIT_LOG_INFO, "%u frames, %u underruns, lowest fill %d", frame, g_BgmTestStream.underruns,
+               g_BgmTestStream.minFillFrames);
+    g_BgmTestStream.Stop();
+    return MUNIT_OK;
+}
+
+static MunitTest bgmstream_test_suite_tests[] = {
+    {"/wrap", test_bgm_stream_wrap, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/end", test_bgm_stream_end, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/underrun", test_bgm_stream_underrun, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/threaded", test_bgm_stream_threaded, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "ChainPriorities.hpp"
+#include "ChainProfiler.hpp"
+#include "utils.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define CHAIN_PROFILER_TEST_PRIO 8
+
+// The chains only report to the profiler with CHAIN_PROFILER.
+#ifdef CHAIN_PROFILER
+static ChainCallbackResult ChainProfilerTestContinue(void *arg)
+{
+    (*(i32 *)arg)++;
+    return CHAIN_CALLBACK_RESULT_CONTINUE;
+}
+
+static ChainCallbackResult ChainProfilerTestRemove(void *arg)
+{
+    (*(i32 *)arg)++;
+    return CHAIN_CALLBACK_RESULT_CONTINUE_AND_REMOVE_JOB;
+}
+
+static MunitResult test_chain_profiler_events(const MunitParameter params[], void *user_data)
+{
+    Chain chain;
+    ChainElem player;
+    ChainElem unnamed;
+    ChainElem *once;
+    ChainProfileEvent events[8];
+    i32 calls;
+    i32 count;
+
+    calls = 0;
+    player.callback = ChainProfilerTestContinue;
+    player.arg = &calls;
+    unnamed.callback = ChainProfilerTestContinue;
+    unnamed.arg = &calls;
+    // Cut and freed from inside its own callback, on the first frame.
+    once = chain.CreateElem(ChainProfilerTestRemove);
+    once->arg = &calls;
+    chain.AddToCalcChain(&player, TH_CHAIN_PRIO_CALC_PLAYER);
+    chain.AddToCalcChain(&unnamed, CHAIN_PROFILER_TEST_PRIO);
+    chain.AddToCalcChain(once, CHAIN_PROFILER_TEST_PRIO + 1);
+
+    g_ChainProfiler.Start();
+    chain.RunCalcChain();
+    chain.RunCalcChain();
+    g_ChainProfiler.Stop();
+    // Not recorded once stopped.
+    chain.RunCalcChain();
+
+    munit_assert_int(calls, ==, 7);
+    count = g_ChainProfiler.Snapshot(events, ARRAY_SIZE_SIGNED(events));
+    munit_assert_int(count, ==, 5);
+    munit_assert_int(events[0].priority, ==, TH_CHAIN_PRIO_CALC_PLAYER);
+    munit_assert_int(events[0].chain, ==, ChainProfileChain_Calc);
+    munit_assert_uint32(events[0].frame, ==, 1);
+    munit_assert_int(events[1].priority, ==, CHAIN_PROFILER_TEST_PRIO);
+    munit_assert_int(events[2].priority, ==, CHAIN_PROFILER_TEST_PRIO + 1);
+    munit_assert_ptr_equal(events[2].callback, ChainProfilerTestRemove);
+    munit_assert_int(events[3].priority, ==, TH_CHAIN_PRIO_CALC_PLAYER);
+    munit_assert_uint32(events[3].frame, ==, 2);
+    munit_assert_uint32(events[4].frame, ==, 2);
+    munit_assert(events[1].begin >= events[0].begin);
+    munit_assert(events[3].begin >= events[2].begin);
+
+    chain.Cut(&player);
+    chain.Cut(&unnamed);
+    return MUNIT_OK;
+}
+
+// The oldest events are dropped, never the newest.
+static MunitResult test_chain_profiler_wraparound(const MunitParameter params[], void *user_data)
+{
+    Chain chain;
+    ChainElem elem;
+    ChainProfileEvent *events;
+    i32 calls;
+    i32 count;
+    i32 frame;
+
+    calls = 0;
+    elem.callback = ChainProfilerTestContinue;
+    elem.arg = &calls;
+    chain.AddToCalcChain(&elem, TH_CHAIN_PRIO_CALC_STAGE);
+
+    g_ChainProfiler.Start();
+    for (frame = 0; frame < CHAIN_PROFILER_RING_SIZE + 10; frame++)
+    {
+        chain.RunCalcChain();
+    }
+    g_ChainProfiler.Stop();
+
+    events = new ChainProfileEvent[CHAIN_PROFILER_RING_SIZE];
+    count = g_ChainProfiler.Snapshot(events, CHAIN_PROFILER_RING_SIZE);
+    munit_assert_int(count, ==, CHAIN_PROFILER_RING_SIZE);
+    munit_assert_uint32(events[0].frame, ==, 11);
+    munit_assert_uint32(events[count - 1].frame, ==, CHAIN_PROFILER_RING_SIZE + 10);
+    count = g_ChainProfiler.Snapshot(events, 4);
+    munit_assert_int(count, ==, 4);
+    munit_assert_uint32(events[0].frame, ==, CHAIN_PROFILER_RING_SIZE + 7);
+
+    delete[] events;
+    chain.Cut(&elem);
+    return MUNIT_OK;
+}
+
+static MunitResult test_chain_profiler_export(const MunitParameter params[], void *user_data)
+{
+    Chain chain;
+    ChainElem calc;
+    ChainElem draw;
+    ChainProfileBinaryHeader header;
+    ChainProfileBinaryName name;
+    ChainProfileBinaryEvent event;
+    char json[0x800];
+    FILE *file;
+    i32 calls;
+    i32 size;
+
+    calls = 0;
+    calc.callback = ChainProfilerTestContinue;
+    calc.arg = &calls;
+    draw.callback = ChainProfilerTestContinue;
+    draw.arg = &calls;
+    chain.AddToCalcChain(&calc, TH_CHAIN_PRIO_CALC_BULLETMANAGER);
+    chain.AddToDrawChain(&draw, TH_CHAIN_PRIO_DRAW_BULLETMANAGER);
+
+    g_ChainProfiler.Start();
+    chain.RunCalcChain();
+    chain.RunDrawChain();
+    chain.RunCalcChain();
+    chain.RunDrawChain();
+    g_ChainProfiler.Stop();
+
+    munit_assert_int(g_ChainProfiler.ExportChromeTrace("test_chaintrace.json"), ==, ZUN_SUCCESS);
+    file = fopen("test_chaintrace.json", "r");
+    munit_assert_not_null(file);
+    size = fread(json, 1, sizeof(json) - 1, file);
+    json[size] = '\0';
+    fclose(file);
+    remove("test_chaintrace.json");
+    munit_assert_not_null(strstr(json, "{\"traceEvents\":["));
+    munit_assert_not_null(
+        strstr(json, "\"name\":\"BulletManager\",\"cat\":\"calc\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"));
+    munit_assert_not_null(
+        strstr(json, "\"name\":\"BulletManager\",\"cat\":\"draw\",\"ph\":\"X\",\"pid\":1,\"tid\":2,"));
+    munit_assert_not_null(strstr(json, "\"args\":{\"priority\":9,\"frame\":2}}\n]"));
+
+    munit_assert_int(g_ChainProfiler.ExportBinary("test_chaintrace.bin"), ==, ZUN_SUCCESS);
+    file = fopen("test_chaintrace.bin", "rb");
+    munit_assert_not_null(file);
+    munit_assert_int(fread(&header, sizeof(header), 1, file), ==, 1);
+    munit_assert_memory_equal(4, header.magic, "CHPF");
+    munit_assert_uint32(header.version, ==, 1);
+    munit_assert_uint32(header.nameCount, ==, 2);
+    munit_assert_uint32(header.eventCount, ==, 4);
+    munit_assert_int(fread(&name, sizeof(name), 1, file), ==, 1);
+    munit_assert_int(name.chain, ==, ChainProfileChain_Calc);
+    munit_assert_int(name.priority, ==, TH_CHAIN_PRIO_CALC_BULLETMANAGER);
+    munit_assert_string_equal(name.name, "BulletManager");
+    munit_assert_int(fread(&name, sizeof(name), 1, file), ==, 1);
+    munit_assert_int(name.chain, ==, ChainProfileChain_Draw);
+    munit_assert_int(fseek(file, sizeof(event) * 3, SEEK_CUR), ==, 0);
+    munit_assert_int(fread(&event, sizeof(event), 1, file), ==, 1);
+    munit_assert_int(event.chain, ==, ChainProfileChain_Draw);
+    munit_assert_uint32(event.frame, ==, 2);
+    munit_assert_int(fread(&event, 1, 1, file), ==, 0);
+    fclose(file);
+    remove("test_chaintrace.bin");
+
+    chain.Cut(&calc);
+    chain.Cut(&draw);
+    return MUNIT_OK;
+}
+
+#endif
+
+static MunitResult test_chain_profiler_names(const MunitParameter params[], void *user_data)
+{
+    munit_assert_string_equal(g_ChainProfiler.GetName(ChainProfileChain_Calc, TH_CHAIN_PRIO_CALC_PLAYER), "Player");
+    munit_assert_string_equal(g_ChainProfiler.GetName(ChainProfileChain_Draw, TH_CHAIN_PRIO_DRAW_GUI), "Gui");
+    munit_assert_null(g_ChainProfiler.GetName(ChainProfileChain_Calc, CHAIN_PROFILER_TEST_PRIO));
+    return MUNIT_OK;
+}
+
+static MunitTest chainprofiler_test_suite_tests[] = {
+#ifdef CHAIN_PROFILER
+    {"/events", test_chain_profiler_events, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/wraparound", test_chain_profiler_wraparound, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/export", test_chain_profiler_export, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {"/names", test_chain_profiler_names, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
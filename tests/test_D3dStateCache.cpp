@@ -0,0 +1,99 @@
+#include <string.h>
+
+#include "D3dStateCache.hpp"
+#include "GameWindow.hpp"
+#include "RecordingD3dDevice.hpp"
+#include "Supervisor.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+static RecordingD3dDevice *g_StateCacheTestDevice;
+static IDirect3DDevice8 *g_StateCacheTestSavedDevice;
+
+static void SetUpStateCacheTest()
+{
+    g_StateCacheTestDevice = new RecordingD3dDevice(GAME_WINDOW_WIDTH, GAME_WINDOW_HEIGHT);
+    g_StateCacheTestSavedDevice = g_Supervisor.d3dDevice;
+    g_Supervisor.d3dDevice = g_StateCacheTestDevice;
+    g_D3dStateCache.Invalidate();
+    memset(&g_D3dStateCache.thisFrame, 0, sizeof(g_D3dStateCache.thisFrame));
+}
+
+static void TearDownStateCacheTest()
+{
+    g_Supervisor.d3dDevice = g_StateCacheTestSavedDevice;
+    g_D3dStateCache.Invalidate();
+    memset(&g_D3dStateCache.thisFrame, 0, sizeof(g_D3dStateCache.thisFrame));
+    delete g_StateCacheTestDevice;
+    g_StateCacheTestDevice = NULL;
+}
+
+// A value the device already holds is dropped and counted as redundant, anything else reaches the device, whichever
+// kind of state it is.
+static MunitResult test_state_cache_drops_redundant(const MunitParameter params[], void *user_data)
+{
+    IDirect3DTexture8 *texture;
+
+    SetUpStateCacheTest();
+    g_StateCacheTestDevice->CreateTexture(16, 16, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &texture);
+    g_D3dStateCache.SetRenderState(D3DRS_ZFUNC, D3DCMP_ALWAYS);
+    g_D3dStateCache.SetRenderState(D3DRS_ZFUNC, D3DCMP_ALWAYS);
+    g_D3dStateCache.SetRenderState(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
+    g_D3dStateCache.SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+    munit_assert_int(g_StateCacheTestDevice->logCount, ==, 3);
+    munit_assert_uint32(g_StateCacheTestDevice->renderStates[D3DRS_ZFUNC], ==, D3DCMP_LESSEQUAL);
+
+    g_D3dStateCache.SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+    g_D3dStateCache.SetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_MODULATE);
+    g_D3dStateCache.SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+    g_D3dStateCache.SetTexture(0, texture);
+    g_D3dStateCache.SetTexture(0, texture);
+    g_D3dStateCache.SetTexture(0, NULL);
+    g_D3dStateCache.SetVertexShader(D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
+    g_D3dStateCache.SetVertexShader(D3DFVF_DIFFUSE | D3DFVF_XYZRHW);
+    munit_assert_int(g_StateCacheTestDevice->logCount, ==, 3 + 2 + 2 + 1);
+    munit_assert_null(g_StateCacheTestDevice->textures[0]);
+
+    munit_assert_int(g_D3dStateCache.thisFrame.renderStates, ==, 3);
+    munit_assert_int(g_D3dStateCache.thisFrame.textureStageStates, ==, 2);
+    munit_assert_int(g_D3dStateCache.thisFrame.textures, ==, 2);
+    munit_assert_int(g_D3dStateCache.thisFrame.vertexShaders, ==, 1);
+    munit_assert_int(g_D3dStateCache.thisFrame.redundant, ==, 4);
+
+    texture->Release();
+    TearDownStateCacheTest();
+    return MUNIT_OK;
+}
+
+// After Invalidate, as after a device reset, the cache can't know what the device holds and sends everything again.
+// EndFrame hands the counts over to lastFrame.
+static MunitResult test_state_cache_invalidate(const MunitParameter params[], void *user_data)
+{
+    SetUpStateCacheTest();
+    g_D3dStateCache.SetRenderState(D3DRS_ALPHAREF, 4);
+    g_D3dStateCache.SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+    g_D3dStateCache.SetVertexShader(D3DFVF_TEX1 | D3DFVF_XYZRHW);
+    g_D3dStateCache.SetRenderState(D3DRS_ALPHAREF, 4);
+    g_D3dStateCache.EndFrame();
+    munit_assert_int(g_D3dStateCache.lastFrame.renderStates, ==, 1);
+    munit_assert_int(g_D3dStateCache.lastFrame.redundant, ==, 1);
+    munit_assert_int(g_D3dStateCache.thisFrame.renderStates, ==, 0);
+    munit_assert_int(g_D3dStateCache.thisFrame.redundant, ==, 0);
+
+    g_D3dStateCache.Invalidate();
+    g_StateCacheTestDevice->Present(NULL, NULL, NULL, NULL);
+    g_D3dStateCache.SetRenderState(D3DRS_ALPHAREF, 4);
+    g_D3dStateCache.SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+    g_D3dStateCache.SetVertexShader(D3DFVF_TEX1 | D3DFVF_XYZRHW);
+    munit_assert_int(g_StateCacheTestDevice->logCount, ==, 3);
+    munit_assert_int(g_D3dStateCache.thisFrame.redundant, ==, 0);
+
+    TearDownStateCacheTest();
+    return MUNIT_OK;
+}
+
+static MunitTest d3dstatecache_test_suite_tests[] = {
+    {"/drops_redundant", test_state_cache_drops_redundant, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/invalidate", test_state_cache_invalidate, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "EclManager.hpp"
+#include "Enemy.hpp"
+#include "FileSystem.hpp"
+#include "GameManager.hpp"
+#include "Supervisor.hpp"
+#include "ZunMemory.hpp"
+#include "pbg3/Pbg3Archive.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define ECL_TEST_INSTR_SIZE 0x20
+#define ECL_TEST_INSTR_COUNT 20
+#define ECL_TEST_FRAME_COUNT 2000
+#define ECL_TEST_ALL_DIFFICULTIES 0xff
+#define ECL_TEST_NOT_NORMAL (0xff & ~(1 << NORMAL))
+// The loop at instruction 4 runs 40 times a frame, at about 12 instructions per pass.
+#define ECL_TEST_INSTRS_PER_FRAME (40 * 12 + 3)
+
+// A single sub of fixed-size instructions, laid out the way EclManager::Load leaves a relocated file.
+struct EclTestFile
+{
+    EclRawHeader header;
+    EclRawInstr *subOffsets[1];
+    u8 instrs[ECL_TEST_INSTR_COUNT][ECL_TEST_INSTR_SIZE];
+};
+
+static EclTestFile g_EclTestFile;
+static Enemy g_EclTestEnemy;
+
+static EclRawInstr *TestInstr(i32 idx)
+{
+    return (EclRawInstr *)g_EclTestFile.instrs[idx];
+}
+
+static void WriteInstr(i32 idx, i32 time, i16 opCode, u8 difficulties, i32 arg0, i32 arg1, i32 arg2)
+{
+    EclRawInstr *instr = TestInstr(idx);
+    i32 *args = (i32 *)&instr->args;
+
+    instr->time = time;
+    instr->opCode = opCode;
+    instr->offsetToNext = ECL_TEST_INSTR_SIZE;
+    instr->skipForDifficulty = difficulties;
+    args[0] = arg0;
+    args[1] = arg1;
+    args[2] = arg2;
+}
+
+static i32 FloatBits(f32 value)
+{
+    return *(i32 *)&value;
+}
+
+static void WriteJump(i32 idx, i32 time, i16 opCode, i32 target, i32 jumpTime, i32 var)
+{
+    WriteInstr(idx, time, opCode, ECL_TEST_ALL_DIFFICULTIES, jumpTime, (target - idx) * ECL_TEST_INSTR_SIZE, var);
+}
+
+// A loop mixing integer and float math, compares, conditional jumps and difficulty-skipped instructions, which is
+// the shape most enemy subs in the shipped ecldata take between their bullet patterns.
+static void BuildTestFile()
+{
+    memset(&g_EclTestFile, 0, sizeof(g_EclTestFile));
+    g_EclTestFile.header.subCount = 1;
+    g_EclTestFile.subOffsets[0] = TestInstr(0);
+
+    WriteInstr(0, 0, ECL_OPCODE_SETINT, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_I32_0, 0, 0);
+    WriteInstr(1, 0, ECL_OPCODE_SETFLOAT, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_F32_0, FloatBits(1.0f), 0);
+    WriteInstr(2, 0, ECL_OPCODE_SETINT, ECL_TEST_NOT_NORMAL, ECL_VAR_I32_1, 1000, 0);
+    WriteInstr(3, 0, ECL_OPCODE_SETINT, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_I32_1, 40, 0);
+    WriteInstr(4, 1, ECL_OPCODE_MATHINTADD, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_I32_0, ECL_VAR_I32_0, 7);
+    WriteInstr(5, 1, ECL_OPCODE_MATHINTMOD, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_I32_2, ECL_VAR_I32_0, 13);
+    WriteInstr(6, 1, ECL_OPCODE_MATHFLOATMUL, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_F32_0, FloatBits(-10005.0f),
+               FloatBits(1.0625f));
+    WriteInstr(7, 1, ECL_OPCODE_MATHFLOATSUB, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_F32_1, FloatBits(-10005.0f),
+               FloatBits(0.5f));
+    WriteInstr(8, 1, ECL_OPCODE_CMPINT, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_I32_2, 6, 0);
+    WriteJump(9, 1, ECL_OPCODE_JUMPGEQ, 11, 1, 0);
+    WriteInstr(10, 1, ECL_OPCODE_MATHINC, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_I32_3, 0, 0);
+    WriteInstr(11, 1, ECL_OPCODE_CMPFLOAT, ECL_TEST_ALL_DIFFICULTIES, FloatBits(-10005.0f), FloatBits(1000.0f), 0);
+    WriteJump(12, 1, ECL_OPCODE_JUMPLSS, 14, 1, 0);
+    WriteInstr(13, 1, ECL_OPCODE_SETFLOAT, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_F32_0, FloatBits(1.0f), 0);
+    WriteInstr(14, 1, ECL_OPCODE_SETINT, ECL_TEST_NOT_NORMAL, ECL_VAR_I32_4, 5, 0);
+    WriteJump(15, 1, ECL_OPCODE_JUMPDEC, 4, 1, ECL_VAR_I32_1);
+    WriteInstr(16, 2, ECL_OPCODE_MATHINTADD, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_I32_5, ECL_VAR_I32_5, 1);
+    WriteInstr(17, 2, ECL_OPCODE_SETINT, ECL_TEST_ALL_DIFFICULTIES, ECL_VAR_I32_1, 40, 0);
+    WriteJump(18, 2, ECL_OPCODE_JUMP, 4, 1, 0);
+    WriteInstr(19, -1, ECL_OPCODE_NOP, ECL_TEST_ALL_DIFFICULTIES, 0, 0, 0);
+
+    g_EclManager.eclFile = &g_EclTestFile.header;
+    g_EclManager.subTable = g_EclTestFile.subOffsets;
+    g_EclManager.timeline = NULL;
+}
+
+static void ResetTestEnemy()
+{
+    memset(&g_EclTestEnemy, 0, sizeof(g_EclTestEnemy));
+    g_EclTestEnemy.runInterrupt = -1;
+    g_EclTestEnemy.anmExLeft = -1;
+    g_EclManager.CallEclSub(&g_EclTestEnemy.currentContext, 0);
+}
+
+static void SetUpEclTest(ZunBool predecode)
+{
+    g_GameManager.difficulty = NORMAL;
+    g_Supervisor.framerateMultiplier = 1.0f;
+    g_Supervisor.effectiveFramerateMultiplier = 1.0f;
+    BuildTestFile();
+    g_EclManager.ReleasePredecoded();
+    if (predecode)
+    {
+        munit_assert_int(g_EclManager.Predecode(sizeof(g_EclTestFile)), ==, ZUN_SUCCESS);
+    }
+    ResetTestEnemy();
+}
+
+static void RunFrames(i32 frameCount)
+{
+    i32 frame;
+
+    for (frame = 0; frame < frameCount; frame++)
+    {
+        munit_assert_int(g_EclManager.RunEcl(&g_EclTestEnemy), ==, ZUN_SUCCESS);
+    }
+}
+
+// RunEcl only runs the decoded form with PREDECODED_ECL, so without it there is nothing to compare.
+#ifdef PREDECODED_ECL
+static MunitResult test_predecoded_matches_raw(const MunitParameter params[], void *user_data)
+{
+    EnemyEclContext rawContext;
+
+    SetUpEclTest(false);
+    RunFrames(ECL_TEST_FRAME_COUNT / 10);
+    memcpy(&rawContext, &g_EclTestEnemy.currentContext, sizeof(rawContext));
+
+    SetUpEclTest(true);
+    munit_assert_int(g_EclProgram.count, ==, ECL_TEST_INSTR_COUNT - 1);
+    munit_assert_int(g_EclProgram.handlerCount, ==, ECL_TEST_INSTR_COUNT - 1);
+    munit_assert_int(g_EclProgram.prunedCount, >, 0);
+    RunFrames(ECL_TEST_FRAME_COUNT / 10);
+
+    munit_assert_memory_equal(sizeof(rawContext), &g_EclTestEnemy.currentContext, &rawContext);
+    munit_assert_int(g_EclTestEnemy.currentContext.var1, ==, 0);
+    munit_assert_int(g_EclTestEnemy.currentContext.var4, ==, 0);
+    munit_assert_int(g_EclTestEnemy.currentContext.var5, ==, ECL_TEST_FRAME_COUNT / 10 - 2);
+
+    g_EclManager.ReleasePredecoded();
+    return MUNIT_OK;
+}
+
+static MunitResult test_skipped_instr_keeps_its_time(const MunitParameter params[], void *user_data)
+{
+    EnemyEclContext rawContext;
+
+    // A skipped instruction at a different time than the next one still makes the sub wait for it.
+    SetUpEclTest(false);
+    TestInstr(2)->time = 3;
+    RunFrames(8);
+    memcpy(&rawContext, &g_EclTestEnemy.currentContext, sizeof(rawContext));
+
+    SetUpEclTest(true);
+    TestInstr(2)->time = 3;
+    munit_assert_int(g_EclManager.Predecode(sizeof(g_EclTestFile)), ==, ZUN_SUCCESS);
+    ResetTestEnemy();
+    RunFrames(8);
+
+    munit_assert_memory_equal(sizeof(rawContext), &g_EclTestEnemy.currentContext, &rawContext);
+    munit_assert_int(g_EclTestEnemy.currentContext.var1, ==, 0);
+
+    g_EclManager.ReleasePredecoded();
+    return MUNIT_OK;
+}
+#endif
+
+static MunitResult test_predecode_shipped(const MunitParameter params[], void *user_data)
+{
+    static Pbg3Archive *archives[0x10];
+    Pbg3Archive archive;
+    char path[32];
+    i32 stage;
+
+    if (archive.Load("resources/KOUMAKYO_ST.dat") == 0)
+    {
+        return MUNIT_SKIP;
+    }
+    archives[0] = &archive;
+    g_Pbg3Archives = archives;
+    g_GameManager.difficulty = LUNATIC;
+
+    for (stage = 1; stage <= 7; stage++)
+    {
+        sprintf(path, "data/ecldata%d.ecl", stage);
+        munit_assert_int(g_EclManager.Load(path), ==, ZUN_SUCCESS);
+#ifndef PREDECODED_ECL
+        munit_assert_int(g_EclManager.Predecode(g_LastFileSize), ==, ZUN_SUCCESS);
+#endif
+        munit_assert_not_null(g_EclProgram.instrs);
+        munit_logf(MUNIT_LOG_INFO, "%s: %d instructions, %d with handlers, %d pruned steps", path,
+                   g_EclProgram.count, g_EclProgram.handlerCount, g_EclProgram.prunedCount);
+        g_EclManager.Unload();
+#ifndef PREDECODED_ECL
+        g_EclManager.ReleasePredecoded();
+#endif
+        g_ZunArenas[ZUN_ARENA_STAGE].Reset();
+    }
+
+    g_Pbg3Archives = NULL;
+    return MUNIT_OK;
+}
+
+static MunitResult RunEclBenchmark(ZunBool predecode)
+{
+    clock_t start;
+    f64 seconds;
+
+    SetUpEclTest(predecode);
+    start = clock();
+    RunFrames(ECL_TEST_FRAME_COUNT);
+    seconds = (f64)(clock() - start) / CLOCKS_PER_SEC;
+    if (seconds > 0.0)
+    {
+        munit_logf(MUNIT_LOG_INFO, "%.0f instructions per second",
+                   (f64)ECL_TEST_INSTRS_PER_FRAME * ECL_TEST_FRAME_COUNT / seconds);
+    }
+
+    g_EclManager.ReleasePredecoded();
+    return MUNIT_OK;
+}
+
+// Run with --log-visible info to see the instructions per second each benchmark reaches.
+static MunitResult bench_raw(const MunitParameter params[], void *user_data)
+{
+    return RunEclBenchmark(false);
+}
+
+#ifdef PREDECODED_ECL
+static MunitResult bench_predecoded(const MunitParameter params[], void *user_data)
+{
+    return RunEclBenchmark(true);
+}
+#endif
+
+static MunitTest eclmanager_test_suite_tests[] = {
+#ifdef PREDECODED_ECL
+    {"/predecoded_matches_raw", test_predecoded_matches_raw, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/skipped_instr_keeps_its_time", test_skipped_instr_keeps_its_time, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {"/predecode_shipped", test_predecode_shipped, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bench_raw", bench_raw, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#ifdef PREDECODED_ECL
+    {"/bench_predecoded", bench_predecoded, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -0,0 +1,78 @@
+#include <string.h>
+
+#include "FixedStep.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+// Not a multiple of FIXED_STEP_HZ, so a step is a fraction of a tick.
+#define FIXED_STEP_TEST_FREQUENCY 3579545
+
+static void StartFixedStepTest(FixedStep *clock)
+{
+    memset(clock, 0, sizeof(*clock));
+    clock->ticksPerSecond = FIXED_STEP_TEST_FREQUENCY;
+}
+
+// However the time is cut up, a second of it is FIXED_STEP_HZ steps, none lost to rounding.
+static MunitResult test_fixed_step_rate(const MunitParameter params[], void *user_data)
+{
+    FixedStep clock;
+    LONGLONG ticks;
+    i32 second;
+    i32 steps;
+
+    StartFixedStepTest(&clock);
+    munit_assert_int(clock.Advance(FIXED_STEP_TEST_FREQUENCY / FIXED_STEP_HZ), ==, 0);
+    munit_assert_int(clock.Advance(FIXED_STEP_TEST_FREQUENCY / FIXED_STEP_HZ + 1), ==, 1);
+    munit_assert_int(clock.lastSteps, ==, 1);
+
+    // A display at 144Hz asking every refresh.
+    StartFixedStepTest(&clock);
+    for (second = 1; second <= 10; second++)
+    {
+        steps = 0;
+        for (ticks = 1; ticks <= 144; ticks++)
+        {
+            steps += clock.Advance((second - 1) * (LONGLONG)FIXED_STEP_TEST_FREQUENCY +
+                                   ticks * FIXED_STEP_TEST_FREQUENCY / 144);
+            munit_assert_int(clock.lastSteps, <=, 1);
+        }
+        munit_assert_int(steps, ==, FIXED_STEP_HZ);
+    }
+    munit_assert_uint32(clock.numSteps, ==, FIXED_STEP_HZ * 10);
+    munit_assert_uint32(clock.numDroppedSteps, ==, 0);
+    return MUNIT_OK;
+}
+
+static MunitResult test_fixed_step_catch_up(const MunitParameter params[], void *user_data)
+{
+    FixedStep clock;
+    LONGLONG ticks;
+
+    // A GPU that only manages 25 frames a second still gets the game its 60 steps.
+    StartFixedStepTest(&clock);
+    for (ticks = 1; ticks <= 25; ticks++)
+    {
+        munit_assert_int(clock.Advance(ticks * FIXED_STEP_TEST_FREQUENCY / 25), >=, 2);
+    }
+    munit_assert_uint32(clock.numSteps, ==, FIXED_STEP_HZ);
+
+    // Half a second stuck loading only gets caught up on as far as FIXED_STEP_MAX_STEPS, and what's left of the step
+    // in progress carries on.
+    StartFixedStepTest(&clock);
+    ticks = FIXED_STEP_TEST_FREQUENCY / 2 + FIXED_STEP_TEST_FREQUENCY / FIXED_STEP_HZ / 2;
+    munit_assert_int(clock.Advance(ticks), ==, FIXED_STEP_MAX_STEPS);
+    munit_assert_uint32(clock.numDroppedSteps, ==, FIXED_STEP_HZ / 2 - FIXED_STEP_MAX_STEPS);
+    munit_assert_int(clock.Advance(ticks + FIXED_STEP_TEST_FREQUENCY / FIXED_STEP_HZ / 2 + 2), ==, 1);
+
+    // A clock that goes backwards counts as no time at all.
+    munit_assert_int(clock.Advance(0), ==, 0);
+    munit_assert_int(clock.Advance(FIXED_STEP_TEST_FREQUENCY / FIXED_STEP_HZ + 1), ==, 1);
+    return MUNIT_OK;
+}
+
+static MunitTest fixedstep_test_suite_tests[] = {
+    {"/rate", test_fixed_step_rate, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/catch_up", test_fixed_step_catch_up, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "MidiOutput.hpp"
+#include "MidiTimeline.hpp"
+#include "ZunMemory.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+// MidiOutput only builds and plays a timeline with MIDI_TIMELINE.
+#ifdef MIDI_TIMELINE
+// 96 ticks per quarter note, a conductor track and one channel track.
+static u8 g_MidiTestFile[] = {
+    'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 2, 0, 96,
+    // Two tempos, a quarter note apart, and the end a quarter note after that.
+    'M', 'T', 'r', 'k', 0, 0, 0, 18, 0x00, 0xff, 0x51, 0x03, 0x07, 0xa1, 0x20, 0x60, 0xff, 0x51, 0x03, 0x0f, 0x42,
+    0x40, 0x60, 0xff, 0x2f, 0x00,
+    // Program change and a note on at 0, the note off as a running status note on at 48, the loop start at 96, a
+    // sysex at 144, the loop end at 192.
+    'M', 'T', 'r', 'k', 0, 0, 0, 28, 0x00, 0xc0, 0x05, 0x00, 0x90, 0x3c, 0x64, 0x30, 0x3c, 0x00, 0x30, 0xb0, 0x02,
+    0x00, 0x30, 0xf0, 0x03, 0x41, 0x10, 0xf7, 0x30, 0xb0, 0x04, 0x00, 0x00, 0xff, 0x2f, 0x00};
+
+// The tempos as MidiOutput reads them: 0x07a120 comes out as 503752us and 0x0f4240 as 1007761us.
+#define MIDI_TEST_TICK_48 251876
+#define MIDI_TEST_TICK_96 503752
+#define MIDI_TEST_TICK_144 1007632
+#define MIDI_TEST_TICK_192 1511513
+
+static void LoadMidiTestFile(MidiOutput *output)
+{
+    output->midiFileData[0] = (u8 *)ZunAlloc(sizeof(g_MidiTestFile));
+    memcpy(output->midiFileData[0], g_MidiTestFile, sizeof(g_MidiTestFile));
+    munit_assert_int32(output->ParseFile((i32)0), ==, ZUN_SUCCESS);
+    output->ReleaseFileData(0);
+}
+
+static void AssertMidiTestEvent(i32 idx, u32 time, u8 status, u8 arg1, u8 arg2)
+{
+    MidiEvent *event;
+
+    event = &g_MidiTimeline.events[idx];
+    munit_assert_uint32(event->time, ==, time);
+    munit_assert_uint8(event->status, ==, status);
+    munit_assert_uint8(event->arg1, ==, arg1);
+    munit_assert_uint8(event->arg2, ==, arg2);
+}
+
+static MunitResult test_midi_timeline_build(const MunitParameter params[], void *user_data)
+{
+    MidiOutput output;
+    MidiEvent *event;
+    FILE *file;
+    char line[64];
+
+    g_MidiTimeline.isEnabled = true;
+    LoadMidiTestFile(&output);
+
+    munit_assert_int32(g_MidiTimeline.numEvents, ==, 6);
+    AssertMidiTestEvent(0, 0, 0xc0, 0x05, 0x00);
+    AssertMidiTestEvent(1, 0, 0x90, 0x3c, 0x64);
+    AssertMidiTestEvent(2, MIDI_TEST_TICK_48, 0x90, 0x3c, 0x00);
+    AssertMidiTestEvent(3, MIDI_TEST_TICK_96, 0xb0, 0x02, 0x00);
+    AssertMidiTestEvent(5, MIDI_TEST_TICK_192, 0xb0, 0x04, 0x00);
+    event = &g_MidiTimeline.events[4];
+    munit_assert_uint32(event->time, ==, MIDI_TEST_TICK_144);
+    munit_assert_uint8(event->status, ==, 0xf0);
+    munit_assert_uint32(event->sysexLength, ==, 3);
+    munit_assert_memory_equal(3, g_MidiTimeline.sysexData + event->sysexOffset, "\x41\x10\xf7");
+    munit_assert_uint32(g_MidiTimeline.endTime, ==, MIDI_TEST_TICK_192);
+
+    file = tmpfile();
+    munit_assert_not_null(file);
+    g_MidiTimeline.Dump(file);
+    rewind(file);
+    munit_assert_not_null(fgets(line, sizeof(line), file));
+    munit_assert_string_equal(line, "         0 c0 05 00\n");
+    fgets(line, sizeof(line), file);
+    fgets(line, sizeof(line), file);
+    fgets(line, sizeof(line), file);
+    fgets(line, sizeof(line), file);
+    munit_assert_string_equal(line, "   1007632 f0 41 10 f7\n");
+    fgets(line, sizeof(line), file);
+    fgets(line, sizeof(line), file);
+    munit_assert_string_equal(line, "   1511513 end\n");
+    fclose(file);
+
+    output.ClearTracks();
+    munit_assert_null(g_MidiTimeline.events);
+    g_MidiTimeline.isEnabled = false;
+    return MUNIT_OK;
+}
+
+// Ticks the timer by hand, with no device open: the channel state still follows the events.
+static MunitResult test_midi_timeline_playback(const MunitParameter params[], void *user_data)
+{
+    MidiOutput output;
+    i32 tick;
+
+    g_MidiTimeline.isEnabled = true;
+    LoadMidiTestFile(&output);
+    output.LoadTracks();
+
+    output.OnTimerElapsed();
+    munit_assert_uint8(output.channels[0].instrument, ==, 5);
+    munit_assert_uint8(output.channels[0].keyPressedFlags[0x3c >> 3], ==, 1 << (0x3c & 7));
+    munit_assert_int32(g_MidiTimeline.cursor, ==, 2);
+
+    // Due on the first millisecond at or after it.
+    for (tick = 1; tick <= MIDI_TEST_TICK_48 / 1000; tick++)
+    {
+        output.OnTimerElapsed();
+    }
+    munit_assert_uint8(output.channels[0].keyPressedFlags[0x3c >> 3], ==, 1 << (0x3c & 7));
+    output.OnTimerElapsed();
+    munit_assert_uint8(output.channels[0].keyPressedFlags[0x3c >> 3], ==, 0);
+
+    // The loop end goes back to just after the loop start, at the time of the loop start.
+    for (tick++; tick <= MIDI_TEST_TICK_192 / 1000 + 1; tick++)
+    {
+        output.OnTimerElapsed();
+    }
+    munit_assert_int32(g_MidiTimeline.cursor, ==, 4);
+    munit_assert_uint32(g_MidiTimeline.time, ==, MIDI_TEST_TICK_96 + 1000);
+    munit_assert_false(g_MidiTimeline.isFinished);
+
+    output.ClearTracks();
+    g_MidiTimeline.isEnabled = false;
+    return MUNIT_OK;
+}
+#endif
+
+static MunitTest miditimeline_test_suite_tests[] = {
+#ifdef MIDI_TIMELINE
+    {"/build", test_midi_timeline_build, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/playback", test_midi_timeline_playback, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "PcmAsset.hpp"
+#include "SoundMixer.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define PCM_TEST_HEADER_BYTES 44
+#define PCM_TEST_FRAMES 300
+
+static PcmAssetCache g_PcmTestCache;
+static SoundMixer g_PcmTestMixer;
+static SoundMixerNullSink g_PcmTestSink;
+
+static void GetPcmTestFormat(WAVEFORMATEX *format, i32 channels, i32 bits, i32 rate)
+{
+    memset(format, 0, sizeof(*format));
+    format->wFormatTag = WAVE_FORMAT_PCM;
+    format->nChannels = channels;
+    format->nSamplesPerSec = rate;
+    format->wBitsPerSample = bits;
+    format->nBlockAlign = channels * bits / 8;
+    format->nAvgBytesPerSec = rate * format->nBlockAlign;
+}
+
+// A file as FileSystem::OpenPath would hand it over: malloc'd, with the samples after a header.
+static u8 *LoadPcmTestFile(u32 seed)
+{
+    u8 *file;
+    i32 idx;
+
+    file = (u8 *)malloc(PCM_TEST_HEADER_BYTES + PCM_TEST_FRAMES * 4);
+    memset(file, 0, PCM_TEST_HEADER_BYTES);
+    for (idx = 0; idx < PCM_TEST_FRAMES * 4; idx++)
+    {
+        file[PCM_TEST_HEADER_BYTES + idx] = (u8)(idx * 7 + seed);
+    }
+    return file;
+}
+
+static MunitResult test_pcm_asset_share(const MunitParameter params[], void *user_data)
+{
+    WAVEFORMATEX format;
+    PcmAsset *first;
+    PcmAsset *copy;
+    PcmAsset *other;
+    u8 *file;
+
+    GetPcmTestFormat(&format, 2, 16, SOUND_MIXER_SAMPLE_RATE);
+    file = LoadPcmTestFile(0);
+    first = g_PcmTestCache.Adopt("a.wav", file, &format, file + PCM_TEST_HEADER_BYTES, PCM_TEST_FRAMES * 4);
+    munit_assert_not_null(first);
+    munit_assert_ptr_equal(first->pcm, file + PCM_TEST_HEADER_BYTES);
+    munit_assert_int32(first->refCount, ==, 1);
+
+    // The same path again doesn't need reading.
+    munit_assert_ptr_equal(g_PcmTestCache.FindPath("a.wav"), first);
+    munit_assert_int32(first->refCount, ==, 2);
+    munit_assert_null(g_PcmTestCache.FindPath("b.wav"));
+
+    // Another file with the same samples is the same asset.
+    file = LoadPcmTestFile(0);
+    copy = g_PcmTestCache.Adopt("b.wav", file, &format, file + PCM_TEST_HEADER_BYTES, PCM_TEST_FRAMES * 4);
+    munit_assert_ptr_equal(copy, first);
+    munit_assert_int32(first->refCount, ==, 3);
+    munit_assert_uint32(g_PcmTestCache.sharedBytes, ==, PCM_TEST_FRAMES * 4);
+
+    // Different samples, or the same samples played differently, are not.
+    file = LoadPcmTestFile(1);
+    other = g_PcmTestCache.Adopt("c.wav", file, &format, file + PCM_TEST_HEADER_BYTES, PCM_TEST_FRAMES * 4);
+    munit_assert_ptr_not_equal(other, first);
+    g_PcmTestCache.Release(other);
+    GetPcmTestFormat(&format, 2, 16, 22050);
+    file = LoadPcmTestFile(0);
+    other = g_PcmTestCache.Adopt("d.wav", file, &format, file + PCM_TEST_HEADER_BYTES, PCM_TEST_FRAMES * 4);
+    munit_assert_ptr_not_equal(other, first);
+    g_PcmTestCache.Release(other);
+    munit_assert_int32(other->refCount, ==, 0);
+    munit_assert_null(other->fileData);
+
+    g_PcmTestCache.Release(first);
+    g_PcmTestCache.Release(first);
+    munit_assert_int32(first->refCount, ==, 1);
+    g_PcmTestCache.Release(first);
+    munit_assert_null(first->fileData);
+    munit_assert_null(g_PcmTestCache.FindPath("a.wav"));
+    return MUNIT_OK;
+}
+
+static MunitResult test_pcm_asset_mixer(const MunitParameter params[], void *user_data)
+{
+    WAVEFORMATEX format;
+    PcmAsset *asset;
+    PcmAsset *mono;
+    u8 *file;
+
+    g_PcmTestMixer.Start(&g_PcmTestSink);
+
+    // Already the mixer's format: played from the file's buffer, which the mixer keeps alive.
+    GetPcmTestFormat(&format, 2, 16, SOUND_MIXER_SAMPLE_RATE);
+    file = LoadPcmTestFile(0);
+    asset = g_PcmAssetCache.Adopt("a.wav", file, &format, file + PCM_TEST_HEADER_BYTES, PCM_TEST_FRAMES * 4);
+    munit_assert_int32(g_PcmTestMixer.LoadSample(0, asset), ==, ZUN_SUCCESS);
+    munit_assert_int32(g_PcmTestMixer.LoadSample(1, asset), ==, ZUN_SUCCESS);
+    munit_assert_ptr_equal(g_PcmTestMixer.samples[0].frames, asset->pcm);
+    munit_assert_ptr_equal(g_PcmTestMixer.samples[1].frames, asset->pcm);
+    munit_assert_int32(g_PcmTestMixer.samples[0].frameCount, ==, PCM_TEST_FRAMES);
+    g_PcmAssetCache.Release(asset);
+    munit_assert_int32(asset->refCount, ==, 2);
+
+    // Anything else is converted, and the file isn't needed after.
+    GetPcmTestFormat(&format, 1, 16, SOUND_MIXER_SAMPLE_RATE);
+    file = LoadPcmTestFile(1);
+    mono = g_PcmAssetCache.Adopt("b.wav", file, &format, file + PCM_TEST_HEADER_BYTES, PCM_TEST_FRAMES * 4);
+    munit_assert_int32(g_PcmTestMixer.LoadSample(2, mono), ==, ZUN_SUCCESS);
+    munit_assert_ptr_not_equal(g_PcmTestMixer.samples[2].frames, mono->pcm);
+    munit_assert_null(g_PcmTestMixer.samples[2].asset);
+    munit_assert_int32(g_PcmTestMixer.samples[2].frameCount, ==, PCM_TEST_FRAMES * 2);
+    munit_assert_int16(g_PcmTestMixer.samples[2].frames[3], ==, ((i16 *)mono->pcm)[1]);
+    munit_assert_int32(mono->refCount, ==, 1);
+
+    // Loading over a shared sample lets go of it.
+    munit_assert_int32(g_PcmTestMixer.LoadSample(1, mono), ==, ZUN_SUCCESS);
+    munit_assert_int32(asset->refCount, ==, 1);
+    g_PcmAssetCache.Release(mono);
+    g_PcmTestMixer.Stop();
+    munit_assert_int32(asset->refCount, ==, 0);
+    munit_assert_null(asset->fileData);
+    return MUNIT_OK;
+}
+
+static MunitTest pcmasset_test_suite_tests[] = {
+    {"/share", test_pcm_asset_share, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/mixer", test_pcm_asset_mixer, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
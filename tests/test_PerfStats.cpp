@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "PerfStats.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+static void SetPerfTestFrame(PerfFrameStats *stats, i32 frame)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->ms[PerfSection_Calc] = 1.0f + (frame % 7);
+    stats->ms[PerfSection_Draw] = 2.0f + (frame % 5);
+    stats->ms[PerfSection_Present] = 0.5f;
+    stats->bullets = frame;
+}
+
+static MunitResult test_perf_stats_history(const MunitParameter params[], void *user_data)
+{
+    PerfFrameStats stats;
+    PerfFrameStats *worst;
+    i32 frame;
+
+    g_PerfStats.Start(false);
+    munit_assert_null(g_PerfStats.GetFrame(0));
+    munit_assert_null(g_PerfStats.GetWorstFrame(60));
+    for (frame = 0; frame < 300; frame++)
+    {
+        SetPerfTestFrame(&stats, frame);
+        // A single slow frame, older than the worst frame window but still in the history.
+        if (frame == 50)
+        {
+            stats.ms[PerfSection_Present] = 40.0f;
+        }
+        g_PerfStats.PushFrame(&stats);
+    }
+
+    munit_assert_uint32(g_PerfStats.GetFrame(0)->frame, ==, 299);
+    munit_assert_int(g_PerfStats.GetFrame(0)->bullets, ==, 299);
+    munit_assert_uint32(g_PerfStats.GetFrame(PERF_STATS_HISTORY - 1)->frame, ==, 300 - PERF_STATS_HISTORY);
+    munit_assert_null(g_PerfStats.GetFrame(PERF_STATS_HISTORY));
+    munit_assert_float(g_PerfStats.GetFrameMs(g_PerfStats.GetFrame(0)), ==, 1.0f + 5 + 2.0f + 4 + 0.5f);
+
+    // 7 and 5 are coprime, so the worst of any 35 frames has both at their maximum.
+    worst = g_PerfStats.GetWorstFrame(PERF_STATS_WORST_SECONDS * 60);
+    munit_assert_not_null(worst);
+    munit_assert_float(g_PerfStats.GetFrameMs(worst), ==, 7.0f + 6.0f + 0.5f);
+    munit_assert_uint32(worst->frame % 35, ==, 34);
+    worst = g_PerfStats.GetWorstFrame(PERF_STATS_HISTORY);
+    munit_assert_uint32(worst->frame, ==, 50);
+
+    g_PerfStats.isEnabled = false;
+    return MUNIT_OK;
+}
+
+static MunitResult test_perf_stats_sections(const MunitParameter params[], void *user_data)
+{
+    volatile u32 hash;
+    i32 idx;
+
+    g_PerfStats.Start(false);
+    g_PerfStats.Begin(PerfSection_Calc);
+    for (hash = 0, idx = 0; idx < 100000; idx++)
+    {
+        hash = hash * 31 + idx;
+    }
+    g_PerfStats.End(PerfSection_Calc);
+    munit_assert(g_PerfStats.sectionTicks[PerfSection_Calc] > 0);
+    munit_assert(g_PerfStats.sectionTicks[PerfSection_Draw] == 0);
+
+    // Nothing is timed while disabled.
+    g_PerfStats.isEnabled = false;
+    g_PerfStats.Begin(PerfSection_Draw);
+    g_PerfStats.End(PerfSection_Draw);
+    munit_assert(g_PerfStats.sectionTicks[PerfSection_Draw] == 0);
+    return MUNIT_OK;
+}
+
+static MunitResult test_perf_stats_csv(const MunitParameter params[], void *user_data)
+{
+    PerfFrameStats stats;
+    char line[128];
+    FILE *file;
+
+    g_PerfStats.Start(false);
+    munit_assert_int(g_PerfStats.OpenCsv("test_perfstats.csv"), ==, ZUN_SUCCESS);
+    SetPerfTestFrame(&stats, 0);
+    stats.enemies = 3;
+    stats.items = 4;
+    stats.effects = 5;
+    stats.lasers = 6;
+    stats.playerBullets = 7;
+    g_PerfStats.PushFrame(&stats);
+    SetPerfTestFrame(&stats, 1);
+    g_PerfStats.PushFrame(&stats);
+    g_PerfStats.CloseCsv();
+    munit_assert_null(g_PerfStats.csvFile);
+
+    file = fopen("test_perfstats.csv", "r");
+    munit_assert_not_null(file);
+    munit_assert_not_null(fgets(line, sizeof(line), file));
+    munit_assert_string_equal(line,
+                              "frame,calc_ms,draw_ms,present_ms,bullets,enemies,items,effects,lasers,player_bullets\n");
+    munit_assert_not_null(fgets(line, sizeof(line), file));
+    munit_assert_string_equal(line, "0,1.000,2.000,0.500,0,3,4,5,6,7\n");
+    munit_assert_not_null(fgets(line, sizeof(line), file));
+    munit_assert_string_equal(line, "1,2.000,3.000,0.500,1,0,0,0,0,0\n");
+    munit_assert_null(fgets(line, sizeof(line), file));
+    fclose(file);
+    remove("test_perfstats.csv");
+
+    g_PerfStats.isEnabled = false;
+    return MUNIT_OK;
+}
+
+static MunitTest perfstats_test_suite_tests[] = {
+    {"/history", test_perf_stats_history, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/sections", test_perf_stats_sections, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/csv", test_perf_stats_csv, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
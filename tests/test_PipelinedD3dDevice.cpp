@@ -0,0 +1,198 @@
+#include <string.h>
+#include <time.h>
+
+#include "PipelinedD3dDevice.hpp"
+#include "SoftwareD3dDevice.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define PIPELINED_TEST_QUAD_COUNT 1000
+#define PIPELINED_TEST_BENCH_FRAMES 10
+
+struct PipelinedTestVertex
+{
+    f32 x;
+    f32 y;
+    f32 z;
+    f32 rhw;
+    D3DCOLOR diffuse;
+};
+
+static void SetPipelinedTestQuad(PipelinedTestVertex *quad, f32 left, f32 top, f32 size, D3DCOLOR diffuse)
+{
+    i32 idx;
+
+    for (idx = 0; idx < 4; idx++)
+    {
+        quad[idx].x = left + (idx & 1) * size;
+        quad[idx].y = top + (idx >> 1) * size;
+        quad[idx].z = 0.5f;
+        quad[idx].rhw = 1.0f;
+        quad[idx].diffuse = diffuse;
+    }
+}
+
+static void SetUpPipelinedTestDevice(IDirect3DDevice8 *device)
+{
+    device->SetRenderState(D3DRS_ZENABLE, FALSE);
+    device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+    device->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+    device->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+    device->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+    device->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+    device->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
+    device->SetVertexShader(D3DFVF_XYZRHW | D3DFVF_DIFFUSE);
+}
+
+// One quad buffer reused for every draw, the way the game reuses its sprite vertices, so a device that kept a pointer
+// instead of a copy would draw the last quad everywhere.
+static void DrawPipelinedTestFrame(IDirect3DDevice8 *device, i32 frame)
+{
+    PipelinedTestVertex quad[4];
+    u32 seed;
+    i32 idx;
+
+    device->BeginScene();
+    device->Clear(0, NULL, D3DCLEAR_TARGET, 0xff000000, 1.0f, 0);
+    seed = frame * 7 + 1;
+    for (idx = 0; idx < PIPELINED_TEST_QUAD_COUNT; idx++)
+    {
+        seed = seed * 1103515245 + 12345;
+        SetPipelinedTestQuad(quad, (f32)(seed >> 8 & 0x1ff), (f32)(seed >> 18 & 0x1ff) * 0.75f,
+                             4.0f + (f32)(seed & 0x1f), 0x80000000 | (seed * 2654435761u >> 8));
+        device->SetRenderState(D3DRS_DESTBLEND, idx & 1 ? D3DBLEND_ONE : D3DBLEND_INVSRCALPHA);
+        device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quad, sizeof(PipelinedTestVertex));
+    }
+    device->EndScene();
+}
+
+// Stands in for the calc chain: work the game thread does between EndScene and Present.
+static u32 RunPipelinedTestCalc()
+{
+    u32 hash;
+    i32 idx;
+
+    hash = 0;
+    for (idx = 0; idx < 2000000; idx++)
+    {
+        hash = hash * 31 + idx;
+    }
+    return hash;
+}
+
+static MunitResult test_pipelined_device_snapshot(const MunitParameter params[], void *user_data)
+{
+    SoftwareD3dDevice *target = new SoftwareD3dDevice(64, 64, 1);
+    PipelinedD3dDevice *pipeline = new PipelinedD3dDevice(target);
+    PipelinedTestVertex quad[4];
+    u16 indices[6] = {0, 1, 2, 2, 1, 3};
+    u32 *pixels = (u32 *)target->backBuffer->bits;
+    DWORD value;
+
+    SetUpPipelinedTestDevice(pipeline);
+    pipeline->BeginScene();
+    pipeline->Clear(0, NULL, D3DCLEAR_TARGET, 0xff000000, 1.0f, 0);
+    pipeline->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_ZERO);
+    SetPipelinedTestQuad(quad, -0.5f, -0.5f, 8.0f, 0xffff0000);
+    pipeline->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quad, sizeof(PipelinedTestVertex));
+    SetPipelinedTestQuad(quad, 7.5f, -0.5f, 8.0f, 0xff00ff00);
+    pipeline->DrawIndexedPrimitiveUP(D3DPT_TRIANGLELIST, 0, 4, 2, indices, D3DFMT_INDEX16, quad,
+                                     sizeof(PipelinedTestVertex));
+    pipeline->EndScene();
+
+    // Nothing the game does to its copy after the call may show up on screen.
+    SetPipelinedTestQuad(quad, -0.5f, -0.5f, 64.0f, 0xff0000ff);
+    memset(indices, 0, sizeof(indices));
+
+    // A read goes to the device only once everything before it has.
+    munit_assert_int(pipeline->GetRenderState(D3DRS_DESTBLEND, &value), ==, D3D_OK);
+    munit_assert_uint32(value, ==, D3DBLEND_ZERO);
+    munit_assert_int(target->thisFrame.drawCalls, ==, 2);
+
+    pipeline->Present(NULL, NULL, NULL, NULL);
+    munit_assert_uint32(pixels[0], ==, 0xffff0000);
+    munit_assert_uint32(pixels[8], ==, 0xff00ff00);
+    munit_assert_uint32(pixels[16], ==, 0xff000000);
+    munit_assert_uint32(pixels[8 * 64], ==, 0xff000000);
+    munit_assert_int(pipeline->lastFrame.commands, ==, 14);
+    munit_assert_int(pipeline->lastFrame.syncs, <=, 1);
+
+    pipeline->Release();
+    delete target;
+    return MUNIT_OK;
+}
+
+// Draws the same frames straight to one device and through the pipeline to another, with some calc work between
+// EndScene and Present, and checks they come out the same.
+static MunitResult test_pipelined_device_matches_direct(const MunitParameter params[], void *user_data)
+{
+    SoftwareD3dDevice *direct = new SoftwareD3dDevice(640, 480, 1);
+    SoftwareD3dDevice *target = new SoftwareD3dDevice(640, 480, 1);
+    PipelinedD3dDevice *pipeline = new PipelinedD3dDevice(target);
+    clock_t start;
+    f64 directMs;
+    f64 pipelinedMs;
+    u32 hash;
+    i32 frame;
+
+    SetUpPipelinedTestDevice(direct);
+    SetUpPipelinedTestDevice(pipeline);
+    hash = 0;
+    start = clock();
+    for (frame = 0; frame < PIPELINED_TEST_BENCH_FRAMES; frame++)
+    {
+        DrawPipelinedTestFrame(direct, frame);
+        hash += RunPipelinedTestCalc();
+        direct->Present(NULL, NULL, NULL, NULL);
+    }
+    directMs = (f64)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / PIPELINED_TEST_BENCH_FRAMES;
+    start = clock();
+    for (frame = 0; frame < PIPELINED_TEST_BENCH_FRAMES; frame++)
+    {
+        DrawPipelinedTestFrame(pipeline, frame);
+        hash += RunPipelinedTestCalc();
+        pipeline->Present(NULL, NULL, NULL, NULL);
+    }
+    pipelinedMs = (f64)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / PIPELINED_TEST_BENCH_FRAMES;
+
+    munit_assert_memory_equal(640 * 480 * 4, direct->backBuffer->bits, target->backBuffer->bits);
+    munit_assert_int(target->lastFrame.drawCalls, ==, direct->lastFrame.drawCalls);
+    munit_assert_int(target->total.vertices, ==, direct->total.vertices);
+    munit_logf(MUNIT_LOG_INFO, "direct: %.3f ms/frame, pipelined: %.3f ms/frame, %d commands, %d bytes (%08x)",
+               directMs, pipelinedMs, pipeline->lastFrame.commands, pipeline->lastFrame.dataBytes, hash);
+
+    pipeline->Release();
+    delete target;
+    delete direct;
+    return MUNIT_OK;
+}
+
+// D3DX queries the device it's handed for IDirect3DDevice8, and the wrapper has to answer for itself.
+static MunitResult test_pipelined_device_query_interface(const MunitParameter params[], void *user_data)
+{
+    SoftwareD3dDevice *target = new SoftwareD3dDevice(64, 64, 1);
+    PipelinedD3dDevice *pipeline = new PipelinedD3dDevice(target);
+    void *object;
+
+    munit_assert_int(pipeline->QueryInterface(IID_IDirect3DDevice8, &object), ==, S_OK);
+    munit_assert_ptr_equal(object, pipeline);
+    munit_assert_int(pipeline->QueryInterface(IID_IUnknown, &object), ==, S_OK);
+    munit_assert_ptr_equal(object, pipeline);
+    munit_assert_int(pipeline->Release(), ==, 2);
+    munit_assert_int(pipeline->Release(), ==, 1);
+    munit_assert_int(pipeline->QueryInterface(IID_IDirect3DTexture8, &object), ==, E_NOINTERFACE);
+    munit_assert_null(object);
+
+    g_PipelinedD3dDevice = pipeline;
+    pipeline->Release();
+    munit_assert_null(g_PipelinedD3dDevice);
+    delete target;
+    return MUNIT_OK;
+}
+
+static MunitTest pipelinedd3ddevice_test_suite_tests[] = {
+    {"/snapshot", test_pipelined_device_snapshot, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/matches_direct", test_pipelined_device_matches_direct, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/query_interface", test_pipelined_device_query_interface, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
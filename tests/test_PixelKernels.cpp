@@ -0,0 +1,255 @@
+#include <string.h>
+#include <time.h>
+
+#include "PixelKernels.hpp"
+#include "utils.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define PIXEL_TEST_WIDTH 77
+#define PIXEL_TEST_HEIGHT 9
+#define PIXEL_TEST_PITCH 96
+#define PIXEL_TEST_BENCH_WIDTH 256
+#define PIXEL_TEST_BENCH_HEIGHT 256
+#define PIXEL_TEST_BENCH_PASSES 64
+
+static u32 g_PixelTestSrc[PIXEL_TEST_BENCH_WIDTH * PIXEL_TEST_BENCH_HEIGHT];
+static u32 g_PixelTestDst[PIXEL_TEST_BENCH_WIDTH * PIXEL_TEST_BENCH_HEIGHT];
+static u32 g_PixelTestExpected[PIXEL_TEST_BENCH_WIDTH * PIXEL_TEST_BENCH_HEIGHT];
+
+static void FillPixelTestBuffer(u32 *buffer, i32 count)
+{
+    i32 idx;
+
+    for (idx = 0; idx < count; idx++)
+    {
+        buffer[idx] = munit_rand_uint32();
+    }
+}
+
+// Switches to level, or returns false if the CPU can't run it.
+static bool SetPixelTestLevel(i32 level)
+{
+    PixelKernels::SetLevel(level);
+    return PixelKernels::GetLevel() == level;
+}
+
+// The loop AnmManager::LoadTextureAlphaChannel runs without PIXEL_KERNELS.
+static void MergeAlphaReference(D3DFORMAT format, u8 *dst, u8 *src, i32 width, i32 height)
+{
+    struct Argb1555Pixel
+    {
+        u16 b : 5;
+        u16 g : 5;
+        u16 r : 5;
+        u16 a : 1;
+    };
+
+    struct Argb4444Pixel
+    {
+        u16 b : 4;
+        u16 g : 4;
+        u16 r : 4;
+        u16 a : 4;
+    };
+
+    i32 x;
+    i32 y;
+
+    for (y = 0; y < height; y++, dst += PIXEL_TEST_PITCH * 4, src += PIXEL_TEST_PITCH * 4)
+    {
+        for (x = 0; x < width; x++)
+        {
+            switch (format)
+            {
+            case D3DFMT_A8R8G8B8:
+                dst[x * 4 + 3] = src[x * 4];
+                break;
+            case D3DFMT_A1R5G5B5:
+                ((Argb1555Pixel *)dst)[x].a = ((Argb1555Pixel *)src)[x].b >> 4;
+                break;
+            case D3DFMT_A4R4G4B4:
+                ((Argb4444Pixel *)dst)[x].a = ((Argb4444Pixel *)src)[x].b;
+                break;
+            }
+        }
+    }
+}
+
+// TextHelper::InvertAlpha without PIXEL_KERNELS.
+static void InvertAlphaReference(D3DFORMAT format, u8 *bufferRegion, i32 doubleArea)
+{
+    struct A1R5G5B5
+    {
+        u16 blue : 5;
+        u16 green : 5;
+        u16 red : 5;
+        u16 alpha : 1;
+    };
+
+    A1R5G5B5 *bufferCursor;
+    i32 idx;
+
+    switch (format)
+    {
+    case D3DFMT_A8R8G8B8:
+        for (idx = 3; idx < doubleArea; idx += 4)
+        {
+            bufferRegion[idx] = bufferRegion[idx] ^ 0xff;
+        }
+        break;
+    case D3DFMT_A1R5G5B5:
+        for (bufferCursor = (A1R5G5B5 *)bufferRegion, idx = 0; idx < doubleArea; idx += 2, bufferCursor += 1)
+        {
+            bufferCursor->alpha ^= 1;
+            if (bufferCursor->alpha)
+            {
+                bufferCursor->red = bufferCursor->red - bufferCursor->red * idx / doubleArea / 2;
+                bufferCursor->green = bufferCursor->green - bufferCursor->green * idx / doubleArea / 2;
+                bufferCursor->blue = bufferCursor->blue - bufferCursor->blue * idx / doubleArea / 4;
+            }
+            else
+            {
+                bufferCursor->red = 31 - idx * 31 / doubleArea / 2;
+                bufferCursor->green = 31 - idx * 31 / doubleArea / 2;
+                bufferCursor->blue = 31 - idx * 31 / doubleArea / 4;
+            }
+        }
+        break;
+    case D3DFMT_A4R4G4B4:
+        for (idx = 1; idx < doubleArea; idx = idx + 2)
+        {
+            bufferRegion[idx] = bufferRegion[idx] ^ 0xf0;
+        }
+        break;
+    }
+}
+
+static MunitResult test_pixel_kernels_merge_alpha(const MunitParameter params[], void *user_data)
+{
+    D3DFORMAT formats[] = {D3DFMT_A8R8G8B8, D3DFMT_A1R5G5B5, D3DFMT_A4R4G4B4};
+    i32 level;
+    i32 idx;
+
+    for (level = PixelKernelLevel_Scalar; level <= PixelKernelLevel_Sse2; level++)
+    {
+        if (!SetPixelTestLevel(level))
+        {
+            continue;
+        }
+        for (idx = 0; idx < ARRAY_SIZE_SIGNED(formats); idx++)
+        {
+            FillPixelTestBuffer(g_PixelTestSrc, PIXEL_TEST_PITCH * PIXEL_TEST_HEIGHT);
+            FillPixelTestBuffer(g_PixelTestDst, PIXEL_TEST_PITCH * PIXEL_TEST_HEIGHT);
+            memcpy(g_PixelTestExpected, g_PixelTestDst, PIXEL_TEST_PITCH * PIXEL_TEST_HEIGHT * 4);
+            MergeAlphaReference(formats[idx], (u8 *)g_PixelTestExpected, (u8 *)g_PixelTestSrc, PIXEL_TEST_WIDTH,
+                                PIXEL_TEST_HEIGHT);
+            munit_assert_true(PixelKernels::MergeAlpha(formats[idx], (u8 *)g_PixelTestDst, PIXEL_TEST_PITCH * 4,
+                                                       (u8 *)g_PixelTestSrc, PIXEL_TEST_PITCH * 4, PIXEL_TEST_WIDTH,
+                                                       PIXEL_TEST_HEIGHT));
+            munit_assert_memory_equal(PIXEL_TEST_PITCH * PIXEL_TEST_HEIGHT * 4, g_PixelTestDst, g_PixelTestExpected);
+        }
+    }
+    munit_assert_false(PixelKernels::MergeAlpha(D3DFMT_R5G6B5, (u8 *)g_PixelTestDst, 0, (u8 *)g_PixelTestSrc, 0, 1, 1));
+
+    SetPixelTestLevel(PixelKernelLevel_Sse2);
+    return MUNIT_OK;
+}
+
+static MunitResult test_pixel_kernels_invert_alpha(const MunitParameter params[], void *user_data)
+{
+    D3DFORMAT formats[] = {D3DFMT_A8R8G8B8, D3DFMT_A1R5G5B5, D3DFMT_A4R4G4B4};
+    // TextHelper's text buffers, then sizes that leave a tail for the scalar code.
+    i32 doubleAreas[] = {512 * 36 * 2, 512 * 38 * 2, 256 * 34 * 2, 70, 2, 0};
+    i32 level;
+    i32 formatIdx;
+    i32 areaIdx;
+    i32 idx;
+
+    for (level = PixelKernelLevel_Scalar; level <= PixelKernelLevel_Sse2; level++)
+    {
+        if (!SetPixelTestLevel(level))
+        {
+            continue;
+        }
+        for (formatIdx = 0; formatIdx < ARRAY_SIZE_SIGNED(formats); formatIdx++)
+        {
+            for (areaIdx = 0; areaIdx < ARRAY_SIZE_SIGNED(doubleAreas); areaIdx++)
+            {
+                // Mostly the opaque black background a text buffer has at this point, with some text pixels on it.
+                FillPixelTestBuffer(g_PixelTestDst, ARRAY_SIZE_SIGNED(g_PixelTestDst));
+                for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_PixelTestDst); idx++)
+                {
+                    if (g_PixelTestDst[idx] % 4 != 0)
+                    {
+                        g_PixelTestDst[idx] = 0x80008000;
+                    }
+                }
+                memcpy(g_PixelTestExpected, g_PixelTestDst, sizeof(g_PixelTestDst));
+                InvertAlphaReference(formats[formatIdx], (u8 *)g_PixelTestExpected, doubleAreas[areaIdx]);
+                munit_assert_true(
+                    PixelKernels::InvertAlpha(formats[formatIdx], (u8 *)g_PixelTestDst, doubleAreas[areaIdx]));
+                munit_assert_memory_equal(sizeof(g_PixelTestDst), g_PixelTestDst, g_PixelTestExpected);
+            }
+        }
+    }
+
+    SetPixelTestLevel(PixelKernelLevel_Sse2);
+    return MUNIT_OK;
+}
+
+static f64 GetPixelTestMPixelsPerSecond(clock_t start, i32 pixels)
+{
+    f64 seconds;
+
+    seconds = (f64)(clock() - start) / CLOCKS_PER_SEC;
+    return seconds > 0.0 ? (f64)pixels * PIXEL_TEST_BENCH_PASSES / seconds / 1000000.0 : 0.0;
+}
+
+// CPU only: the kernels never touch the device, so this measures the same thing with or without a GPU.
+static MunitResult test_pixel_kernels_bench(const MunitParameter params[], void *user_data)
+{
+    const char *levelNames[] = {"scalar", "sse2"};
+    f64 mergeRate;
+    f64 invertRate;
+    clock_t start;
+    i32 level;
+    i32 pass;
+
+    FillPixelTestBuffer(g_PixelTestSrc, ARRAY_SIZE_SIGNED(g_PixelTestSrc));
+    for (level = PixelKernelLevel_Scalar; level <= PixelKernelLevel_Sse2; level++)
+    {
+        if (!SetPixelTestLevel(level))
+        {
+            continue;
+        }
+        start = clock();
+        for (pass = 0; pass < PIXEL_TEST_BENCH_PASSES; pass++)
+        {
+            PixelKernels::MergeAlpha(D3DFMT_A4R4G4B4, (u8 *)g_PixelTestDst, PIXEL_TEST_BENCH_WIDTH * 2,
+                                     (u8 *)g_PixelTestSrc, PIXEL_TEST_BENCH_WIDTH * 2, PIXEL_TEST_BENCH_WIDTH,
+                                     PIXEL_TEST_BENCH_HEIGHT);
+        }
+        mergeRate = GetPixelTestMPixelsPerSecond(start, PIXEL_TEST_BENCH_WIDTH * PIXEL_TEST_BENCH_HEIGHT);
+
+        start = clock();
+        for (pass = 0; pass < PIXEL_TEST_BENCH_PASSES; pass++)
+        {
+            PixelKernels::InvertAlpha(D3DFMT_A1R5G5B5, (u8 *)g_PixelTestDst, 512 * 38 * 2);
+        }
+        invertRate = GetPixelTestMPixelsPerSecond(start, 512 * 38);
+
+        munit_logf(MUNIT_LOG_INFO, "%s: merge alpha %.1f, invert alpha %.1f MPixels/s", levelNames[level], mergeRate,
+                   invertRate);
+    }
+
+    SetPixelTestLevel(PixelKernelLevel_Sse2);
+    return MUNIT_OK;
+}
+
+static MunitTest pixelkernels_test_suite_tests[] = {
+    {"/merge_alpha", test_pixel_kernels_merge_alpha, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/invert_alpha", test_pixel_kernels_invert_alpha, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bench", test_pixel_kernels_bench, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
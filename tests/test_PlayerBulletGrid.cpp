@@ -0,0 +1,207 @@
+#include "Player.hpp"
+#include "utils.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+// The grid only exists with PLAYER_BULLET_GRID.
+#ifdef PLAYER_BULLET_GRID
+#define GRID_TEST_ENEMY_COUNT 32
+#define GRID_TEST_FRAME_COUNT 2000
+
+// A full wave of player shots and enemies, scattered over and slightly outside the play area.
+struct GridTestWave
+{
+    PlayerBullet bullets[80];
+    D3DXVECTOR3 enemyPos[GRID_TEST_ENEMY_COUNT];
+    D3DXVECTOR3 enemySize[GRID_TEST_ENEMY_COUNT];
+};
+
+static f32 RandomF32(f32 min, f32 max)
+{
+    return (f32)(munit_rand_double() * (max - min) + min);
+}
+
+static void GenerateWave(GridTestWave *wave)
+{
+    i32 idx;
+    PlayerBullet *bullet;
+
+    memset(wave, 0, sizeof(*wave));
+    for (idx = 0, bullet = wave->bullets; idx < ARRAY_SIZE_SIGNED(wave->bullets); idx++, bullet++)
+    {
+        bullet->bulletState = munit_rand_int_range(PLAYER_BULLET_STATE_UNUSED, PLAYER_BULLET_STATE_COLLIDED);
+        bullet->bulletType = munit_rand_int_range(BULLET_TYPE_0, BULLET_TYPE_LASER);
+        bullet->position.x = RandomF32(-32.0f, 416.0f);
+        bullet->position.y = RandomF32(-32.0f, 480.0f);
+        bullet->size.x = RandomF32(8.0f, 48.0f);
+        bullet->size.y = RandomF32(8.0f, 48.0f);
+        if (bullet->bulletType == BULLET_TYPE_LASER)
+        {
+            bullet->position.y /= 2.0f;
+            bullet->size.y = bullet->position.y * 2;
+        }
+    }
+    for (idx = 0; idx < GRID_TEST_ENEMY_COUNT; idx++)
+    {
+        wave->enemyPos[idx].x = RandomF32(-64.0f, 448.0f);
+        wave->enemyPos[idx].y = RandomF32(-64.0f, 512.0f);
+        wave->enemySize[idx].x = RandomF32(8.0f, 96.0f);
+        wave->enemySize[idx].y = RandomF32(8.0f, 96.0f);
+    }
+}
+
+static void BuildGrid(PlayerBulletGrid *grid, GridTestWave *wave)
+{
+    i32 idx;
+
+    grid->Clear();
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(wave->bullets); idx++)
+    {
+        if (wave->bullets[idx].bulletState != PLAYER_BULLET_STATE_UNUSED)
+        {
+            grid->Insert(idx, &wave->bullets[idx]);
+        }
+    }
+}
+
+// Same filter and overlap test as Player::CalcDamageToEnemy, without the side effects. Records the indices
+// of the bullets hitting the enemy, in the order the damage would be accumulated.
+static i32 CollectHits(GridTestWave *wave, i32 enemyIdx, PlayerBulletGrid *grid, i32 *hits)
+{
+    ZunVec3 enemyTopLeft, enemyBottomRight;
+    ZunVec3 bulletTopLeft, bulletBottomRight;
+    u32 candidates[PLAYER_BULLET_GRID_WORDS];
+    PlayerBullet *bullet;
+    i32 idx;
+    i32 hitCount;
+
+    ZunVec3::SetVecCorners(&enemyTopLeft, &enemyBottomRight, &wave->enemyPos[enemyIdx], &wave->enemySize[enemyIdx]);
+    if (grid != NULL)
+    {
+        grid->Query(&enemyTopLeft, &enemyBottomRight, candidates);
+    }
+    else
+    {
+        memset(candidates, 0xff, sizeof(candidates));
+    }
+
+    hitCount = 0;
+    for (idx = 0, bullet = wave->bullets; idx < ARRAY_SIZE_SIGNED(wave->bullets); idx++, bullet++)
+    {
+        if ((candidates[idx >> 5] & (1 << (idx & 31))) == 0)
+        {
+            continue;
+        }
+        if (bullet->bulletState == PLAYER_BULLET_STATE_UNUSED ||
+            bullet->bulletState != PLAYER_BULLET_STATE_FIRED && bullet->bulletType != BULLET_TYPE_2)
+        {
+            continue;
+        }
+        ZunVec3::SetVecCorners(&bulletTopLeft, &bulletBottomRight, &bullet->position, &bullet->size);
+        if (bulletTopLeft.y > enemyBottomRight.y || bulletTopLeft.x > enemyBottomRight.x ||
+            bulletBottomRight.y < enemyTopLeft.y || bulletBottomRight.x < enemyTopLeft.x)
+        {
+            continue;
+        }
+        hits[hitCount++] = idx;
+    }
+    return hitCount;
+}
+
+static MunitResult test_matches_brute_force(const MunitParameter params[], void *user_data)
+{
+    static GridTestWave wave;
+    static PlayerBulletGrid grid;
+    i32 expectedHits[80];
+    i32 gridHits[80];
+    i32 expectedCount;
+    i32 gridCount;
+    i32 frame;
+    i32 enemyIdx;
+
+    for (frame = 0; frame < 200; frame++)
+    {
+        GenerateWave(&wave);
+        BuildGrid(&grid, &wave);
+        for (enemyIdx = 0; enemyIdx < GRID_TEST_ENEMY_COUNT; enemyIdx++)
+        {
+            expectedCount = CollectHits(&wave, enemyIdx, NULL, expectedHits);
+            gridCount = CollectHits(&wave, enemyIdx, &grid, gridHits);
+            munit_assert_int(gridCount, ==, expectedCount);
+            munit_assert_memory_equal(expectedCount * sizeof(i32), gridHits, expectedHits);
+        }
+    }
+    return MUNIT_OK;
+}
+
+// A BULLET_TYPE_2 shot that grows after hitting an enemy must still be found by the enemies tested after it.
+static MunitResult test_grown_bullet_is_found(const MunitParameter params[], void *user_data)
+{
+    static GridTestWave wave;
+    static PlayerBulletGrid grid;
+    i32 hits[80];
+
+    memset(&wave, 0, sizeof(wave));
+    wave.bullets[5].bulletState = PLAYER_BULLET_STATE_COLLIDED;
+    wave.bullets[5].bulletType = BULLET_TYPE_2;
+    wave.bullets[5].position = D3DXVECTOR3(120.0f, 100.0f, 0.0f);
+    wave.bullets[5].size = D3DXVECTOR3(8.0f, 8.0f, 1.0f);
+    wave.enemyPos[0] = D3DXVECTOR3(146.0f, 100.0f, 0.0f);
+    wave.enemySize[0] = D3DXVECTOR3(32.0f, 32.0f, 0.0f);
+    BuildGrid(&grid, &wave);
+
+    wave.bullets[5].size = D3DXVECTOR3(48.0f, 48.0f, 1.0f);
+    munit_assert_int(CollectHits(&wave, 0, &grid, hits), ==, 1);
+    munit_assert_int(hits[0], ==, 5);
+    return MUNIT_OK;
+}
+
+static MunitResult RunWaveBenchmark(PlayerBulletGrid *grid)
+{
+    static GridTestWave wave;
+    i32 hits[80];
+    i32 frame;
+    i32 enemyIdx;
+    i32 totalHits;
+
+    GenerateWave(&wave);
+    totalHits = 0;
+    for (frame = 0; frame < GRID_TEST_FRAME_COUNT; frame++)
+    {
+        if (grid != NULL)
+        {
+            BuildGrid(grid, &wave);
+        }
+        for (enemyIdx = 0; enemyIdx < GRID_TEST_ENEMY_COUNT; enemyIdx++)
+        {
+            totalHits += CollectHits(&wave, enemyIdx, grid, hits);
+        }
+    }
+    munit_assert_int(totalHits, >=, 0);
+    return MUNIT_OK;
+}
+
+// Run with --iterations to compare the per-test times munit reports for both benchmarks.
+static MunitResult bench_brute_force(const MunitParameter params[], void *user_data)
+{
+    return RunWaveBenchmark(NULL);
+}
+
+static MunitResult bench_grid(const MunitParameter params[], void *user_data)
+{
+    static PlayerBulletGrid grid;
+
+    return RunWaveBenchmark(&grid);
+}
+
+#endif
+
+static MunitTest playerbulletgrid_test_suite_tests[] = {
+#ifdef PLAYER_BULLET_GRID
+    {"/matches_brute_force", test_matches_brute_force, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/grown_bullet_is_found", test_grown_bullet_is_found, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bench_brute_force", bench_brute_force, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bench_grid", bench_grid, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
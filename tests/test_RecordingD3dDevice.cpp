@@ -0,0 +1,264 @@
+#include <time.h>
+
+#include "AnmManager.hpp"
+#include "Chain.hpp"
+#include "D3dStateCache.hpp"
+#include "GameWindow.hpp"
+#include "RecordingD3dDevice.hpp"
+#include "Rng.hpp"
+#include "Supervisor.hpp"
+#include "ZunMath.hpp"
+#include "utils.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define RECORDING_TEST_VM_COUNT 256
+#define RECORDING_TEST_BENCH_FRAMES 200
+
+static RecordingD3dDevice *g_RecordingTestDevice;
+static IDirect3DDevice8 *g_RecordingTestSavedDevice;
+static AnmManager *g_RecordingTestManager;
+static IDirect3DTexture8 *g_RecordingTestTextures[2];
+static AnmVm g_RecordingTestVms[RECORDING_TEST_VM_COUNT];
+// The draw chain test compares Draw against AnmSpriteBatch, which only exists with BATCHED_SPRITES.
+#ifdef BATCHED_SPRITES
+static AnmSpriteBatch g_RecordingTestBatch;
+
+static ChainCallbackResult DrawRecordingTestSprites(void *arg)
+{
+    i32 idx;
+
+    for (idx = 0; idx < RECORDING_TEST_VM_COUNT; idx++)
+    {
+        g_RecordingTestManager->Draw(&g_RecordingTestVms[idx]);
+    }
+    return CHAIN_CALLBACK_RESULT_CONTINUE;
+}
+
+static ChainCallbackResult DrawRecordingTestBatch(void *arg)
+{
+    i32 idx;
+
+    g_RecordingTestManager->BeginSpriteBatch(&g_RecordingTestBatch);
+    for (idx = 0; idx < RECORDING_TEST_VM_COUNT; idx++)
+    {
+        g_RecordingTestManager->BatchSprite(&g_RecordingTestBatch, &g_RecordingTestVms[idx]);
+    }
+    g_RecordingTestManager->EndSpriteBatchLayer(&g_RecordingTestBatch);
+    g_RecordingTestManager->FlushSpriteBatch(&g_RecordingTestBatch);
+    return CHAIN_CALLBACK_RESULT_CONTINUE;
+}
+#endif
+
+static void SetUpRecordingTest()
+{
+    AnmVm *vm;
+    i32 idx;
+
+    g_Rng.Initialize(0x5678);
+    if (g_RecordingTestDevice == NULL)
+    {
+        g_RecordingTestDevice = new RecordingD3dDevice(GAME_WINDOW_WIDTH, GAME_WINDOW_HEIGHT);
+    }
+    if (g_RecordingTestManager == NULL)
+    {
+        g_RecordingTestManager = new AnmManager();
+    }
+    g_RecordingTestSavedDevice = g_Supervisor.d3dDevice;
+    g_Supervisor.d3dDevice = g_RecordingTestDevice;
+    g_D3dStateCache.Invalidate();
+
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_RecordingTestTextures); idx++)
+    {
+        g_RecordingTestDevice->CreateTexture(256, 256, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED,
+                                             &g_RecordingTestTextures[idx]);
+        g_RecordingTestManager->textures[idx] = g_RecordingTestTextures[idx];
+        g_RecordingTestManager->sprites[idx].sourceFileIndex = idx;
+        g_RecordingTestManager->sprites[idx].widthPx = 16.0f;
+        g_RecordingTestManager->sprites[idx].heightPx = 16.0f;
+        g_RecordingTestManager->sprites[idx].textureWidth = 256.0f;
+        g_RecordingTestManager->sprites[idx].textureHeight = 256.0f;
+        g_RecordingTestManager->sprites[idx].uvStart.x = idx * 0.0625f;
+        g_RecordingTestManager->sprites[idx].uvStart.y = 0.0f;
+        g_RecordingTestManager->sprites[idx].uvEnd.x = idx * 0.0625f + 0.0625f;
+        g_RecordingTestManager->sprites[idx].uvEnd.y = 0.0625f;
+    }
+    // Interleave the two textures the way mixed bullet types end up in the bullet array.
+    for (vm = g_RecordingTestVms, idx = 0; idx < RECORDING_TEST_VM_COUNT; idx++, vm++)
+    {
+        g_RecordingTestManager->InitializeAndSetSprite(vm, (idx / 3) % 2);
+        vm->pos = D3DXVECTOR3(g_Rng.GetRandomF32InRange(384.0f), g_Rng.GetRandomF32InRange(448.0f), 0.1f);
+        vm->rotation.z = idx % 4 == 0 ? g_Rng.GetRandomF32InRange(ZUN_PI) : 0.0f;
+    }
+    g_RecordingTestManager->SetCurrentTexture(NULL);
+    g_RecordingTestManager->SetCurrentSprite(NULL);
+    g_RecordingTestManager->SetCurrentVertexShader(0xff);
+}
+
+static void TearDownRecordingTest()
+{
+    i32 idx;
+
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_RecordingTestTextures); idx++)
+    {
+        g_RecordingTestManager->textures[idx] = NULL;
+        g_RecordingTestTextures[idx]->Release();
+        g_RecordingTestTextures[idx] = NULL;
+    }
+    g_RecordingTestManager->SetCurrentTexture(NULL);
+    g_RecordingTestManager->SetCurrentSprite(NULL);
+    g_D3dStateCache.SetTexture(0, NULL);
+    g_Supervisor.d3dDevice = g_RecordingTestSavedDevice;
+    g_D3dStateCache.Invalidate();
+}
+
+static void RunRecordingTestFrame()
+{
+    g_RecordingTestDevice->BeginScene();
+    g_RecordingTestDevice->Clear(0, NULL, D3DCLEAR_TARGET, 0, 1.0f, 0);
+    g_Chain.RunDrawChain();
+    g_RecordingTestDevice->EndScene();
+    g_RecordingTestDevice->Present(NULL, NULL, NULL, NULL);
+}
+
+static MunitResult test_recording_device_counts(const MunitParameter params[], void *user_data)
+{
+    RecordingD3dDevice *device = new RecordingD3dDevice(GAME_WINDOW_WIDTH, GAME_WINDOW_HEIGHT);
+    u16 indices[6] = {0, 1, 2, 2, 1, 3};
+    u8 vertices[4 * 0x1c];
+    DWORD value;
+    i32 idx;
+
+    device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+    device->SetTexture(0, NULL);
+    device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, vertices, 0x1c);
+    device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, 4);
+    device->DrawPrimitive(D3DPT_LINESTRIP, 0, 3);
+    device->DrawIndexedPrimitiveUP(D3DPT_TRIANGLELIST, 0, 4, 2, indices, D3DFMT_INDEX16, vertices, 0x1c);
+
+    munit_assert_int(device->logCount, ==, 6);
+    munit_assert_uint32(device->log[0].type, ==, RecordedD3dCommand_RenderState);
+    munit_assert_uint32(device->log[2].type, ==, RecordedD3dCommand_Draw);
+    munit_assert_uint32(device->log[2].args[2], ==, 4);
+    munit_assert_int(device->GetRenderState(D3DRS_ALPHABLENDENABLE, &value), ==, D3D_OK);
+    munit_assert_uint32(value, ==, TRUE);
+    munit_assert_int(device->thisFrame.drawCalls, ==, 4);
+    munit_assert_int(device->thisFrame.primitives, ==, 2 + 4 + 3 + 2);
+    munit_assert_int(device->thisFrame.vertices, ==, 4 + 12 + 4 + 4);
+    munit_assert_int(device->thisFrame.stateChanges, ==, 2);
+    munit_assert_int(device->thisFrame.textureChanges, ==, 1);
+
+    device->Present(NULL, NULL, NULL, NULL);
+    munit_assert_int(device->logCount, ==, 0);
+    munit_assert_int(device->lastFrame.vertices, ==, 24);
+    munit_assert_int(device->thisFrame.drawCalls, ==, 0);
+
+    // A full log stops recording commands but keeps counting.
+    for (idx = 0; idx < RECORDING_D3D_LOG_SIZE + 16; idx++)
+    {
+        device->SetRenderState(D3DRS_ZWRITEENABLE, idx & 1);
+    }
+    munit_assert_int(device->logCount, ==, RECORDING_D3D_LOG_SIZE);
+    munit_assert_int(device->thisFrame.stateChanges, ==, RECORDING_D3D_LOG_SIZE + 16);
+    device->Present(NULL, NULL, NULL, NULL);
+    munit_assert_int(device->frameCount, ==, 2);
+    munit_assert_int(device->total.drawCalls, ==, 4);
+
+    delete device;
+    return MUNIT_OK;
+}
+
+// D3DX queries the device and the textures it is handed for their interfaces before using them.
+static MunitResult test_recording_device_query_interface(const MunitParameter params[], void *user_data)
+{
+    RecordingD3dDevice *device = new RecordingD3dDevice(GAME_WINDOW_WIDTH, GAME_WINDOW_HEIGHT);
+    IDirect3DTexture8 *texture;
+    void *iface;
+
+    munit_assert_int(device->QueryInterface(IID_IDirect3DDevice8, &iface), ==, S_OK);
+    munit_assert_ptr_equal(iface, (IDirect3DDevice8 *)device);
+    munit_assert_int(device->QueryInterface(IID_IUnknown, &iface), ==, S_OK);
+    munit_assert_int(device->Release(), ==, 2);
+    munit_assert_int(device->Release(), ==, 1);
+    munit_assert_int(device->QueryInterface(IID_IDirect3DTexture8, &iface), ==, E_NOINTERFACE);
+    munit_assert_null(iface);
+
+    munit_assert_int(device->CreateTexture(16, 16, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &texture), ==, D3D_OK);
+    munit_assert_int(texture->QueryInterface(IID_IDirect3DTexture8, &iface), ==, S_OK);
+    munit_assert_ptr_equal(iface, texture);
+    munit_assert_int(texture->QueryInterface(IID_IDirect3DBaseTexture8, &iface), ==, S_OK);
+    munit_assert_int(texture->Release(), ==, 2);
+    munit_assert_int(texture->Release(), ==, 1);
+    munit_assert_int(texture->QueryInterface(IID_IDirect3DDevice8, &iface), ==, E_NOINTERFACE);
+    texture->Release();
+
+    delete device;
+    return MUNIT_OK;
+}
+
+#ifdef BATCHED_SPRITES
+// Runs the same sprites through the draw chain one Draw at a time and then batched, and checks the batch puts the
+// same geometry on screen with fewer calls.
+static MunitResult test_recording_device_draw_chain(const MunitParameter params[], void *user_data)
+{
+    RecordedD3dFrameStats perSprite;
+    RecordedD3dFrameStats batched;
+    ChainElem *elem;
+    clock_t start;
+    f64 perSpriteMs;
+    f64 batchedMs;
+    i32 frame;
+
+    SetUpRecordingTest();
+
+    elem = g_Chain.CreateElem((ChainCallback)DrawRecordingTestSprites);
+    g_Chain.AddToDrawChain(elem, 1);
+    RunRecordingTestFrame();
+    perSprite = g_RecordingTestDevice->lastFrame;
+    start = clock();
+    for (frame = 0; frame < RECORDING_TEST_BENCH_FRAMES; frame++)
+    {
+        RunRecordingTestFrame();
+    }
+    perSpriteMs = (f64)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / RECORDING_TEST_BENCH_FRAMES;
+    g_Chain.Cut(elem);
+
+    g_RecordingTestManager->SetCurrentTexture(NULL);
+    g_RecordingTestManager->SetCurrentSprite(NULL);
+    elem = g_Chain.CreateElem((ChainCallback)DrawRecordingTestBatch);
+    g_Chain.AddToDrawChain(elem, 1);
+    RunRecordingTestFrame();
+    batched = g_RecordingTestDevice->lastFrame;
+    start = clock();
+    for (frame = 0; frame < RECORDING_TEST_BENCH_FRAMES; frame++)
+    {
+        RunRecordingTestFrame();
+    }
+    batchedMs = (f64)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / RECORDING_TEST_BENCH_FRAMES;
+    g_Chain.Cut(elem);
+
+    munit_assert_int(perSprite.drawCalls, ==, RECORDING_TEST_VM_COUNT);
+    munit_assert_int(perSprite.vertices, ==, RECORDING_TEST_VM_COUNT * 4);
+    munit_assert_int(batched.vertices, ==, perSprite.vertices);
+    munit_assert_int(batched.primitives, ==, perSprite.primitives);
+    munit_assert_int(batched.drawCalls, <, perSprite.drawCalls);
+    munit_assert_int(batched.textureChanges, <=, 2);
+    munit_assert_int(batched.textureChanges, <, perSprite.textureChanges);
+    munit_logf(MUNIT_LOG_INFO, "per sprite: %d draws, %d state changes, %.3f ms/frame", perSprite.drawCalls,
+               perSprite.stateChanges, perSpriteMs);
+    munit_logf(MUNIT_LOG_INFO, "batched: %d draws, %d state changes, %.3f ms/frame", batched.drawCalls,
+               batched.stateChanges, batchedMs);
+
+    TearDownRecordingTest();
+    return MUNIT_OK;
+}
+#endif
+
+static MunitTest recordingd3ddevice_test_suite_tests[] = {
+    {"/counts", test_recording_device_counts, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/query_interface", test_recording_device_query_interface, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#ifdef BATCHED_SPRITES
+    {"/draw_chain", test_recording_device_draw_chain, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -0,0 +1,235 @@
+#include <string.h>
+#include <time.h>
+
+#include "SoftwareD3dDevice.hpp"
+#include "utils.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define SOFTWARE_TEST_QUAD_COUNT 2000
+#define SOFTWARE_TEST_BENCH_FRAMES 10
+
+struct SoftwareTestVertex
+{
+    f32 x;
+    f32 y;
+    f32 z;
+    f32 rhw;
+    D3DCOLOR diffuse;
+    f32 u;
+    f32 v;
+};
+
+static void SetSoftwareTestQuad(SoftwareTestVertex *quad, f32 left, f32 top, f32 size, f32 z, D3DCOLOR diffuse)
+{
+    i32 idx;
+
+    for (idx = 0; idx < 4; idx++)
+    {
+        quad[idx].x = left + (idx & 1) * size;
+        quad[idx].y = top + (idx >> 1) * size;
+        quad[idx].z = z;
+        quad[idx].rhw = 1.0f;
+        quad[idx].diffuse = diffuse;
+        quad[idx].u = (f32)(idx & 1);
+        quad[idx].v = (f32)(idx >> 1);
+    }
+}
+
+static IDirect3DTexture8 *CreateSoftwareTestTexture(SoftwareD3dDevice *device)
+{
+    IDirect3DTexture8 *texture;
+    D3DLOCKED_RECT locked;
+    i32 idx;
+
+    device->CreateTexture(16, 16, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &texture);
+    texture->LockRect(0, &locked, NULL, 0);
+    for (idx = 0; idx < 16 * 16; idx++)
+    {
+        ((u32 *)locked.pBits)[idx] = (idx ^ (idx >> 4)) & 1 ? 0xffffffff : 0x80ff8040;
+    }
+    texture->UnlockRect(0);
+    return texture;
+}
+
+// Overlapping blended, textured and depth tested quads, the mix a busy bullet frame puts through the rasterizer.
+static void DrawSoftwareTestScene(SoftwareD3dDevice *device, IDirect3DTexture8 *texture)
+{
+    SoftwareTestVertex quad[4];
+    u32 seed;
+    i32 idx;
+
+    device->Clear(0, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0xff102030, 1.0f, 0);
+    device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+    device->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+    device->SetRenderState(D3DRS_ZENABLE, TRUE);
+    device->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+    device->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+    device->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+    device->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+    device->SetTexture(0, texture);
+    device->SetVertexShader(D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1);
+
+    seed = 7;
+    for (idx = 0; idx < SOFTWARE_TEST_QUAD_COUNT; idx++)
+    {
+        seed = seed * 1103515245 + 12345;
+        SetSoftwareTestQuad(quad, (f32)(seed >> 8 & 0x3ff) * 0.625f - 8.0f, (f32)(seed >> 18 & 0x1ff) - 16.0f,
+                            4.0f + (f32)(seed & 0x1f) + (seed >> 28) * 0.25f, (f32)(seed >> 4 & 0xff) / 256.0f,
+                            0x80000000 | (seed * 2654435761u >> 8));
+        device->SetRenderState(D3DRS_DESTBLEND, idx & 1 ? D3DBLEND_ONE : D3DBLEND_INVSRCALPHA);
+        device->SetRenderState(D3DRS_ZWRITEENABLE, idx % 3 == 0);
+        device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quad, sizeof(SoftwareTestVertex));
+    }
+}
+
+static MunitResult test_software_device_quad(const MunitParameter params[], void *user_data)
+{
+    SoftwareD3dDevice *device = new SoftwareD3dDevice(64, 64, 1);
+    SoftwareTestVertex quad[4];
+    u32 *pixels;
+    u32 pixel;
+    i32 covered;
+    i32 idx;
+
+    device->Clear(0, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0xff000000, 1.0f, 0);
+    device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+    device->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+    device->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+    device->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+    device->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+    device->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+    device->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
+    device->SetVertexShader(D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1);
+    // Corners half a pixel off the centers cover exactly a 16x16 block, with no pixel drawn twice along the shared
+    // diagonal.
+    SetSoftwareTestQuad(quad, 7.5f, 7.5f, 16.0f, 0.5f, 0x80ff0000);
+    device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quad, sizeof(SoftwareTestVertex));
+    device->Flush();
+
+    pixels = (u32 *)device->backBuffer->bits;
+    covered = 0;
+    for (idx = 0; idx < 64 * 64; idx++)
+    {
+        if (pixels[idx] != 0xff000000)
+        {
+            covered++;
+        }
+    }
+    munit_assert_int(covered, ==, 16 * 16);
+    pixel = pixels[8 * 64 + 8];
+    munit_assert_uint32(pixel & 0xffff, ==, 0);
+    munit_assert_uint32(pixel >> 16 & 0xff, >=, 0x7f);
+    munit_assert_uint32(pixel >> 16 & 0xff, <=, 0x81);
+    munit_assert_uint32(pixels[23 * 64 + 23], ==, pixel);
+    munit_assert_uint32(pixels[24 * 64 + 23], ==, 0xff000000);
+    munit_assert_uint32(pixels[7 * 64 + 8], ==, 0xff000000);
+
+    // Drawing it again blends over the first pass.
+    device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quad, sizeof(SoftwareTestVertex));
+    device->Flush();
+    munit_assert_uint32(pixels[8 * 64 + 8] >> 16 & 0xff, >, pixel >> 16 & 0xff);
+    munit_assert_int(device->thisFrame.drawCalls, ==, 2);
+
+    delete device;
+    return MUNIT_OK;
+}
+
+// The tiles land on whichever worker claims them first, so the frame has to come out the same whatever the thread
+// count.
+static MunitResult test_software_device_threads(const MunitParameter params[], void *user_data)
+{
+    SoftwareD3dDevice *single = new SoftwareD3dDevice(640, 480, 1);
+    SoftwareD3dDevice *pooled = new SoftwareD3dDevice(640, 480, 4);
+    IDirect3DTexture8 *singleTexture = CreateSoftwareTestTexture(single);
+    IDirect3DTexture8 *pooledTexture = CreateSoftwareTestTexture(pooled);
+    clock_t start;
+    f64 singleMs;
+    f64 pooledMs;
+    i32 frame;
+
+    start = clock();
+    for (frame = 0; frame < SOFTWARE_TEST_BENCH_FRAMES; frame++)
+    {
+        DrawSoftwareTestScene(single, singleTexture);
+        single->Flush();
+    }
+    singleMs = (f64)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / SOFTWARE_TEST_BENCH_FRAMES;
+    start = clock();
+    for (frame = 0; frame < SOFTWARE_TEST_BENCH_FRAMES; frame++)
+    {
+        DrawSoftwareTestScene(pooled, pooledTexture);
+        pooled->Flush();
+    }
+    pooledMs = (f64)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / SOFTWARE_TEST_BENCH_FRAMES;
+
+    munit_assert_int(pooled->workerCount, ==, 3);
+    munit_assert_memory_equal(640 * 480 * 4, single->backBuffer->bits, pooled->backBuffer->bits);
+    munit_logf(MUNIT_LOG_INFO, "1 thread: %.3f ms/frame, 4 threads: %.3f ms/frame", singleMs, pooledMs);
+
+    singleTexture->Release();
+    pooledTexture->Release();
+    delete single;
+    delete pooled;
+    return MUNIT_OK;
+}
+
+// Clears and flat quads of every width, so the SSE2 fill's leftovers past the last group of four get covered too.
+static void DrawSoftwareTestFills(SoftwareD3dDevice *device)
+{
+    SoftwareTestVertex quad[4];
+    D3DRECT rect;
+    i32 idx;
+
+    device->Clear(0, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0xff000000, 0.75f, 0);
+    device->SetRenderState(D3DRS_ZENABLE, FALSE);
+    device->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+    device->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+    device->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+    device->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
+    device->SetVertexShader(D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1);
+    for (idx = 0; idx < 9; idx++)
+    {
+        rect.x1 = idx * 3;
+        rect.y1 = idx * 7;
+        rect.x2 = rect.x1 + idx + 1;
+        rect.y2 = rect.y1 + 5;
+        device->Clear(1, &rect, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0xff00ff00 + idx, 0.25f * idx, 0);
+        SetSoftwareTestQuad(quad, 30.25f + idx * 0.5f, idx * 7.0f - 0.5f, 1.5f + idx * 1.75f, 0.5f, 0xff0000ff - idx);
+        device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quad, sizeof(SoftwareTestVertex));
+    }
+    device->Flush();
+}
+
+static MunitResult test_software_device_span_fill(const MunitParameter params[], void *user_data)
+{
+    SoftwareD3dDevice *scalar;
+    SoftwareD3dDevice *sse2;
+
+    if (!(utils::GetCpuFeatures() & CPU_FEATURE_SSE2))
+    {
+        return MUNIT_SKIP;
+    }
+    scalar = new SoftwareD3dDevice(64, 64, 1);
+    sse2 = new SoftwareD3dDevice(64, 64, 1);
+    scalar->useSse2 = false;
+    sse2->useSse2 = true;
+    DrawSoftwareTestFills(scalar);
+    DrawSoftwareTestFills(sse2);
+    munit_assert_memory_equal(64 * 64 * 4, scalar->backBuffer->bits, sse2->backBuffer->bits);
+    munit_assert_memory_equal(64 * 64 * sizeof(f32), scalar->depthBuffer, sse2->depthBuffer);
+    munit_assert_uint32(((u32 *)scalar->backBuffer->bits)[8 * 3 + 8 * 7 * 64], ==, 0xff00ff08);
+    munit_assert_float(scalar->depthBuffer[8 * 3 + 8 * 7 * 64], ==, 2.0f);
+    munit_assert_float(scalar->depthBuffer[63 * 64 + 63], ==, 0.75f);
+
+    delete scalar;
+    delete sse2;
+    return MUNIT_OK;
+}
+
+static MunitTest softwared3ddevice_test_suite_tests[] = {
+    {"/quad", test_software_device_quad, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/threads", test_software_device_threads, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/span_fill", test_software_device_span_fill, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "SoundMixer.hpp"
+#include "utils.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define MIXER_TEST_SAMPLE_FRAMES 1300
+#define MIXER_TEST_BENCH_BLOCKS 2000
+
+static SoundMixer g_MixerTestScalar;
+static SoundMixer g_MixerTestSse2;
+static SoundMixerNullSink g_MixerTestSink;
+static i16 g_MixerTestPcm[MIXER_TEST_SAMPLE_FRAMES * SOUND_MIXER_CHANNELS];
+static i16 g_MixerTestOut[SOUND_MIXER_BLOCK_SAMPLES];
+static i16 g_MixerTestOut2[SOUND_MIXER_BLOCK_SAMPLES];
+static i32 g_MixerTestStreamFrames;
+
+static void GetMixerTestFormat(WAVEFORMATEX *format, i32 channels, i32 bits, i32 rate)
+{
+    memset(format, 0, sizeof(*format));
+    format->wFormatTag = WAVE_FORMAT_PCM;
+    format->nChannels = channels;
+    format->nSamplesPerSec = rate;
+    format->wBitsPerSample = bits;
+    format->nBlockAlign = channels * bits / 8;
+    format->nAvgBytesPerSec = rate * format->nBlockAlign;
+}
+
+// Loud enough that a handful of voices together saturates.
+static void FillMixerTestPcm()
+{
+    i32 idx;
+
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_MixerTestPcm); idx++)
+    {
+        g_MixerTestPcm[idx] = (i16)munit_rand_uint32();
+    }
+}
+
+static void StartMixerTest(SoundMixer *mixer, ZunBool useSse2)
+{
+    WAVEFORMATEX format;
+    i32 idx;
+
+    mixer->Start(&g_MixerTestSink);
+    mixer->useSse2 = useSse2;
+    GetMixerTestFormat(&format, 2, 16, SOUND_MIXER_SAMPLE_RATE);
+    for (idx = 0; idx < 4; idx++)
+    {
+        mixer->LoadSample(idx, &format, (u8 *)(g_MixerTestPcm + idx * 8), sizeof(g_MixerTestPcm) - idx * 16);
+    }
+}
+
+static i32 MixerTestStream(void *arg, i16 *frames, i32 frameCount)
+{
+    i32 count;
+    i32 idx;
+
+    count = frameCount < g_MixerTestStreamFrames ? frameCount : g_MixerTestStreamFrames;
+    for (idx = 0; idx < count * SOUND_MIXER_CHANNELS; idx++)
+    {
+        frames[idx] = 0x1000;
+    }
+    g_MixerTestStreamFrames -= count;
+    return count;
+}
+
+static MunitResult test_sound_mixer_mix(const MunitParameter params[], void *user_data)
+{
+    i16 gains[] = {SOUND_MIXER_UNITY_GAIN, 0x4000, 0x0123, SOUND_MIXER_UNITY_GAIN, 0x7ffe, 0x2000};
+    i32 expected;
+    i32 block;
+    i32 idx;
+    i32 voice;
+    i32 position;
+
+    if (!(utils::GetCpuFeatures() & CPU_FEATURE_SSE2))
+    {
+        return MUNIT_SKIP;
+    }
+    FillMixerTestPcm();
+    StartMixerTest(&g_MixerTestScalar, false);
+    StartMixerTest(&g_MixerTestSse2, true);
+    for (voice = 0; voice < ARRAY_SIZE_SIGNED(gains); voice++)
+    {
+        g_MixerTestScalar.Play(voice, voice % 4, gains[voice]);
+        g_MixerTestSse2.Play(voice, voice % 4, gains[voice]);
+    }
+
+    // The first block against the mix done one voice and one saturating add at a time.
+    g_MixerTestScalar.MixBlock(g_MixerTestOut);
+    for (idx = 0; idx < SOUND_MIXER_BLOCK_SAMPLES; idx++)
+    {
+        expected = 0;
+        for (voice = 0; voice < ARRAY_SIZE_SIGNED(gains); voice++)
+        {
+            position = (voice % 4) * 8 + idx;
+            expected += gains[voice] == SOUND_MIXER_UNITY_GAIN ? g_MixerTestPcm[position]
+                                                               : (g_MixerTestPcm[position] * gains[voice]) >> 15;
+            expected = expected > 0x7fff ? 0x7fff : expected < -0x8000 ? -0x8000 : expected;
+        }
+        munit_assert_int32(g_MixerTestOut[idx], ==, expected);
+    }
+    g_MixerTestSse2.MixBlock(g_MixerTestOut2);
+    munit_assert_memory_equal(SOUND_MIXER_BLOCK_BYTES, g_MixerTestOut, g_MixerTestOut2);
+
+    // The rest, including the blocks where the samples end partway through.
+    for (block = 1; block < 4; block++)
+    {
+        g_MixerTestScalar.MixBlock(g_MixerTestOut);
+        g_MixerTestSse2.MixBlock(g_MixerTestOut2);
+        munit_assert_memory_equal(SOUND_MIXER_BLOCK_BYTES, g_MixerTestOut, g_MixerTestOut2);
+    }
+    for (voice = 0; voice < SOUND_MIXER_MAX_VOICES; voice++)
+    {
+        munit_assert_false(g_MixerTestScalar.voices[voice].isPlaying);
+    }
+    g_MixerTestScalar.Stop();
+    g_MixerTestSse2.Stop();
+    return MUNIT_OK;
+}
+
+static MunitResult test_sound_mixer_voices(const MunitParameter params[], void *user_data)
+{
+    WAVEFORMATEX format;
+    u8 pcm8[] = {128, 192, 64, 255};
+    SoundMixerSample *sample;
+
+    g_MixerTestScalar.Start(&g_MixerTestSink);
+
+    // 8 bit mono at half the rate comes out as 16 bit stereo, every other frame halfway between its neighbours.
+    GetMixerTestFormat(&format, 1, 8, SOUND_MIXER_SAMPLE_RATE / 2);
+    munit_assert_int32(g_MixerTestScalar.LoadSample(0, &format, pcm8, sizeof(pcm8)), ==, ZUN_SUCCESS);
+    sample = &g_MixerTestScalar.samples[0];
+    munit_assert_int32(sample->frameCount, ==, 8);
+    munit_assert_int16(sample->frames[0], ==, 0);
+    munit_assert_int16(sample->frames[2], ==, 0x2000);
+    munit_assert_int16(sample->frames[3], ==, 0x2000);
+    munit_assert_int16(sample->frames[4], ==, 0x4000);
+    munit_assert_int16(sample->frames[8], ==, -0x4000);
+    munit_assert_int16(sample->frames[14], ==, 0x7f00);
+
+    format.wFormatTag = 2;
+    munit_assert_int32(g_MixerTestScalar.LoadSample(1, &format, pcm8, sizeof(pcm8)), ==, ZUN_ERROR);
+
+    // Playing a voice again starts it over, as stopping and rewinding its duplicate buffer did.
+    FillMixerTestPcm();
+    GetMixerTestFormat(&format, 2, 16, SOUND_MIXER_SAMPLE_RATE);
+    g_MixerTestScalar.LoadSample(1, &format, (u8 *)g_MixerTestPcm, sizeof(g_MixerTestPcm));
+    g_MixerTestScalar.Play(5, 1, SOUND_MIXER_UNITY_GAIN);
+    g_MixerTestScalar.MixBlock(g_MixerTestOut);
+    munit_assert_int32(g_MixerTestScalar.voices[5].position, ==, SOUND_MIXER_BLOCK_FRAMES);
+    g_MixerTestScalar.Play(5, 1, SOUND_MIXER_UNITY_GAIN);
+    g_MixerTestScalar.MixBlock(g_MixerTestOut2);
+    munit_assert_memory_equal(SOUND_MIXER_BLOCK_BYTES, g_MixerTestOut, g_MixerTestOut2);
+
+    // Samples that aren't loaded don't play.
+    g_MixerTestScalar.Play(6, 20, SOUND_MIXER_UNITY_GAIN);
+    munit_assert_false(g_MixerTestScalar.voices[6].isPlaying);
+
+    munit_assert_int16(SoundMixer::VolumeToGain(0), ==, SOUND_MIXER_UNITY_GAIN);
+    munit_assert_int16(SoundMixer::VolumeToGain(-2000), ==, 3277);
+    munit_assert_int16(SoundMixer::VolumeToGain(-10000), ==, 0);
+    g_MixerTestScalar.Stop();
+    return MUNIT_OK;
+}
+
+static MunitResult test_sound_mixer_stream(const MunitParameter params[], void *user_data)
+{
+    g_MixerTestScalar.Start(&g_MixerTestSink);
+    g_MixerTestStreamFrames = SOUND_MIXER_BLOCK_FRAMES + 10;
+    g_MixerTestScalar.SetStream(MixerTestStream, NULL);
+    g_MixerTestScalar.MixBlock(g_MixerTestOut);
+    munit_assert_int16(g_MixerTestOut[SOUND_MIXER_BLOCK_SAMPLES - 1], ==, 0x1000);
+
+    // A short read plays what there was and ends the stream.
+    g_MixerTestScalar.MixBlock(g_MixerTestOut);
+    munit_assert_int16(g_MixerTestOut[19], ==, 0x1000);
+    munit_assert_int16(g_MixerTestOut[20], ==, 0);
+    munit_assert_null(g_MixerTestScalar.streamCallback);
+
+    // A fade takes the gain down to -50dB over its frames, then stops the stream.
+    g_MixerTestStreamFrames = 0x7fffffff;
+    g_MixerTestScalar.SetStream(MixerTestStream, NULL);
+    g_MixerTestScalar.FadeOutStream(4);
+    g_MixerTestScalar.UpdateFadeOut();
+    munit_assert_int16(g_MixerTestScalar.streamGain, ==, SoundMixer::VolumeToGain(-1250));
+    g_MixerTestScalar.MixBlock(g_MixerTestOut);
+    munit_assert_int16(g_MixerTestOut[0], ==, (0x1000 * SoundMixer::VolumeToGain(-1250)) >> 15);
+    g_MixerTestScalar.UpdateFadeOut();
+    g_MixerTestScalar.UpdateFadeOut();
+    munit_assert_not_null(g_MixerTestScalar.streamCallback);
+    g_MixerTestScalar.UpdateFadeOut();
+    munit_assert_null(g_MixerTestScalar.streamCallback);
+    munit_assert_int16(g_MixerTestScalar.streamGain, ==, SOUND_MIXER_UNITY_GAIN);
+    g_MixerTestScalar.Stop();
+    return MUNIT_OK;
+}
+
+static MunitResult test_sound_mixer_wav_sink(const MunitParameter params[], void *user_data)
+{
+    SoundMixerWavSink sink;
+    u32 header[11];
+    FILE *file;
+    i32 frame;
+
+    munit_assert_int32(sink.Open("test_sound_mixer.wav"), ==, ZUN_SUCCESS);
+    g_MixerTestScalar.Start(&sink);
+
+    // A second of game frames is a second of audio, give or take the partly filled block still pending.
+    for (frame = 0; frame < 60; frame++)
+    {
+        g_MixerTestScalar.AdvanceFrame();
+    }
+    munit_assert_int32(g_MixerTestScalar.blocksMixed, ==, SOUND_MIXER_SAMPLE_RATE / SOUND_MIXER_BLOCK_FRAMES);
+    g_MixerTestScalar.Stop();
+
+    file = fopen("test_sound_mixer.wav", "rb");
+    munit_assert_not_null(file);
+    munit_assert_size(fread(header, sizeof(header), 1, file), ==, 1);
+    fseek(file, 0, SEEK_END);
+    munit_assert_long(ftell(file), ==, sizeof(header) + header[10]);
+    fclose(file);
+    remove("test_sound_mixer.wav");
+
+    munit_assert_memory_equal(4, &header[0], "RIFF");
+    munit_assert_memory_equal(4, &header[2], "WAVE");
+    munit_assert_uint32(header[6], ==, SOUND_MIXER_SAMPLE_RATE);
+    munit_assert_uint32(header[10], ==, SOUND_MIXER_SAMPLE_RATE / SOUND_MIXER_BLOCK_FRAMES * SOUND_MIXER_BLOCK_BYTES);
+    munit_assert_uint32(header[1], ==, header[10] + 36);
+    return MUNIT_OK;
+}
+
+// A block is 11.6ms of audio; this is how much of that mixing it takes with every voice busy.
+static MunitResult test_sound_mixer_bench(const MunitParameter params[], void *user_data)
+{
+    const char *pathNames[] = {"scalar", "sse2"};
+    SoundMixer *mixer;
+    clock_t start;
+    f64 seconds;
+    i32 path;
+    i32 block;
+    i32 voice;
+
+    FillMixerTestPcm();
+    for (path = 0; path < 2; path++)
+    {
+        if (path == 1 && !(utils::GetCpuFeatures() & CPU_FEATURE_SSE2))
+        {
+            continue;
+        }
+        mixer = path == 0 ? &g_MixerTestScalar : &g_MixerTestSse2;
+        StartMixerTest(mixer, path == 1);
+        start = clock();
+        for (block = 0; block < MIXER_TEST_BENCH_BLOCKS; block++)
+        {
+            if (block % 2 == 0)
+            {
+                for (voice = 0; voice < SOUND_MIXER_MAX_VOICES; voice++)
+                {
+                    mixer->Play(voice, voice % 4, voice % 3 == 0 ? SOUND_MIXER_UNITY_GAIN : 0x3000);
+                }
+            }
+            mixer->MixBlock(g_MixerTestOut);
+        }
+        seconds = (f64)(clock() - start) / CLOCKS_PER_SEC;
+        munit_logf(MUNIT_LOG_INFO, "%s: %.2f us per block of %d voices", pathNames[path],
+                   seconds * 1000000.0 / MIXER_TEST_BENCH_BLOCKS, SOUND_MIXER_MAX_VOICES);
+        mixer->Stop();
+    }
+    return MUNIT_OK;
+}
+
+static MunitTest soundmixer_test_suite_tests[] = {
+    {"/mix", test_sound_mixer_mix, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/voices", test_sound_mixer_voices, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/stream", test_sound_mixer_stream, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/wav_sink", test_sound_mixer_wav_sink, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bench", test_sound_mixer_bench, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
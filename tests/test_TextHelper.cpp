@@ -0,0 +1,189 @@
+#include <string.h>
+#include <time.h>
+
+#include "TextHelper.hpp"
+#include "utils.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#ifdef TEXT_GLYPH_ATLAS
+#define TEXT_TEST_BENCH_STRINGS 200
+
+struct TextTestString
+{
+    i32 xPos;
+    i32 spriteWidth;
+    i32 fontHeight;
+    ZunColor textColor;
+    ZunColor shadowColor;
+    const char *string;
+};
+
+// Spellcard name, dialogue and menu text, in the colors Gui uses for them.
+static TextTestString g_TextTestStrings[] = {
+    {0, 256, 15, 0xfff0f0, 0x000000, "\x95\x84\x95\x84\x81\x75\x83\x65\x83\x58\x83\x67\x81\x76"},
+    {0, 256, 15, 0xf0f0ff, 0x000000, "Sign \"Test Spell\""},
+    {8, 256, 15, 0xe0e0ff, 0x000000, "\x82\xa0\x82\xa2\x82\xa4 The quick fox, 123!"},
+    {0, 128, 14, 0xffff80, COLOR_WHITE, "Stage 1"},
+    {4, 256, 16, 0x80ffff, 0x000000, "\x82\xa0 a \x82\xa2 b \x82\xa4 c \x82\xa6 d \x82\xa8 e \x82\xa9 f \x82\xab"},
+};
+
+// The atlas is not bit-exact with GDI's antialiasing, so a handful of edge pixels may differ by a few steps. Anything
+// placed or blended wrong is far more than that.
+static void CompareTextTestBuffers(TextHelper *gdi, TextHelper *composed)
+{
+    u16 *gdiPixels;
+    u16 *composedPixels;
+    i32 opaque;
+    i32 alphaMismatches;
+    i32 channelMismatches;
+    i32 maxChannelDiff;
+    i32 diff;
+    i32 shift;
+    i32 idx;
+
+    gdiPixels = (u16 *)gdi->buffer;
+    composedPixels = (u16 *)composed->buffer;
+    opaque = 0;
+    alphaMismatches = 0;
+    channelMismatches = 0;
+    maxChannelDiff = 0;
+    for (idx = 0; idx < gdi->width * gdi->height; idx++)
+    {
+        if (gdiPixels[idx] >> 15)
+        {
+            opaque++;
+        }
+        if ((gdiPixels[idx] ^ composedPixels[idx]) >> 15)
+        {
+            alphaMismatches++;
+            continue;
+        }
+        if (!(gdiPixels[idx] >> 15))
+        {
+            continue;
+        }
+        for (shift = 0; shift < 15; shift += 5)
+        {
+            diff = (gdiPixels[idx] >> shift & 0x1f) - (composedPixels[idx] >> shift & 0x1f);
+            diff = diff < 0 ? -diff : diff;
+            maxChannelDiff = diff > maxChannelDiff ? diff : maxChannelDiff;
+            if (diff > 1)
+            {
+                channelMismatches++;
+            }
+        }
+    }
+    munit_assert_int(opaque, >, 0);
+    munit_assert_int(alphaMismatches, <=, opaque / 50);
+    munit_assert_int(channelMismatches, <=, opaque / 50);
+    munit_assert_int(maxChannelDiff, <=, 4);
+}
+
+static MunitResult test_text_helper_glyph_cache(const MunitParameter params[], void *user_data)
+{
+    TextHelper gdi;
+    TextHelper composed;
+    TextTestString *test;
+    i32 misses;
+    i32 idx;
+
+    munit_assert_true(gdi.AllocateBufferWithFallback(640, 64, D3DFMT_A1R5G5B5));
+    munit_assert_true(composed.AllocateBufferWithFallback(640, 64, D3DFMT_A1R5G5B5));
+    munit_assert_int(gdi.format, ==, D3DFMT_A1R5G5B5);
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_TextTestStrings); idx++)
+    {
+        test = &g_TextTestStrings[idx];
+        TextHelper::RenderTextWithGdi(&gdi, test->xPos, test->spriteWidth, test->fontHeight, test->textColor,
+                                      test->shadowColor, (char *)test->string);
+        munit_assert_true(TextHelper::ComposeText(&composed, test->xPos, test->spriteWidth, test->fontHeight,
+                                                  test->textColor, test->shadowColor, (char *)test->string));
+        CompareTextTestBuffers(&gdi, &composed);
+    }
+
+    // Every glyph is in the cache now, so the same strings again rasterize nothing.
+    misses = g_TextGlyphCache.misses;
+    for (idx = 0; idx < ARRAY_SIZE_SIGNED(g_TextTestStrings); idx++)
+    {
+        test = &g_TextTestStrings[idx];
+        TextHelper::ComposeText(&composed, test->xPos, test->spriteWidth, test->fontHeight, test->textColor,
+                                test->shadowColor, (char *)test->string);
+    }
+    munit_assert_int(g_TextGlyphCache.misses, ==, misses);
+    munit_assert_int(g_TextGlyphCache.hits, >, 0);
+
+    g_TextGlyphCache.Release();
+    return MUNIT_OK;
+}
+
+// A table or atlas that fills up is dropped and refilled, without the output changing.
+static MunitResult test_text_helper_glyph_cache_flush(const MunitParameter params[], void *user_data)
+{
+    TextHelper before;
+    TextHelper after;
+    char string[3];
+    i32 code;
+
+    munit_assert_true(before.AllocateBufferWithFallback(640, 64, D3DFMT_A1R5G5B5));
+    munit_assert_true(after.AllocateBufferWithFallback(640, 64, D3DFMT_A1R5G5B5));
+    TextHelper::ComposeText(&before, 0, 256, 15, 0xffffff, 0x000000, (char *)g_TextTestStrings[2].string);
+
+    // Two Shift-JIS rows at every size the font table holds add up to more than the atlas and table take.
+    string[2] = '\0';
+    for (code = 0; code < TEXT_GLYPH_CACHE_SIZE * 2; code++)
+    {
+        string[0] = (char)(0x82 + (code & 1));
+        string[1] = (char)(0x40 + (code >> 1) % 0xbc);
+        TextHelper::ComposeText(&after, 0, 256, 10 + (code / 0x178) % TEXT_GLYPH_MAX_FONTS, 0xffffff, 0x000000,
+                                string);
+        munit_assert_int(g_TextGlyphCache.glyphCount, <, TEXT_GLYPH_CACHE_SIZE);
+    }
+    TextHelper::ComposeText(&after, 0, 256, 15, 0xffffff, 0x000000, (char *)g_TextTestStrings[2].string);
+    munit_assert_memory_equal(before.imageSizeInBytes, before.buffer, after.buffer);
+
+    g_TextGlyphCache.Release();
+    return MUNIT_OK;
+}
+
+static MunitResult test_text_helper_bench(const MunitParameter params[], void *user_data)
+{
+    TextHelper helper;
+    TextTestString *test;
+    clock_t start;
+    f64 gdiMs;
+    f64 composedMs;
+    i32 idx;
+
+    munit_assert_true(helper.AllocateBufferWithFallback(640, 64, D3DFMT_A1R5G5B5));
+    start = clock();
+    for (idx = 0; idx < TEXT_TEST_BENCH_STRINGS; idx++)
+    {
+        test = &g_TextTestStrings[idx % ARRAY_SIZE_SIGNED(g_TextTestStrings)];
+        TextHelper::RenderTextWithGdi(&helper, test->xPos, test->spriteWidth, test->fontHeight, test->textColor,
+                                      test->shadowColor, (char *)test->string);
+    }
+    gdiMs = (f64)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / TEXT_TEST_BENCH_STRINGS;
+    start = clock();
+    for (idx = 0; idx < TEXT_TEST_BENCH_STRINGS; idx++)
+    {
+        test = &g_TextTestStrings[idx % ARRAY_SIZE_SIGNED(g_TextTestStrings)];
+        TextHelper::ComposeText(&helper, test->xPos, test->spriteWidth, test->fontHeight, test->textColor,
+                                test->shadowColor, (char *)test->string);
+    }
+    composedMs = (f64)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / TEXT_TEST_BENCH_STRINGS;
+    munit_logf(MUNIT_LOG_INFO, "gdi: %.4f ms/string, glyph cache: %.4f ms/string", gdiMs, composedMs);
+
+    g_TextGlyphCache.Release();
+    return MUNIT_OK;
+}
+
+#endif
+
+static MunitTest texthelper_test_suite_tests[] = {
+#ifdef TEXT_GLYPH_ATLAS
+    {"/glyph_cache", test_text_helper_glyph_cache, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/glyph_cache_flush", test_text_helper_glyph_cache_flush, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bench", test_text_helper_bench, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AssetTrace.hpp"
+#include "FileSystem.hpp"
+#include "ZunMemory.hpp"
+#include <munit.h>
+
+using namespace th06;
+
+#define ARENA_TEST_FILE "zunmemory_test.bin"
+#define TRACKER_TEST_LOG "zunmemory_test.log"
+#define TRACKER_TEST_ALLOCS 0x800
+
+static ZunMemoryTracker g_TrackerTest;
+static void *g_TrackerTestPtrs[TRACKER_TEST_ALLOCS];
+
+static MunitResult test_arena_alloc(const MunitParameter params[], void *user_data)
+{
+    ZunArena arena;
+    u8 *first;
+    u8 *second;
+    u8 *heap;
+
+    memset(&arena, 0, sizeof(arena));
+    first = (u8 *)arena.Alloc(3);
+    second = (u8 *)arena.Alloc(40);
+    munit_assert_not_null(first);
+    munit_assert_ptr_equal(second, first + ZUN_ARENA_ALIGN);
+    munit_assert_uint32((u32)second % ZUN_ARENA_ALIGN, ==, 0);
+    munit_assert_uint32(arena.usedBytes, ==, ZUN_ARENA_ALIGN * 4);
+    munit_assert_uint32(arena.numAllocs, ==, 2);
+    munit_assert_uint32(arena.reservedBytes, ==, ZUN_ARENA_BLOCK_SIZE);
+
+    heap = (u8 *)malloc(16);
+    munit_assert_true(arena.Owns(second + 39));
+    munit_assert_false(arena.Owns(heap));
+    free(heap);
+
+    // Reset hands the same memory out again.
+    arena.Reset();
+    munit_assert_uint32(arena.usedBytes, ==, 0);
+    munit_assert_uint32(arena.peakBytes, ==, ZUN_ARENA_ALIGN * 4);
+    munit_assert_ptr_equal(arena.Alloc(8), first);
+
+    arena.Release();
+    munit_assert_null(arena.blocks);
+    return MUNIT_OK;
+}
+
+// Whatever doesn't fit takes another block. The reset keeps them all, so the next round fits in them again, and what
+// was handed out before the reset is still the arena's.
+static MunitResult test_arena_grow(const MunitParameter params[], void *user_data)
+{
+    ZunArena arena;
+    u8 *small;
+    u8 *big;
+
+    memset(&arena, 0, sizeof(arena));
+    small = (u8 *)arena.Alloc(ZUN_ARENA_BLOCK_SIZE - 32);
+    big = (u8 *)arena.Alloc(ZUN_ARENA_BLOCK_SIZE * 2);
+    munit_assert_not_null(big);
+    big[ZUN_ARENA_BLOCK_SIZE * 2 - 1] = 1;
+    munit_assert_not_null(arena.blocks->next);
+    munit_assert_uint32(arena.reservedBytes, ==, ZUN_ARENA_BLOCK_SIZE * 3);
+    munit_assert_uint32(arena.peakBytes, ==, ZUN_ARENA_BLOCK_SIZE * 3 - 32);
+
+    arena.Reset();
+    munit_assert_uint32(arena.numResets, ==, 1);
+    munit_assert_true(arena.Owns(small));
+    munit_assert_true(arena.Owns(big));
+    munit_assert_ptr_equal(arena.Alloc(ZUN_ARENA_BLOCK_SIZE * 2), big);
+    munit_assert_ptr_equal(arena.Alloc(ZUN_ARENA_BLOCK_SIZE - 32), small);
+    munit_assert_uint32(arena.reservedBytes, ==, ZUN_ARENA_BLOCK_SIZE * 3);
+
+    arena.Release();
+    return MUNIT_OK;
+}
+
+#ifdef ZUN_ARENAS
+static MunitResult test_arena_open_path(const MunitParameter params[], void *user_data)
+{
+    char contents[100];
+    u8 *data;
+    u32 usedBytes;
+
+    memset(contents, 'z', sizeof(contents));
+    munit_assert_int(FileSystem::WriteDataToFile(ARENA_TEST_FILE, contents, sizeof(contents)), ==, 0);
+
+    usedBytes = g_ZunArenas[ZUN_ARENA_STAGE].usedBytes;
+    data = FileSystem::OpenPath(ARENA_TEST_FILE, 1, ZUN_ARENA_STAGE);
+    munit_assert_not_null(data);
+    munit_assert_uint32(g_LastFileSize, ==, sizeof(contents));
+    munit_assert_memory_equal(sizeof(contents), data, contents);
+    munit_assert_true(g_ZunArenas[ZUN_ARENA_STAGE].Owns(data));
+    munit_assert_uint32(g_ZunArenas[ZUN_ARENA_STAGE].usedBytes, >, usedBytes);
+
+    // Left for the reset.
+    ZunFree(data, ZUN_ARENA_STAGE);
+    munit_assert_memory_equal(sizeof(contents), data, contents);
+    g_ZunArenas[ZUN_ARENA_STAGE].Reset();
+    munit_assert_uint32(g_ZunArenas[ZUN_ARENA_STAGE].usedBytes, ==, 0);
+
+    // And what the heap handed out goes back to the heap.
+    ZunFree(malloc(16), ZUN_ARENA_STAGE);
+
+    remove(ARENA_TEST_FILE);
+    return MUNIT_OK;
+}
+#endif
+
+// Enough allocations that the hash table probes past collisions, freed in a shuffled order so removals have to pull
+// later records back.
+static MunitResult test_tracker_records(const MunitParameter params[], void *user_data)
+{
+    void *swap;
+    u32 liveBytes;
+    i32 tag;
+    i32 other;
+    i32 idx;
+
+    memset(&g_TrackerTest, 0, sizeof(g_TrackerTest));
+    liveBytes = 0;
+    for (idx = 0; idx < TRACKER_TEST_ALLOCS; idx++)
+    {
+        g_TrackerTestPtrs[idx] = g_TrackerTest.Alloc(idx + 1, idx % 3 == 0 ? ".anm" : "replay");
+        liveBytes += idx + 1;
+    }
+    munit_assert_int32(g_TrackerTest.numRecords, ==, TRACKER_TEST_ALLOCS);
+    munit_assert_int32(g_TrackerTest.numTags, ==, 2);
+    munit_assert_uint32(g_TrackerTest.liveBytes, ==, liveBytes);
+    tag = g_TrackerTest.FindTag(".anm");
+    munit_assert_uint32(g_TrackerTest.tags[tag].numLive, ==, (TRACKER_TEST_ALLOCS + 2) / 3);
+
+    for (idx = TRACKER_TEST_ALLOCS - 1; idx > 0; idx--)
+    {
+        other = munit_rand_int_range(0, idx);
+        swap = g_TrackerTestPtrs[idx];
+        g_TrackerTestPtrs[idx] = g_TrackerTestPtrs[other];
+        g_TrackerTestPtrs[other] = swap;
+    }
+    for (idx = 0; idx < TRACKER_TEST_ALLOCS / 2; idx++)
+    {
+        g_TrackerTest.Free(g_TrackerTestPtrs[idx]);
+    }
+    munit_assert_int32(g_TrackerTest.numRecords, ==, TRACKER_TEST_ALLOCS / 2);
+    for (idx = 0; idx < TRACKER_TEST_ALLOCS; idx++)
+    {
+        if (idx < TRACKER_TEST_ALLOCS / 2)
+        {
+            munit_assert_null(g_TrackerTest.FindRecord(g_TrackerTestPtrs[idx]));
+        }
+        else
+        {
+            munit_assert_not_null(g_TrackerTest.FindRecord(g_TrackerTestPtrs[idx]));
+        }
+    }
+    for (; idx > TRACKER_TEST_ALLOCS / 2; idx--)
+    {
+        g_TrackerTest.Free(g_TrackerTestPtrs[idx - 1]);
+    }
+    munit_assert_int32(g_TrackerTest.numRecords, ==, 0);
+    munit_assert_uint32(g_TrackerTest.liveBytes, ==, 0);
+    munit_assert_uint32(g_TrackerTest.peakBytes, ==, liveBytes);
+    munit_assert_uint32(g_TrackerTest.tags[tag].liveBytes, ==, 0);
+    munit_assert_uint32(g_TrackerTest.numUnknownFrees, ==, 0);
+    return MUNIT_OK;
+}
+
+static MunitResult test_tracker_report(const MunitParameter params[], void *user_data)
+{
+    char line[256];
+    FILE *file;
+    void *boot;
+    void *kept;
+    void *freed;
+    ZunBool sawLeft;
+
+    // Nothing boot loads counts as left behind.
+    memset(&g_TrackerTest, 0, sizeof(g_TrackerTest));
+    g_TrackerTest.scene = ASSET_SCENE_BOOT;
+    boot = g_TrackerTest.Alloc(64, "text atlas");
+    g_TrackerTest.scene = ASSET_SCENE_TITLE;
+    kept = g_TrackerTest.Alloc(100, ".anm");
+    freed = g_TrackerTest.Alloc(50, ".anm");
+    g_TrackerTest.Free(freed);
+    g_TrackerTest.scene = ASSET_SCENE_STAGE1;
+    munit_assert_uint32(g_TrackerTest.numUnknownFrees, ==, 0);
+
+    remove(TRACKER_TEST_LOG);
+    munit_assert_int32(g_TrackerTest.WriteReport(TRACKER_TEST_LOG, "title -> stage1"), ==, ZUN_SUCCESS);
+    file = fopen(TRACKER_TEST_LOG, "r");
+    munit_assert_not_null(file);
+    munit_assert_not_null(fgets(line, sizeof(line), file));
+    munit_assert_memory_equal(18, line, "== title -> stage1");
+    sawLeft = false;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strcmp(line, "still live from title: 1 allocations, .anm 100\n") == 0)
+        {
+            sawLeft = true;
+        }
+    }
+    fclose(file);
+    munit_assert_true(sawLeft);
+    // The counts since the last report start over.
+    munit_assert_uint32(g_TrackerTest.tags[g_TrackerTest.FindTag(".anm")].numAllocs, ==, 0);
+
+    g_TrackerTest.Free(kept);
+    g_TrackerTest.Free(boot);
+    remove(TRACKER_TEST_LOG);
+    return MUNIT_OK;
+}
+
+static MunitTest zunmemory_test_suite_tests[] = {
+    {"/alloc", test_arena_alloc, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/grow", test_arena_grow, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#ifdef ZUN_ARENAS
+    {"/open_path", test_arena_open_path, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+#endif
+    {"/tracker_records", test_tracker_records, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/tracker_report", test_tracker_report, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
@@ -1,9 +1,45 @@
 #include "munit.h"
 
+#include "test_AnmManager.cpp"
+#include "test_AssetTrace.cpp"
+#include "test_BgmStream.cpp"
+#include "test_ChainProfiler.cpp"
+#include "test_D3dStateCache.cpp"
+#include "test_EclManager.cpp"
+#include "test_FixedStep.cpp"
+#include "test_MidiTimeline.cpp"
 #include "test_Pbg3Archive.cpp"
+#include "test_PcmAsset.cpp"
+#include "test_PerfStats.cpp"
+#include "test_PipelinedD3dDevice.cpp"
+#include "test_PixelKernels.cpp"
+#include "test_PlayerBulletGrid.cpp"
+#include "test_RecordingD3dDevice.cpp"
+#include "test_SoftwareD3dDevice.cpp"
+#include "test_SoundMixer.cpp"
+#include "test_TextHelper.cpp"
+#include "test_ZunMemory.cpp"
 
 static MunitSuite root_test_suites[] = {
+    {"/AnmManager", anmmanager_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/AssetTrace", assettrace_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/BgmStream", bgmstream_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/ChainProfiler", chainprofiler_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/D3dStateCache", d3dstatecache_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/EclManager", eclmanager_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/FixedStep", fixedstep_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/MidiTimeline", miditimeline_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
     {"/Pbg3Archives", pbg3archives_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/PcmAsset", pcmasset_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/PerfStats", perfstats_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/PipelinedD3dDevice", pipelinedd3ddevice_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/PixelKernels", pixelkernels_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/PlayerBulletGrid", playerbulletgrid_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/RecordingD3dDevice", recordingd3ddevice_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/SoftwareD3dDevice", softwared3ddevice_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/SoundMixer", soundmixer_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/TextHelper", texthelper_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/ZunMemory", zunmemory_test_suite_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
     {NULL, NULL, NULL, 0, MUNIT_SUITE_OPTION_NONE}};
 static const MunitSuite test_suite = {"", NULL, root_test_suites, 1, MUNIT_SUITE_OPTION_NONE};
 